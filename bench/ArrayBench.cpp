@@ -0,0 +1,95 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/ForkableGlobals.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+#include <random>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(array) {
+  const std::size_t elements = 1000000u;
+  std::mt19937 random(5u);
+  std::uniform_real_distribution<double> numbers(-100.0, 100.0);
+  SmallVector<double, 0> x(elements), y(elements);
+  for (std::size_t i = 0u; i < elements; ++i) {
+    x[i] = numbers(random);
+    y[i] = numbers(random);
+  }
+
+  struct Case {
+    /// Evaluated once per element, on numbers `x`, `y` and `acc`.
+    const char *PerElement;
+    /// Evaluated once, on arrays `x` and `y`.
+    const char *Bulk;
+  };
+  const Case cases[] = {{"acc = acc + x", "sum(x)"},
+                        {"x * 2.5 + y", "x * 2.5 + y"},
+                        {"acc = acc + x * y", "dot(x, y)"}};
+
+  SourceMgr srcMgr;
+  std::vector<uptr<Lexer>> lexers;
+  const auto parse = [&](const StringRef code) -> uptr<Expr> {
+    const auto id = srcMgr.AddNewSourceBuffer(
+        MemoryBuffer::getMemBufferCopy(code, "expr"), {});
+    lexers.push_back(
+        mkuptr<Lexer>(srcMgr, srcMgr.getMemoryBuffer(id)->getBuffer()));
+    if (!lexers.back()->Lex())
+      return nullptr;
+    Parser parser(lexers.back()->getTokens(), srcMgr);
+    return parser.Expression();
+  };
+
+  for (const auto &[perElementCode, bulkCode] : cases) {
+    const auto perElement = parse(perElementCode);
+    const auto bulk = parse(bulkCode);
+    if (!perElement || !bulk)
+      return;
+
+    // Baseline: the interpreter once per element, on boxed numbers.
+    LoxValueEnv env;
+    ForkableGlobals globals;
+    ExprInterpreter interpreter(srcMgr, env);
+    interpreter.setForkableGlobals(&globals);
+    const auto scalar = measure(
+        [&] {
+          globals.define("acc", mksptr<NumberValue>(0.0L));
+          for (std::size_t i = 0u; i < elements; ++i) {
+            globals.define("x", mksptr<NumberValue>(x[i]));
+            globals.define("y", mksptr<NumberValue>(y[i]));
+            std::visit(interpreter, *perElement);
+          }
+        },
+        1u);
+
+    globals.define("x", mksptr<ArrayValue>(x));
+    globals.define("y", mksptr<ArrayValue>(y));
+    const auto array = measure([&] { std::visit(interpreter, *bulk); });
+
+    outs() << formatv("array: {0} vs {1}\n", perElementCode, bulkCode);
+    report("array", "per-element script", scalar, elements, "element");
+    report("array", "array builtin", array, elements, "element");
+    outs() << formatv("array: {0:f0}x faster\n", scalar / array);
+  }
+
+  // Sorting has no per-element script; against sorting a copy directly.
+  LoxValueEnv env;
+  ForkableGlobals globals;
+  ExprInterpreter interpreter(srcMgr, env);
+  interpreter.setForkableGlobals(&globals);
+  globals.define("x", mksptr<ArrayValue>(x));
+  const auto sortExpr = parse("sort(x)");
+  if (!sortExpr)
+    return;
+  const auto sorted = measure([&] { std::visit(interpreter, *sortExpr); });
+  const auto direct = measure([&] {
+    auto copy = x;
+    std::sort(copy.begin(), copy.end());
+  });
+  report("array", "sort builtin", sorted, elements, "element");
+  report("array", "std::sort of a copy", direct, elements, "element");
+}
+
+} // namespace lox::bench
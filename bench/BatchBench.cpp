@@ -0,0 +1,48 @@
+#include "BenchUtils.hpp"
+#include "lox/driver/BatchDriver.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include <thread>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(batch) {
+  const auto fileCount = 4000u;
+  SmallString<128> dir;
+  if (sys::fs::createUniqueDirectory("lox-batch-bench", dir))
+    return;
+
+  SmallVector<std::string> files;
+  for (auto i = 0u; i < fileCount; ++i) {
+    SmallString<128> path(dir);
+    sys::path::append(path, formatv("s{0}.lox", i).str());
+    std::error_code ec;
+    raw_fd_ostream os(path, ec);
+    os << makeScript(40u + i % 40u);
+    files.push_back(path.str().str());
+  }
+
+  raw_null_ostream os;
+  const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (const auto syntaxOnly : {true, false}) {
+    double single = 0.0;
+    for (auto threads = 1u; threads <= hardware; threads *= 2u) {
+      BatchOptions options;
+      options.Threads = threads;
+      options.SyntaxOnly = syntaxOnly;
+      const auto seconds =
+          measure([&] { runBatch(files, options, os, os); });
+      if (threads == 1u)
+        single = seconds;
+      report(syntaxOnly ? "batch syntax-only" : "batch run",
+             formatv("{0} threads", threads).str(), seconds, fileCount,
+             "file");
+      outs() << formatv("batch scaling with {0} threads: {1:f2}x\n", threads,
+                        single / seconds);
+    }
+  }
+
+  sys::fs::remove_directories(dir);
+}
+
+} // namespace lox::bench
@@ -0,0 +1,14 @@
+#include "BenchUtils.hpp"
+
+/// Usage: LoxBench [name-filter...]
+int main(int argc, char **argv) {
+  using namespace lox::bench;
+  for (const auto &benchmark : getBenchmarks()) {
+    auto selected = argc == 1;
+    for (auto i = 1; i < argc; ++i)
+      selected |= StringRef(benchmark.Name).contains(argv[i]);
+    if (selected)
+      benchmark.Run();
+  }
+  return 0;
+}
@@ -0,0 +1,84 @@
+#ifndef __BENCH_UTILS_HPP__
+#define __BENCH_UTILS_HPP__
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace lox::bench {
+using namespace llvm;
+
+struct Benchmark {
+  const char *Name;
+  void (*Run)();
+};
+
+inline std::vector<Benchmark> &getBenchmarks() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+struct BenchmarkRegistration {
+  BenchmarkRegistration(const char *name, void (*run)()) {
+    getBenchmarks().push_back({name, run});
+  }
+};
+
+#define LOX_BENCHMARK(name)                                                    \
+  static void bench_##name();                                                  \
+  static ::lox::bench::BenchmarkRegistration registration_##name(              \
+      #name, bench_##name);                                                    \
+  static void bench_##name()
+
+/// Wall-clock seconds of the fastest of `repeat` runs of `fn`.
+template <typename Fn>
+double measure(Fn &&fn, const unsigned repeat = 3u) {
+  auto best = 1e300;
+  for (auto i = 0u; i < repeat; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+inline void report(const StringRef name, const StringRef variant,
+                   const double seconds, const double items,
+                   const StringRef unit) {
+  outs() << formatv("{0,-28} {1,-22} {2,10:f3} ms {3,14:f0} {4}/s\n", name,
+                    variant, seconds * 1e3, items / seconds, unit);
+}
+
+/// `statements` independent top-level statements: declarations, arithmetic
+/// assignments and prints, in a fixed rotation.
+inline std::string makeScript(const std::size_t statements) {
+  std::string script;
+  script.reserve(statements * 24u);
+  for (std::size_t i = 0u; i < statements; ++i) {
+    switch (i % 4u) {
+    case 0u:
+      script += formatv("var v{0} = {0} * 2 + 1;\n", i).str();
+      break;
+    case 1u:
+      script += formatv("v{0} = v{0} - 3 / 4;\n", i - 1u).str();
+      break;
+    case 2u:
+      script += formatv("print v{0} + 0.5;\n", i - 2u).str();
+      break;
+    default:
+      script += "print \"row \" + \"done\";\n";
+      break;
+    }
+  }
+  return script;
+}
+
+} // namespace lox::bench
+
+#endif // __BENCH_UTILS_HPP__
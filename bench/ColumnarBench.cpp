@@ -0,0 +1,67 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Columnar.hpp"
+#include "lox/interpreter/ForkableGlobals.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+#include <random>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(columnar) {
+  const std::size_t rows = 1000000u;
+  std::mt19937 random(11u);
+  std::uniform_real_distribution<double> numbers(-100.0, 100.0);
+  SmallVector<double, 0> x(rows), y(rows);
+  SmallVector<bool, 0> flag(rows);
+  for (std::size_t i = 0u; i < rows; ++i) {
+    x[i] = numbers(random);
+    y[i] = numbers(random);
+    flag[i] = random() % 2u;
+  }
+  ColumnBatch batch(rows);
+  batch.addNumbers("x", x);
+  batch.addNumbers("y", y);
+  batch.addBools("flag", flag);
+
+  for (const auto *formula : {"x * 2.5 + y * y - 3 / x",
+                              "(x * 2.5 + y) / (x - y * 0.5) > 1 == !flag"}) {
+    SourceMgr srcMgr;
+    const auto id = srcMgr.AddNewSourceBuffer(
+        MemoryBuffer::getMemBufferCopy(formula, "formula"), {});
+    Lexer lexer(srcMgr, srcMgr.getMemoryBuffer(id)->getBuffer());
+    if (!lexer.Lex())
+      return;
+    Parser parser(lexer.getTokens(), srcMgr);
+    const auto expr = parser.Expression();
+    const auto compiled = ColumnarExpr::compile(*expr, batch, srcMgr);
+    if (!compiled)
+      return;
+
+    // Baseline: the interpreter once per row.
+    LoxValueEnv env;
+    ForkableGlobals globals;
+    ExprInterpreter interpreter(srcMgr, env);
+    interpreter.setForkableGlobals(&globals);
+    const auto perRow = measure(
+        [&] {
+          for (std::size_t i = 0u; i < rows; ++i) {
+            globals.define("x", mksptr<NumberValue>(x[i]));
+            globals.define("y", mksptr<NumberValue>(y[i]));
+            globals.define("flag", mksptr<BoolValue>(flag[i]));
+            std::visit(interpreter, *expr);
+          }
+        },
+        1u);
+
+    const auto columnar = measure([&] { (void)compiled->evaluate(batch); });
+
+    outs() << formatv("columnar: {0}\n", formula);
+    report("columnar", "per-row interpreter", perRow, rows, "row");
+    report("columnar", "columnar", columnar, rows, "row");
+    outs() << formatv("columnar: {0:f0}x faster\n", perRow / columnar);
+  }
+}
+
+} // namespace lox::bench
@@ -0,0 +1,50 @@
+#include "BenchUtils.hpp"
+#include "lox/parser/Diagnostics.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace lox::bench {
+
+LOX_BENCHMARK(diagnostics) {
+  // A file of garbage: every token is an error.
+  const auto errors = 1000000u;
+  std::string code;
+  for (auto i = 0u; i < errors; ++i)
+    code += i % 16u ? "$ " : "$\n";
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "garbage"), {});
+  std::error_code ec;
+  raw_fd_ostream os("/dev/null", ec);
+  if (ec)
+    return;
+
+  const auto run = [&](const DiagnosticOptions &options) {
+    return measure(
+        [&] {
+          DiagnosticEngine engine(srcMgr, os, options);
+          Lexer lexer(srcMgr, code);
+          lexer.setDiagnosticEngine(engine);
+          lexer.Lex();
+          if (options.Deferred)
+            engine.printJSON(os);
+          else
+            engine.flush();
+          os.flush();
+        },
+        1u);
+  };
+
+  // Baseline: every error printed as it is reported.
+  const auto unlimited = run(DiagnosticOptions());
+  DiagnosticOptions capped;
+  capped.MaxPerCategory = 100u;
+  const auto limited = run(capped);
+  capped.Deferred = true;
+  const auto json = run(capped);
+
+  report("diagnostics", "unlimited", unlimited, errors, "error");
+  report("diagnostics", "limit 100", limited, errors, "error");
+  report("diagnostics", "limit 100, JSON", json, errors, "error");
+}
+
+} // namespace lox::bench
@@ -0,0 +1,68 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace lox::bench {
+
+LOX_BENCHMARK(expr_depth) {
+  // Typical scripts: how fast the parser gets through their tokens.
+  const auto statements = 500000u;
+  const auto code = makeScript(statements);
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "bench"), {});
+  Lexer lexer(srcMgr, code);
+  lexer.Lex();
+  const auto tokens = lexer.getTokens().size();
+  const auto parse = measure([&] {
+    Parser parser(lexer.getTokens(), srcMgr);
+    parser.Parse();
+  });
+
+  // A generated expression as deep as the parser accepts, evaluated over
+  // and over.
+  std::string chain = "1";
+  for (auto i = 2u; i < Parser::DefaultMaxDepth; ++i)
+    chain += " + 1";
+  SourceMgr chainMgr;
+  chainMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(chain, "chain"), {});
+  Lexer chainLexer(chainMgr, chain);
+  chainLexer.Lex();
+  Parser chainParser(chainLexer.getTokens(), chainMgr);
+  const auto expr = chainParser.Expression();
+  if (!expr)
+    return;
+  const auto evaluations = 2000u;
+  const auto nodes = 2u * (Parser::DefaultMaxDepth - 1u) - 1u;
+  LoxValueEnv env;
+  ExprInterpreter interpreter(chainMgr, env);
+  const auto evaluate = measure([&] {
+    for (auto i = 0u; i < evaluations; ++i)
+      (void)interpreter.evaluate(*expr);
+  });
+
+  // Adversarial input, which used to overflow the stack.
+  const auto depth = 1000000u;
+  std::string nested(depth, '(');
+  nested += "1";
+  nested.append(depth, ')');
+  nested += ";";
+  SourceMgr nestedMgr;
+  nestedMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(nested, "nested"),
+                               {});
+  Lexer nestedLexer(nestedMgr, nested);
+  nestedLexer.Lex();
+  const auto reject = measure([&] {
+    Parser parser(nestedLexer.getTokens(), nestedMgr);
+    parser.setDiagnosticStream(nulls());
+    parser.Parse();
+  });
+
+  report("expr_depth", "parse", parse, tokens, "tok");
+  report("expr_depth", "evaluate, depth 5000", evaluate,
+         static_cast<double>(evaluations) * nodes, "node");
+  report("expr_depth", "reject, depth 1M", reject, depth, "level");
+}
+
+} // namespace lox::bench
@@ -0,0 +1,72 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Isolate.hpp"
+
+namespace lox::bench {
+
+LOX_BENCHMARK(fork) {
+  const auto baseGlobals = 100000u;
+  const auto scenarios = 2000u;
+  const auto rerunScenarios = 20u;
+
+  std::string baseCode;
+  for (auto i = 0u; i < baseGlobals; ++i)
+    baseCode += formatv("var g{0} = {0} * 1.5 + 2;\n", i).str();
+  const auto base = CompiledScript::compile("base", baseCode);
+  const auto scenario = CompiledScript::compile("scenario", R"(
+g1 = g1 * 2;
+g42 = g42 + g1;
+var delta = g42 - g7;
+print delta;
+)");
+  if (!base || !scenario)
+    return;
+
+  // Baseline: every scenario starts by re-running the base.
+  const auto rerun = measure(
+      [&] {
+        for (auto i = 0u; i < rerunScenarios; ++i) {
+          raw_null_ostream os;
+          Isolate isolate;
+          isolate.setOutputStream(os);
+          isolate.run(base);
+          isolate.run(scenario);
+        }
+      },
+      1u);
+
+  Isolate parent;
+  parent.run(base);
+  std::size_t overlay = 0u;
+  const auto forked = measure([&] {
+    overlay = 0u;
+    for (auto i = 0u; i < scenarios; ++i) {
+      raw_null_ostream os;
+      const auto child = parent.fork();
+      child->setOutputStream(os);
+      child->run(scenario);
+      overlay += child->getInterpreter()
+                     .ExprEvaluator.getForkableGlobals()
+                     ->getOverlaySize();
+    }
+  });
+
+  // Thousands of forks alive at once.
+  std::vector<uptr<Isolate>> alive;
+  const auto forkOnly = measure(
+      [&] {
+        alive.clear();
+        for (auto i = 0u; i < scenarios; ++i)
+          alive.push_back(parent.fork());
+      },
+      1u);
+
+  report("fork", "rerun base", rerun, rerunScenarios, "scenario");
+  report("fork", "fork + run", forked, scenarios, "scenario");
+  report("fork", "fork only", forkOnly, scenarios, "fork");
+  outs() << formatv("fork: {0} base globals, {1:f1} bindings copied per "
+                    "scenario, {2:f0}x faster than re-running the base\n",
+                    baseGlobals, double(overlay) / scenarios,
+                    (rerun / rerunScenarios) / (forked / scenarios));
+}
+
+} // namespace lox::bench
@@ -0,0 +1,62 @@
+#include "BenchUtils.hpp"
+#include "lox/parser/IncrementalParser.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include <random>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(incremental_parse) {
+  const auto lines = 50000u;
+  const auto code = makeScript(lines);
+
+  const auto full = measure([&] {
+    SourceMgr srcMgr;
+    srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "bench"), {});
+    Lexer lexer(srcMgr, code);
+    lexer.Lex();
+    Parser parser(lexer.getTokens(), srcMgr);
+    parser.Parse();
+  });
+
+  IncrementalDocument document(code, "bench");
+
+  // Typing: insert a character into an expression and delete it again.
+  const auto edits = 20000u;
+  std::mt19937 random(1u);
+  EditStats total;
+  const auto typing = measure(
+      [&] {
+        for (auto i = 0u; i < edits; i += 2u) {
+          const auto line = code.find("+ 0.5", random() % code.size());
+          if (line == std::string::npos)
+            continue;
+          for (const auto &edit :
+               {TextEdit{line + 2u, 0u, "1"}, TextEdit{line + 2u, 1u, ""}}) {
+            const auto stats = document.edit(edit);
+            total.RelexedBytes += stats.RelexedBytes;
+            total.ReparsedSegments += stats.ReparsedSegments;
+          }
+        }
+      },
+      1u);
+
+  // Worst case: open a string near the top, which runs to the end.
+  const auto quote = code.find("+ 0.5") + 2u;
+  const auto openString = measure(
+      [&] {
+        document.edit({quote, 0u, "\""});
+        document.edit({quote, 1u, ""});
+      },
+      1u);
+
+  report("incremental_parse", "full parse", full, lines, "line");
+  report("incremental_parse", "keystroke", typing, edits, "edit");
+  report("incremental_parse", "open string", openString, 2u, "edit");
+  outs() << formatv("incremental_parse: {0:f1} us per keystroke vs {1:f1} ms "
+                    "for a full parse; {2:f1} bytes re-lexed per edit\n",
+                    typing / edits * 1e6, full * 1e3,
+                    double(total.RelexedBytes) / edits);
+}
+
+} // namespace lox::bench
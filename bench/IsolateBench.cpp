@@ -0,0 +1,37 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Isolate.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include <thread>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(isolate) {
+  const auto isolateCount = 5000u;
+  const auto script = CompiledScript::compile("tenant", makeScript(200u));
+  if (!script)
+    return;
+
+  const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+  double single = 0.0;
+  for (auto threads = 1u; threads <= hardware; threads *= 2u) {
+    const auto seconds = measure([&] {
+      WorkStealingPool pool(threads);
+      for (auto i = 0u; i < isolateCount; ++i)
+        pool.async([&] {
+          raw_null_ostream os;
+          Isolate isolate;
+          isolate.setOutputStream(os);
+          isolate.run(script);
+        });
+      pool.wait();
+    });
+    if (threads == 1u)
+      single = seconds;
+    report("isolate", formatv("{0} threads", threads).str(), seconds,
+           isolateCount, "isolate");
+    outs() << formatv("isolate scaling with {0} threads: {1:f2}x\n", threads,
+                      single / seconds);
+  }
+}
+
+} // namespace lox::bench
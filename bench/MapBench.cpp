@@ -0,0 +1,158 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/ForkableGlobals.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/MapTable.hpp"
+#include "lox/interpreter/Value.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+namespace lox::bench {
+
+namespace {
+
+/// The same hash and key equality as MapTable, so only the layouts differ.
+struct KeyHash {
+  std::size_t operator()(const sptr<Value> &key) const {
+    return MapTable::hash(*key);
+  }
+};
+struct KeyEqual {
+  bool operator()(const sptr<Value> &lhs, const sptr<Value> &rhs) const {
+    return *lhs == *rhs;
+  }
+};
+using StdMap = std::unordered_map<sptr<Value>, sptr<Value>, KeyHash, KeyEqual>;
+
+} // namespace
+
+LOX_BENCHMARK(map) {
+  std::mt19937 random(11u);
+  for (const std::size_t entries : {1000u, 100000u, 1000000u, 10000000u}) {
+    // Keys are inserted and looked up in two different random orders.
+    std::vector<sptr<Value>> keys;
+    keys.reserve(entries);
+    for (std::size_t i = 0u; i < entries; ++i)
+      keys.push_back(mksptr<NumberValue>(i));
+    std::shuffle(keys.begin(), keys.end(), random);
+    auto lookups = keys;
+    std::shuffle(lookups.begin(), lookups.end(), random);
+    // Enough work per run that small tables are not all timer noise.
+    const auto repeat = std::max<std::size_t>(1u, 1000000u / entries);
+    const auto runs = entries >= 1000000u ? 1u : 3u;
+
+    MapTable table;
+    const auto tableInsert = measure(
+        [&] {
+          for (std::size_t r = 0u; r < repeat; ++r) {
+            table = MapTable();
+            for (const auto &key : keys)
+              table.insert(key, key);
+          }
+        },
+        runs);
+    std::size_t found = 0u;
+    const auto tableLookup = measure(
+        [&] {
+          for (std::size_t r = 0u; r < repeat; ++r)
+            for (const auto &key : lookups)
+              found += table.find(*key) != nullptr;
+        },
+        runs);
+    table = MapTable();
+
+    StdMap map;
+    const auto stdInsert = measure(
+        [&] {
+          for (std::size_t r = 0u; r < repeat; ++r) {
+            map = StdMap();
+            for (const auto &key : keys)
+              map.emplace(key, key);
+          }
+        },
+        runs);
+    const auto stdLookup = measure(
+        [&] {
+          for (std::size_t r = 0u; r < repeat; ++r)
+            for (const auto &key : lookups)
+              found += map.count(key);
+        },
+        runs);
+    map = StdMap();
+    if (found != 2u * entries * repeat * runs)
+      outs() << "map: lookups missed\n";
+
+    const auto items = static_cast<double>(entries * repeat);
+    outs() << formatv("map: {0} entries\n", entries);
+    report("map", "MapTable insert", tableInsert, items, "entry");
+    report("map", "unordered_map insert", stdInsert, items, "entry");
+    report("map", "MapTable lookup", tableLookup, items, "lookup");
+    report("map", "unordered_map lookup", stdLookup, items, "lookup");
+  }
+}
+
+LOX_BENCHMARK(map_set) {
+  struct Case {
+    /// Evaluated once per entry, with a new key `k` and value `v`.
+    const char *Code;
+    const char *Variant;
+    /// Copying the table each time is quadratic, so it stops early.
+    std::size_t MaxEntries;
+  };
+  const Case cases[] = {
+      {"m = set(m, k, v)", "m = set(m, k, v)", 1000000u},
+      {"old = m = set(m, k, v)", "old map kept", 10000u},
+  };
+
+  SourceMgr srcMgr;
+  std::vector<uptr<Lexer>> lexers;
+  const auto parse = [&](const StringRef code) -> uptr<Expr> {
+    const auto id = srcMgr.AddNewSourceBuffer(
+        MemoryBuffer::getMemBufferCopy(code, "expr"), {});
+    lexers.push_back(
+        mkuptr<Lexer>(srcMgr, srcMgr.getMemoryBuffer(id)->getBuffer()));
+    if (!lexers.back()->Lex())
+      return nullptr;
+    Parser parser(lexers.back()->getTokens(), srcMgr);
+    return parser.Expression();
+  };
+
+  for (const std::size_t entries : {1000u, 10000u, 100000u, 1000000u}) {
+    std::vector<sptr<Value>> keys;
+    keys.reserve(entries);
+    for (std::size_t i = 0u; i < entries; ++i)
+      keys.push_back(mksptr<NumberValue>(i));
+    outs() << formatv("map_set: {0} entries\n", entries);
+    for (const auto &[code, variant, maxEntries] : cases) {
+      if (entries > maxEntries)
+        continue;
+      const auto expr = parse(code);
+      if (!expr)
+        return;
+      LoxValueEnv env;
+      ForkableGlobals globals;
+      ExprInterpreter interpreter(srcMgr, env);
+      interpreter.setForkableGlobals(&globals);
+      const auto seconds = measure(
+          [&] {
+            globals.define("m", mksptr<MapValue>(MapTable()));
+            globals.define("old", mksptr<NilValue>());
+            for (const auto &key : keys) {
+              globals.define("k", key);
+              globals.define("v", key);
+              std::visit(interpreter, *expr);
+            }
+          },
+          entries >= 100000u ? 1u : 3u);
+      const auto *map = dyn_cast<MapValue>(globals.find("m")->get());
+      if (!map || map->size() != entries)
+        outs() << "map_set: entries missing\n";
+      report("map_set", variant, seconds, entries, "set");
+    }
+  }
+}
+
+} // namespace lox::bench
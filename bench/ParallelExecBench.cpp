@@ -0,0 +1,59 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/ParallelInterpreter.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+#include <thread>
+
+namespace lox::bench {
+
+/// Independent declarations with a long arithmetic initializer each.
+static std::string makeIndependentScript(const std::size_t statements) {
+  std::string script;
+  for (std::size_t i = 0u; i < statements; ++i) {
+    script += formatv("var r{0} = {0}", i).str();
+    for (auto term = 0u; term < 32u; ++term)
+      script += formatv(" + {0} * 0.5 - {0} / 3", term).str();
+    script += formatv(";\nprint r{0};\n", i).str();
+  }
+  return script;
+}
+
+LOX_BENCHMARK(parallel_exec) {
+  const auto statements = 20000u;
+  const auto code = makeIndependentScript(statements);
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "bench"), {});
+  Lexer lexer(srcMgr, code);
+  lexer.Lex();
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+
+  const auto sequential = measure([&] {
+    raw_null_ostream os;
+    LoxValueEnv env;
+    ExprInterpreter exprInterpreter(srcMgr, env);
+    StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+    LoxValueScope globalScope(env);
+    for (const auto &stmt : program)
+      std::visit(stmtInterpreter, *stmt);
+  });
+  report("parallel_exec", "sequential", sequential, program.size(), "stmt");
+
+  const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (auto threads = 1u; threads <= hardware; threads *= 2u) {
+    ParallelExecOptions options;
+    options.Threads = threads;
+    const auto seconds = measure([&] {
+      raw_null_ostream os;
+      interpretParallel(srcMgr, program, os, os, options);
+    });
+    report("parallel_exec", formatv("{0} threads", threads).str(), seconds,
+           program.size(), "stmt");
+    outs() << formatv("parallel_exec speedup with {0} threads: {1:f2}x\n",
+                      threads, sequential / seconds);
+  }
+}
+
+} // namespace lox::bench
@@ -0,0 +1,38 @@
+#include "BenchUtils.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/ParallelParser.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+#include <thread>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(parallel_parse) {
+  const auto statements = 2000000u;
+  const auto code = makeScript(statements);
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "bench"), {});
+
+  const auto sequential = measure([&] {
+    Lexer lexer(srcMgr, code);
+    lexer.Lex();
+    Parser parser(lexer.getTokens(), srcMgr);
+    parser.Parse();
+  });
+  report("parallel_parse", "sequential", sequential, code.size() / 1e6, "MB");
+
+  const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (auto threads = 1u; threads <= hardware; threads *= 2u) {
+    ParallelParseOptions options;
+    options.Threads = threads;
+    options.MinChunkSize = 1u << 16;
+    const auto seconds =
+        measure([&] { parseParallel(srcMgr, code, options); });
+    report("parallel_parse", formatv("{0} threads", threads).str(), seconds,
+           code.size() / 1e6, "MB");
+    outs() << formatv("parallel_parse speedup with {0} threads: {1:f2}x\n",
+                      threads, sequential / seconds);
+  }
+}
+
+} // namespace lox::bench
@@ -0,0 +1,60 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/Streaming.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+#include <thread>
+
+namespace lox::bench {
+
+enum class FrontEnd { Batch, Streaming, Pipelined };
+
+static void runScript(const StringRef code, const FrontEnd frontEnd) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "bench"), {});
+  raw_null_ostream os;
+  LoxValueEnv env;
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+  LoxValueScope globalScope(env);
+
+  switch (frontEnd) {
+  case FrontEnd::Batch: {
+    Lexer lexer(srcMgr, code);
+    lexer.Lex();
+    Parser parser(lexer.getTokens(), srcMgr);
+    const auto program = parser.Parse();
+    for (const auto &stmt : program)
+      std::visit(stmtInterpreter, *stmt);
+    break;
+  }
+  case FrontEnd::Streaming:
+    interpretStreaming(srcMgr, code, stmtInterpreter);
+    break;
+  case FrontEnd::Pipelined:
+    interpretPipelined(srcMgr, code, stmtInterpreter);
+    break;
+  }
+}
+
+LOX_BENCHMARK(pipeline) {
+  const auto statements = 400000u;
+  const auto code = makeScript(statements);
+
+  const auto batch = measure([&] { runScript(code, FrontEnd::Batch); });
+  const auto streaming =
+      measure([&] { runScript(code, FrontEnd::Streaming); });
+  const auto pipelined =
+      measure([&] { runScript(code, FrontEnd::Pipelined); });
+
+  report("pipeline", "batch", batch, statements, "stmt");
+  report("pipeline", "streaming", streaming, statements, "stmt");
+  report("pipeline", "pipelined", pipelined, statements, "stmt");
+  outs() << formatv("pipeline speedup vs batch: {0:f2}x, vs streaming: "
+                    "{1:f2}x ({2} hardware threads)\n",
+                    batch / pipelined, streaming / pipelined,
+                    std::thread::hardware_concurrency());
+}
+
+} // namespace lox::bench
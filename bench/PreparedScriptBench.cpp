@@ -0,0 +1,82 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/PreparedScript.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <algorithm>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(prepared) {
+  const auto calls = 1000000u;
+  const auto freshCalls = 100000u;
+  const StringRef code = "var total = price * quantity;\n"
+                         "var taxed = total * (1 + rate);\n"
+                         "print taxed > 100;\n";
+  const StringRef params[] = {"price", "quantity", "rate"};
+
+  // Baseline: a fresh environment and interpreter per call, the inputs
+  // inserted by name, running a program parsed once.
+  SourceMgr srcMgr;
+  const auto id = srcMgr.AddNewSourceBuffer(
+      MemoryBuffer::getMemBufferCopy(code, "prepared"), {});
+  Lexer lexer(srcMgr, srcMgr.getMemoryBuffer(id)->getBuffer());
+  if (!lexer.Lex())
+    return;
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+  SmallString<64> output;
+  raw_svector_ostream os(output);
+  const auto fresh = measure([&] {
+    for (auto i = 0u; i < freshCalls; ++i) {
+      output.clear();
+      LoxValueEnv env;
+      LoxValueScope scope(env);
+      env.insert("price", mksptr<NumberValue>(i * 0.25L));
+      env.insert("quantity", mksptr<NumberValue>(3.0L));
+      env.insert("rate", mksptr<NumberValue>(0.08L));
+      ExprInterpreter exprInterpreter(srcMgr, env);
+      StmtInterpreter interpreter(srcMgr, exprInterpreter, env, os);
+      for (const auto &stmt : program)
+        std::visit(interpreter, *stmt);
+    }
+  });
+
+  const auto prepared = PreparedScript::prepare("prepared", code, params);
+  if (!prepared)
+    return;
+  prepared->bindNumber(1u, 3.0L);
+  prepared->bindNumber(2u, 0.08L);
+  const auto invoke = [&](const unsigned i) {
+    output.clear();
+    prepared->bindNumber(0u, i * 0.25L);
+    prepared->invoke(os);
+  };
+  const auto batched = measure([&] {
+    for (auto i = 0u; i < calls; ++i)
+      invoke(i);
+  });
+
+  // Latency of single calls, clock overhead included.
+  std::vector<double> latencies(calls / 10u);
+  for (std::size_t i = 0u; i < latencies.size(); ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    invoke(i);
+    latencies[i] = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  report("prepared", "fresh interpreter", fresh, freshCalls, "call");
+  report("prepared", "prepared script", batched, calls, "call");
+  outs() << formatv("prepared: {0:f0} ns per fresh call, {1:f0} ns per "
+                    "prepared call (p50 {2:f0} ns, p99 {3:f0} ns)\n",
+                    fresh / freshCalls * 1e9, batched / calls * 1e9,
+                    latencies[latencies.size() / 2u] * 1e9,
+                    latencies[latencies.size() * 99u / 100u] * 1e9);
+}
+
+} // namespace lox::bench
@@ -0,0 +1,51 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Value.hpp"
+
+namespace lox::bench {
+
+LOX_BENCHMARK(print) {
+  const auto numbers = 10000000u;
+  std::error_code ec;
+  raw_fd_ostream os("/dev/null", ec);
+  if (ec)
+    return;
+
+  // Amounts in cents, which are the nearest long doubles to decimals of two
+  // digits, like the results of arithmetic on literals; or arbitrary
+  // fractions, whose shortest text has up to 20 digits.
+  const auto run = [&](const std::size_t bufferSize, const auto &printOne,
+                       const bool decimals = true) {
+    os.SetBufferSize(bufferSize);
+    return measure(
+        [&] {
+          for (auto i = 0u; i < numbers; ++i) {
+            const NumberValue value(decimals ? i / 100.0L : i * 0.37L);
+            printOne(value);
+            os << '\n';
+          }
+          os.flush();
+        },
+        1u);
+  };
+
+  // Baseline: the text as a string first, in a page-sized buffer.
+  const auto viaString =
+      run(4u << 10u, [&](const Value &value) { os << value.str(); });
+  const auto smallBuffer = run(
+      4u << 10u, [&](const Value &value) { printValue(os, value); });
+  const auto fixed = run(
+      64u << 10u, [&](const Value &value) { printValue(os, value); });
+  const auto printShortest = [&](const Value &value) {
+    printValue(os, value, NumberFormat::Shortest);
+  };
+  const auto shortest = run(64u << 10u, printShortest);
+  const auto longest = run(64u << 10u, printShortest, false);
+
+  report("print", "str(), 4K buffer", viaString, numbers, "num");
+  report("print", "fixed, 4K buffer", smallBuffer, numbers, "num");
+  report("print", "fixed, 64K buffer", fixed, numbers, "num");
+  report("print", "shortest, 64K buffer", shortest, numbers, "num");
+  report("print", "shortest, 20 digits", longest, numbers, "num");
+}
+
+} // namespace lox::bench
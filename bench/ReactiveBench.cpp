@@ -0,0 +1,55 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Reactive.hpp"
+
+namespace lox::bench {
+
+LOX_BENCHMARK(reactive) {
+  // Derivations from 100 inputs, each an independent chain of statements.
+  const auto derivations = 100000u;
+  const auto chains = 100u;
+  std::string code;
+  std::size_t statements = 0u;
+  for (auto i = 0u; i < derivations; ++i, ++statements) {
+    if (i < chains)
+      code += formatv("var d{0} = in{0} * 2 + 1;\n", i).str();
+    else
+      code += formatv("var d{0} = d{1} + 1.5;\n", i, i - chains).str();
+    if (i % 10u == 9u) {
+      code += formatv("print d{0};\n", i).str();
+      ++statements;
+    }
+  }
+  std::string inputs;
+  for (auto i = 0u; i < chains; ++i)
+    inputs += formatv("var in{0} = {0};\n", i).str();
+  const auto script = CompiledScript::compile("reactive", code);
+  const auto prelude = CompiledScript::compile("inputs", inputs);
+  if (!script || !prelude)
+    return;
+
+  // Baseline: the whole script again after every change.
+  Isolate isolate;
+  isolate.setOutputStream(nulls());
+  isolate.run(prelude);
+  const auto full = measure([&] { isolate.run(script); });
+
+  ReactiveScript reactive(script);
+  for (auto i = 0u; i < chains; ++i)
+    reactive.setInput(formatv("in{0}", i).str(), mksptr<NumberValue>(i));
+  reactive.run(nulls());
+  std::size_t executed = 0u;
+  auto change = 0u;
+  const auto incremental = measure([&] {
+    ++change;
+    reactive.setInput("in9", mksptr<NumberValue>(change));
+    executed = reactive.run(nulls());
+  });
+
+  report("reactive", "full run", full, statements, "stmt");
+  report("reactive", "one input changed", incremental, executed, "stmt");
+  outs() << formatv("reactive: {0} of {1} statements executed, {2:f0}x "
+                    "faster than a full run\n",
+                    executed, statements, full / incremental);
+}
+
+} // namespace lox::bench
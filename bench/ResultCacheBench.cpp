@@ -0,0 +1,71 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/ResultCache.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace lox::bench {
+
+LOX_BENCHMARK(result_cache) {
+  const auto statements = 200000u;
+  const auto code = makeScript(statements);
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "bench"), {});
+
+  SmallString<128> dir;
+  if (sys::fs::createUniqueDirectory("lox-result-bench", dir))
+    return;
+  ResultCacheOptions options;
+  options.Dir = dir.str().str();
+  ResultCache cache(options);
+
+  // What the driver does on a miss, and on a hit.
+  const auto run = [&] {
+    const auto start = std::chrono::steady_clock::now();
+    Lexer lexer(srcMgr, code);
+    lexer.Lex();
+    const auto key = ResultCache::makeKey("bench", code, lexer.getTokens());
+    if (const auto hit = cache.lookup(key)) {
+      nulls() << hit->Output;
+      return;
+    }
+    CachedResult result;
+    raw_string_ostream os(result.Output);
+    Parser parser(lexer.getTokens(), srcMgr);
+    const auto program = parser.Parse();
+    LoxValueEnv env;
+    ExprInterpreter exprInterpreter(srcMgr, env);
+    StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+    {
+      LoxValueScope globalScope(env);
+      for (const auto &stmt : program)
+        std::visit(stmtInterpreter, *stmt);
+    }
+    nulls() << os.str();
+    result.Seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    cache.store(key, std::move(result));
+  };
+  const auto miss = measure([&] { run(); }, 1u);
+  const auto hit = measure(run);
+  // A new process, reading the file written above.
+  const auto reload = measure([&] {
+    ResultCache fresh(options);
+    Lexer lexer(srcMgr, code);
+    lexer.Lex();
+    (void)fresh.lookup(
+        ResultCache::makeKey("bench", code, lexer.getTokens()));
+  });
+  const auto stats = cache.getStats();
+  sys::fs::remove_directories(dir);
+
+  report("result_cache", "miss (run and store)", miss, statements, "stmt");
+  report("result_cache", "hit in memory", hit, statements, "stmt");
+  report("result_cache", "hit from directory", reload, statements, "stmt");
+  stats.print(outs());
+}
+
+} // namespace lox::bench
@@ -0,0 +1,36 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Scheduler.hpp"
+#include <limits>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(scheduler) {
+  const auto light = CompiledScript::compile("light", makeScript(8u));
+  const auto heavy = CompiledScript::compile("heavy", makeScript(20000u));
+  if (!light || !heavy)
+    return;
+
+  const auto runWith = [&](const StringRef variant,
+                           const SchedulerOptions &options) {
+    ScriptScheduler scheduler(options);
+    // The heavy scripts are queued first: without slicing every light
+    // script waits for all of them.
+    for (auto i = 0u; i < 20u; ++i)
+      scheduler.submit({heavy, "heavy"});
+    for (auto i = 0u; i < 5000u; ++i)
+      scheduler.submit({light, "light"});
+    const auto seconds = measure([&] { scheduler.run(); }, 1u);
+    report("scheduler", variant, seconds, 5020u, "script");
+    scheduler.printLatencyReport(outs());
+  };
+
+  SchedulerOptions options;
+  options.Slice = std::numeric_limits<std::uint64_t>::max();
+  runWith("run to completion", options);
+  options.Slice = 1000u;
+  runWith("fair, 1000 fuel", options);
+  options.Policy = SlicePolicy::Priority;
+  runWith("priority, 1000 fuel", options);
+}
+
+} // namespace lox::bench
@@ -0,0 +1,69 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/ScriptCache.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/FileSystem.h"
+
+namespace lox::bench {
+
+LOX_BENCHMARK(script_cache) {
+  const auto statements = 800000u;
+  const auto code = makeScript(statements);
+
+  SmallString<128> dir;
+  if (sys::fs::createUniqueDirectory("lox-cache-bench", dir))
+    return;
+  const ScriptCache cache(dir.str().str());
+
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "bench"), {});
+  const auto parse = measure([&] {
+    Lexer lexer(srcMgr, code);
+    lexer.Lex();
+    Parser parser(lexer.getTokens(), srcMgr);
+    parser.Parse();
+  });
+  {
+    Lexer lexer(srcMgr, code);
+    lexer.Lex();
+    Parser parser(lexer.getTokens(), srcMgr);
+    cache.store(code, parser.Parse());
+  }
+  const auto load = measure([&] { (void)cache.lookup(code); });
+
+  const auto run = [&](const bool cached) {
+    // Names in the environment point into the image or the tokens.
+    uptr<ScriptImage> image;
+    Lexer lexer(srcMgr, code);
+    raw_null_ostream os;
+    LoxValueEnv env;
+    ExprInterpreter exprInterpreter(srcMgr, env);
+    StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+    LoxValueScope globalScope(env);
+    if (cached) {
+      image = cache.lookup(code);
+      image->execute(stmtInterpreter);
+      return;
+    }
+    lexer.Lex();
+    Parser parser(lexer.getTokens(), srcMgr);
+    for (const auto &stmt : parser.Parse())
+      std::visit(stmtInterpreter, *stmt);
+  };
+  const auto cold = measure([&] { run(false); });
+  const auto warm = measure([&] { run(true); });
+
+  uint64_t imageSize = 0u;
+  sys::fs::file_size(cache.getPath(code), imageSize);
+  sys::fs::remove_directories(dir);
+
+  report("script_cache", "lex+parse", parse, statements, "stmt");
+  report("script_cache", "image load", load, statements, "stmt");
+  report("script_cache", "parse+run", cold, statements, "stmt");
+  report("script_cache", "image+run", warm, statements, "stmt");
+  outs() << formatv("script_cache: {0:f1} MB source, {1:f1} MB image, "
+                    "startup {2:f0}x faster\n",
+                    code.size() / 1e6, imageSize / 1e6, parse / load);
+}
+
+} // namespace lox::bench
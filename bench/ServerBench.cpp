@@ -0,0 +1,68 @@
+#include "BenchUtils.hpp"
+#include "lox/driver/Server.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include <thread>
+
+namespace lox::bench {
+
+LOX_BENCHMARK(server) {
+  const auto requests = 20000u;
+  const auto spawned = 50u;
+  const auto code = makeScript(40u);
+
+  SmallString<128> dir;
+  if (sys::fs::createUniqueDirectory("lox-server-bench", dir))
+    return;
+  SmallString<128> socket(dir), script(dir);
+  sys::path::append(socket, "lox.sock");
+  sys::path::append(script, "script.lox");
+  {
+    std::error_code ec;
+    raw_fd_ostream os(script, ec);
+    os << code;
+  }
+
+  // Baseline: a process per script, when the interpreter was built next to
+  // the benchmarks.
+  const auto self = sys::fs::getMainExecutable(nullptr, nullptr);
+  SmallString<128> interpreter(
+      sys::path::parent_path(sys::path::parent_path(self)));
+  sys::path::append(interpreter, "crafting_interpreter");
+  if (sys::fs::can_execute(interpreter)) {
+    const StringRef args[] = {interpreter, script};
+    const Optional<StringRef> redirects[] = {None, StringRef(""),
+                                             StringRef("")};
+    const auto seconds = measure(
+        [&] {
+          for (auto i = 0u; i < spawned; ++i)
+            sys::ExecuteAndWait(interpreter, args, None, redirects);
+        },
+        1u);
+    report("server", "process per script", seconds, spawned, "req");
+  }
+
+  ServerOptions options;
+  ScriptServer server(options);
+  if (!server.listen(socket, outs()))
+    return;
+  std::thread serving([&] { server.run(); });
+
+  for (const auto concurrency : {1u, 8u}) {
+    LoadTestOptions loadOptions;
+    loadOptions.Requests = requests;
+    loadOptions.Concurrency = concurrency;
+    const auto result = runLoadTest(socket, "script.lox", code, loadOptions);
+    report("server", formatv("{0} clients", concurrency).str(),
+           result.Seconds, result.Requests, "req");
+    result.print(outs());
+  }
+
+  server.requestStop();
+  serving.join();
+  sys::fs::remove_directories(dir);
+}
+
+} // namespace lox::bench
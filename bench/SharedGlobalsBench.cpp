@@ -0,0 +1,58 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/SharedGlobals.hpp"
+#include <mutex>
+#include <thread>
+
+namespace lox::bench {
+
+/// Run `reads` lookups of rotating names on each of `threads` threads.
+template <typename LookupFn>
+static double readOnThreads(const unsigned threads, const unsigned reads,
+                            const std::vector<std::string> &names,
+                            LookupFn lookup) {
+  return measure([&] {
+    std::vector<std::thread> workers;
+    for (auto t = 0u; t < threads; ++t)
+      workers.emplace_back([&, t] {
+        for (auto i = 0u; i < reads; ++i)
+          lookup(names[(i * 7u + t) % names.size()]);
+      });
+    for (auto &worker : workers)
+      worker.join();
+  });
+}
+
+LOX_BENCHMARK(shared_globals) {
+  const auto reads = 1000000u;
+  std::vector<std::string> names;
+  SharedGlobals globals;
+  StringMap<sptr<Value>> locked;
+  std::mutex mutex;
+  for (auto i = 0u; i < 1000u; ++i) {
+    names.push_back(formatv("config{0}", i).str());
+    globals.define(names.back(), mksptr<NumberValue>(i));
+    locked[names.back()] = mksptr<NumberValue>(i);
+  }
+
+  const auto maxThreads =
+      std::max(16u, std::thread::hardware_concurrency());
+  for (auto threads = 1u; threads <= maxThreads; threads *= 2u) {
+    const auto lockFree = readOnThreads(
+        threads, reads, names,
+        [&](const std::string &name) { return globals.lookup(name); });
+    const auto withMutex =
+        readOnThreads(threads, reads, names, [&](const std::string &name) {
+          std::lock_guard<std::mutex> lock(mutex);
+          return locked.lookup(name);
+        });
+    const auto total = static_cast<double>(threads) * reads;
+    report("shared_globals", formatv("lock-free {0} threads", threads).str(),
+           lockFree, total, "read");
+    report("shared_globals", formatv("mutex {0} threads", threads).str(),
+           withMutex, total, "read");
+  }
+  outs() << formatv("shared_globals: {0} hardware threads\n",
+                    std::thread::hardware_concurrency());
+}
+
+} // namespace lox::bench
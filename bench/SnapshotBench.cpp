@@ -0,0 +1,86 @@
+#include "BenchUtils.hpp"
+#include "lox/interpreter/Snapshot.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+namespace lox::bench {
+
+/// A prelude of constant tables: `entries` numbers computed from each other
+/// and string templates built by concatenation.
+static std::string makePrelude(const std::size_t entries) {
+  std::string prelude = "var base = 1.5;\nvar prefix = \"item-\";\n";
+  prelude.reserve(entries * 48u);
+  for (std::size_t i = 0u; i < entries; ++i) {
+    if (i % 2u)
+      prelude += formatv("var s{0} = prefix + \"{0}\" + \" of \" + "
+                         "\"table\";\n",
+                         i)
+                     .str();
+    else
+      prelude +=
+          formatv("var n{0} = base * {0} + (base - {0}) / 3;\n", i).str();
+  }
+  return prelude;
+}
+
+LOX_BENCHMARK(snapshot) {
+  const auto entries = 200000u;
+  const auto prelude = makePrelude(entries);
+  const StringRef main = "print n0 + n2;\nprint s1;\n";
+
+  SmallString<128> path;
+  if (sys::fs::createTemporaryFile("lox-prelude", "snap", path))
+    return;
+
+  const auto run = [&](const bool restore, const bool save) {
+    SourceMgr srcMgr;
+    srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(prelude, "prelude"),
+                              {});
+    uptr<EnvSnapshot> snapshot;
+    Lexer lexer(srcMgr, prelude);
+    Program program;
+    raw_null_ostream os;
+    LoxValueEnv env;
+    ExprInterpreter exprInterpreter(srcMgr, env);
+    StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+    LoxValueScope globalScope(env);
+    if (restore) {
+      snapshot = EnvSnapshot::load(path, prelude);
+      snapshot->restore(env);
+    } else {
+      lexer.Lex();
+      Parser parser(lexer.getTokens(), srcMgr);
+      program = parser.Parse();
+      for (const auto &stmt : program)
+        std::visit(stmtInterpreter, *stmt);
+      if (save)
+        EnvSnapshot::save(path, prelude, program, env);
+    }
+
+    Lexer mainLexer(srcMgr, main);
+    mainLexer.Lex();
+    Parser parser(mainLexer.getTokens(), srcMgr);
+    for (const auto &stmt : parser.Parse())
+      std::visit(stmtInterpreter, *stmt);
+  };
+
+  const auto save = measure([&] { run(false, true); }, 1u);
+  const auto replay = measure([&] { run(false, false); });
+  const auto restore = measure([&] { run(true, false); });
+
+  uint64_t size = 0u;
+  sys::fs::file_size(path, size);
+  sys::fs::remove(path);
+
+  report("snapshot", "replay and save", save, entries, "global");
+  report("snapshot", "replay prelude", replay, entries, "global");
+  report("snapshot", "restore snapshot", restore, entries, "global");
+  outs() << formatv("snapshot: {0:f1} MB prelude, {1:f1} MB snapshot, "
+                    "startup {2:f1}x faster\n",
+                    prelude.size() / 1e6, size / 1e6, replay / restore);
+}
+
+} // namespace lox::bench
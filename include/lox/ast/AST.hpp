@@ -3,6 +3,7 @@
 
 #include "lox/parser/Token.hpp"
 #include "utils/TypeUtils.hpp"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include <variant>
 
@@ -16,8 +17,27 @@ class GroupingE;
 class LiteralE;
 class VarE;
 class AssignE;
+class ArrayE;
+class IndexE;
+class CallE;
+class MapE;
 
-using Expr = std::variant<BinaryE, UnaryE, GroupingE, LiteralE, VarE, AssignE>;
+using Expr = std::variant<BinaryE, UnaryE, GroupingE, LiteralE, VarE, AssignE,
+                          ArrayE, IndexE, CallE, MapE>;
+
+/// Functions built into the language; there are no user-defined ones.
+enum Builtin : unsigned {
+#define BUILTIN(ID, ARITY) Builtin_##ID,
+#include "lox/ast/Builtin.def"
+
+  BuiltinCount
+};
+
+const char *getBuiltinName(Builtin builtin);
+/// Number of arguments `builtin` takes.
+unsigned getBuiltinArity(Builtin builtin);
+/// The builtin called `name`, if any.
+opt<Builtin> lookupBuiltin(StringRef name);
 
 template <typename ConcreteType>
 class ASTBase {
@@ -105,6 +125,72 @@ private:
   uptr<Expr> value;
 };
 
+/// An array literal: `[1, 2, 3]`.
+class ArrayE : public ASTBase<ArrayE> {
+public:
+  ArrayE(const SMLoc loc, SmallVector<uptr<Expr>, 4> elements)
+      : ASTBase(loc), elements(std::move(elements)) {}
+
+  [[nodiscard]] ArrayRef<uptr<Expr>> getElements() const { return elements; }
+
+private:
+  SmallVector<uptr<Expr>, 4> elements;
+};
+
+/// `array[index]`
+class IndexE : public ASTBase<IndexE> {
+public:
+  IndexE(const SMLoc loc, uptr<Expr> array, uptr<Expr> index)
+      : ASTBase(loc), array(std::move(array)), index(std::move(index)) {}
+
+  [[nodiscard]] Expr *getArray() const { return array.get(); }
+  [[nodiscard]] Expr *getIndex() const { return index.get(); }
+
+private:
+  uptr<Expr> array;
+  uptr<Expr> index;
+};
+
+/// A call of a builtin, which the parser resolved and checked the arity of.
+class CallE : public ASTBase<CallE> {
+public:
+  CallE(const SMLoc loc, Token *callee, const Builtin builtin,
+        SmallVector<uptr<Expr>, 4> args)
+      : ASTBase(loc), callee(callee), builtin(builtin), args(std::move(args)) {
+  }
+
+  [[nodiscard]] Token *getCallee() const { return callee; }
+  [[nodiscard]] Builtin getBuiltin() const { return builtin; }
+  [[nodiscard]] ArrayRef<uptr<Expr>> getArgs() const { return args; }
+
+  /// The variable of `m = set(m, ...)` or `m = delete(m, ...)`, which is
+  /// overwritten by the result, so the call may update the old map in place;
+  /// empty otherwise.
+  [[nodiscard]] StringRef getUpdated() const {
+    return updated ? updated->Symbol : StringRef();
+  }
+  void setUpdated(Token *symbol) { updated = symbol; }
+
+private:
+  Token *callee;
+  Builtin builtin;
+  SmallVector<uptr<Expr>, 4> args;
+  Token *updated = nullptr;
+};
+
+/// A map literal: `{"a": 1, 2: true}`.
+class MapE : public ASTBase<MapE> {
+public:
+  MapE(const SMLoc loc, SmallVector<uptr<Expr>, 4> operands)
+      : ASTBase(loc), operands(std::move(operands)) {}
+
+  /// Each key followed by its value.
+  [[nodiscard]] ArrayRef<uptr<Expr>> getOperands() const { return operands; }
+
+private:
+  SmallVector<uptr<Expr>, 4> operands;
+};
+
 inline SMLoc getLoc(const Expr &expr) {
   if (auto *unaryE = std::get_if<UnaryE>(&expr))
     return unaryE->getLoc();
@@ -116,6 +202,16 @@ inline SMLoc getLoc(const Expr &expr) {
     return literalE->getLoc();
   if (auto *varE = std::get_if<VarE>(&expr))
     return varE->getLoc();
+  if (auto *assignE = std::get_if<AssignE>(&expr))
+    return assignE->getLoc();
+  if (auto *arrayE = std::get_if<ArrayE>(&expr))
+    return arrayE->getLoc();
+  if (auto *indexE = std::get_if<IndexE>(&expr))
+    return indexE->getLoc();
+  if (auto *callE = std::get_if<CallE>(&expr))
+    return callE->getLoc();
+  if (auto *mapE = std::get_if<MapE>(&expr))
+    return mapE->getLoc();
   return {};
 }
 
@@ -128,7 +224,7 @@ class VarStmt;
 using Stmt = std::variant<ExprStmt, PrintStmt, VarStmt>;
 using Program = SmallVector<uptr<Stmt>, 16u>;
 
-class ExprStmt : ASTBase<ExprStmt> {
+class ExprStmt : public ASTBase<ExprStmt> {
 public:
   ExprStmt(const SMLoc loc, uptr<Expr> expr)
       : ASTBase(loc), expr(std::move(expr)) {}
@@ -138,7 +234,7 @@ private:
   uptr<Expr> expr;
 };
 
-class PrintStmt : ASTBase<PrintStmt> {
+class PrintStmt : public ASTBase<PrintStmt> {
 public:
   PrintStmt(const SMLoc loc, uptr<Expr> expr)
       : ASTBase(loc), expr(std::move(expr)) {}
@@ -148,7 +244,7 @@ private:
   uptr<Expr> expr;
 };
 
-class VarStmt : ASTBase<VarStmt> {
+class VarStmt : public ASTBase<VarStmt> {
 public:
   VarStmt(const SMLoc loc, Token *symbol, uptr<Expr> init)
       : ASTBase(loc), symbol(symbol), init(std::move(init)) {}
@@ -161,6 +257,10 @@ private:
   uptr<Expr> init;
 };
 
+inline SMLoc getLoc(const Stmt &stmt) {
+  return std::visit([](const auto &s) { return s.getLoc(); }, stmt);
+}
+
 using AST = std::variant<Expr, Stmt>;
 
 } // namespace lox
@@ -47,10 +47,16 @@ struct ExprPrinter : PrinterBase<ExprPrinter> {
   void operator()(const LiteralE &literalE);
   void operator()(const VarE &varE);
   void operator()(const AssignE &assignE);
+  void operator()(const ArrayE &arrayE);
+  void operator()(const IndexE &indexE);
+  void operator()(const CallE &callE);
+  void operator()(const MapE &mapE);
 
   void clear();
 
 private:
+  void printList(ArrayRef<uptr<Expr>> exprs);
+
   raw_string_ostream ss;
 };
 
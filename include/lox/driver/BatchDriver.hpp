@@ -0,0 +1,53 @@
+#ifndef __LOX_BATCH_DRIVER_HPP__
+#define __LOX_BATCH_DRIVER_HPP__
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+
+namespace lox {
+using namespace llvm;
+
+struct BatchOptions {
+  /// Worker threads; 0 uses every hardware thread.
+  unsigned Threads = 0u;
+  /// Stop after Parser::Parse(); nothing is executed.
+  bool SyntaxOnly = false;
+};
+
+struct BatchSummary {
+  std::size_t Files = 0u;
+  /// Files that did not exit with Exit_success.
+  std::size_t Failed = 0u;
+  /// The worst exit code: data errors win over runtime errors.
+  int ExitCode = 0;
+  double Seconds = 0.0;
+
+  [[nodiscard]] double getFilesPerSecond() const {
+    return Seconds > 0.0 ? Files / Seconds : 0.0;
+  }
+};
+
+/// The scripts named by `path`: every *.lox file below a directory, in
+/// sorted order, or one path per line of a manifest file. Blank lines and
+/// lines starting with '#' are skipped; relative entries are relative to the
+/// manifest's directory. Returns false after reporting to `diagOS` if `path`
+/// can't be read.
+bool collectBatchInputs(StringRef path, SmallVectorImpl<std::string> &files,
+                        raw_ostream &diagOS = errs());
+
+/// Check or run every file on a worker pool.
+///
+/// Each file gets its own SourceMgr, Lexer, Parser and interpreters, so the
+/// workers share nothing but the input list. Per-file `print` output and
+/// diagnostics are buffered and written to `os` and `diagOS` in input order
+/// as soon as every earlier file is done, so the result doesn't depend on
+/// scheduling.
+BatchSummary runBatch(ArrayRef<std::string> files, const BatchOptions &options,
+                      raw_ostream &os = outs(), raw_ostream &diagOS = errs());
+
+} // namespace lox
+
+#endif // __LOX_BATCH_DRIVER_HPP__
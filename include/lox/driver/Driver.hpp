@@ -0,0 +1,103 @@
+#ifndef __LOX_DRIVER_HPP__
+#define __LOX_DRIVER_HPP__
+
+#include "lox/interpreter/Value.hpp"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+
+namespace lox {
+using namespace llvm;
+
+/// Exit codes of the driver, following sysexits.h like clox does.
+enum ExitCode : int {
+  Exit_success = 0,
+  Exit_usage = 64,
+  Exit_data = 65,
+  Exit_noinput = 66,
+  Exit_unavailable = 69,
+  Exit_software = 70,
+  Exit_tempfail = 75,
+};
+
+enum class DiagnosticFormat { Text, JSON };
+
+struct DriverOptions {
+  /// Sample the running script with a CPU-time timer.
+  bool Profile = false;
+  /// Destination of the folded stacks; "-" for stdout.
+  std::string ProfileOutput = "lox.folded";
+  unsigned ProfileFrequency = 997u;
+  /// Number of lines listed in the profile hot list.
+  unsigned ProfileTop = 20u;
+  /// Count abstract work units and print them after the run.
+  bool CountWork = false;
+  /// Execute each declaration as soon as it is parsed instead of parsing the
+  /// whole script first.
+  bool Stream = false;
+  /// Streaming with the lexer and parser on their own threads.
+  bool Pipeline = false;
+  /// Lex and parse the script in chunks on a thread pool.
+  bool ParallelParse = false;
+  /// Worker threads; 0 uses every hardware thread.
+  unsigned Threads = 0u;
+  /// Stop after parsing; nothing is executed.
+  bool SyntaxOnly = false;
+  /// Run independent top-level statements in parallel.
+  bool AutoParallel = false;
+  /// Directory of compiled script images; empty disables the cache.
+  std::string CacheDir;
+  /// Script run before the main one, in the same global scope.
+  std::string Prelude;
+  /// Snapshot of the globals left by the prelude: restored instead of running
+  /// the prelude when it is up to date, written after running it otherwise.
+  std::string Snapshot;
+  /// Per-request timeout of the server and its clients, in milliseconds; 0
+  /// for none.
+  unsigned Timeout = 0u;
+  /// Reuse the output and diagnostics of scripts run before (see
+  /// ResultCache): in the server, and across runs with ResultCacheDir.
+  bool CacheResults = false;
+  /// Directory the results persist in; empty keeps them in memory.
+  std::string ResultCacheDir;
+  /// Bytes of results kept.
+  std::size_t ResultCacheBytes = 64u << 20u;
+  /// How `print` formats numbers.
+  NumberFormat Format = NumberFormat::Fixed;
+  /// Size of the stdout buffer in bytes when it isn't a terminal; 0 keeps
+  /// the default.
+  std::size_t OutputBuffer = 64u << 10u;
+  /// Diagnostics printed per category (lexer, parser, runtime); the rest
+  /// are counted and summarized in one note. 0 for no limit.
+  unsigned DiagnosticLimit = 100u;
+  /// Text is printed as errors are reported; JSON once the run is over.
+  DiagnosticFormat DiagFormat = DiagnosticFormat::Text;
+};
+
+/// Lex, parse and interpret the script at `path` ("-" for stdin). `print`
+/// output goes to stdout, diagnostics and reports to stderr.
+int runFile(StringRef path, const DriverOptions &options);
+
+/// Check or run every script listed in the manifest at `path`, or found
+/// below the directory `path`, on a worker pool (see runBatch()). Reports
+/// files/sec to stderr and returns the worst exit code.
+int runFiles(StringRef path, const DriverOptions &options);
+
+/// Serve scripts on the Unix domain socket `socketPath` until SIGINT or
+/// SIGTERM (see ScriptServer).
+int runServer(StringRef socketPath, const DriverOptions &options);
+
+/// Run the script at `path` ("-" for stdin) on the server listening at
+/// `socketPath`, printing its output as it arrives. Returns the exit code
+/// of the script.
+int runClient(StringRef path, StringRef socketPath,
+              const DriverOptions &options);
+
+/// Submit the script at `path` `requests` times to the server at
+/// `socketPath`, `concurrency` at a time, and report requests/sec and
+/// latency percentiles to stderr.
+int runLoadTest(StringRef path, StringRef socketPath, unsigned requests,
+                unsigned concurrency, const DriverOptions &options);
+
+} // namespace lox
+
+#endif // __LOX_DRIVER_HPP__
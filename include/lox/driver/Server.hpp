@@ -0,0 +1,193 @@
+#ifndef __LOX_SERVER_HPP__
+#define __LOX_SERVER_HPP__
+
+#include "lox/interpreter/ResultCache.hpp"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include "utils/TypeUtils.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lox {
+using namespace llvm;
+
+class CompiledScript;
+class Isolate;
+
+struct ServerOptions {
+  /// Worker threads; 0 uses every hardware thread.
+  unsigned Threads = 0u;
+  /// Timeout in milliseconds of requests that don't set one; 0 for none.
+  unsigned Timeout = 0u;
+  /// Milliseconds a client may take to send the rest of a request once it
+  /// started; 0 for no limit. A connection that stalls is closed.
+  unsigned ReadTimeout = 5000u;
+  /// Compiled scripts kept for requests submitting the same source again.
+  std::size_t CacheEntries = 256u;
+  /// Fuel spent between two checks of the deadline, see Isolate::resume().
+  std::uint64_t Slice = 100000u;
+  /// Answer scripts submitted again from their earlier result.
+  bool CacheResults = false;
+  ResultCacheOptions ResultCache;
+};
+
+/// Runs scripts submitted over a Unix domain socket, so that clients don't
+/// pay for starting a process.
+///
+/// A client sends frames of a one-byte kind, a little-endian u32 size and
+/// the payload. A request ('R') holds a u32 timeout in milliseconds, a u32
+/// name size, the name and the source. The server answers with any number
+/// of output ('O') and diagnostic ('E') frames, streamed while the script
+/// runs, then a done ('D') frame with the exit code as one byte: Exit_data
+/// for syntax errors, Exit_software for runtime errors and Exit_tempfail
+/// if the script ran out of time. A connection may send any number of
+/// requests, one at a time. The timeout of a request counts from its first
+/// byte, so it covers receiving and compiling the script, running it and
+/// sending the answer: a client that stops reading doesn't hold a worker.
+///
+/// A dispatcher thread accepts connections and waits for requests; each
+/// request runs on a worker pool. The state kept warm between requests is
+/// a cache of compiled scripts, keyed by name and source, and a free list
+/// of isolates. Every request starts from fresh globals; tokens and
+/// identifiers are shared by every run of a cached script. With
+/// CacheResults, a script whose result is cached isn't even parsed: the
+/// answer is the recorded output, diagnostics and exit code. Timed out runs
+/// aren't recorded.
+class ScriptServer {
+public:
+  explicit ScriptServer(const ServerOptions &options = ServerOptions());
+  ~ScriptServer();
+
+  ScriptServer(const ScriptServer &) = delete;
+  ScriptServer &operator=(const ScriptServer &) = delete;
+
+  /// Listen at `path`, replacing a socket left by a server that is gone.
+  /// Returns false after reporting to `diagOS` if that fails.
+  bool listen(StringRef path, raw_ostream &diagOS = errs());
+
+  /// Serve until requestStop(), then answer the requests being executed,
+  /// close every connection and remove the socket.
+  void run();
+
+  /// Make run() return. Async-signal-safe; may be called from any thread.
+  void requestStop();
+
+  [[nodiscard]] std::size_t getRequestCount() const { return requests; }
+  /// Requests that reused a compiled script.
+  [[nodiscard]] std::size_t getCacheHitCount() const { return cacheHits; }
+  [[nodiscard]] std::size_t getTimeoutCount() const { return timeouts; }
+  /// Empty statistics unless results are cached.
+  [[nodiscard]] ResultCacheStats getResultCacheStats() const {
+    return results ? results->getStats() : ResultCacheStats();
+  }
+
+private:
+  /// Answer one request of the connection `fd`, then hand it back to the
+  /// dispatcher, or close it if the client is gone.
+  void serve(int fd);
+  /// Compile and run a request that started arriving at `start`, streaming
+  /// the answer to `fd`. `timeout` is in milliseconds; 0 for none.
+  int execute(int fd, StringRef name, StringRef source, unsigned timeout,
+              std::chrono::steady_clock::time_point start);
+
+  sptr<const CompiledScript> getScript(StringRef name, StringRef source,
+                                       raw_ostream &diagOS);
+  uptr<Isolate> acquireIsolate();
+  void releaseIsolate(uptr<Isolate> isolate);
+
+  ServerOptions options;
+  unsigned threads;
+  std::string path;
+  int listenFD;
+  /// Written by requestStop() and when a connection is handed back.
+  int wakeFDs[2];
+  std::atomic<bool> stopping;
+
+  std::atomic<std::size_t> requests;
+  std::atomic<std::size_t> cacheHits;
+  std::atomic<std::size_t> timeouts;
+
+  /// Connections whose request was answered, for the dispatcher.
+  std::mutex parkedMutex;
+  std::vector<int> parked;
+
+  /// The compiled scripts, most recently used first, indexed by the hash
+  /// of their source.
+  std::mutex cacheMutex;
+  std::list<sptr<const CompiledScript>> cache;
+  std::unordered_multimap<std::uint64_t,
+                          std::list<sptr<const CompiledScript>>::iterator>
+      cacheIndex;
+
+  std::mutex isolateMutex;
+  std::vector<uptr<Isolate>> isolates;
+
+  uptr<ResultCache> results;
+};
+
+/// A connection to a ScriptServer.
+class ServerClient {
+public:
+  /// Returns nullptr after reporting to `diagOS` if nothing listens at
+  /// `path`.
+  static uptr<ServerClient> connect(StringRef path,
+                                    raw_ostream &diagOS = errs());
+  ~ServerClient();
+
+  ServerClient(const ServerClient &) = delete;
+  ServerClient &operator=(const ServerClient &) = delete;
+
+  /// Run `source` on the server, writing its output to `os` and its
+  /// diagnostics to `diagOS` as they arrive. `timeout` is in milliseconds;
+  /// 0 uses the server's. Returns the exit code of the script, or
+  /// Exit_unavailable if the connection broke.
+  int submit(StringRef name, StringRef source, unsigned timeout,
+             raw_ostream &os, raw_ostream &diagOS);
+
+private:
+  explicit ServerClient(int fd) : fd(fd) {}
+
+  int fd;
+};
+
+struct LoadTestOptions {
+  unsigned Requests = 1000u;
+  /// Clients submitting at the same time, each on its own connection.
+  unsigned Concurrency = 8u;
+  /// Per request, in milliseconds; 0 uses the server's.
+  unsigned Timeout = 0u;
+};
+
+struct LoadTestReport {
+  std::size_t Requests = 0u;
+  /// Requests that did not exit with Exit_success.
+  std::size_t Failed = 0u;
+  double Seconds = 0.0;
+  /// Latency percentiles of the requests, in seconds.
+  double P50 = 0.0;
+  double P90 = 0.0;
+  double P99 = 0.0;
+  double Max = 0.0;
+
+  [[nodiscard]] double getRequestsPerSecond() const {
+    return Seconds > 0.0 ? Requests / Seconds : 0.0;
+  }
+
+  void print(raw_ostream &os) const;
+};
+
+/// Submit `source` `options.Requests` times to the server at `path`, from
+/// `options.Concurrency` clients at once, and measure the latencies. The
+/// output of the script is discarded.
+LoadTestReport runLoadTest(StringRef path, StringRef name, StringRef source,
+                           const LoadTestOptions &options);
+
+} // namespace lox
+
+#endif // __LOX_SERVER_HPP__
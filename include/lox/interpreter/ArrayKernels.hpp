@@ -0,0 +1,42 @@
+#ifndef __LOX_ARRAY_KERNELS_HPP__
+#define __LOX_ARRAY_KERNELS_HPP__
+
+#include "lox/parser/Token.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include <cstddef>
+
+namespace lox::kernels {
+using namespace llvm;
+
+/// The bulk operations of ArrayValue and its builtins, over whole buffers
+/// of doubles. Elementwise ones are plain loops that the compiler
+/// vectorizes; reductions keep eight accumulators, each of every eighth
+/// element, so that they vectorize without reassociating additions the
+/// compiler must keep in order. Their result may thus differ in the last
+/// bits from adding the elements one by one.
+
+/// out[i] = lhs[i] `op` rhs[i], for `op` one of + - * /.
+void map(TokenKind op, const double *lhs, const double *rhs, double *out,
+         std::size_t size);
+/// out[i] = lhs[i] `op` rhs
+void map(TokenKind op, const double *lhs, double rhs, double *out,
+         std::size_t size);
+/// out[i] = lhs `op` rhs[i]
+void map(TokenKind op, double lhs, const double *rhs, double *out,
+         std::size_t size);
+
+void negate(const double *values, double *out, std::size_t size);
+
+double sum(ArrayRef<double> values);
+/// The least of `values`, which are not empty; NaNs are skipped.
+double min(ArrayRef<double> values);
+double max(ArrayRef<double> values);
+/// Sum of lhs[i] * rhs[i], for arrays of the same size.
+double dot(ArrayRef<double> lhs, ArrayRef<double> rhs);
+
+/// Ascending, NaNs last.
+void sort(MutableArrayRef<double> values);
+
+} // namespace lox::kernels
+
+#endif // __LOX_ARRAY_KERNELS_HPP__
@@ -0,0 +1,147 @@
+#ifndef __LOX_COLUMNAR_HPP__
+#define __LOX_COLUMNAR_HPP__
+
+#include "lox/ast/AST.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace lox {
+using namespace llvm;
+
+enum class ColumnType : std::uint8_t {
+  Number,
+  Bool,
+  /// Every row is nil: the type of a `nil` literal.
+  Nil,
+};
+
+/// Input columns of a batch, bound to variables by name. The arrays are
+/// borrowed and must outlive the batch.
+class ColumnBatch {
+public:
+  explicit ColumnBatch(std::size_t rows) : rows(rows) {}
+
+  /// Bind `name` to `values`. Rows set in `nils` hold nil instead; an empty
+  /// `nils` has no nil rows.
+  void addNumbers(StringRef name, ArrayRef<double> values,
+                  ArrayRef<bool> nils = None);
+  void addBools(StringRef name, ArrayRef<bool> values,
+                ArrayRef<bool> nils = None);
+
+  [[nodiscard]] std::size_t size() const { return rows; }
+
+private:
+  friend class ColumnarExpr;
+
+  struct Column {
+    ColumnType Type;
+    const double *Numbers;
+    const bool *Bools;
+    /// nullptr if no row is nil.
+    const bool *Nils;
+  };
+
+  std::size_t rows;
+  StringMap<Column> columns;
+};
+
+struct ColumnOutput {
+  ColumnType Type = ColumnType::Nil;
+  /// One per row, for a Number expression.
+  SmallVector<double, 0> Numbers;
+  /// One per row, for a Bool expression.
+  SmallVector<bool, 0> Bools;
+  /// Rows whose value is nil.
+  SmallVector<bool, 0> Nils;
+  /// Rows that raised a runtime error; their value is unspecified.
+  SmallVector<bool, 0> Errors;
+  std::size_t ErrorCount = 0u;
+};
+
+/// An expression compiled to run over whole columns at once.
+///
+/// ExprInterpreter allocates a Value per node and row. Here the free
+/// variables of the expression are bound to the columns of a ColumnBatch,
+/// every node gets a static type, and the expression becomes a sequence
+/// of kernels over blocks of rows: each kernel is a plain loop over
+/// arrays of double or bool that the compiler vectorizes. Variables are
+/// read from the columns in place; nothing is allocated per row.
+///
+/// The results are those of ExprInterpreter, with two differences:
+/// - arithmetic is done in double rather than long double;
+/// - an operator whose operand types can't succeed on any row, such as
+///   `x + true`, is reported by compile() instead of on every row.
+///
+/// What remains for evaluation are nil rows: an arithmetic, comparison or
+/// negation with a nil operand flags a runtime error on its row, and `==`,
+/// `!=` and `!` treat nil like the interpreter does. String literals and
+/// assignments are not supported.
+class ColumnarExpr {
+public:
+  /// Rows per block: the temporaries of a block stay in the cache.
+  static constexpr std::size_t BlockSize = 1024u;
+
+  /// Compile `expr` for batches with the columns of `layout`. Returns
+  /// nullptr, after reporting through `srcMgr` to `diagOS`, if the
+  /// expression uses a variable without a column or isn't supported.
+  static uptr<ColumnarExpr> compile(const Expr &expr,
+                                    const ColumnBatch &layout,
+                                    SourceMgr &srcMgr,
+                                    raw_ostream &diagOS = errs());
+
+  /// Evaluate every row of `batch`. It has the columns of the layout the
+  /// expression was compiled for, with the same types, and nils only where
+  /// the layout has them.
+  [[nodiscard]] ColumnOutput evaluate(const ColumnBatch &batch) const;
+
+  [[nodiscard]] ColumnType getType() const;
+
+private:
+  struct Compiler;
+
+  enum Opcode : std::uint8_t {
+    Op_column,
+    Op_constant,
+    Op_add,
+    Op_sub,
+    Op_mul,
+    Op_div,
+    Op_lt,
+    Op_le,
+    Op_gt,
+    Op_ge,
+    Op_eq,
+    Op_ne,
+    Op_neg,
+    Op_not,
+  };
+
+  /// Instruction `i` writes register `i`. Operands are registers; a column
+  /// is named by `Column`, a constant held in `Number` or `Bool`.
+  struct Instruction {
+    Opcode Op;
+    ColumnType Type;
+    /// Some row of the result may be nil.
+    bool MayBeNil;
+    unsigned Lhs;
+    unsigned Rhs;
+    double Number;
+    bool Bool;
+    StringRef Column;
+  };
+
+  ColumnarExpr() = default;
+
+  /// In evaluation order; the last one computes the result.
+  SmallVector<Instruction, 16> code;
+  /// Names of the columns read, owned here.
+  StringSet<> columnNames;
+};
+
+} // namespace lox
+
+#endif // __LOX_COLUMNAR_HPP__
@@ -0,0 +1,63 @@
+#ifndef __LOX_DEPENDENCIES_HPP__
+#define __LOX_DEPENDENCIES_HPP__
+
+#include "lox/ast/AST.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace lox {
+using namespace llvm;
+
+/// The global names a statement may read and write: every VarE is a read,
+/// every VarStmt and AssignE a write. Each name is listed once.
+struct StmtAccess {
+  SmallVector<StringRef, 4> Reads;
+  SmallVector<StringRef, 2> Writes;
+};
+
+StmtAccess collectAccess(const Stmt &stmt);
+
+/// Ordering constraints between the top-level statements of a program.
+///
+/// Statement j depends on an earlier statement i if j reads a name i writes
+/// (read after write), writes a name i reads (write after read) or writes a
+/// name i writes (write after write). Any schedule that runs every statement
+/// after the ones it depends on gives the same result as running them in
+/// program order.
+class DependencyGraph {
+public:
+  explicit DependencyGraph(const Program &program);
+
+  [[nodiscard]] std::size_t size() const { return accesses.size(); }
+
+  [[nodiscard]] const StmtAccess &getAccess(std::size_t stmt) const {
+    return accesses[stmt];
+  }
+
+  /// Earlier statements `stmt` has to wait for.
+  [[nodiscard]] ArrayRef<unsigned> getPredecessors(std::size_t stmt) const {
+    return predecessors[stmt];
+  }
+
+  /// Later statements waiting for `stmt`.
+  [[nodiscard]] ArrayRef<unsigned> getSuccessors(std::size_t stmt) const {
+    return successors[stmt];
+  }
+
+  [[nodiscard]] std::size_t getEdgeCount() const { return edges; }
+
+  /// Statements on the longest dependency chain; the best any number of
+  /// threads can do is run that many statements one after another.
+  [[nodiscard]] std::size_t getCriticalPath() const;
+
+private:
+  SmallVector<StmtAccess, 0> accesses;
+  SmallVector<SmallVector<unsigned, 2>, 0> predecessors;
+  SmallVector<SmallVector<unsigned, 2>, 0> successors;
+  std::size_t edges;
+};
+
+} // namespace lox
+
+#endif // __LOX_DEPENDENCIES_HPP__
@@ -0,0 +1,59 @@
+#ifndef __LOX_FORKABLE_GLOBALS_HPP__
+#define __LOX_FORKABLE_GLOBALS_HPP__
+
+#include "lox/interpreter/Value.hpp"
+#include "utils/TypeUtils.hpp"
+#include "llvm/ADT/StringMap.h"
+
+namespace lox {
+
+/// Global variables that can be forked in constant time.
+///
+/// The bindings are a writable overlay on top of a chain of frozen layers.
+/// fork() freezes the overlay into a new layer that parent and child then
+/// share, and gives both an empty overlay: nothing is copied, and a fork
+/// holds only the bindings it changed since. Assigning a variable of a
+/// frozen layer rebinds it in the overlay. Values are immutable, so a
+/// binding copied this way shares its Value.
+///
+/// Lookups probe the overlay and then each layer, so long chains of forks
+/// of changed state get slower to read; forking again without changes adds
+/// no layer. Frozen layers are never written, so forks may run on different
+/// threads; each ForkableGlobals is used by one thread at a time.
+class ForkableGlobals {
+public:
+  ForkableGlobals() = default;
+
+  /// Define `name` in the overlay, or rebind it.
+  void define(StringRef name, sptr<Value> value);
+
+  /// Rebind an existing `name`. Returns false if it isn't defined.
+  bool assign(StringRef name, sptr<Value> value);
+
+  /// The binding of `name`, or nullptr if it isn't defined.
+  [[nodiscard]] const sptr<Value> *find(StringRef name) const;
+
+  [[nodiscard]] bool count(StringRef name) const { return find(name); }
+
+  /// A copy of the current bindings that changes independently.
+  [[nodiscard]] ForkableGlobals fork();
+
+  /// Bindings this instance holds on its own.
+  [[nodiscard]] std::size_t getOverlaySize() const { return overlay.size(); }
+
+  /// Frozen layers below the overlay.
+  [[nodiscard]] std::size_t getDepth() const;
+
+private:
+  struct Layer {
+    StringMap<sptr<Value>> Bindings;
+    sptr<const Layer> Parent;
+  };
+
+  StringMap<sptr<Value>> overlay;
+  sptr<const Layer> frozen;
+};
+
+} // namespace lox
+
+#endif // __LOX_FORKABLE_GLOBALS_HPP__
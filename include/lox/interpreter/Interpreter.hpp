@@ -2,7 +2,13 @@
 #define LOW_INTERPRETER_HPP
 
 #include "lox/ast/AST.hpp"
+#include "lox/interpreter/ForkableGlobals.hpp"
+#include "lox/interpreter/Profiler.hpp"
+#include "lox/interpreter/SharedGlobals.hpp"
 #include "lox/interpreter/Value.hpp"
+#include "lox/interpreter/WorkCounter.hpp"
+#include "lox/parser/Diagnostics.hpp"
+#include "utils/Trace.hpp"
 #include "utils/TypeUtils.hpp"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
@@ -18,8 +24,8 @@ using LoxValueScope = LoxValueEnv::ScopeTy;
 struct StmtInterpreter {
   explicit StmtInterpreter(SourceMgr &srcMgr, ExprInterpreter &exprInterpreter,
                            LoxValueEnv &env, raw_ostream &os = llvm::errs())
-      : SrcMgr(srcMgr), ExprEvaluator(exprInterpreter), env(env), os(os),
-        error(0u) {}
+      : SrcMgr(srcMgr), ExprEvaluator(exprInterpreter), env(env), os(&os),
+        error(0u), profiler(nullptr), counters(nullptr) {}
 
   SourceMgr &SrcMgr;
   ExprInterpreter &ExprEvaluator;
@@ -30,18 +36,47 @@ struct StmtInterpreter {
   bool operator()(const PrintStmt &printStmt);
   bool operator()(const VarStmt &varStmt);
 
+  /// The part of a statement that runs after its expression was evaluated;
+  /// a null value means the evaluation failed.
+  bool print(const sptr<Value> &value);
+  /// `hasInit` tells a failed initializer from a missing one.
+  bool define(StringRef symbol, bool hasInit, sptr<Value> init);
+
   [[nodiscard]] std::size_t getError() const;
 
+  void setOutputStream(raw_ostream &stream) { os = &stream; }
+
+  /// How printed numbers are formatted; "%Lf" by default.
+  void setNumberFormat(const NumberFormat format) { numberFormat = format; }
+
+  /// Attach a sampling profiler to this interpreter and its expression
+  /// evaluator. Pass nullptr to detach.
+  void setProfiler(Profiler *prof);
+
+  /// Count abstract work units in this interpreter and its expression
+  /// evaluator. Pass nullptr to stop counting.
+  void setWorkCounters(WorkCounters *workCounters);
+
+  void count(const WorkCounters::StmtNode node) {
+    if (counters)
+      counters->StmtVisits[node]++;
+  }
+
 private:
   LoxValueEnv &env;
   /// redirect of print
-  raw_ostream &os;
+  raw_ostream *os;
   std::size_t error;
+  Profiler *profiler;
+  WorkCounters *counters;
+  NumberFormat numberFormat = NumberFormat::Fixed;
 };
 
 struct ExprInterpreter {
   explicit ExprInterpreter(SourceMgr &srcMgr, LoxValueEnv &env)
-      : SrcMgr(srcMgr), error(0u), env(env) {}
+      : SrcMgr(srcMgr), env(env), diags(srcMgr, DiagCategory::Runtime),
+        profiler(nullptr), counters(nullptr), shared(nullptr),
+        forkable(nullptr) {}
 
   sptr<Value> operator()(const BinaryE &binaryE);
   sptr<Value> operator()(const UnaryE &unaryE);
@@ -49,17 +84,176 @@ struct ExprInterpreter {
   sptr<Value> operator()(const LiteralE &literalE);
   sptr<Value> operator()(const VarE &varE);
   sptr<Value> operator()(const AssignE &assignE);
+  sptr<Value> operator()(const ArrayE &arrayE);
+  sptr<Value> operator()(const IndexE &indexE);
+  sptr<Value> operator()(const CallE &callE);
+  sptr<Value> operator()(const MapE &mapE);
+
+  /// Same as visiting `expr`, but walks the tree with an explicit work stack
+  /// instead of recursing, so that its depth is bounded by memory rather
+  /// than by the native stack.
+  sptr<Value> evaluate(const Expr &expr);
+
+  /// The part of each node that runs after its operands were evaluated, for
+  /// evaluators that walk the tree, or another form of it, themselves. A null
+  /// operand means its evaluation failed.
+  sptr<Value> evaluateBinary(SMLoc loc, TokenKind op, const sptr<Value> &lhs,
+                             const sptr<Value> &rhs);
+  sptr<Value> evaluateUnary(SMLoc loc, TokenKind op, const sptr<Value> &target);
+  sptr<Value> evaluateLiteral(TokenKind kind, StringRef symbol);
+  sptr<Value> evaluateVar(SMLoc loc, StringRef symbol);
+  /// Reports and returns false if the assigned name is undefined; the value
+  /// is only evaluated if this succeeds.
+  bool checkAssignTarget(SMLoc symbolLoc, StringRef symbol);
+  sptr<Value> evaluateAssign(StringRef symbol, sptr<Value> value);
+  /// An array of `elements`, which must all be numbers.
+  sptr<Value> evaluateArray(SMLoc loc, ArrayRef<sptr<Value>> elements);
+  /// An element of an array, or the value of a key of a map.
+  sptr<Value> evaluateIndex(SMLoc loc, const sptr<Value> &array,
+                            const sptr<Value> &index);
+  /// A map of `operands`, each key followed by its value. A key given twice
+  /// maps to its last value.
+  sptr<Value> evaluateMap(SMLoc loc, ArrayRef<sptr<Value>> operands);
+  /// `args` are as many as `builtin` takes; see Builtins.cpp. `updated` is
+  /// CallE::getUpdated(), a variable the result is assigned to.
+  sptr<Value> evaluateCall(SMLoc loc, Builtin builtin,
+                           ArrayRef<sptr<Value>> args,
+                           StringRef updated = {});
 
   SourceMgr &SrcMgr;
 
-  [[nodiscard]] std::size_t getError() const { return error; }
+  [[nodiscard]] std::size_t getError() const { return diags.getErrorCount(); }
+
+  void setProfiler(Profiler *prof) { profiler = prof; }
+
+  /// Where runtime errors are printed; stderr by default.
+  void setDiagnosticStream(raw_ostream &os) { diags.setStream(os); }
+
+  /// Report into `engine`, shared with the lexer and the parser.
+  void setDiagnosticEngine(DiagnosticEngine &engine) {
+    diags.setEngine(engine);
+  }
+
+  void setWorkCounters(WorkCounters *workCounters) { counters = workCounters; }
+  [[nodiscard]] WorkCounters *getWorkCounters() const { return counters; }
+
+  void count(const WorkCounters::ExprNode node) {
+    if (counters)
+      counters->ExprVisits[node]++;
+  }
+
+  /// Resolve names missing from the environment in `globals`, which other
+  /// interpreter threads may be reading and writing too. `var` still defines
+  /// in the environment, shadowing a shared global.
+  void setSharedGlobals(SharedGlobals *globals) { shared = globals; }
+  [[nodiscard]] SharedGlobals *getSharedGlobals() const { return shared; }
+
+  /// Keep globals in `globals`, which `var` then defines in, instead of the
+  /// environment. They are found before shared globals.
+  void setForkableGlobals(ForkableGlobals *globals) { forkable = globals; }
+  [[nodiscard]] ForkableGlobals *getForkableGlobals() const {
+    return forkable;
+  }
 
 private:
-  void report(SMLoc loc, SourceMgr::DiagKind kind, StringRef msg,
-              raw_ostream &os = llvm::errs());
+  template <typename ValueT, typename... Ts>
+  sptr<Value> makeValue(Ts &&...args) {
+    auto value = mksptr<ValueT>(std::forward<Ts>(args)...);
+    LOX_TRACE2(value__alloc, value.get(), value->getKind());
+    if (counters) {
+      counters->ValueAllocations++;
+      if constexpr (std::is_same_v<ValueT, StringValue>)
+        counters->StringBytesCopied += value->getValue().size();
+    }
+    return value;
+  }
+
+  bool hasVar(StringRef symbol) {
+    if (counters)
+      counters->EnvLookups++;
+    return env.count(symbol) || (forkable && forkable->count(symbol)) ||
+           (shared && shared->count(symbol));
+  }
+
+  sptr<Value> lookupVar(StringRef symbol) {
+    if (counters)
+      counters->EnvLookups++;
+    if ((!shared && !forkable) || env.count(symbol))
+      return env.lookup(symbol);
+    if (forkable)
+      if (const auto *value = forkable->find(symbol))
+        return *value;
+    return shared ? shared->lookup(symbol) : nullptr;
+  }
+
+  /// Rebind the innermost definition of `symbol` in place, so assignments
+  /// don't pile up shadowed entries in the environment.
+  void assignVar(StringRef symbol, sptr<Value> value) {
+    if (counters)
+      counters->EnvInserts++;
+    if ((shared || forkable) && !env.count(symbol)) {
+      if (!forkable || !forkable->assign(symbol, value))
+        shared->assign(symbol, std::move(value));
+      return;
+    }
+    *env.begin(symbol) = std::move(value);
+  }
+
+  /// Unbind `symbol` ahead of assigning it, so its value can be updated in
+  /// place if nothing else holds it. Shared globals keep their value, since
+  /// other threads may read it meanwhile.
+  void releaseVar(StringRef symbol) {
+    if ((shared || forkable) && !env.count(symbol)) {
+      if (forkable)
+        forkable->assign(symbol, nullptr);
+      return;
+    }
+    *env.begin(symbol) = nullptr;
+  }
+
+  void report(DiagCode code, SMLoc loc, ArrayRef<StringRef> args = {});
+
+  /// + - * / with an array operand, elementwise or with a number broadcast.
+  sptr<Value> evaluateArrayArithmetic(SMLoc loc, TokenKind op,
+                                      const Value &lhs, const Value &rhs);
+
+  /// The argument `position` (from 1) of `builtin`, or null after reporting
+  /// that it has another type.
+  const NumberValue *getNumberArg(SMLoc loc, Builtin builtin,
+                                  ArrayRef<sptr<Value>> args,
+                                  unsigned position);
+  const ArrayValue *getArrayArg(SMLoc loc, Builtin builtin,
+                                ArrayRef<sptr<Value>> args,
+                                unsigned position);
+  /// The length given as argument `position`, or nullopt after reporting it
+  /// is not a whole number up to ArrayValue::MaxSize.
+  opt<std::size_t> getLengthArg(SMLoc loc, Builtin builtin,
+                                ArrayRef<sptr<Value>> args,
+                                unsigned position);
+  const MapValue *getMapArg(SMLoc loc, Builtin builtin,
+                            ArrayRef<sptr<Value>> args, unsigned position);
+  /// Reports and returns false if `key` can't be a map key.
+  bool checkKey(SMLoc loc, const Value &key);
+
+  /// A node of evaluate(): first expanded into its operands, then finished
+  /// once their values are on the operand stack.
+  struct WorkItem {
+    const Expr *Node;
+    bool Expanded;
+  };
+
+  void expand(const Expr &expr);
+  void finish(const Expr &expr);
 
-  std::size_t error;
   LoxValueEnv &env;
+  DiagnosticSink diags;
+  Profiler *profiler;
+  WorkCounters *counters;
+  SharedGlobals *shared;
+  ForkableGlobals *forkable;
+  /// Stacks of evaluate(), kept across calls to reuse their memory.
+  SmallVector<WorkItem, 0> work;
+  SmallVector<sptr<Value>, 0> operands;
 };
 
 } // namespace lox
@@ -0,0 +1,138 @@
+#ifndef __LOX_ISOLATE_HPP__
+#define __LOX_ISOLATE_HPP__
+
+#include "lox/interpreter/ForkableGlobals.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/Resumable.hpp"
+#include "lox/parser/Token.hpp"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+/// Thread safety of the interpreter
+/// --------------------------------
+/// Lexer, Parser, ExprInterpreter and StmtInterpreter are not thread-safe:
+/// each instance, and the SourceMgr and LoxValueEnv it refers to, may be used
+/// by one thread at a time. A SourceMgr builds its line tables lazily when a
+/// diagnostic is printed, so it can't even be shared for reading.
+///
+/// A parsed program is never written by the interpreters. A CompiledScript
+/// packages one with the tokens and source it points into, and may be run by
+/// any number of Isolates on any number of threads at once. Each Isolate owns
+/// everything an interpreter writes: the SourceMgr it reports through, the
+/// global environment, every Value it allocates and its output sinks. An
+/// Isolate is used by one thread at a time but may move between threads.
+/// SharedGlobals is the one structure isolates may read and write together.
+///
+/// The sampling Profiler is process-wide; attach it to one isolate at most.
+
+namespace lox {
+
+/// An immutable parsed script, shared by the isolates that run it.
+class CompiledScript {
+public:
+  /// Lex and parse `code`. Returns nullptr, after printing the diagnostics
+  /// to `diagOS`, if the script has syntax errors.
+  static sptr<const CompiledScript> compile(StringRef name, StringRef code,
+                                            raw_ostream &diagOS = errs());
+
+  [[nodiscard]] StringRef getName() const {
+    return buffer->getBufferIdentifier();
+  }
+  [[nodiscard]] StringRef getSource() const { return buffer->getBuffer(); }
+  [[nodiscard]] const Program &getProgram() const { return program; }
+
+private:
+  CompiledScript() = default;
+
+  uptr<MemoryBuffer> buffer;
+  SmallVector<uptr<Token>> tokens;
+  Program program;
+};
+
+/// An independent interpreter instance.
+///
+/// Globals defined by one run stay visible to the next run on the same
+/// isolate, and to forks of it. `print` output and runtime diagnostics are
+/// collected in the isolate unless redirected.
+class Isolate {
+public:
+  Isolate();
+  ~Isolate();
+
+  Isolate(const Isolate &) = delete;
+  Isolate &operator=(const Isolate &) = delete;
+
+  /// A new isolate starting from a copy-on-write view of this one's globals,
+  /// see ForkableGlobals. It uses the same shared globals and starts with
+  /// no output. Forking is O(1) and the fork keeps only the globals it
+  /// changes; forks may run on other threads than this isolate.
+  [[nodiscard]] uptr<Isolate> fork();
+
+  /// Run every statement of `script`. Returns false if any of them raised a
+  /// runtime error.
+  bool run(const sptr<const CompiledScript> &script);
+
+  /// Prepare to run `script` in slices with resume(), see
+  /// ResumableInterpreter.
+  void start(const sptr<const CompiledScript> &script);
+
+  /// Run the started script until `fuel` more units are spent. Returns true
+  /// once it has finished.
+  bool resume(std::uint64_t fuel) { return resumable.resume(fuel); }
+
+  /// Fuel spent by the started script.
+  [[nodiscard]] std::uint64_t getFuelUsed() const {
+    return resumable.getFuelUsed();
+  }
+
+  [[nodiscard]] StringRef getOutput() const { return output; }
+  [[nodiscard]] StringRef getDiagnostics() const { return diagnostics; }
+  /// Drop the collected output and diagnostics, keeping the globals.
+  void clearOutput();
+
+  /// Forget the globals, the loaded scripts, the output and a started
+  /// script, and collect the output again, so that the isolate can be
+  /// reused for unrelated work. The shared globals stay attached.
+  void reset();
+
+  /// Send `print` output to `os` instead of collecting it.
+  void setOutputStream(raw_ostream &os);
+  /// Send runtime diagnostics to `os` instead of collecting them.
+  void setDiagnosticStream(raw_ostream &os);
+
+  [[nodiscard]] std::size_t getError() const {
+    return stmtInterpreter.getError();
+  }
+
+  /// Read and write globals missing from this isolate in `globals`.
+  void setSharedGlobals(SharedGlobals *globals) {
+    exprInterpreter.setSharedGlobals(globals);
+  }
+
+  [[nodiscard]] StmtInterpreter &getInterpreter() { return stmtInterpreter; }
+
+private:
+  /// Make the locations of `script` resolvable and keep it alive.
+  void load(const sptr<const CompiledScript> &script);
+
+  SourceMgr srcMgr;
+  /// Scripts run here; a started script is executed from their AST.
+  SmallPtrSet<const CompiledScript *, 4> loaded;
+  SmallVector<sptr<const CompiledScript>, 4> scripts;
+
+  std::string output;
+  std::string diagnostics;
+  raw_string_ostream outputOS;
+  raw_string_ostream diagOS;
+
+  ForkableGlobals variables;
+  LoxValueEnv env;
+  uptr<LoxValueScope> globals;
+  ExprInterpreter exprInterpreter;
+  StmtInterpreter stmtInterpreter;
+  ResumableInterpreter resumable;
+};
+
+} // namespace lox
+
+#endif // __LOX_ISOLATE_HPP__
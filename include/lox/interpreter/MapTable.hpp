@@ -0,0 +1,116 @@
+#ifndef __LOX_MAP_TABLE_HPP__
+#define __LOX_MAP_TABLE_HPP__
+
+#include "utils/TypeUtils.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace lox {
+
+class Value;
+
+/// The hash table of MapValue: open addressing in the layout of Swiss
+/// tables.
+///
+/// Besides its slots the table keeps one control byte per slot: empty,
+/// deleted, or the low 7 bits of the hash of the key in it. A lookup hashes
+/// the key once, then probes groups of 16 control bytes with one SSE2
+/// comparison each (a portable loop elsewhere), and only compares the keys
+/// of slots whose 7 bits match. Slots keep the full hash of their key, so
+/// that growing never hashes a key again. The table is at most 7/8 full and
+/// doubles when it grows.
+///
+/// Keys are numbers, strings, booleans and nil, and are found by
+/// Value::operator==: -0 is the same key as 0. NaN, which equals nothing,
+/// is no key.
+class MapTable {
+public:
+  struct Entry {
+    std::uint64_t Hash;
+    sptr<Value> Key;
+    sptr<Value> Mapped;
+  };
+
+  MapTable() = default;
+
+  /// Whether `key` can be a key.
+  static bool isKey(const Value &key);
+  static std::uint64_t hash(const Value &key);
+
+  [[nodiscard]] std::size_t size() const { return count; }
+  [[nodiscard]] bool empty() const { return !count; }
+  [[nodiscard]] std::size_t capacity() const { return ctrl.size(); }
+
+  /// The entry of `key`, or null.
+  [[nodiscard]] const Entry *find(const Value &key) const;
+  /// Map `key`, which isKey(), to `mapped`. Returns false if it replaced the
+  /// value of a key already in the table.
+  bool insert(sptr<Value> key, sptr<Value> mapped);
+  /// Returns whether `key` was in the table.
+  bool erase(const Value &key);
+  /// Make room for `size` keys without growing.
+  void reserve(std::size_t size);
+
+  /// Iterates over the entries in slot order, which depends on the keys
+  /// and the history of the table but not on where it runs.
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Entry;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Entry *;
+    using reference = const Entry &;
+
+    const Entry &operator*() const { return table->slots[index]; }
+    const Entry *operator->() const { return &table->slots[index]; }
+    const_iterator &operator++() {
+      ++index;
+      skipFree();
+      return *this;
+    }
+    bool operator==(const const_iterator &other) const {
+      return index == other.index;
+    }
+    bool operator!=(const const_iterator &other) const {
+      return index != other.index;
+    }
+
+  private:
+    friend class MapTable;
+    const_iterator(const MapTable *table, const std::size_t index)
+        : table(table), index(index) {
+      skipFree();
+    }
+    void skipFree() {
+      while (index < table->ctrl.size() && table->ctrl[index] < 0)
+        ++index;
+    }
+
+    const MapTable *table;
+    std::size_t index;
+  };
+
+  [[nodiscard]] const_iterator begin() const { return {this, 0u}; }
+  [[nodiscard]] const_iterator end() const { return {this, ctrl.size()}; }
+
+private:
+  /// The slot of `key`, or NotFound.
+  [[nodiscard]] std::size_t findSlot(const Value &key,
+                                     std::uint64_t hash) const;
+  /// The first free slot on the probe sequence of `hash`.
+  [[nodiscard]] std::size_t findFree(std::uint64_t hash) const;
+  void rehash(std::size_t newCapacity);
+
+  /// Negative for free slots, the 7 bits of the hash for full ones.
+  std::vector<std::int8_t> ctrl;
+  std::vector<Entry> slots;
+  std::size_t count = 0u;
+  /// Slots that may still become full before the table grows.
+  std::size_t growthLeft = 0u;
+};
+
+} // namespace lox
+
+#endif // __LOX_MAP_TABLE_HPP__
@@ -0,0 +1,41 @@
+#ifndef __LOX_PARALLEL_INTERPRETER_HPP__
+#define __LOX_PARALLEL_INTERPRETER_HPP__
+
+#include "lox/ast/AST.hpp"
+#include "lox/interpreter/Value.hpp"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace lox {
+using namespace llvm;
+
+struct ParallelExecOptions {
+  /// Worker threads; 0 uses every hardware thread.
+  unsigned Threads = 0u;
+  NumberFormat Format = NumberFormat::Fixed;
+};
+
+struct ParallelExecStats {
+  std::size_t Statements = 0u;
+  std::size_t Edges = 0u;
+  /// Length of the longest dependency chain, see DependencyGraph.
+  std::size_t CriticalPath = 0u;
+  std::size_t RuntimeErrors = 0u;
+};
+
+/// Run the top-level statements of `program` on a thread pool, each as soon
+/// as every statement it depends on (see DependencyGraph) has finished.
+///
+/// Every statement runs in its own environment, filled with the current
+/// values of the names it touches and written back when it is done.
+/// `print` output and runtime diagnostics are buffered per statement and
+/// written to `os` and `diagOS` in program order, so both are identical to
+/// running the program with one StmtInterpreter.
+ParallelExecStats interpretParallel(SourceMgr &srcMgr, const Program &program,
+                                    raw_ostream &os,
+                                    raw_ostream &diagOS = errs(),
+                                    const ParallelExecOptions &options = {});
+
+} // namespace lox
+
+#endif // __LOX_PARALLEL_INTERPRETER_HPP__
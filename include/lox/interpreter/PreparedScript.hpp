@@ -0,0 +1,132 @@
+#ifndef __LOX_PREPARED_SCRIPT_HPP__
+#define __LOX_PREPARED_SCRIPT_HPP__
+
+#include "lox/parser/Token.hpp"
+#include "utils/TypeUtils.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+
+namespace lox {
+using namespace llvm;
+
+/// A script compiled once and invoked many times with different inputs.
+///
+/// The inputs are variables named at prepare time and bound by index, like
+/// the parameters of a prepared SQL statement. Every variable of the script
+/// is resolved to a numbered slot when it is prepared, and the statements
+/// are lowered to code for a small stack machine over unboxed values, so
+/// an invocation does no name lookups and allocates nothing: strings live
+/// in buffers of the slots that are reused from one call to the next.
+///
+/// Each invocation starts from the bound parameters with every other global
+/// undefined, and behaves like running the script with a fresh interpreter
+/// in which the parameters are defined: same output, same diagnostics. The
+/// profiler and work counters don't see prepared scripts.
+class PreparedScript {
+public:
+  /// Lex, parse and lower `code`, with the input variables `params`.
+  /// Returns nullptr, after printing the diagnostics to `diagOS`, if the
+  /// script has syntax errors.
+  static uptr<PreparedScript> prepare(StringRef name, StringRef code,
+                                      ArrayRef<StringRef> params,
+                                      raw_ostream &diagOS = errs());
+  ~PreparedScript();
+
+  PreparedScript(const PreparedScript &) = delete;
+  PreparedScript &operator=(const PreparedScript &) = delete;
+
+  [[nodiscard]] std::size_t getParamCount() const { return params; }
+
+  /// Bind parameter `index` for the next invocations. Parameters start as
+  /// nil.
+  void bindNumber(unsigned index, long double value);
+  void bindBool(unsigned index, bool value);
+  void bindString(unsigned index, StringRef value);
+  void bindNil(unsigned index);
+
+  /// Run the script, printing to `os`. Returns false if it reported a
+  /// runtime error.
+  bool invoke(raw_ostream &os);
+
+  /// Send runtime diagnostics to `os` instead of stderr.
+  void setDiagnosticStream(raw_ostream &os) { diagOS = &os; }
+
+  /// Runtime errors reported by every invocation so far.
+  [[nodiscard]] std::size_t getError() const { return error; }
+
+private:
+  /// A value: a number, a string, a bool, nil, or the absence of one, as
+  /// when the interpreter returns nullptr.
+  struct Slot {
+    enum SlotKind : std::uint8_t {
+      Absent,
+      Number,
+      String,
+      Bool,
+      Nil,
+    };
+
+    SlotKind Kind = Nil;
+    bool Boolean = false;
+    long double Num = 0.0L;
+    /// The string: a view of the source or of `Storage`.
+    StringRef Str;
+    std::string Storage;
+  };
+
+  enum Opcode : std::uint8_t {
+    Op_constant,
+    Op_load,
+    /// Fail an assignment to an undefined variable, skipping to `Target`.
+    Op_check_assign,
+    Op_store,
+    Op_binary,
+    Op_unary,
+    Op_print,
+    Op_pop,
+    Op_define,
+    Op_define_empty,
+  };
+
+  struct Instruction {
+    Opcode Op;
+    TokenKind Operator;
+    /// The slot, or the constant.
+    unsigned Operand;
+    unsigned Target;
+    SMLoc Loc;
+  };
+
+  struct Lowering;
+
+  PreparedScript() = default;
+
+  static void copy(Slot &to, const Slot &from);
+  void binary(const Instruction &instruction, Slot &lhs, const Slot &rhs);
+  void unary(const Instruction &instruction, Slot &operand);
+  void print(raw_ostream &os, const Slot &value);
+  void report(SMLoc loc, const Twine &msg);
+
+  SourceMgr srcMgr;
+  raw_ostream *diagOS = &errs();
+  std::size_t error = 0u;
+
+  SmallVector<Instruction, 32> code;
+  SmallVector<Slot, 8> constants;
+  /// Globals, the parameters first, and their names.
+  SmallVector<Slot, 8> globals;
+  SmallVector<bool, 8> defined;
+  SmallVector<std::string, 8> names;
+  std::size_t params = 0u;
+  /// Values of the parameters at the start of an invocation.
+  SmallVector<Slot, 8> bound;
+  /// Operands, as deep as the deepest expression.
+  SmallVector<Slot, 8> stack;
+};
+
+} // namespace lox
+
+#endif // __LOX_PREPARED_SCRIPT_HPP__
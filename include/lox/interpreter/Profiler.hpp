@@ -0,0 +1,112 @@
+#ifndef __LOX_PROFILER_HPP__
+#define __LOX_PROFILER_HPP__
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/SMLoc.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <vector>
+
+namespace lox {
+using namespace llvm;
+
+/// Timer-signal sampling profiler.
+///
+/// The interpreters keep a shadow stack of the locations of the statements and
+/// expressions that are currently being evaluated. A SIGPROF handler copies
+/// that stack into a preallocated sample buffer, so nothing is allocated or
+/// resolved while the script runs. After the run, locations are mapped to
+/// `file:line` through the SourceMgr and reported as folded stacks
+/// (flamegraph.pl compatible) or as a per-line hot list.
+///
+/// Only one profiler can be sampling at a time.
+class Profiler {
+public:
+  static constexpr unsigned MaxDepth = 64u;
+
+  explicit Profiler(SourceMgr &srcMgr, std::size_t frameCapacity = 1u << 20);
+  ~Profiler();
+
+  Profiler(const Profiler &) = delete;
+  Profiler &operator=(const Profiler &) = delete;
+
+  /// Install the signal handler and arm the CPU-time interval timer.
+  bool start(unsigned frequency = 997u);
+  void stop();
+
+  void push(const SMLoc loc) {
+    const auto d = depth.load(std::memory_order_relaxed);
+    if (d < MaxDepth)
+      frames[d] = loc.getPointer();
+    std::atomic_signal_fence(std::memory_order_release);
+    depth.store(d + 1, std::memory_order_relaxed);
+  }
+
+  void pop() {
+    depth.store(depth.load(std::memory_order_relaxed) - 1,
+                std::memory_order_relaxed);
+  }
+
+  /// Record the current shadow stack. Async-signal-safe.
+  void sample();
+
+  [[nodiscard]] std::size_t getSampleCount() const { return samples.size(); }
+  [[nodiscard]] std::size_t getDroppedCount() const { return dropped; }
+
+  /// One line per distinct stack: `frame;frame;... count`
+  void printFoldedStacks(raw_ostream &os);
+
+  /// Lines sorted by the number of samples in which they were the innermost
+  /// frame.
+  void printHotLines(raw_ostream &os, unsigned top = 20u);
+
+  SourceMgr &SrcMgr;
+
+private:
+  struct Sample {
+    std::size_t Begin;
+    unsigned Depth;
+  };
+
+  StringRef resolve(const char *ptr);
+
+  const char *frames[MaxDepth];
+  std::atomic<unsigned> depth;
+
+  std::vector<const char *> frameBuffer;
+  std::size_t frameCursor;
+  std::vector<Sample> samples;
+  std::size_t dropped;
+
+  BumpPtrAllocator allocator;
+  StringSaver saver;
+  DenseMap<const char *, StringRef> resolved;
+};
+
+/// Pushes a location on the profiler shadow stack for the lifetime of the
+/// object. Costs a single null check when profiling is off.
+class ProfileFrame {
+public:
+  ProfileFrame(Profiler *profiler, const SMLoc loc) : profiler(profiler) {
+    if (profiler)
+      profiler->push(loc);
+  }
+  ~ProfileFrame() {
+    if (profiler)
+      profiler->pop();
+  }
+
+  ProfileFrame(const ProfileFrame &) = delete;
+  ProfileFrame &operator=(const ProfileFrame &) = delete;
+
+private:
+  Profiler *profiler;
+};
+
+} // namespace lox
+
+#endif // __LOX_PROFILER_HPP__
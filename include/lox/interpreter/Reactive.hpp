@@ -0,0 +1,114 @@
+#ifndef __LOX_REACTIVE_HPP__
+#define __LOX_REACTIVE_HPP__
+
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/Isolate.hpp"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/StringMap.h"
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace lox {
+
+/// A script kept up to date with its inputs, like a spreadsheet.
+///
+/// Inputs are globals the host defines with setInput(). Each top-level
+/// statement is a cell: every name it reads or writes refers to the result
+/// of the last earlier statement writing that name, or to the input, and
+/// the statement keeps the values of the names it writes. Scripts have no
+/// control flow, so the names a statement touches are known before it runs
+/// (see collectAccess()).
+///
+/// The first run() executes every statement. After that, run() re-executes
+/// only the statements reading a changed input or a changed result, in
+/// program order, and prints the output of the `print` statements among
+/// them. A statement whose results come out equal to the previous ones
+/// stops the propagation, so the work is proportional to what changed, not
+/// to the length of the script. getOutput() is then the output a full run
+/// with the current inputs would print; runtime errors of statements that
+/// aren't re-executed aren't reported again.
+class ReactiveScript {
+public:
+  explicit ReactiveScript(sptr<const CompiledScript> script);
+  ~ReactiveScript();
+
+  ReactiveScript(const ReactiveScript &) = delete;
+  ReactiveScript &operator=(const ReactiveScript &) = delete;
+
+  /// Define or rebind the input `name` for the next run().
+  void setInput(StringRef name, sptr<Value> value);
+
+  /// Execute the statements affected by the changes since the last run,
+  /// printing the output of the reprinted statements to `os`. Returns the
+  /// number of statements executed.
+  std::size_t run(raw_ostream &os);
+
+  /// The output of every `print` statement, in program order.
+  [[nodiscard]] std::string getOutput() const;
+
+  /// The value of global `name` at the end of the script, or nullptr.
+  [[nodiscard]] sptr<Value> lookup(StringRef name) const;
+
+  /// Send runtime diagnostics to `os` instead of stderr.
+  void setDiagnosticStream(raw_ostream &os) {
+    exprInterpreter.setDiagnosticStream(os);
+  }
+
+  [[nodiscard]] std::size_t getError() const {
+    return stmtInterpreter.getError();
+  }
+
+private:
+  struct Binding {
+    sptr<Value> Val;
+    bool Defined = false;
+
+    [[nodiscard]] bool operator==(const Binding &other) const;
+  };
+
+  struct Use {
+    StringRef Name;
+    /// The result of an earlier statement or an input.
+    const Binding *Source;
+  };
+
+  struct Cell {
+    /// Names read or written.
+    SmallVector<Use, 4> Uses;
+    SmallVector<StringRef, 2> Writes;
+    /// The values of `Writes` after the statement.
+    SmallVector<Binding, 2> Results;
+    /// Later statements using `Results`.
+    SmallVector<unsigned, 4> Readers;
+    std::string Output;
+  };
+
+  struct Input {
+    Binding Bound;
+    SmallVector<unsigned, 4> Readers;
+  };
+
+  void enqueue(unsigned stmt);
+  void evaluate(unsigned stmt, raw_ostream &os);
+
+  sptr<const CompiledScript> script;
+  SourceMgr srcMgr;
+  SmallVector<Cell, 0> cells;
+  StringMap<Input> inputs;
+  /// The statement whose results are the final value of each name.
+  StringMap<const Binding *> finals;
+
+  /// Statements to execute, lowest first.
+  std::priority_queue<unsigned, std::vector<unsigned>, std::greater<>>
+      pending;
+  BitVector queued;
+
+  LoxValueEnv env;
+  ExprInterpreter exprInterpreter;
+  StmtInterpreter stmtInterpreter;
+};
+
+} // namespace lox
+
+#endif // __LOX_REACTIVE_HPP__
@@ -0,0 +1,120 @@
+#ifndef __LOX_RESULT_CACHE_HPP__
+#define __LOX_RESULT_CACHE_HPP__
+
+#include "lox/parser/Token.hpp"
+#include "utils/TypeUtils.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace lox {
+
+/// What a run of a script printed and how it ended.
+struct CachedResult {
+  std::string Output;
+  std::string Diagnostics;
+  int ExitCode = 0;
+  /// Seconds the run took, which every hit saves.
+  double Seconds = 0.0;
+};
+
+/// Identifies the result of a script.
+struct ResultKey {
+  /// Hash of the token stream: scripts that differ only in whitespace and
+  /// comments share it.
+  std::uint64_t Tokens = 0u;
+  /// Hash of the name and the exact source, which diagnostics quote.
+  std::uint64_t Exact = 0u;
+};
+
+struct ResultCacheOptions {
+  /// Bytes of results kept; the least recently used are evicted beyond.
+  std::size_t MaxBytes = 64u << 20u;
+  /// Directory the results persist in across processes; empty keeps them in
+  /// memory only.
+  std::string Dir;
+};
+
+struct ResultCacheStats {
+  std::size_t Hits = 0u;
+  std::size_t Misses = 0u;
+  std::size_t Stores = 0u;
+  std::size_t Evictions = 0u;
+  /// Sum of the run times of the results that were hit.
+  double SavedSeconds = 0.0;
+  std::size_t Entries = 0u;
+  std::size_t Bytes = 0u;
+
+  [[nodiscard]] double getHitRate() const {
+    return Hits + Misses ? static_cast<double>(Hits) / (Hits + Misses) : 0.0;
+  }
+
+  void print(raw_ostream &os) const;
+};
+
+/// Results of scripts keyed by their token stream, for scripts submitted
+/// again, byte for byte or with other whitespace and comments.
+///
+/// Lox has no I/O or clock, so a script prints the same thing every time it
+/// runs from fresh globals; only diagnostics depend on the layout of the
+/// source and on its name, since they quote both. A result with diagnostics
+/// is therefore only returned for the exact source it was made from.
+///
+/// Results are kept in memory up to a size, evicting the least recently
+/// used. With a directory they are also written to one file each, named
+/// after the key, and a new cache picks up the files there lazily; the
+/// modification time of a file is its last use, so the directory stays
+/// bounded across processes too. Files are native-endian, like script
+/// images. The cache may be used from several threads at once.
+class ResultCache {
+public:
+  explicit ResultCache(ResultCacheOptions options = ResultCacheOptions());
+
+  ResultCache(const ResultCache &) = delete;
+  ResultCache &operator=(const ResultCache &) = delete;
+
+  /// The key of the script `source` named `name`, lexed to `tokens`.
+  static ResultKey makeKey(StringRef name, StringRef source,
+                           ArrayRef<uptr<Token>> tokens);
+
+  /// The result for `key`, or nothing.
+  [[nodiscard]] opt<CachedResult> lookup(const ResultKey &key);
+
+  /// Keep `result` for `key`. Returns false if it couldn't be written to the
+  /// directory; it is still kept in memory.
+  bool store(const ResultKey &key, CachedResult result);
+
+  [[nodiscard]] ResultCacheStats getStats() const;
+
+private:
+  struct Entry {
+    std::uint64_t Key;
+    std::uint64_t Exact;
+    std::size_t Size;
+    /// Null for a file of the directory that wasn't read yet.
+    uptr<CachedResult> Result;
+  };
+
+  [[nodiscard]] std::string getPath(std::uint64_t key) const;
+  uptr<CachedResult> read(std::uint64_t key, std::uint64_t &exact) const;
+  bool write(const Entry &entry) const;
+  void touch(std::uint64_t key) const;
+  void erase(std::list<Entry>::iterator entry);
+  void evict();
+
+  ResultCacheOptions options;
+  mutable std::mutex mutex;
+  /// Most recently used first.
+  std::list<Entry> entries;
+  std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+  std::size_t bytes = 0u;
+  ResultCacheStats stats;
+};
+
+} // namespace lox
+
+#endif // __LOX_RESULT_CACHE_HPP__
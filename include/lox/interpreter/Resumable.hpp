@@ -0,0 +1,71 @@
+#ifndef __LOX_RESUMABLE_HPP__
+#define __LOX_RESUMABLE_HPP__
+
+#include "lox/interpreter/Interpreter.hpp"
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
+
+namespace lox {
+
+/// Runs a program in slices with a fuel budget.
+///
+/// Every statement and every expression node visited costs one unit of fuel.
+/// When a slice's fuel runs out the interpreter stops, in the middle of an
+/// expression if need be: the position in the program, the expression nodes
+/// being evaluated and the operands computed so far are kept in explicit
+/// stacks instead of on the native stack, and resume() carries on exactly
+/// where it left off. The output and diagnostics are the same as running the
+/// program with `interpreter` in one go.
+///
+/// The program and the interpreter must outlive the execution. The sampling
+/// profiler doesn't see statements run this way.
+class ResumableInterpreter {
+public:
+  explicit ResumableInterpreter(StmtInterpreter &interpreter)
+      : interpreter(interpreter), program(nullptr), stmtIndex(0u),
+        inStmt(false), fuelUsed(0u) {}
+
+  /// Start over at the first statement of `program`.
+  void start(const Program &program);
+
+  /// Run until `fuel` more units are spent or the program ends. Returns true
+  /// once the program has finished.
+  bool resume(std::uint64_t fuel);
+
+  /// Abandon the started program, e.g. when it ran out of time. The
+  /// statement being executed is left half done.
+  void stop();
+
+  [[nodiscard]] bool isFinished() const {
+    return !program || (!inStmt && stmtIndex == program->size());
+  }
+
+  /// Fuel spent since start().
+  [[nodiscard]] std::uint64_t getFuelUsed() const { return fuelUsed; }
+
+private:
+  struct Frame {
+    const Expr *Node;
+    /// Operands of `Node` evaluated so far.
+    unsigned Stage;
+  };
+
+  /// Begin the current statement.
+  void enterStmt();
+  void finishStmt();
+  /// Advance the innermost expression frame by one step.
+  void step();
+
+  StmtInterpreter &interpreter;
+  const Program *program;
+  std::size_t stmtIndex;
+  /// The expression of program[stmtIndex] is being evaluated.
+  bool inStmt;
+  SmallVector<Frame, 16> frames;
+  SmallVector<sptr<Value>, 16> operands;
+  std::uint64_t fuelUsed;
+};
+
+} // namespace lox
+
+#endif // __LOX_RESUMABLE_HPP__
@@ -0,0 +1,105 @@
+#ifndef __LOX_SCHEDULER_HPP__
+#define __LOX_SCHEDULER_HPP__
+
+#include "lox/interpreter/Isolate.hpp"
+#include "llvm/ADT/SmallVector.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lox {
+
+enum class SlicePolicy {
+  /// Round-robin: every unfinished script gets a slice in turn.
+  Fair,
+  /// A script only runs while no script of a higher priority is waiting;
+  /// scripts of the same priority take turns.
+  Priority,
+};
+
+struct SchedulerOptions {
+  /// Threads, each multiplexing its share of the scripts.
+  unsigned Threads = 1u;
+  /// Fuel per time slice, see ResumableInterpreter.
+  std::uint64_t Slice = 1000u;
+  SlicePolicy Policy = SlicePolicy::Fair;
+};
+
+struct ScriptJob {
+  sptr<const CompiledScript> Script;
+  /// Latencies are reported per class.
+  std::string Class = "default";
+  /// Higher runs first under SlicePolicy::Priority.
+  unsigned Priority = 0u;
+  /// Fuel after which the script is stopped; 0 for no limit.
+  std::uint64_t FuelLimit = 0u;
+  /// CPU seconds after which the script is stopped; 0 for no limit.
+  double CpuLimit = 0.0;
+};
+
+enum class JobStatus {
+  Pending,
+  Finished,
+  /// Finished with runtime errors.
+  Failed,
+  FuelLimitExceeded,
+  CpuLimitExceeded,
+};
+
+struct JobResult {
+  JobStatus Status = JobStatus::Pending;
+  std::string Output;
+  std::string Diagnostics;
+  std::uint64_t FuelUsed = 0u;
+  unsigned Slices = 0u;
+  double CpuSeconds = 0.0;
+  /// From the start of ScriptScheduler::run() until the job ended.
+  double Latency = 0.0;
+};
+
+struct ClassLatency {
+  std::string Class;
+  std::size_t Jobs = 0u;
+  double P50 = 0.0;
+  double P99 = 0.0;
+  double Max = 0.0;
+};
+
+/// Runs many scripts on a few threads by time slicing.
+///
+/// Each job runs in its own Isolate, in slices of `Slice` units of fuel, so a
+/// long script can't hold up the short ones behind it. Jobs are dealt to the
+/// threads round-robin and stay on their thread. A job that reaches its fuel
+/// or CPU limit is stopped at the end of the slice that reached it; the fuel
+/// limit is exact.
+class ScriptScheduler {
+public:
+  explicit ScriptScheduler(const SchedulerOptions &options = {})
+      : options(options) {}
+
+  /// Queue a job; returns its id.
+  std::size_t submit(ScriptJob job);
+
+  /// Run every queued job to completion.
+  void run();
+
+  [[nodiscard]] const JobResult &getResult(std::size_t id) const {
+    return results[id];
+  }
+
+  /// p50/p99/max latency per class, in order of first submission.
+  [[nodiscard]] SmallVector<ClassLatency> getLatencies() const;
+
+  void printLatencyReport(raw_ostream &os) const;
+
+private:
+  void runShard(unsigned shard);
+
+  SchedulerOptions options;
+  std::vector<ScriptJob> jobs;
+  std::vector<JobResult> results;
+};
+
+} // namespace lox
+
+#endif // __LOX_SCHEDULER_HPP__
@@ -0,0 +1,94 @@
+#ifndef __LOX_SCRIPT_CACHE_HPP__
+#define __LOX_SCRIPT_CACHE_HPP__
+
+#include "lox/interpreter/Interpreter.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <string>
+
+namespace lox {
+
+namespace image {
+struct Header;
+struct Stmt;
+struct Node;
+struct StringEntry;
+} // namespace image
+
+/// A parsed Program in a flat binary form that is executed in place.
+///
+/// The image is a header followed by four arrays: statements, expression
+/// nodes in post-order (children refer to earlier nodes by index), a string
+/// table holding every token symbol once, and the string bytes. Locations
+/// are offsets into the source, which must be loaded too: the header carries
+/// a hash and the size of the source it was made from, and the format
+/// version, and an image that doesn't match is refused. Loading maps the
+/// file and checks the indices; nothing is decoded per node, execution reads
+/// the arrays directly.
+///
+/// Images are native-endian and only valid on the machine that wrote them.
+class ScriptImage {
+public:
+  /// Bump on any change of the layout.
+  static constexpr std::uint32_t Version = 4u;
+
+  static std::uint64_t hashSource(StringRef code);
+
+  /// Write the image of `program`, parsed without errors from `code`.
+  static bool write(raw_ostream &os, StringRef code, const Program &program);
+
+  /// Map the image at `path` for `code`. Returns nullptr if there is none,
+  /// or it was made from a different source or by another version.
+  static uptr<ScriptImage> load(StringRef path, StringRef code);
+
+  ~ScriptImage();
+
+  [[nodiscard]] std::size_t getStmtCount() const;
+
+  /// Run every statement with `interpreter`, whose SourceMgr has to hold
+  /// the source the image was loaded for. The image must outlive the
+  /// interpreter's environment, whose names point into it. The sampling
+  /// profiler doesn't see statements run this way.
+  void execute(StmtInterpreter &interpreter) const;
+
+private:
+  ScriptImage(uptr<MemoryBuffer> file, StringRef code);
+  bool verify();
+  [[nodiscard]] StringRef getString(std::uint32_t index) const;
+  [[nodiscard]] SMLoc getLoc(std::uint32_t offset) const;
+  sptr<Value> evaluate(ExprInterpreter &evaluator, std::uint32_t index) const;
+  /// The values of the list of Flat_args from `index`.
+  SmallVector<sptr<Value>, 4> evaluateList(ExprInterpreter &evaluator,
+                                           std::uint32_t index) const;
+
+  uptr<MemoryBuffer> file;
+  StringRef code;
+  const image::Header *header;
+  ArrayRef<image::Stmt> stmts;
+  ArrayRef<image::Node> nodes;
+  ArrayRef<image::StringEntry> strings;
+  StringRef stringData;
+};
+
+/// A directory of script images named after the hash of their source.
+class ScriptCache {
+public:
+  explicit ScriptCache(std::string dir) : dir(std::move(dir)) {}
+
+  [[nodiscard]] std::string getPath(StringRef code) const;
+
+  /// The cached image for `code`, or nullptr.
+  [[nodiscard]] uptr<ScriptImage> lookup(StringRef code) const;
+
+  /// Cache the image of `program`. The file is written under a temporary
+  /// name and renamed, so readers never see a partial image.
+  bool store(StringRef code, const Program &program) const;
+
+private:
+  std::string dir;
+};
+
+} // namespace lox
+
+#endif // __LOX_SCRIPT_CACHE_HPP__
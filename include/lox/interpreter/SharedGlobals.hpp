@@ -0,0 +1,64 @@
+#ifndef __LOX_SHARED_GLOBALS_HPP__
+#define __LOX_SHARED_GLOBALS_HPP__
+
+#include "lox/interpreter/Value.hpp"
+#include "llvm/ADT/StringMap.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+namespace lox {
+
+/// Global variables shared by interpreters running on many threads.
+///
+/// Reads take no lock: the name table and each variable's value are
+/// published through atomic pointers, and a reader only announces the epoch
+/// it is reading in. A write swaps in a new value with one atomic exchange,
+/// so each variable changes atomically; the value it replaced is freed once
+/// every thread that could still be reading it has left its epoch. Defining
+/// a new name copies the table and is serialized by a lock, which suits a
+/// large set of globals that is rarely updated.
+///
+/// Variables can't be removed. The table must outlive every interpreter
+/// reading it, and may not be destroyed while it is being read.
+class SharedGlobals {
+public:
+  SharedGlobals();
+  ~SharedGlobals();
+
+  SharedGlobals(const SharedGlobals &) = delete;
+  SharedGlobals &operator=(const SharedGlobals &) = delete;
+
+  /// Define `name`, or rebind it if it exists. `value` must not be null.
+  void define(StringRef name, sptr<Value> value);
+
+  /// Rebind an existing `name`. Returns false if it isn't defined.
+  bool assign(StringRef name, sptr<Value> value);
+
+  /// The current value of `name`, or nullptr if it isn't defined.
+  [[nodiscard]] sptr<Value> lookup(StringRef name) const;
+
+  [[nodiscard]] bool count(StringRef name) const;
+
+  [[nodiscard]] std::size_t size() const;
+
+private:
+  struct Slot {
+    /// Owned box; replaced boxes are reclaimed by epoch.
+    std::atomic<const sptr<Value> *> Box{nullptr};
+  };
+  using Table = StringMap<Slot *>;
+
+  /// Rebind `slot` and retire the box it held.
+  static void store(Slot &slot, sptr<Value> value);
+
+  std::atomic<const Table *> table;
+  /// Every slot ever created; slots are never retired.
+  std::deque<Slot> slots;
+  /// Serializes definitions of new names.
+  std::mutex defineMutex;
+};
+
+} // namespace lox
+
+#endif // __LOX_SHARED_GLOBALS_HPP__
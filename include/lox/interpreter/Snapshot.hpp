@@ -0,0 +1,76 @@
+#ifndef __LOX_SNAPSHOT_HPP__
+#define __LOX_SNAPSHOT_HPP__
+
+#include "lox/interpreter/Interpreter.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <vector>
+
+namespace lox {
+
+namespace snapshot {
+struct Header;
+struct Binding;
+struct ValueEntry;
+struct StringEntry;
+} // namespace snapshot
+
+/// The global variables left behind by a prelude script, saved to a file.
+///
+/// Running a prelude of constant tables every time produces the same
+/// environment; a snapshot stores that environment instead, so later runs
+/// restore it and go on with the main script. The file holds the bindings
+/// (name, value) in definition order, every distinct value once, and a
+/// string table shared by names, string values and the contents of arrays
+/// and maps. Loading maps the file and checks it; restoring builds one Value
+/// per distinct value and binds the names, which point into the mapping.
+///
+/// Like script images, snapshots carry the hash and size of the prelude
+/// they were made from and are refused for any other source. They are
+/// native-endian and only valid on the machine that wrote them.
+class EnvSnapshot {
+public:
+  /// Bump on any change of the layout.
+  static constexpr std::uint32_t Version = 3u;
+
+  /// Write the current bindings in `env` of every global `prelude`
+  /// defines. `program` is the parsed prelude, which has been run in `env`.
+  static bool write(raw_ostream &os, StringRef prelude, const Program &program,
+                    const LoxValueEnv &env);
+
+  /// write() to `path`, under a temporary name that is then renamed.
+  static bool save(StringRef path, StringRef prelude, const Program &program,
+                   const LoxValueEnv &env);
+
+  /// Map the snapshot at `path` made from `prelude`. Returns nullptr if there
+  /// is none, or it was made from another source or by another version.
+  static uptr<EnvSnapshot> load(StringRef path, StringRef prelude);
+
+  ~EnvSnapshot();
+
+  [[nodiscard]] std::size_t getBindingCount() const;
+
+  /// Define every binding in the innermost scope of `env`. The snapshot must
+  /// outlive `env`, whose names point into it.
+  void restore(LoxValueEnv &env) const;
+
+private:
+  explicit EnvSnapshot(uptr<MemoryBuffer> file);
+  bool verify(StringRef prelude);
+  [[nodiscard]] StringRef getString(std::uint32_t index) const;
+  /// The value of `entry`, whose keys and values are in `restored`.
+  [[nodiscard]] sptr<Value>
+  materialize(const snapshot::ValueEntry &entry,
+              ArrayRef<sptr<Value>> restored) const;
+
+  uptr<MemoryBuffer> file;
+  ArrayRef<snapshot::Binding> bindings;
+  ArrayRef<snapshot::ValueEntry> values;
+  ArrayRef<snapshot::StringEntry> strings;
+  StringRef stringData;
+};
+
+} // namespace lox
+
+#endif // __LOX_SNAPSHOT_HPP__
@@ -0,0 +1,50 @@
+#ifndef __LOX_STREAMING_HPP__
+#define __LOX_STREAMING_HPP__
+
+#include "lox/interpreter/Interpreter.hpp"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/SourceMgr.h"
+
+namespace lox {
+
+struct StreamingStats {
+  std::size_t Statements = 0u;
+  std::size_t SyntaxErrors = 0u;
+  /// Largest number of tokens alive at once.
+  std::size_t PeakTokens = 0u;
+};
+
+/// Lex, parse and execute `code` one declaration at a time. The lexer runs
+/// only as far ahead as the parser needs, each statement is executed as soon
+/// as it is parsed, and its tokens and AST are released right after, so
+/// memory stays roughly constant in the length of the script.
+///
+/// Unlike the batch pipeline, statements before a syntax error have already
+/// run when it is found; once one is found, the rest of the script is only
+/// parsed for diagnostics. The caller owns the global scope of the
+/// interpreter environment.
+StreamingStats interpretStreaming(SourceMgr &srcMgr, StringRef code,
+                                  StmtInterpreter &interpreter);
+
+struct PipelineOptions {
+  /// Tokens per batch handed from the lexer thread to the parser thread.
+  std::size_t TokenBatch = 1024u;
+  /// Declarations per batch handed from the parser thread to the executor.
+  std::size_t StmtBatch = 64u;
+  /// Batches in flight between two stages; a full queue stalls the producer.
+  std::size_t QueueDepth = 16u;
+};
+
+/// Streaming execution with the lexer and the parser on their own threads,
+/// connected to the calling (executing) thread by bounded lock-free rings.
+///
+/// Lexer and parser diagnostics travel with the declaration they belong to
+/// and are printed by the executing thread, so the order of all diagnostics
+/// and output is the same as interpretStreaming() regardless of timing.
+StreamingStats interpretPipelined(SourceMgr &srcMgr, StringRef code,
+                                  StmtInterpreter &interpreter,
+                                  const PipelineOptions &options = {});
+
+} // namespace lox
+
+#endif // __LOX_STREAMING_HPP__
@@ -1,8 +1,12 @@
 #ifndef __LOX_VALUE_HPP__
 #define __LOX_VALUE_HPP__
 
+#include "lox/interpreter/MapTable.hpp"
 #include "utils/TypeUtils.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
 #include <string>
 
 namespace lox {
@@ -13,6 +17,8 @@ enum ValueKind : unsigned {
   String,
   Bool,
   Nil,
+  Array,
+  Map,
 };
 
 class Value {
@@ -47,7 +53,8 @@ private:
 
 class StringValue : public Value {
 public:
-  explicit StringValue(const StringRef str) : Value(String), value(str.str()) {}
+  explicit StringValue(std::string str)
+      : Value(String), value(std::move(str)) {}
 
   [[nodiscard]] std::string str() const override;
   [[nodiscard]] bool truthy() const override;
@@ -55,7 +62,7 @@ public:
 
   static bool classof(const Value *value);
 
-  [[nodiscard]] auto getValue() const { return value; }
+  [[nodiscard]] const std::string &getValue() const { return value; }
 
 private:
   std::string value;
@@ -84,6 +91,75 @@ public:
   static bool classof(const Value *value);
 };
 
+/// A dense array of numbers, unboxed in one buffer. Like the other values it
+/// is immutable: indexing and the builtins make new arrays.
+///
+/// Elements are doubles, not long doubles like NumberValue, so that the bulk
+/// operations (see ArrayKernels.hpp) run on vectors of them.
+class ArrayValue : public Value {
+public:
+  /// Longest array the builtins make: 1 GiB of elements.
+  static constexpr std::size_t MaxSize = std::size_t{1u} << 27u;
+
+  explicit ArrayValue(SmallVector<double, 0> elements)
+      : Value(Array), elements(std::move(elements)) {}
+
+  [[nodiscard]] std::string str() const override;
+  [[nodiscard]] bool truthy() const override;
+  /// Equal lengths and elements.
+  [[nodiscard]] bool operator==(const Value &other) const override;
+
+  static bool classof(const Value *value);
+
+  [[nodiscard]] ArrayRef<double> getElements() const { return elements; }
+  [[nodiscard]] std::size_t size() const { return elements.size(); }
+
+private:
+  SmallVector<double, 0> elements;
+};
+
+/// A hash map from numbers, strings, booleans and nil to any values, in a
+/// MapTable. Like the other values it is immutable: `set` and `delete` make
+/// a new map with a copy of the table.
+class MapValue : public Value {
+public:
+  explicit MapValue(MapTable table) : Value(Map), table(std::move(table)) {}
+
+  [[nodiscard]] std::string str() const override;
+  [[nodiscard]] bool truthy() const override;
+  /// The same keys, mapped to equal values.
+  [[nodiscard]] bool operator==(const Value &other) const override;
+
+  static bool classof(const Value *value);
+
+  [[nodiscard]] const MapTable &getTable() const { return table; }
+  /// Only for a map nothing else refers to, which can't be observed changing.
+  [[nodiscard]] MapTable &getTable() { return table; }
+  [[nodiscard]] std::size_t size() const { return table.size(); }
+
+private:
+  MapTable table;
+};
+
+/// How `print` shows numbers.
+enum class NumberFormat : unsigned {
+  /// Six decimals, like printf's "%Lf" and NumberValue::str().
+  Fixed,
+  /// The shortest decimal that reads back as the same number, e.g. "0.1"
+  /// and "1e+30".
+  Shortest,
+};
+
+/// Write `value` to `os` in `format`, without allocating except for fixed
+/// numbers of 2^63 and more. Returns the number of bytes written.
+std::size_t printNumber(raw_ostream &os, long double value,
+                        NumberFormat format = NumberFormat::Fixed);
+
+/// Write `value` as `print` shows it, without the newline. Returns the number
+/// of bytes written.
+std::size_t printValue(raw_ostream &os, const Value &value,
+                       NumberFormat format = NumberFormat::Fixed);
+
 } // namespace lox
 
 #endif // __LOX_VALUE_HPP__
\ No newline at end of file
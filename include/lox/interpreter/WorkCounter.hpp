@@ -0,0 +1,56 @@
+#ifndef __LOX_WORK_COUNTER_HPP__
+#define __LOX_WORK_COUNTER_HPP__
+
+#include "llvm/Support/raw_ostream.h"
+#include <array>
+#include <cstdint>
+
+namespace lox {
+using namespace llvm;
+
+/// Deterministic counts of abstract work done by the interpreters.
+///
+/// Unlike wall-clock time these do not depend on machine load, so tests can
+/// put upper bounds on them and catch changes that make evaluation do more
+/// work.
+struct WorkCounters {
+  enum ExprNode : unsigned {
+    Binary,
+    Unary,
+    Grouping,
+    Literal,
+    Var,
+    Assign,
+    Array,
+    Index,
+    Call,
+    Map,
+    ExprNodeCount
+  };
+
+  enum StmtNode : unsigned { ExprS, PrintS, VarS, StmtNodeCount };
+
+  static const char *getExprNodeName(ExprNode node);
+  static const char *getStmtNodeName(StmtNode node);
+
+  std::array<std::uint64_t, ExprNodeCount> ExprVisits{};
+  std::array<std::uint64_t, StmtNodeCount> StmtVisits{};
+  std::uint64_t ValueAllocations = 0u;
+  std::uint64_t EnvLookups = 0u;
+  std::uint64_t EnvInserts = 0u;
+  std::uint64_t StringBytesCopied = 0u;
+
+  [[nodiscard]] std::uint64_t getExprVisits() const;
+  [[nodiscard]] std::uint64_t getStmtVisits() const;
+
+  /// Every counter summed with unit weight.
+  [[nodiscard]] std::uint64_t getTotal() const;
+
+  void reset() { *this = WorkCounters(); }
+
+  void print(raw_ostream &os) const;
+};
+
+} // namespace lox
+
+#endif // __LOX_WORK_COUNTER_HPP__
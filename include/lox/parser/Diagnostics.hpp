@@ -0,0 +1,164 @@
+#ifndef __LOX_DIAGNOSTICS_HPP__
+#define __LOX_DIAGNOSTICS_HPP__
+
+#include "utils/TypeUtils.hpp"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
+#include <array>
+#include <vector>
+
+namespace lox {
+using namespace llvm;
+
+/// Where a diagnostic comes from; each has its own limit and counter.
+enum class DiagCategory : unsigned { Lexer, Parser, Runtime };
+constexpr unsigned DiagCategoryCount = 3u;
+
+enum DiagCode : unsigned {
+#define DIAG(ID, CATEGORY, FORMAT) Diag_##ID,
+#include "lox/parser/Diagnostic.def"
+
+  DiagCodeCount
+};
+
+/// "unhandled_token" for Diag_unhandled_token.
+const char *getDiagName(DiagCode code);
+DiagCategory getDiagCategory(DiagCode code);
+/// "lexer", "parser" or "runtime".
+const char *getDiagCategoryName(DiagCategory category);
+
+/// A reported error, as recorded: its message is only formatted when it is
+/// rendered.
+struct Diagnostic {
+  DiagCode Code;
+  SMLoc Loc;
+  /// The arguments of the message, in DiagnosticEngine::getArgs().
+  unsigned FirstArg;
+  unsigned ArgCount;
+};
+
+struct DiagnosticOptions {
+  /// Diagnostics kept per category; beyond it they are only counted, and
+  /// summarized in one note. 0 for no limit.
+  unsigned MaxPerCategory = 0u;
+  /// Keep diagnostics until flush() instead of printing each as it is
+  /// reported.
+  bool Deferred = false;
+};
+
+/// Collects the diagnostics of the lexer, the parser and the interpreter
+/// (see DiagnosticSink). Each is recorded as its code, location and
+/// arguments; the line and column are looked up and the message formatted
+/// only when it's printed, which a diagnostic beyond the limit of its
+/// category never is.
+///
+/// Messages are printed like SourceMgr::PrintMessage(). An engine belongs to
+/// one thread at a time.
+class DiagnosticEngine {
+public:
+  explicit DiagnosticEngine(SourceMgr &srcMgr, raw_ostream &os = errs(),
+                            DiagnosticOptions options = DiagnosticOptions());
+
+  DiagnosticEngine(const DiagnosticEngine &) = delete;
+  DiagnosticEngine &operator=(const DiagnosticEngine &) = delete;
+
+  /// Record an error. `args` fill the {N} of the format of `code`; they are
+  /// copied.
+  void report(DiagCode code, SMLoc loc, ArrayRef<StringRef> args = {});
+
+  /// Print the diagnostics kept since the last flush, in deferred mode, and
+  /// a note for each category with suppressed diagnostics.
+  void flush();
+
+  /// Print every diagnostic kept as a JSON object:
+  /// {"diagnostics": [{"severity", "category", "code", "file", "line",
+  /// "column", "offset", "message", "args"}...], "errors": N,
+  /// "suppressed": {"lexer": N, "parser": N, "runtime": N}}
+  void printJSON(raw_ostream &os) const;
+
+  void setStream(raw_ostream &stream) { os = &stream; }
+
+  /// Errors reported, including suppressed ones.
+  [[nodiscard]] std::size_t getErrorCount() const;
+  [[nodiscard]] std::size_t getErrorCount(const DiagCategory category) const {
+    return errors[static_cast<unsigned>(category)];
+  }
+  [[nodiscard]] std::size_t getSuppressedCount(DiagCategory category) const;
+
+  /// Diagnostics kept, oldest first.
+  [[nodiscard]] ArrayRef<Diagnostic> getDiagnostics() const {
+    return diagnostics;
+  }
+  [[nodiscard]] ArrayRef<StringRef> getArgs(const Diagnostic &diag) const {
+    return ArrayRef<StringRef>(args).slice(diag.FirstArg, diag.ArgCount);
+  }
+  [[nodiscard]] std::string getMessage(const Diagnostic &diag) const;
+
+  SourceMgr &SrcMgr;
+
+private:
+  void print(const Diagnostic &diag);
+
+  raw_ostream *os;
+  DiagnosticOptions options;
+  std::vector<Diagnostic> diagnostics;
+  /// In deferred mode, diagnostics before this one were flushed.
+  std::size_t flushed = 0u;
+  SmallVector<StringRef, 0> args;
+  BumpPtrAllocator allocator;
+  StringSaver saver{allocator};
+  std::array<std::size_t, DiagCategoryCount> errors{};
+  std::array<std::size_t, DiagCategoryCount> kept{};
+  /// Suppressed diagnostics already summarized by flush().
+  std::array<std::size_t, DiagCategoryCount> summarized{};
+};
+
+/// How the lexer, the parser and the interpreter report: into an engine
+/// shared with the others, or by default into one of their own, which
+/// prints every diagnostic to a stream right away.
+class DiagnosticSink {
+public:
+  DiagnosticSink(SourceMgr &srcMgr, const DiagCategory category)
+      : srcMgr(&srcMgr), category(category) {}
+
+  /// Print to `os` (stderr by default) as diagnostics are reported.
+  void setStream(raw_ostream &os);
+
+  /// Report into `engine` from now on.
+  void setEngine(DiagnosticEngine &shared);
+
+  void report(const DiagCode code, const SMLoc loc,
+              const ArrayRef<StringRef> args = {}) {
+    if (!engine) {
+      own = mkuptr<DiagnosticEngine>(*srcMgr, *stream);
+      engine = own.get();
+    }
+    engine->report(code, loc, args);
+  }
+
+  /// Errors reported through this sink, into any engine.
+  [[nodiscard]] std::size_t getErrorCount() const {
+    return carried + (engine ? engine->getErrorCount(category) - base : 0u);
+  }
+
+private:
+  SourceMgr *srcMgr;
+  DiagCategory category;
+  raw_ostream *stream = &errs();
+  DiagnosticEngine *engine = nullptr;
+  /// Created on the first diagnostic without a shared engine.
+  uptr<DiagnosticEngine> own;
+  /// Errors of the category in `engine` before this sink used it.
+  std::size_t base = 0u;
+  /// Errors reported into the engines used before.
+  std::size_t carried = 0u;
+};
+
+} // namespace lox
+
+#endif // __LOX_DIAGNOSTICS_HPP__
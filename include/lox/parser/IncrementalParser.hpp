@@ -0,0 +1,113 @@
+#ifndef __LOX_INCREMENTAL_PARSER_HPP__
+#define __LOX_INCREMENTAL_PARSER_HPP__
+
+#include "lox/ast/AST.hpp"
+#include "lox/parser/Token.hpp"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <string>
+#include <vector>
+
+namespace lox {
+using namespace llvm;
+
+/// Replace `Removed` bytes at `Offset` with `Inserted`.
+struct TextEdit {
+  std::size_t Offset = 0u;
+  std::size_t Removed = 0u;
+  StringRef Inserted;
+};
+
+struct IncrementalDiagnostic {
+  /// Byte offset in the document.
+  std::size_t Offset;
+  std::string Message;
+};
+
+struct EditStats {
+  /// Bytes lexed again.
+  std::size_t RelexedBytes = 0u;
+  /// Declarations parsed again, and those kept as they were.
+  std::size_t ReparsedSegments = 0u;
+  std::size_t ReusedSegments = 0u;
+};
+
+/// A source buffer that is lexed and parsed again as it is edited, for
+/// editors and interactive sessions.
+///
+/// The document is kept as a sequence of segments, one per top-level
+/// declaration: each ends with the `;` of its declaration, and owns its
+/// tokens, its statements and its diagnostics. An edit re-lexes only the
+/// segments it touches, as one region, and cuts the result into segments
+/// at each `;` again. The region grows into the next segment while it
+/// doesn't end at a declaration boundary, e.g. after deleting a `;` or
+/// opening a string. Untouched segments, and the Stmt trees in them, are
+/// reused as they are.
+///
+/// Since segments own their text, locations in the AST and tokens point
+/// into the segment buffers, not into one contiguous document; offsets in
+/// the document are reported by getDiagnostics() and getOffset().
+/// A segment that fails to lex isn't parsed, like in the batch driver.
+class IncrementalDocument {
+public:
+  explicit IncrementalDocument(StringRef text = "", StringRef name = "");
+  ~IncrementalDocument();
+
+  IncrementalDocument(const IncrementalDocument &) = delete;
+  IncrementalDocument &operator=(const IncrementalDocument &) = delete;
+
+  /// Apply `edit`. Edits past the end of the document are clamped to it.
+  EditStats edit(const TextEdit &edit);
+
+  [[nodiscard]] std::size_t size() const;
+  /// The whole text; linear in the size of the document.
+  [[nodiscard]] std::string getText() const;
+
+  /// Every top-level statement in order. Statements of untouched segments
+  /// are the same objects before and after an edit.
+  void getStatements(SmallVectorImpl<const Stmt *> &statements) const;
+
+  [[nodiscard]] std::vector<IncrementalDiagnostic> getDiagnostics() const;
+  [[nodiscard]] std::size_t getErrorCount() const { return errors; }
+
+  [[nodiscard]] std::size_t getSegmentCount() const { return segments.size(); }
+
+  /// Document offset of `loc`, a location in a token or statement of this
+  /// document, or npos. Linear in the number of segments.
+  [[nodiscard]] std::size_t getOffset(SMLoc loc) const;
+
+private:
+  struct Segment;
+
+  /// Lex and parse `text` into `result`. With `atEnd` the text runs to the
+  /// end of the document; otherwise this fails if `text` doesn't end at a
+  /// declaration boundary.
+  bool parseRegion(StringRef text, bool atEnd,
+                   std::vector<uptr<Segment>> &result) const;
+
+  /// Index of the segment holding `offset`; the last segment holds the end.
+  [[nodiscard]] std::size_t findSegment(std::size_t offset) const;
+
+  /// Document offset of segment `index`, or of the end.
+  [[nodiscard]] std::size_t getStart(std::size_t index) const {
+    return starts[index] + (index >= shiftFrom ? shift : 0u);
+  }
+
+  /// Apply the pending shift below `index` and undo it from `index` on, so
+  /// that it starts at `index`.
+  void moveShift(std::size_t index);
+
+  std::string name;
+  std::vector<uptr<Segment>> segments;
+  /// Document offset of each segment, and of the end, without the shift.
+  std::vector<std::size_t> starts;
+  /// Pending change of the offsets from `shiftFrom` on: an edit only
+  /// updates the offsets between it and the previous edit.
+  std::size_t shiftFrom;
+  std::size_t shift;
+  std::size_t errors;
+};
+
+} // namespace lox
+
+#endif // __LOX_INCREMENTAL_PARSER_HPP__
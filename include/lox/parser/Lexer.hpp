@@ -1,6 +1,7 @@
 #ifndef __LEXER_HPP__
 #define __LEXER_HPP__
 
+#include "lox/parser/Diagnostics.hpp"
 #include "lox/parser/Token.hpp"
 #include "utils/TypeUtils.hpp"
 #include "llvm/ADT/SmallVector.h"
@@ -12,22 +13,43 @@
 namespace lox {
 using namespace llvm;
 
-class Lexer {
+class Lexer : public TokenSource {
 public:
   Lexer(SourceMgr &S, const StringRef code)
-      : SrcMgr(S), buffer(code), cursor(0u), errorNum(0u) {}
+      : SrcMgr(S), buffer(code), cursor(0u), tokenIndex(0u),
+        diags(S, DiagCategory::Lexer) {}
 
   SourceMgr &SrcMgr;
 
+  /// Tokenize the whole buffer into getTokens().
   bool Lex();
 
+  /// Lex a single token on demand without storing it. Used by the streaming
+  /// parser; don't mix with Lex().
+  uptr<Token> next() override;
+
   static constexpr char CharEof = static_cast<char>(EOF);
 
   ArrayRef<uptr<Token>> getTokens() const { return tokens; }
 
+  /// Hand over the tokens produced by Lex().
+  SmallVector<uptr<Token>> takeTokens() { return std::move(tokens); }
+
+  [[nodiscard]] std::size_t getError() const { return diags.getErrorCount(); }
+
+  /// Where diagnostics are printed; stderr by default.
+  void setDiagnosticStream(raw_ostream &os) { diags.setStream(os); }
+
+  /// Report into `engine`, shared with the parser and the interpreter.
+  void setDiagnosticEngine(DiagnosticEngine &engine) {
+    diags.setEngine(engine);
+  }
+
 private:
   Token addNextToken();
 
+  Token lexToken();
+
   [[nodiscard]] char peekChar(int lookAt = 0) const;
 
   char getNextChar();
@@ -44,12 +66,10 @@ private:
 
   static bool isWhitespace(char ch);
 
-  void report(SMLoc loc, SourceMgr::DiagKind kind, StringRef msg,
-              raw_ostream &os = errs());
-
   StringRef buffer;
   std::size_t cursor;
-  std::size_t errorNum;
+  std::size_t tokenIndex;
+  DiagnosticSink diags;
 
   SmallVector<uptr<Token>> tokens;
 };
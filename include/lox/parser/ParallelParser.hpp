@@ -0,0 +1,51 @@
+#ifndef __LOX_PARALLEL_PARSER_HPP__
+#define __LOX_PARALLEL_PARSER_HPP__
+
+#include "lox/ast/AST.hpp"
+#include "lox/parser/Token.hpp"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace lox {
+using namespace llvm;
+
+struct ParallelParseOptions {
+  /// Worker threads; 0 uses every hardware thread.
+  unsigned Threads = 0u;
+  /// Smallest chunk handed to a worker, in bytes.
+  std::size_t MinChunkSize = 1u << 20;
+};
+
+struct ParsedSource {
+  /// Every token of the source, numbered as the sequential Lexer would.
+  SmallVector<uptr<Token>, 0> Tokens;
+  /// Empty when there were lexer errors, like the batch driver.
+  Program Statements;
+  std::size_t LexErrors = 0u;
+  std::size_t ParseErrors = 0u;
+  /// Chunks that were lexed and parsed independently.
+  std::size_t Chunks = 0u;
+  /// Chunk boundaries that turned out not to be statement boundaries.
+  std::size_t Misspeculations = 0u;
+};
+
+/// Lex and parse `code` on a thread pool.
+///
+/// A cheap speculative pre-scan splits the buffer at line breaks that follow
+/// a `;`. Each chunk gets its own Lexer and Parser; since the chunks are
+/// slices of the same buffer, every SMLoc is already right. A boundary that
+/// was actually inside a string literal or comment, or inside a statement,
+/// shows up as a chunk that doesn't end in a `;` token; that chunk is merged
+/// with the next one and re-parsed. The chunks are then stitched together in
+/// order, with token indices renumbered.
+///
+/// Tokens, statements and diagnostics (written to `diagOS`) are identical to
+/// Lexer::Lex() followed by Parser::Parse().
+ParsedSource parseParallel(SourceMgr &srcMgr, StringRef code,
+                           const ParallelParseOptions &options = {},
+                           raw_ostream &diagOS = errs());
+
+} // namespace lox
+
+#endif // __LOX_PARALLEL_PARSER_HPP__
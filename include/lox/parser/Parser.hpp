@@ -2,6 +2,7 @@
 #define __LOX_PARSER_HPP__
 
 #include "lox/ast/AST.hpp"
+#include "lox/parser/Diagnostics.hpp"
 #include "lox/parser/Token.hpp"
 #include "utils/TypeUtils.hpp"
 #include "llvm/Support/SourceMgr.h"
@@ -12,8 +13,16 @@ using namespace llvm;
 
 class Parser {
 public:
-  Parser(const ArrayRef<uptr<Token>> &tokens, SourceMgr &srcMgr)
-      : SrcMgr(srcMgr), errorNum(0u), tokens(tokens), cursor(0u){};
+  Parser(const ArrayRef<uptr<Token>> tokens, SourceMgr &srcMgr)
+      : SrcMgr(srcMgr), tokens(tokens), source(nullptr), windowBase(0u),
+        cursor(0u), diags(srcMgr, DiagCategory::Parser){};
+
+  /// Streaming parser: tokens are pulled from `source` as they are needed and
+  /// kept only until ReleaseTokens() hands them over, so memory stays
+  /// proportional to the declaration being parsed.
+  Parser(TokenSource &source, SourceMgr &srcMgr)
+      : SrcMgr(srcMgr), source(&source), windowBase(0u), cursor(0u),
+        diags(srcMgr, DiagCategory::Parser){};
 
   SourceMgr &SrcMgr;
 
@@ -24,9 +33,41 @@ public:
   uptr<Stmt> Declaration();
 
   /// expression -> assignment
+  /// assignment -> IDENTIFIER "=" assignment | binary
+  /// binary     -> unary ( OPERATOR unary )*
+  ///
+  /// Binary operators are parsed by precedence climbing over an operator
+  /// table, see getPrecedence().
   uptr<Expr> Expression();
 
-  [[nodiscard]] std::size_t getError() const { return errorNum; }
+  /// Streaming mode only: take ownership of every token consumed so far. The
+  /// AST returned by Declaration() refers to them, so keep them alive as long
+  /// as that AST.
+  SmallVector<uptr<Token>> ReleaseTokens();
+
+  [[nodiscard]] bool isAtEnd() const {
+    return peek()->Kind == TokenKind::Tok_eof;
+  }
+
+  [[nodiscard]] std::size_t getError() const { return diags.getErrorCount(); }
+
+  /// Where diagnostics are printed; stderr by default.
+  void setDiagnosticStream(raw_ostream &os) { diags.setStream(os); }
+
+  /// Report into `engine`, shared with the lexer and the interpreter.
+  void setDiagnosticEngine(DiagnosticEngine &engine) {
+    diags.setEngine(engine);
+  }
+
+  /// Default of setMaxDepth(): deep enough for any hand-written script, and
+  /// shallow enough that the passes over the tree which still recurse, like
+  /// its destructor, fit in a thread stack in a debug build.
+  static constexpr unsigned DefaultMaxDepth = 5000u;
+
+  /// Report expressions nested deeper than `depth` as errors instead of
+  /// building their trees.
+  void setMaxDepth(const unsigned depth) { maxDepth = depth; }
+  [[nodiscard]] unsigned getMaxDepth() const { return maxDepth; }
 
 private:
   /// varDecl -> "var" IDENTIFIER ( "=" expression )? ";"
@@ -41,31 +82,69 @@ private:
   /// print statement -> "print" expr ';'
   uptr<Stmt> printStmt();
 
-  /// assignment -> IDENTIFIER "=" expression | equality
-  uptr<Expr> assignment();
+  /// Binding power of the binary operators, loosest first.
+  enum class Precedence : unsigned {
+    None,
+    Assignment,
+    Equality,
+    Comparison,
+    Term,
+    Factor,
+    Unary,
+  };
+
+  /// The operator table: the precedence of `kind` as a binary operator, or
+  /// None. All of them are left-associative except assignment.
+  static Precedence getPrecedence(TokenKind kind);
+
+  /// An expression whose binary operators bind at least as tightly as
+  /// `min`. `height` is set to the height of its tree.
+  uptr<Expr> expression(Precedence min, unsigned &height);
+
+  /// unary -> ( "!" | "-" ) unary
+  ///         | postfix
+  uptr<Expr> unary(unsigned &height);
+
+  /// postfix -> primary ( "[" expression "]" )*
+  uptr<Expr> postfix(unsigned &height);
 
-  /// equality -> comparison ( ( "!=" | "==" ) comparison )*
-  uptr<Expr> equality();
+  /// primary -> NUMBER | STRING | "true" | "false" | "nil" | "(" expression ")"
+  ///          | IDENTIFIER | call | "[" arguments? "]" | "{" entries? "}"
+  uptr<Expr> primary(unsigned &height);
 
-  /// comparison -> term ((">" | ">=" | "<" | "<=" ) term )*
-  uptr<Expr> comparison();
+  /// call -> IDENTIFIER "(" arguments? ")", once past the "(".
+  uptr<Expr> call(Token *callee, unsigned &height);
 
-  /// term -> factor ( ( "-" | "+" ) factor )*
-  uptr<Expr> term();
+  /// arguments -> expression ( "," expression )*, then `close`. `height` is
+  /// that of a node with `args` as its operands.
+  bool arguments(TokenKind close, SmallVectorImpl<uptr<Expr>> &args,
+                 unsigned &height);
 
-  /// factor -> unary ( ( "*" | "/" ) unary) *
-  uptr<Expr> factor();
+  /// entries -> expression ":" expression ( "," expression ":" expression )*,
+  /// then "}". Keys and values alternate in `operands`.
+  bool entries(SmallVectorImpl<uptr<Expr>> &operands, unsigned &height);
 
-  /// unary -> ( "!" | "-" ) unary
-  ///         | primary
-  uptr<Expr> unary();
+  /// Consume a `kind` token, or report.
+  bool expect(TokenKind kind);
 
-  /// primary -> NUMBER | STRING | "true" | "false" | "nil" | "(" expression ")"
-  uptr<Expr> primary();
+  /// Count a nesting level of the parser; reports and returns false beyond
+  /// the maximum depth.
+  bool enter();
+  void leave() { --depth; }
+  void reportTooDeep(SMLoc loc);
 
   void synchronize();
 
-  [[nodiscard]] Token *peek() const { return tokens[cursor].get(); }
+  [[nodiscard]] Token *tokenAt(const std::size_t index) const {
+    if (!source)
+      return tokens[index].get();
+    return fetch(index);
+  }
+
+  /// Streaming mode: pull tokens from the source up to `index`.
+  Token *fetch(std::size_t index) const;
+
+  [[nodiscard]] Token *peek() const { return tokenAt(cursor); }
 
   Token *advance() {
     if (!isAtEnd())
@@ -73,11 +152,7 @@ private:
     return previous();
   }
 
-  [[nodiscard]] Token *previous() const { return tokens[cursor - 1].get(); }
-
-  [[nodiscard]] bool isAtEnd() const {
-    return peek()->Kind == TokenKind::Tok_eof;
-  }
+  [[nodiscard]] Token *previous() const { return tokenAt(cursor - 1); }
 
   [[nodiscard]] bool check(const TokenKind kind) const {
     if (isAtEnd())
@@ -98,16 +173,18 @@ private:
     }
   }
 
-  void report(SMLoc loc, SourceMgr::DiagKind kind, StringRef msg,
-              raw_ostream &os = llvm::errs()) {
-    SrcMgr.PrintMessage(os, loc, kind, msg);
-    if (kind == SourceMgr::DK_Error)
-      errorNum++;
-  }
+  ArrayRef<uptr<Token>> tokens;
+
+  TokenSource *source;
+  /// Streaming mode: tokens [windowBase, windowBase + window.size())
+  mutable SmallVector<uptr<Token>, 32> window;
+  std::size_t windowBase;
 
-  unsigned errorNum;
-  const ArrayRef<uptr<Token>> &tokens;
   std::size_t cursor;
+  DiagnosticSink diags;
+  unsigned maxDepth = DefaultMaxDepth;
+  /// Nesting levels the parser is in, below the current statement.
+  unsigned depth = 0u;
 };
 
 } // namespace lox
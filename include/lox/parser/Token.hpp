@@ -1,6 +1,7 @@
 #ifndef __LOX_TOKEN_HPP__
 #define __LOX_TOKEN_HPP__
 
+#include "utils/TypeUtils.hpp"
 #include "llvm/Support/SMLoc.h"
 
 #include <llvm/ADT/StringRef.h>
@@ -28,6 +29,14 @@ struct Token {
       : Loc(loc), Index(index), Kind(kind), Symbol(symbol) {}
 };
 
+/// Produces tokens one at a time, e.g. for the streaming parser. Once the eof
+/// token has been returned, every further call returns eof again.
+class TokenSource {
+public:
+  virtual ~TokenSource() = default;
+  virtual uptr<Token> next() = 0;
+};
+
 
 } // namespace lox
 
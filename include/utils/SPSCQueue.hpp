@@ -0,0 +1,91 @@
+#ifndef __SPSC_QUEUE__
+#define __SPSC_QUEUE__
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/// Bounded lock-free single-producer/single-consumer ring.
+///
+/// One thread may push and one other thread may pop. A full ring makes the
+/// producer wait, which bounds the memory held between pipeline stages. The
+/// producer calls close() after its last push; pop() then drains the ring and
+/// returns std::nullopt.
+template <typename T>
+class SPSCQueue {
+public:
+  explicit SPSCQueue(const std::size_t capacity)
+      : slots(roundUp(capacity)), mask(slots.size() - 1u), head(0u), tail(0u),
+        closed(false) {}
+
+  SPSCQueue(const SPSCQueue &) = delete;
+  SPSCQueue &operator=(const SPSCQueue &) = delete;
+
+  bool tryPush(T &value) {
+    const auto t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == slots.size())
+      return false;
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1u, std::memory_order_release);
+    return true;
+  }
+
+  void push(T value) {
+    for (unsigned spins = 0u; !tryPush(value); ++spins)
+      backoff(spins);
+  }
+
+  bool tryPop(T &value) {
+    const auto h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    value = std::move(slots[h & mask]);
+    head.store(h + 1u, std::memory_order_release);
+    return true;
+  }
+
+  std::optional<T> pop() {
+    T value;
+    for (unsigned spins = 0u;; ++spins) {
+      if (tryPop(value))
+        return value;
+      if (closed.load(std::memory_order_acquire)) {
+        // Items pushed before close() are visible now.
+        if (tryPop(value))
+          return value;
+        return std::nullopt;
+      }
+      backoff(spins);
+    }
+  }
+
+  void close() { closed.store(true, std::memory_order_release); }
+
+  [[nodiscard]] std::size_t capacity() const { return slots.size(); }
+
+private:
+  static std::size_t roundUp(const std::size_t capacity) {
+    assert(capacity && "empty ring");
+    std::size_t size = 1u;
+    while (size < capacity)
+      size <<= 1u;
+    return size;
+  }
+
+  static void backoff(const unsigned spins) {
+    if (spins > 64u)
+      std::this_thread::yield();
+  }
+
+  std::vector<T> slots;
+  const std::size_t mask;
+
+  alignas(64) std::atomic<std::size_t> head;
+  alignas(64) std::atomic<std::size_t> tail;
+  alignas(64) std::atomic<bool> closed;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef __TRACE__
+#define __TRACE__
+
+/// Static user-space tracepoints (USDT) under the provider `lox`.
+///
+/// Each probe is a single `nop` plus an entry in the `.note.stapsdt` ELF
+/// section, so bpftrace/perf/systemtap can attach to a running process
+/// (`bpftrace -e 'usdt:./lox:lox:stmt__begin { ... }'`) and nothing is paid
+/// until they do. The system <sys/sdt.h> is used when present; otherwise an
+/// equivalent header-only emitter is used on x86-64 ELF targets. Everywhere
+/// else, or without LOX_ENABLE_USDT, the probes compile to nothing and their
+/// arguments are not evaluated.
+///
+/// All probe arguments are passed as 64-bit integers.
+
+#if defined(LOX_ENABLE_USDT) && __has_include(<sys/sdt.h>)
+
+#include <sys/sdt.h>
+
+#define LOX_TRACE0(name) DTRACE_PROBE(lox, name)
+#define LOX_TRACE1(name, a)                                                    \
+  DTRACE_PROBE1(lox, name, (unsigned long long)(a))
+#define LOX_TRACE2(name, a, b)                                                 \
+  DTRACE_PROBE2(lox, name, (unsigned long long)(a), (unsigned long long)(b))
+#define LOX_TRACE3(name, a, b, c)                                              \
+  DTRACE_PROBE3(lox, name, (unsigned long long)(a), (unsigned long long)(b),  \
+                (unsigned long long)(c))
+
+#elif defined(LOX_ENABLE_USDT) && defined(__x86_64__) && defined(__ELF__)
+
+#define LOX_SDT_BASE                                                           \
+  ".ifndef _.stapsdt.base\n"                                                   \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"      \
+  ".weak _.stapsdt.base\n"                                                     \
+  ".hidden _.stapsdt.base\n"                                                   \
+  "_.stapsdt.base: .space 1\n"                                                 \
+  ".size _.stapsdt.base, 1\n"                                                  \
+  ".popsection\n"                                                              \
+  ".endif\n"
+
+#define LOX_SDT_PROBE(name, args, ...)                                         \
+  __asm__ __volatile__("990: nop\n"                                            \
+                       ".pushsection .note.stapsdt,\"?\",\"note\"\n"           \
+                       ".balign 4\n"                                           \
+                       ".4byte 992f-991f, 994f-993f, 3\n"                      \
+                       "991: .asciz \"stapsdt\"\n"                             \
+                       "992: .balign 4\n"                                      \
+                       "993: .8byte 990b\n"                                    \
+                       ".8byte _.stapsdt.base\n"                               \
+                       ".8byte 0\n"                                            \
+                       ".asciz \"lox\"\n"                                      \
+                       ".asciz \"" #name "\"\n"                                \
+                       ".asciz \"" args "\"\n"                                 \
+                       "994: .balign 4\n"                                      \
+                       ".popsection\n" LOX_SDT_BASE ::__VA_ARGS__)
+
+#define LOX_SDT_ARG(a) "nor"((unsigned long long)(a))
+
+#define LOX_TRACE0(name) LOX_SDT_PROBE(name, "", )
+#define LOX_TRACE1(name, a) LOX_SDT_PROBE(name, "8@%0", LOX_SDT_ARG(a))
+#define LOX_TRACE2(name, a, b)                                                 \
+  LOX_SDT_PROBE(name, "8@%0 8@%1", LOX_SDT_ARG(a), LOX_SDT_ARG(b))
+#define LOX_TRACE3(name, a, b, c)                                              \
+  LOX_SDT_PROBE(name, "8@%0 8@%1 8@%2", LOX_SDT_ARG(a), LOX_SDT_ARG(b),       \
+                LOX_SDT_ARG(c))
+
+#else
+
+#define LOX_TRACE0(name)                                                       \
+  do {                                                                         \
+  } while (false)
+#define LOX_TRACE1(name, a) LOX_TRACE0(name)
+#define LOX_TRACE2(name, a, b) LOX_TRACE0(name)
+#define LOX_TRACE3(name, a, b, c) LOX_TRACE0(name)
+
+#endif
+
+#endif
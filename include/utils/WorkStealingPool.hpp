@@ -0,0 +1,156 @@
+#ifndef __WORK_STEALING_POOL__
+#define __WORK_STEALING_POOL__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Fixed-size thread pool where every worker owns a task deque.
+///
+/// A worker runs its own tasks newest first, which keeps the data of the
+/// task it just spawned in cache, and when it runs dry it steals the oldest
+/// task of another worker. Tasks submitted from outside the pool are dealt
+/// round-robin; tasks submitted from a worker go to that worker's deque.
+/// Idle workers sleep until something is submitted.
+class WorkStealingPool {
+public:
+  using Task = std::function<void()>;
+
+  explicit WorkStealingPool(unsigned threads = 0u) {
+    if (!threads)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0u; i < threads; ++i)
+      workers.emplace_back(std::make_unique<Worker>());
+    for (unsigned i = 0u; i < threads; ++i)
+      this->threads.emplace_back([this, i] { work(i); });
+  }
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  ~WorkStealingPool() {
+    wait();
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+  void async(Task task) {
+    const auto self =
+        CurrentPool == this ? CurrentWorker : nextWorker++ % workers.size();
+    pending.fetch_add(1u, std::memory_order_relaxed);
+    {
+      auto &worker = *workers[self];
+      std::lock_guard<std::mutex> lock(worker.Mutex);
+      worker.Tasks.push_back(std::move(task));
+    }
+    queued++;
+    // A worker announces itself in `sleepers` before its last look at
+    // `queued`, so either it sees this task or we see it and wake it.
+    if (sleepers.load()) {
+      { std::lock_guard<std::mutex> lock(sleepMutex); }
+      wake.notify_one();
+    }
+  }
+
+  /// Block until every submitted task, including the ones submitted by tasks,
+  /// has finished.
+  void wait() {
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    done.wait(lock, [this] { return !pending.load(); });
+  }
+
+  [[nodiscard]] unsigned getThreadCount() const { return threads.size(); }
+
+  /// Tasks taken from another worker's deque so far.
+  [[nodiscard]] std::size_t getStealCount() const { return steals.load(); }
+
+private:
+  struct alignas(64) Worker {
+    std::mutex Mutex;
+    std::deque<Task> Tasks;
+  };
+
+  bool popOwn(const unsigned self, Task &task) {
+    auto &worker = *workers[self];
+    std::lock_guard<std::mutex> lock(worker.Mutex);
+    if (worker.Tasks.empty())
+      return false;
+    task = std::move(worker.Tasks.back());
+    worker.Tasks.pop_back();
+    return true;
+  }
+
+  bool steal(const unsigned self, Task &task) {
+    for (std::size_t i = 1u; i < workers.size(); ++i) {
+      auto &victim = *workers[(self + i) % workers.size()];
+      std::lock_guard<std::mutex> lock(victim.Mutex);
+      if (victim.Tasks.empty())
+        continue;
+      task = std::move(victim.Tasks.front());
+      victim.Tasks.pop_front();
+      steals.fetch_add(1u, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  void work(const unsigned self) {
+    CurrentPool = this;
+    CurrentWorker = self;
+    Task task;
+    for (;;) {
+      if (popOwn(self, task) || steal(self, task)) {
+        queued--;
+        task();
+        task = nullptr;
+        if (pending.fetch_sub(1u) == 1u) {
+          std::lock_guard<std::mutex> lock(sleepMutex);
+          done.notify_all();
+        }
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      sleepers++;
+      wake.wait(lock, [this] { return stopping || queued.load(); });
+      sleepers--;
+      if (stopping && !queued.load())
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  /// Guarded by sleepMutex.
+  bool stopping = false;
+
+  /// Tasks sitting in some deque.
+  std::atomic<std::size_t> queued{0u};
+  std::atomic<unsigned> sleepers{0u};
+
+  /// Tasks submitted and not finished yet.
+  std::atomic<std::size_t> pending{0u};
+  std::atomic<std::size_t> nextWorker{0u};
+  std::atomic<std::size_t> steals{0u};
+
+  static inline thread_local const WorkStealingPool *CurrentPool = nullptr;
+  static inline thread_local unsigned CurrentWorker = 0u;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "lox/ast/AST.hpp"
+#include "llvm/ADT/StringSwitch.h"
+
+namespace lox {
+
+const char *getBuiltinName(const Builtin builtin) {
+  static const char *names[] = {
+#define BUILTIN(ID, ARITY) #ID,
+#include "lox/ast/Builtin.def"
+  };
+  return names[static_cast<unsigned>(builtin)];
+}
+
+unsigned getBuiltinArity(const Builtin builtin) {
+  static const unsigned arities[] = {
+#define BUILTIN(ID, ARITY) ARITY,
+#include "lox/ast/Builtin.def"
+  };
+  return arities[static_cast<unsigned>(builtin)];
+}
+
+opt<Builtin> lookupBuiltin(const StringRef name) {
+  return StringSwitch<opt<Builtin>>(name)
+#define BUILTIN(ID, ARITY) .Case(#ID, Builtin_##ID)
+#include "lox/ast/Builtin.def"
+      .Default(std::nullopt);
+}
+
+} // namespace lox
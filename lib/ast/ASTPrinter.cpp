@@ -36,6 +36,46 @@ void ExprPrinter::operator()(const AssignE &assignE) {
   ss << ")";
 }
 
+void ExprPrinter::operator()(const ArrayE &arrayE) {
+  ss << '[';
+  printList(arrayE.getElements());
+  ss << ']';
+}
+
+void ExprPrinter::operator()(const IndexE &indexE) {
+  std::visit(*this, *indexE.getArray());
+  ss << '[';
+  std::visit(*this, *indexE.getIndex());
+  ss << ']';
+}
+
+void ExprPrinter::operator()(const CallE &callE) {
+  ss << callE.getCallee()->Symbol << '(';
+  printList(callE.getArgs());
+  ss << ')';
+}
+
+void ExprPrinter::operator()(const MapE &mapE) {
+  ss << '{';
+  const auto operands = mapE.getOperands();
+  for (std::size_t i = 0u; i < operands.size(); i += 2u) {
+    if (i)
+      ss << ", ";
+    std::visit(*this, *operands[i]);
+    ss << ": ";
+    std::visit(*this, *operands[i + 1u]);
+  }
+  ss << '}';
+}
+
+void ExprPrinter::printList(const ArrayRef<uptr<Expr>> exprs) {
+  for (const auto &expr : exprs) {
+    if (&expr != exprs.begin())
+      ss << ", ";
+    std::visit(*this, *expr);
+  }
+}
+
 void StmtPrinter::operator()(const ExprStmt &exprStmt) {
   exprPrint(*exprStmt.getExpr());
   ss << ";\n";
@@ -0,0 +1,212 @@
+#include "lox/driver/BatchDriver.hpp"
+#include "lox/driver/Driver.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+
+namespace lox {
+
+namespace {
+
+struct FileResult {
+  std::string Output;
+  std::string Diagnostics;
+  int ExitCode = Exit_success;
+};
+
+/// Hands per-file results from the workers to the thread that writes them,
+/// in input order.
+class OrderedCollector {
+public:
+  explicit OrderedCollector(const std::size_t files) : results(files) {}
+
+  void publish(const std::size_t index, FileResult result) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      results[index] = std::move(result);
+    }
+    ready.notify_one();
+  }
+
+  /// Blocks until the result of `index` is published, then takes it.
+  FileResult take(const std::size_t index) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait(lock, [&] { return results[index].has_value(); });
+    auto result = std::move(*results[index]);
+    results[index].reset();
+    return result;
+  }
+
+private:
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::vector<std::optional<FileResult>> results;
+};
+
+FileResult runBatchFile(const StringRef path, const BatchOptions &options) {
+  FileResult result;
+  raw_string_ostream os(result.Output);
+  raw_string_ostream diagOS(result.Diagnostics);
+
+  auto bufferOrError = MemoryBuffer::getFile(path);
+  if (!bufferOrError) {
+    diagOS << formatv("cannot open '{0}': {1}\n", path,
+                      bufferOrError.getError().message());
+    result.ExitCode = Exit_noinput;
+    return result;
+  }
+
+  SourceMgr srcMgr;
+  const auto id = srcMgr.AddNewSourceBuffer(std::move(*bufferOrError), {});
+  const auto code = srcMgr.getMemoryBuffer(id)->getBuffer();
+
+  Lexer lexer(srcMgr, code);
+  lexer.setDiagnosticStream(diagOS);
+  if (!lexer.Lex()) {
+    result.ExitCode = Exit_data;
+    return result;
+  }
+
+  Parser parser(lexer.getTokens(), srcMgr);
+  parser.setDiagnosticStream(diagOS);
+  const auto program = parser.Parse();
+  if (parser.getError()) {
+    result.ExitCode = Exit_data;
+    return result;
+  }
+  if (options.SyntaxOnly)
+    return result;
+
+  LoxValueEnv env;
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  exprInterpreter.setDiagnosticStream(diagOS);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+  {
+    LoxValueScope globalScope(env);
+    for (const auto &stmt : program)
+      std::visit(stmtInterpreter, *stmt);
+  }
+  if (stmtInterpreter.getError())
+    result.ExitCode = Exit_software;
+  return result;
+}
+
+/// Exit_data is the more severe outcome: the script never ran.
+int worseExitCode(const int lhs, const int rhs) {
+  const auto rank = [](const int code) {
+    switch (code) {
+    case Exit_success:
+      return 0;
+    case Exit_software:
+      return 1;
+    case Exit_data:
+      return 2;
+    default:
+      return 3;
+    }
+  };
+  return rank(lhs) >= rank(rhs) ? lhs : rhs;
+}
+
+} // namespace
+
+bool collectBatchInputs(const StringRef path,
+                        SmallVectorImpl<std::string> &files,
+                        raw_ostream &diagOS) {
+  if (sys::fs::is_directory(path)) {
+    std::error_code ec;
+    SmallVector<std::string> found;
+    for (sys::fs::recursive_directory_iterator it(path, ec), end;
+         it != end && !ec; it.increment(ec)) {
+      if (sys::path::extension(it->path()) == ".lox" &&
+          it->type() != sys::fs::file_type::directory_file)
+        found.push_back(it->path());
+    }
+    if (ec) {
+      diagOS << formatv("cannot read directory '{0}': {1}\n", path,
+                        ec.message());
+      return false;
+    }
+    std::sort(found.begin(), found.end());
+    files.append(found.begin(), found.end());
+    return true;
+  }
+
+  auto bufferOrError = MemoryBuffer::getFile(path);
+  if (!bufferOrError) {
+    diagOS << formatv("cannot open manifest '{0}': {1}\n", path,
+                      bufferOrError.getError().message());
+    return false;
+  }
+
+  const auto dir = sys::path::parent_path(path);
+  SmallVector<StringRef> lines;
+  (*bufferOrError)->getBuffer().split(lines, '\n');
+  for (auto line : lines) {
+    line = line.trim();
+    if (line.empty() || line.startswith("#"))
+      continue;
+    if (sys::path::is_absolute(line) || dir.empty()) {
+      files.push_back(line.str());
+      continue;
+    }
+    SmallString<128> entry(dir);
+    sys::path::append(entry, line);
+    files.push_back(entry.str().str());
+  }
+  return true;
+}
+
+BatchSummary runBatch(const ArrayRef<std::string> files,
+                      const BatchOptions &options, raw_ostream &os,
+                      raw_ostream &diagOS) {
+  const auto start = std::chrono::steady_clock::now();
+  BatchSummary summary;
+  summary.Files = files.size();
+
+  OrderedCollector collector(files.size());
+  std::atomic<std::size_t> next(0u);
+  ThreadPool pool(hardware_concurrency(options.Threads));
+  const auto workers = std::min<std::size_t>(
+      std::max<std::size_t>(pool.getThreadCount(), 1u), files.size());
+  for (std::size_t w = 0u; w < workers; ++w) {
+    pool.async([&] {
+      for (auto i = next++; i < files.size(); i = next++)
+        collector.publish(i, runBatchFile(files[i], options));
+    });
+  }
+
+  // Write results as they complete, in order, while the pool keeps going.
+  for (std::size_t i = 0u; i < files.size(); ++i) {
+    const auto result = collector.take(i);
+    os << result.Output;
+    if (!result.Diagnostics.empty()) {
+      // Keep stdout and stderr interleaved per file on a terminal.
+      os.flush();
+      diagOS << result.Diagnostics;
+    }
+    if (result.ExitCode != Exit_success)
+      summary.Failed++;
+    summary.ExitCode = worseExitCode(summary.ExitCode, result.ExitCode);
+  }
+  pool.wait();
+  os.flush();
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  summary.Seconds = elapsed.count();
+  return summary;
+}
+
+} // namespace lox
@@ -0,0 +1,416 @@
+#include "lox/driver/Driver.hpp"
+#include "lox/driver/BatchDriver.hpp"
+#include "lox/driver/Server.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/ParallelInterpreter.hpp"
+#include "lox/interpreter/Profiler.hpp"
+#include "lox/interpreter/ResultCache.hpp"
+#include "lox/interpreter/ScriptCache.hpp"
+#include "lox/interpreter/Snapshot.hpp"
+#include "lox/interpreter/Streaming.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/ParallelParser.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <chrono>
+#include <csignal>
+#include <optional>
+
+namespace lox {
+
+static bool writeProfile(Profiler &profiler, const DriverOptions &options) {
+  if (options.ProfileOutput == "-") {
+    profiler.printFoldedStacks(outs());
+  } else {
+    std::error_code ec;
+    raw_fd_ostream os(options.ProfileOutput, ec, sys::fs::OF_Text);
+    if (ec) {
+      errs() << formatv("cannot open profile output '{0}': {1}\n",
+                        options.ProfileOutput, ec.message());
+      return false;
+    }
+    profiler.printFoldedStacks(os);
+  }
+
+  errs() << formatv("profile: {0} samples, folded stacks written to {1}\n",
+                    profiler.getSampleCount(), options.ProfileOutput);
+  profiler.printHotLines(errs(), options.ProfileTop);
+  return true;
+}
+
+namespace {
+
+/// Forwards to another stream and keeps a copy of what was written.
+class CaptureStream : public raw_ostream {
+public:
+  CaptureStream(raw_ostream &target, std::string &copy)
+      : target(target), copy(copy) {
+    SetUnbuffered();
+  }
+
+private:
+  void write_impl(const char *ptr, const size_t size) override {
+    target.write(ptr, size);
+    copy.append(ptr, size);
+  }
+  std::uint64_t current_pos() const override { return copy.size(); }
+
+  raw_ostream &target;
+  std::string &copy;
+};
+
+/// What the globals defined by the prelude point into; it must outlive the
+/// environment.
+struct LoadedPrelude {
+  uptr<EnvSnapshot> Snapshot;
+  uptr<Lexer> Tokens;
+  Program Statements;
+};
+
+} // namespace
+
+/// Define the prelude's globals in the current scope, from the snapshot when
+/// it matches, by running the prelude otherwise. Its syntax errors are
+/// reported to `diags` like those of the script.
+static int loadPrelude(SourceMgr &srcMgr, LoxValueEnv &env,
+                       StmtInterpreter &interpreter, DiagnosticEngine &diags,
+                       const DriverOptions &options, LoadedPrelude &prelude) {
+  auto bufferOrError = MemoryBuffer::getFile(options.Prelude);
+  if (!bufferOrError) {
+    errs() << formatv("cannot open '{0}': {1}\n", options.Prelude,
+                      bufferOrError.getError().message());
+    return Exit_noinput;
+  }
+  const auto id = srcMgr.AddNewSourceBuffer(std::move(*bufferOrError), {});
+  const auto code = srcMgr.getMemoryBuffer(id)->getBuffer();
+
+  if (!options.Snapshot.empty()) {
+    prelude.Snapshot = EnvSnapshot::load(options.Snapshot, code);
+    if (prelude.Snapshot) {
+      prelude.Snapshot->restore(env);
+      return Exit_success;
+    }
+  }
+
+  prelude.Tokens = mkuptr<Lexer>(srcMgr, code);
+  prelude.Tokens->setDiagnosticEngine(diags);
+  if (!prelude.Tokens->Lex())
+    return Exit_data;
+  Parser parser(prelude.Tokens->getTokens(), srcMgr);
+  parser.setDiagnosticEngine(diags);
+  prelude.Statements = parser.Parse();
+  if (parser.getError())
+    return Exit_data;
+
+  for (const auto &stmt : prelude.Statements)
+    std::visit(interpreter, *stmt);
+  if (interpreter.getError())
+    return Exit_software;
+
+  if (!options.Snapshot.empty() &&
+      !EnvSnapshot::save(options.Snapshot, code, prelude.Statements, env))
+    errs() << formatv("cannot write the snapshot '{0}'\n", options.Snapshot);
+  return Exit_success;
+}
+
+int runFile(const StringRef path, const DriverOptions &options) {
+  if (!options.Prelude.empty() && options.AutoParallel) {
+    errs() << "--prelude is not supported with --auto-parallel\n";
+    return Exit_usage;
+  }
+  // These front ends and executors report on their own threads, not
+  // through the engine of the run.
+  if (options.DiagFormat == DiagnosticFormat::JSON &&
+      (options.Stream || options.Pipeline || options.ParallelParse ||
+       options.AutoParallel)) {
+    errs() << "--diagnostics-format=json is not supported with --stream, "
+              "--pipeline, --parallel-parse or --auto-parallel\n";
+    return Exit_usage;
+  }
+
+  auto bufferOrError = MemoryBuffer::getFileOrSTDIN(path);
+  if (!bufferOrError) {
+    errs() << formatv("cannot open '{0}': {1}\n", path,
+                      bufferOrError.getError().message());
+    return Exit_noinput;
+  }
+
+  SourceMgr srcMgr;
+  const auto id = srcMgr.AddNewSourceBuffer(std::move(*bufferOrError), {});
+  const auto code = srcMgr.getMemoryBuffer(id)->getBuffer();
+
+  // In streaming mode the front end runs interleaved with execution.
+  Lexer lexer(srcMgr, code);
+  Program program;
+  ParsedSource parsed;
+  const auto streaming =
+      !options.SyntaxOnly && (options.Stream || options.Pipeline);
+  // The parallel executor works on the tree, so it doesn't use images.
+  const auto caching = !streaming && !options.SyntaxOnly &&
+                       !options.AutoParallel && !options.CacheDir.empty();
+  // Results depend on nothing but the script when it runs alone and
+  // nothing else is reported.
+  const auto cachingResults =
+      !streaming && !options.SyntaxOnly && !options.AutoParallel &&
+      !options.ParallelParse && !options.Profile && !options.CountWork &&
+      options.Prelude.empty() && options.CacheResults &&
+      options.Format == NumberFormat::Fixed &&
+      options.DiagFormat == DiagnosticFormat::Text &&
+      !options.ResultCacheDir.empty();
+  std::optional<ResultCache> results;
+  ResultKey resultKey;
+  CachedResult result;
+  std::optional<CaptureStream> outputCapture, diagCapture;
+
+  // Every error of the run is counted here; JSON is only printed once the
+  // run is over.
+  DiagnosticOptions diagOptions;
+  diagOptions.MaxPerCategory = options.DiagnosticLimit;
+  diagOptions.Deferred = options.DiagFormat == DiagnosticFormat::JSON;
+  DiagnosticEngine diags(srcMgr, errs(), diagOptions);
+  const auto finishDiagnostics = make_scope_exit([&] {
+    if (diagOptions.Deferred)
+      diags.printJSON(errs());
+    else
+      diags.flush();
+  });
+  lexer.setDiagnosticEngine(diags);
+  // Output to a file or a pipe is written in large blocks; a terminal
+  // keeps its line-at-a-time updates.
+  if (options.OutputBuffer && !outs().is_displayed())
+    outs().SetBufferSize(options.OutputBuffer);
+  const auto start = std::chrono::steady_clock::now();
+  auto lexed = false;
+  if (cachingResults) {
+    if (!lexer.Lex())
+      return Exit_data;
+    lexed = true;
+    ResultCacheOptions resultOptions;
+    resultOptions.Dir = options.ResultCacheDir;
+    resultOptions.MaxBytes = options.ResultCacheBytes;
+    results.emplace(resultOptions);
+    resultKey = ResultCache::makeKey(srcMgr.getMemoryBuffer(id)
+                                         ->getBufferIdentifier(),
+                                     code, lexer.getTokens());
+    if (const auto hit = results->lookup(resultKey)) {
+      outs() << hit->Output;
+      outs().flush();
+      errs() << hit->Diagnostics;
+      return hit->ExitCode;
+    }
+    outputCapture.emplace(outs(), result.Output);
+    diagCapture.emplace(errs(), result.Diagnostics);
+    diags.setStream(*diagCapture);
+  }
+
+  std::optional<ScriptCache> cache;
+  uptr<ScriptImage> image;
+  if (caching) {
+    cache.emplace(options.CacheDir);
+    image = cache->lookup(code);
+  }
+
+  if (image) {
+    // Unchanged since it was cached: nothing to lex or parse.
+  } else if (!streaming && options.ParallelParse) {
+    ParallelParseOptions parseOptions;
+    parseOptions.Threads = options.Threads;
+    parsed = parseParallel(srcMgr, code, parseOptions);
+    if (parsed.LexErrors || parsed.ParseErrors)
+      return Exit_data;
+    program = std::move(parsed.Statements);
+  } else if (!streaming) {
+    if (!lexed && !lexer.Lex())
+      return Exit_data;
+
+    Parser parser(lexer.getTokens(), srcMgr);
+    parser.setDiagnosticEngine(diags);
+    program = parser.Parse();
+    if (parser.getError())
+      return Exit_data;
+  }
+  if (caching && !image && !cache->store(code, program))
+    errs() << formatv("cannot write the image of '{0}' to '{1}'\n", path,
+                      options.CacheDir);
+  if (options.SyntaxOnly)
+    return Exit_success;
+
+  LoadedPrelude prelude;
+  LoxValueEnv env;
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, outs());
+  stmtInterpreter.setNumberFormat(options.Format);
+  exprInterpreter.setDiagnosticEngine(diags);
+  if (outputCapture)
+    stmtInterpreter.setOutputStream(*outputCapture);
+
+  uptr<Profiler> profiler;
+  if (options.Profile) {
+    profiler = mkuptr<Profiler>(srcMgr);
+    if (!profiler->start(options.ProfileFrequency)) {
+      errs() << "cannot start the sampling profiler\n";
+      return Exit_software;
+    }
+    stmtInterpreter.setProfiler(profiler.get());
+  }
+
+  WorkCounters counters;
+  if (options.CountWork)
+    stmtInterpreter.setWorkCounters(&counters);
+
+  std::size_t syntaxErrors = 0u, parallelErrors = 0u;
+  {
+    LoxValueScope globalScope(env);
+    if (!options.Prelude.empty()) {
+      if (const auto exitCode =
+              loadPrelude(srcMgr, env, stmtInterpreter, diags, options,
+                          prelude);
+          exitCode != Exit_success)
+        return exitCode;
+    }
+
+    if (options.Pipeline) {
+      syntaxErrors =
+          interpretPipelined(srcMgr, code, stmtInterpreter).SyntaxErrors;
+    } else if (options.Stream) {
+      syntaxErrors =
+          interpretStreaming(srcMgr, code, stmtInterpreter).SyntaxErrors;
+    } else if (options.AutoParallel) {
+      ParallelExecOptions execOptions;
+      execOptions.Threads = options.Threads;
+      execOptions.Format = options.Format;
+      parallelErrors =
+          interpretParallel(srcMgr, program, outs(), errs(), execOptions)
+              .RuntimeErrors;
+    } else if (image) {
+      image->execute(stmtInterpreter);
+    } else {
+      for (const auto &stmt : program)
+        std::visit(stmtInterpreter, *stmt);
+    }
+  }
+  outs().flush();
+
+  if (profiler) {
+    profiler->stop();
+    stmtInterpreter.setProfiler(nullptr);
+    if (!writeProfile(*profiler, options))
+      return Exit_software;
+  }
+
+  if (options.CountWork)
+    counters.print(errs());
+
+  if (syntaxErrors)
+    return Exit_data;
+  const auto exitCode = stmtInterpreter.getError() || parallelErrors
+                            ? Exit_software
+                            : Exit_success;
+  if (results) {
+    // The summary of suppressed errors is part of the result.
+    diags.flush();
+    result.ExitCode = exitCode;
+    result.Seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    if (!results->store(resultKey, std::move(result)))
+      errs() << formatv("cannot write the result of '{0}' to '{1}'\n", path,
+                        options.ResultCacheDir);
+  }
+  return exitCode;
+}
+
+int runFiles(const StringRef path, const DriverOptions &options) {
+  SmallVector<std::string> files;
+  if (!collectBatchInputs(path, files))
+    return Exit_noinput;
+
+  BatchOptions batchOptions;
+  batchOptions.Threads = options.Threads;
+  batchOptions.SyntaxOnly = options.SyntaxOnly;
+  const auto summary = runBatch(files, batchOptions);
+  errs() << formatv("batch: {0} files, {1} failed, {2:f3} s, {3:f0} files/s\n",
+                    summary.Files, summary.Failed, summary.Seconds,
+                    summary.getFilesPerSecond());
+  return summary.ExitCode;
+}
+
+/// The server stopped by SIGINT and SIGTERM.
+static ScriptServer *ActiveServer = nullptr;
+
+static void stopActiveServer(int) {
+  if (ActiveServer)
+    ActiveServer->requestStop();
+}
+
+int runServer(const StringRef socketPath, const DriverOptions &options) {
+  ServerOptions serverOptions;
+  serverOptions.Threads = options.Threads;
+  serverOptions.Timeout = options.Timeout;
+  serverOptions.CacheResults = options.CacheResults;
+  serverOptions.ResultCache.Dir = options.ResultCacheDir;
+  serverOptions.ResultCache.MaxBytes = options.ResultCacheBytes;
+  ScriptServer server(serverOptions);
+  if (!server.listen(socketPath))
+    return Exit_unavailable;
+
+  ActiveServer = &server;
+  const auto previousInt = std::signal(SIGINT, stopActiveServer);
+  const auto previousTerm = std::signal(SIGTERM, stopActiveServer);
+  errs() << formatv("serving on {0}\n", socketPath);
+  server.run();
+  std::signal(SIGINT, previousInt);
+  std::signal(SIGTERM, previousTerm);
+  ActiveServer = nullptr;
+
+  errs() << formatv("served {0} requests, {1} cache hits, {2} timed out\n",
+                    server.getRequestCount(), server.getCacheHitCount(),
+                    server.getTimeoutCount());
+  if (options.CacheResults)
+    server.getResultCacheStats().print(errs());
+  return Exit_success;
+}
+
+int runClient(const StringRef path, const StringRef socketPath,
+              const DriverOptions &options) {
+  auto bufferOrError = MemoryBuffer::getFileOrSTDIN(path);
+  if (!bufferOrError) {
+    errs() << formatv("cannot open '{0}': {1}\n", path,
+                      bufferOrError.getError().message());
+    return Exit_noinput;
+  }
+  const auto client = ServerClient::connect(socketPath);
+  if (!client)
+    return Exit_unavailable;
+  const auto exitCode =
+      client->submit((*bufferOrError)->getBufferIdentifier(),
+                     (*bufferOrError)->getBuffer(), options.Timeout, outs(),
+                     errs());
+  outs().flush();
+  return exitCode;
+}
+
+int runLoadTest(const StringRef path, const StringRef socketPath,
+                const unsigned requests, const unsigned concurrency,
+                const DriverOptions &options) {
+  auto bufferOrError = MemoryBuffer::getFileOrSTDIN(path);
+  if (!bufferOrError) {
+    errs() << formatv("cannot open '{0}': {1}\n", path,
+                      bufferOrError.getError().message());
+    return Exit_noinput;
+  }
+  LoadTestOptions loadOptions;
+  loadOptions.Requests = requests;
+  loadOptions.Concurrency = concurrency;
+  loadOptions.Timeout = options.Timeout;
+  const auto report = runLoadTest(
+      socketPath, (*bufferOrError)->getBufferIdentifier(),
+      (*bufferOrError)->getBuffer(), loadOptions);
+  report.print(errs());
+  return report.Failed ? Exit_software : Exit_success;
+}
+
+} // namespace lox
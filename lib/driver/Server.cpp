@@ -0,0 +1,629 @@
+#include "lox/driver/Server.hpp"
+#include "lox/driver/Driver.hpp"
+#include "lox/interpreter/Isolate.hpp"
+#include "lox/interpreter/ScriptCache.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace lox {
+
+namespace {
+
+enum FrameKind : char {
+  Frame_request = 'R',
+  Frame_output = 'O',
+  Frame_diagnostic = 'E',
+  Frame_done = 'D',
+};
+
+/// Frames larger than this are refused rather than allocated.
+constexpr std::uint32_t MaxFrameSize = 1u << 30u;
+
+using Clock = std::chrono::steady_clock;
+
+/// The deadline of a request that started at `start`, given `timeout` in
+/// milliseconds; 0 for no limit.
+Clock::time_point getDeadline(const Clock::time_point start,
+                              const unsigned timeout) {
+  return timeout ? start + std::chrono::milliseconds(timeout)
+                 : Clock::time_point::max();
+}
+
+/// Milliseconds left until `deadline`, at most INT_MAX for poll().
+int getMillisLeft(const Clock::time_point deadline) {
+  const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - Clock::now());
+  return static_cast<int>(std::min<std::chrono::milliseconds::rep>(
+      left.count(), std::numeric_limits<int>::max()));
+}
+
+/// Write `size` bytes, failing if the peer hasn't taken them all by
+/// `deadline`; a peer that stops reading doesn't block past it.
+bool writeAll(const int fd, const char *data, std::size_t size,
+              const Clock::time_point deadline = Clock::time_point::max()) {
+  const auto bounded = deadline != Clock::time_point::max();
+  while (size) {
+    const auto written =
+        ::send(fd, data, size, MSG_NOSIGNAL | (bounded ? MSG_DONTWAIT : 0));
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written < 0 && bounded && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      const auto left = getMillisLeft(deadline);
+      if (left <= 0)
+        return false;
+      pollfd writable{fd, POLLOUT, 0};
+      if (::poll(&writable, 1u, left) < 0 && errno != EINTR)
+        return false;
+      continue;
+    }
+    if (written <= 0)
+      return false;
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+/// Read `size` bytes, failing if they haven't all arrived by `deadline`.
+bool readAll(const int fd, char *data, std::size_t size,
+             const Clock::time_point deadline = Clock::time_point::max()) {
+  while (size) {
+    if (deadline != Clock::time_point::max()) {
+      const auto left = getMillisLeft(deadline);
+      if (left <= 0)
+        return false;
+      pollfd readable{fd, POLLIN, 0};
+      const auto ready = ::poll(&readable, 1u, left);
+      if (ready < 0 && errno == EINTR)
+        continue;
+      if (ready <= 0)
+        return false;
+    }
+    const auto read = ::recv(fd, data, size, 0);
+    if (read < 0 && errno == EINTR)
+      continue;
+    if (read <= 0)
+      return false;
+    data += read;
+    size -= read;
+  }
+  return true;
+}
+
+bool writeFrame(const int fd, const char kind, const StringRef payload,
+                const Clock::time_point deadline = Clock::time_point::max()) {
+  char header[5];
+  header[0] = kind;
+  support::endian::write32le(header + 1, payload.size());
+  return writeAll(fd, header, sizeof(header), deadline) &&
+         writeAll(fd, payload.data(), payload.size(), deadline);
+}
+
+bool readFrame(const int fd, char &kind, std::string &payload,
+               const Clock::time_point deadline = Clock::time_point::max()) {
+  char header[5];
+  if (!readAll(fd, header, sizeof(header), deadline))
+    return false;
+  kind = header[0];
+  const auto size = support::endian::read32le(header + 1);
+  if (size > MaxFrameSize)
+    return false;
+  payload.resize(size);
+  return readAll(fd, payload.data(), size, deadline);
+}
+
+/// Sends what is written to it as frames of one kind, giving up on a client
+/// that hasn't read them by `deadline`.
+class FrameStream : public raw_ostream {
+public:
+  FrameStream(const int fd, const char kind, const Clock::time_point deadline)
+      : fd(fd), kind(kind), deadline(deadline) {
+    SetBufferSize(16u * 1024u);
+  }
+  ~FrameStream() override { flush(); }
+
+  /// The client is gone or stopped reading; the rest of the output is
+  /// dropped.
+  [[nodiscard]] bool isBroken() const { return broken; }
+
+  /// Also append what is sent to `to`, as long as it stays within `limit`
+  /// bytes.
+  void setCopy(std::string *to, const std::size_t limit) {
+    copy = to;
+    copyLimit = limit;
+  }
+  /// Whether everything sent since setCopy() is in the copy.
+  [[nodiscard]] bool isCopyComplete() const { return copy != nullptr; }
+
+private:
+  void write_impl(const char *ptr, const size_t size) override {
+    if (!broken && !writeFrame(fd, kind, StringRef(ptr, size), deadline))
+      broken = true;
+    if (copy && copy->size() + size > copyLimit) {
+      copy->clear();
+      copy = nullptr;
+    }
+    if (copy)
+      copy->append(ptr, size);
+    pos += size;
+  }
+  std::uint64_t current_pos() const override { return pos; }
+
+  int fd;
+  char kind;
+  Clock::time_point deadline;
+  bool broken = false;
+  std::string *copy = nullptr;
+  std::size_t copyLimit = 0u;
+  std::uint64_t pos = 0u;
+};
+
+/// The result cache key of a script, or nothing if it doesn't lex.
+opt<ResultKey> getResultKey(const StringRef name, const StringRef source) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(source, name, false),
+                            {});
+  Lexer lexer(srcMgr, source);
+  lexer.setDiagnosticStream(nulls());
+  if (!lexer.Lex())
+    return std::nullopt;
+  return ResultCache::makeKey(name, source, lexer.getTokens());
+}
+
+/// Nearest-rank percentile of sorted `values`.
+double percentile(ArrayRef<double> values, const double p) {
+  if (values.empty())
+    return 0.0;
+  const auto rank = static_cast<std::size_t>(p * values.size() + 0.999999);
+  return values[std::min(values.size(), std::max<std::size_t>(rank, 1u)) - 1u];
+}
+
+bool setBlocking(const int fd, const bool blocking) {
+  const auto flags = ::fcntl(fd, F_GETFL);
+  return flags >= 0 &&
+         ::fcntl(fd, F_SETFL,
+                 blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == 0;
+}
+
+/// The address of `path`, or false if it doesn't fit.
+bool getAddress(const StringRef path, sockaddr_un &address) {
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path))
+    return false;
+  std::memcpy(address.sun_path, path.data(), path.size());
+  return true;
+}
+
+} // namespace
+
+ScriptServer::ScriptServer(const ServerOptions &options)
+    : options(options),
+      threads(hardware_concurrency(options.Threads).compute_thread_count()),
+      listenFD(-1), wakeFDs{-1, -1}, stopping(false), requests(0u),
+      cacheHits(0u), timeouts(0u) {
+  // One isolate per worker is all that can be busy at once.
+  for (auto i = 0u; i < threads; ++i)
+    isolates.push_back(mkuptr<Isolate>());
+  if (options.CacheResults)
+    results = mkuptr<ResultCache>(options.ResultCache);
+}
+
+ScriptServer::~ScriptServer() {
+  for (const auto fd : {listenFD, wakeFDs[0], wakeFDs[1]})
+    if (fd >= 0)
+      ::close(fd);
+}
+
+bool ScriptServer::listen(const StringRef socketPath, raw_ostream &diagOS) {
+  sockaddr_un address;
+  if (!getAddress(socketPath, address)) {
+    diagOS << formatv("invalid socket path '{0}'\n", socketPath);
+    return false;
+  }
+  if (::pipe(wakeFDs) || !setBlocking(wakeFDs[0], false) ||
+      !setBlocking(wakeFDs[1], false)) {
+    diagOS << formatv("cannot create a pipe: {0}\n", std::strerror(errno));
+    return false;
+  }
+
+  // A socket file nobody accepts on is left by a server that is gone.
+  if (const auto probe = ::socket(AF_UNIX, SOCK_STREAM, 0); probe >= 0) {
+    const auto live = ::connect(probe, reinterpret_cast<sockaddr *>(&address),
+                                sizeof(address)) == 0;
+    ::close(probe);
+    if (live) {
+      diagOS << formatv("a server is already listening at '{0}'\n",
+                        socketPath);
+      return false;
+    }
+    ::unlink(address.sun_path);
+  }
+
+  listenFD = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenFD < 0 ||
+      ::bind(listenFD, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) ||
+      ::listen(listenFD, SOMAXCONN) || !setBlocking(listenFD, false)) {
+    diagOS << formatv("cannot listen at '{0}': {1}\n", socketPath,
+                      std::strerror(errno));
+    return false;
+  }
+  path = socketPath.str();
+  return true;
+}
+
+void ScriptServer::requestStop() {
+  stopping.store(true);
+  const char wake = 0;
+  [[maybe_unused]] const auto written = ::write(wakeFDs[1], &wake, 1u);
+}
+
+void ScriptServer::run() {
+  ThreadPool pool(hardware_concurrency(threads));
+  // Connections waiting for their next request.
+  std::vector<int> idle;
+  std::vector<pollfd> fds;
+  while (!stopping.load()) {
+    fds.clear();
+    fds.push_back({wakeFDs[0], POLLIN, 0});
+    fds.push_back({listenFD, POLLIN, 0});
+    for (const auto fd : idle)
+      fds.push_back({fd, POLLIN, 0});
+    if (::poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    if (fds[0].revents) {
+      char drain[64];
+      while (::read(wakeFDs[0], drain, sizeof(drain)) > 0)
+        ;
+      std::lock_guard<std::mutex> lock(parkedMutex);
+      idle.insert(idle.end(), parked.begin(), parked.end());
+      parked.clear();
+    }
+
+    // A request or a hang-up: either way a worker reads the connection.
+    std::vector<int> waiting;
+    for (std::size_t i = 2u; i < fds.size(); ++i) {
+      if (!fds[i].revents) {
+        waiting.push_back(fds[i].fd);
+        continue;
+      }
+      pool.async([this, fd = fds[i].fd] { serve(fd); });
+    }
+    // Connections handed back above weren't polled yet.
+    for (auto i = fds.size() - 2u; i < idle.size(); ++i)
+      waiting.push_back(idle[i]);
+    idle = std::move(waiting);
+
+    if (fds[1].revents & POLLIN) {
+      for (;;) {
+        const auto fd = ::accept(listenFD, nullptr, nullptr);
+        if (fd < 0)
+          break;
+        if (setBlocking(fd, true))
+          idle.push_back(fd);
+        else
+          ::close(fd);
+      }
+    }
+  }
+
+  pool.wait();
+  for (const auto fd : idle)
+    ::close(fd);
+  for (const auto fd : parked)
+    ::close(fd);
+  parked.clear();
+  ::close(listenFD);
+  listenFD = -1;
+  ::unlink(path.c_str());
+}
+
+void ScriptServer::serve(const int fd) {
+  // The dispatcher saw the request start; a client that stops sending
+  // halfway must not hold this worker.
+  const auto start = Clock::now();
+  const auto readDeadline = getDeadline(start, options.ReadTimeout);
+  char kind;
+  std::string payload;
+  auto keep = readFrame(fd, kind, payload, readDeadline) &&
+              kind == Frame_request && payload.size() >= 8u;
+  if (keep) {
+    const StringRef request(payload);
+    auto timeout = support::endian::read32le(request.data());
+    if (!timeout)
+      timeout = options.Timeout;
+    const auto nameSize = support::endian::read32le(request.data() + 4u);
+    const auto body = request.drop_front(8u);
+    keep = nameSize <= body.size();
+    if (keep) {
+      const auto status = execute(fd, body.take_front(nameSize),
+                                  body.drop_front(nameSize), timeout, start);
+      const char code = static_cast<char>(status);
+      keep = writeFrame(fd, Frame_done, StringRef(&code, 1u),
+                        getDeadline(start, timeout));
+    }
+  }
+
+  if (!keep) {
+    ::close(fd);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(parkedMutex);
+    parked.push_back(fd);
+  }
+  const char wake = 1;
+  [[maybe_unused]] const auto written = ::write(wakeFDs[1], &wake, 1u);
+}
+
+int ScriptServer::execute(const int fd, const StringRef name,
+                          const StringRef source, const unsigned timeout,
+                          const Clock::time_point start) {
+  ++requests;
+  const auto deadline = getDeadline(start, timeout);
+  // Destroyed in reverse order: the output is sent before the diagnostics.
+  FrameStream diagOS(fd, Frame_diagnostic, deadline),
+      os(fd, Frame_output, deadline);
+  opt<ResultKey> key;
+  CachedResult result;
+  if (results && (key = getResultKey(name, source))) {
+    if (const auto hit = results->lookup(*key)) {
+      os << hit->Output;
+      os.flush();
+      diagOS << hit->Diagnostics;
+      return hit->ExitCode;
+    }
+    os.setCopy(&result.Output, options.ResultCache.MaxBytes);
+    diagOS.setCopy(&result.Diagnostics, options.ResultCache.MaxBytes);
+  }
+  // Record the result of a run that wasn't cut short.
+  const auto finish = [&](const int status) {
+    os.flush();
+    diagOS.flush();
+    if (key && status != Exit_tempfail && !os.isBroken() &&
+        !diagOS.isBroken() && os.isCopyComplete() &&
+        diagOS.isCopyComplete()) {
+      result.ExitCode = status;
+      result.Seconds =
+          std::chrono::duration<double>(Clock::now() - start).count();
+      results->store(*key, std::move(result));
+    }
+    return status;
+  };
+
+  const auto timeOut = [&] {
+    ++timeouts;
+    diagOS << formatv("{0}: timed out after {1} ms\n", name, timeout);
+    return Exit_tempfail;
+  };
+
+  const auto script = getScript(name, source, diagOS);
+  if (!script)
+    return finish(Exit_data);
+  if (timeout && Clock::now() >= deadline)
+    return timeOut();
+
+  auto isolate = acquireIsolate();
+  isolate->setOutputStream(os);
+  isolate->setDiagnosticStream(diagOS);
+  const auto errors = isolate->getError();
+  isolate->start(script);
+  const auto pastDeadline = [&] {
+    return timeout && Clock::now() >= deadline;
+  };
+  auto finished = false;
+  while (!(finished = isolate->resume(options.Slice))) {
+    // Stream what the slice printed.
+    os.flush();
+    diagOS.flush();
+    if (os.isBroken() || pastDeadline())
+      break;
+  }
+  os.flush();
+  diagOS.flush();
+  const auto failed = isolate->getError() != errors;
+  releaseIsolate(std::move(isolate));
+  // A client that stops reading breaks the streams at the deadline.
+  const auto timedOut =
+      pastDeadline() && (!finished || os.isBroken() || diagOS.isBroken());
+
+  if (timedOut)
+    return timeOut();
+  return finish(failed ? Exit_software : Exit_success);
+}
+
+sptr<const CompiledScript> ScriptServer::getScript(const StringRef name,
+                                                   const StringRef source,
+                                                   raw_ostream &diagOS) {
+  const auto hash = ScriptImage::hashSource(source);
+  const auto matches = [&](const CompiledScript &script) {
+    return script.getName() == name && script.getSource() == source;
+  };
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    const auto [begin, end] = cacheIndex.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+      if (!matches(**it->second))
+        continue;
+      cache.splice(cache.begin(), cache, it->second);
+      ++cacheHits;
+      return cache.front();
+    }
+  }
+
+  // Compiled outside the lock; a script submitted twice at once may be
+  // compiled twice, and is cached once.
+  auto script = CompiledScript::compile(name, source, diagOS);
+  if (!script || !options.CacheEntries)
+    return script;
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  const auto [begin, end] = cacheIndex.equal_range(hash);
+  if (std::any_of(begin, end,
+                  [&](const auto &entry) { return matches(**entry.second); }))
+    return script;
+  if (cache.size() == options.CacheEntries) {
+    const auto evicted = ScriptImage::hashSource(cache.back()->getSource());
+    const auto [first, last] = cacheIndex.equal_range(evicted);
+    cacheIndex.erase(std::find_if(first, last, [&](const auto &entry) {
+      return *entry.second == cache.back();
+    }));
+    cache.pop_back();
+  }
+  cache.push_front(script);
+  cacheIndex.emplace(hash, cache.begin());
+  return script;
+}
+
+uptr<Isolate> ScriptServer::acquireIsolate() {
+  {
+    std::lock_guard<std::mutex> lock(isolateMutex);
+    if (!isolates.empty()) {
+      auto isolate = std::move(isolates.back());
+      isolates.pop_back();
+      return isolate;
+    }
+  }
+  return mkuptr<Isolate>();
+}
+
+void ScriptServer::releaseIsolate(uptr<Isolate> isolate) {
+  isolate->reset();
+  std::lock_guard<std::mutex> lock(isolateMutex);
+  if (isolates.size() < threads)
+    isolates.push_back(std::move(isolate));
+}
+
+uptr<ServerClient> ServerClient::connect(const StringRef path,
+                                         raw_ostream &diagOS) {
+  sockaddr_un address;
+  if (!getAddress(path, address)) {
+    diagOS << formatv("invalid socket path '{0}'\n", path);
+    return nullptr;
+  }
+  const auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&address),
+                          sizeof(address))) {
+    diagOS << formatv("cannot connect to '{0}': {1}\n", path,
+                      std::strerror(errno));
+    if (fd >= 0)
+      ::close(fd);
+    return nullptr;
+  }
+  return uptr<ServerClient>(new ServerClient(fd));
+}
+
+ServerClient::~ServerClient() { ::close(fd); }
+
+int ServerClient::submit(const StringRef name, const StringRef source,
+                         const unsigned timeout, raw_ostream &os,
+                         raw_ostream &diagOS) {
+  std::string request(8u, '\0');
+  support::endian::write32le(request.data(), timeout);
+  support::endian::write32le(request.data() + 4u, name.size());
+  request += name;
+  request += source;
+  if (!writeFrame(fd, Frame_request, request))
+    return Exit_unavailable;
+
+  char kind;
+  std::string payload;
+  while (readFrame(fd, kind, payload)) {
+    switch (kind) {
+    case Frame_output:
+      os << payload;
+      break;
+    case Frame_diagnostic:
+      diagOS << payload;
+      break;
+    case Frame_done:
+      if (payload.size() != 1u)
+        return Exit_unavailable;
+      return static_cast<unsigned char>(payload[0]);
+    default:
+      return Exit_unavailable;
+    }
+  }
+  return Exit_unavailable;
+}
+
+void LoadTestReport::print(raw_ostream &os) const {
+  os << formatv("load test: {0} requests, {1} failed, {2:f3} s, {3:f0} "
+                "req/s\n",
+                Requests, Failed, Seconds, getRequestsPerSecond());
+  os << formatv("latency ms: p50 {0:f3}, p90 {1:f3}, p99 {2:f3}, max "
+                "{3:f3}\n",
+                P50 * 1e3, P90 * 1e3, P99 * 1e3, Max * 1e3);
+}
+
+LoadTestReport runLoadTest(const StringRef path, const StringRef name,
+                           const StringRef source,
+                           const LoadTestOptions &options) {
+  const auto clients = std::max(1u, options.Concurrency);
+  std::vector<std::vector<double>> latencies(clients);
+  std::vector<std::size_t> failed(clients, 0u);
+
+  const auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (auto c = 0u; c < clients; ++c) {
+    // The first clients take the remainder.
+    const auto count =
+        options.Requests / clients + (c < options.Requests % clients);
+    threads.emplace_back([&, c, count] {
+      raw_null_ostream os;
+      const auto client = ServerClient::connect(path, nulls());
+      for (auto i = 0u; i < count; ++i) {
+        const auto begin = Clock::now();
+        const auto status =
+            client ? client->submit(name, source, options.Timeout, os, os)
+                   : Exit_unavailable;
+        latencies[c].push_back(
+            std::chrono::duration<double>(Clock::now() - begin).count());
+        failed[c] += status != Exit_success;
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  LoadTestReport report;
+  report.Seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  std::vector<double> all;
+  for (auto c = 0u; c < clients; ++c) {
+    all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+    report.Failed += failed[c];
+  }
+  std::sort(all.begin(), all.end());
+  report.Requests = all.size();
+  report.P50 = percentile(all, 0.50);
+  report.P90 = percentile(all, 0.90);
+  report.P99 = percentile(all, 0.99);
+  report.Max = all.empty() ? 0.0 : all.back();
+  return report;
+}
+
+} // namespace lox
@@ -0,0 +1,143 @@
+#include "lox/interpreter/ArrayKernels.hpp"
+#include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace lox::kernels {
+
+namespace {
+
+/// Accumulators of a reduction: four SSE2 or two AVX vectors of doubles.
+constexpr std::size_t Lanes = 8u;
+
+/// out[i] = lhs(i) `op` rhs(i)
+template <typename L, typename R>
+void mapWith(const TokenKind op, const L &lhs, const R &rhs, double *out,
+             const std::size_t size) {
+  const auto run = [&](auto fn) {
+    for (std::size_t i = 0u; i < size; ++i)
+      out[i] = fn(lhs(i), rhs(i));
+  };
+  switch (op) {
+  case Tok_plus:
+    return run(std::plus<>());
+  case Tok_minus:
+    return run(std::minus<>());
+  case Tok_star:
+    return run(std::multiplies<>());
+  case Tok_slash:
+    return run(std::divides<>());
+  default:
+    llvm_unreachable("only arithmetic applies to arrays");
+  }
+}
+
+/// Fold `values` with `fn`, from `init` in every lane.
+template <typename Fn>
+double reduce(const ArrayRef<double> values, const double init, Fn fn) {
+  double lanes[Lanes];
+  std::fill_n(lanes, Lanes, init);
+  const auto *data = values.data();
+  const auto size = values.size();
+  std::size_t i = 0u;
+  for (; i + Lanes <= size; i += Lanes)
+    for (std::size_t l = 0u; l < Lanes; ++l)
+      lanes[l] = fn(lanes[l], data[i + l]);
+  for (std::size_t l = 0u; i < size; ++i, ++l)
+    lanes[l] = fn(lanes[l], data[i]);
+  for (auto width = Lanes / 2u; width; width /= 2u)
+    for (std::size_t l = 0u; l < width; ++l)
+      lanes[l] = fn(lanes[l], lanes[l + width]);
+  return lanes[0];
+}
+
+/// A min or max over `values` that skips NaNs: `acc` keeps its value
+/// unless the element compares better.
+template <typename Better>
+double extremum(const ArrayRef<double> values, const double worst,
+                Better better) {
+  const auto result =
+      reduce(values, worst, [&](const double acc, const double element) {
+        return better(element, acc) ? element : acc;
+      });
+  // Only NaNs, or the worst value itself.
+  if (result == worst &&
+      std::all_of(values.begin(), values.end(),
+                  [](const double element) { return std::isnan(element); }))
+    return std::numeric_limits<double>::quiet_NaN();
+  return result;
+}
+
+} // namespace
+
+void map(const TokenKind op, const double *lhs, const double *rhs,
+         double *out, const std::size_t size) {
+  mapWith(
+      op, [lhs](const std::size_t i) { return lhs[i]; },
+      [rhs](const std::size_t i) { return rhs[i]; }, out, size);
+}
+
+void map(const TokenKind op, const double *lhs, const double rhs,
+         double *out, const std::size_t size) {
+  mapWith(
+      op, [lhs](const std::size_t i) { return lhs[i]; },
+      [rhs](std::size_t) { return rhs; }, out, size);
+}
+
+void map(const TokenKind op, const double lhs, const double *rhs,
+         double *out, const std::size_t size) {
+  mapWith(
+      op, [lhs](std::size_t) { return lhs; },
+      [rhs](const std::size_t i) { return rhs[i]; }, out, size);
+}
+
+void negate(const double *values, double *out, const std::size_t size) {
+  for (std::size_t i = 0u; i < size; ++i)
+    out[i] = -values[i];
+}
+
+double sum(const ArrayRef<double> values) {
+  return reduce(values, 0.0, std::plus<>());
+}
+
+double min(const ArrayRef<double> values) {
+  assert(!values.empty() && "the minimum of an empty array");
+  return extremum(values, std::numeric_limits<double>::infinity(),
+                  std::less<>());
+}
+
+double max(const ArrayRef<double> values) {
+  assert(!values.empty() && "the maximum of an empty array");
+  return extremum(values, -std::numeric_limits<double>::infinity(),
+                  std::greater<>());
+}
+
+double dot(const ArrayRef<double> lhs, const ArrayRef<double> rhs) {
+  assert(lhs.size() == rhs.size() && "a dot product of arrays of one size");
+  double lanes[Lanes] = {};
+  const auto *l = lhs.data();
+  const auto *r = rhs.data();
+  const auto size = lhs.size();
+  std::size_t i = 0u;
+  for (; i + Lanes <= size; i += Lanes)
+    for (std::size_t j = 0u; j < Lanes; ++j)
+      lanes[j] += l[i + j] * r[i + j];
+  for (std::size_t j = 0u; i < size; ++i, ++j)
+    lanes[j] += l[i] * r[i];
+  for (auto width = Lanes / 2u; width; width /= 2u)
+    for (std::size_t j = 0u; j < width; ++j)
+      lanes[j] += lanes[j + width];
+  return lanes[0];
+}
+
+void sort(const MutableArrayRef<double> values) {
+  const auto nans = std::partition(
+      values.begin(), values.end(),
+      [](const double value) { return !std::isnan(value); });
+  std::sort(values.begin(), nans);
+}
+
+} // namespace lox::kernels
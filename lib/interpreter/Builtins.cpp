@@ -0,0 +1,337 @@
+#include "lox/interpreter/ArrayKernels.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <cmath>
+#include <numeric>
+
+namespace lox {
+
+namespace {
+
+/// `value` as a count or position, if it is a whole number from 0 to `last`.
+opt<std::size_t> toSize(const long double value, const std::size_t last) {
+  if (!(value >= 0.0L) || value > static_cast<long double>(last) ||
+      std::trunc(value) != value)
+    return std::nullopt;
+  return static_cast<std::size_t>(value);
+}
+
+std::string formatNumber(const long double value) {
+  std::string text;
+  raw_string_ostream os(text);
+  printNumber(os, value, NumberFormat::Shortest);
+  return os.str();
+}
+
+std::string formatSize(const std::size_t size) { return std::to_string(size); }
+
+} // namespace
+
+sptr<Value> ExprInterpreter::evaluateArray(const SMLoc loc,
+                                           const ArrayRef<sptr<Value>> values) {
+  if (llvm::is_contained(values, nullptr))
+    return nullptr;
+
+  SmallVector<double, 0> elements;
+  elements.reserve(values.size());
+  for (const auto &value : values) {
+    const auto *numberV = dyn_cast<NumberValue>(value.get());
+    if (!numberV) {
+      report(Diag_element_not_number, loc);
+      return nullptr;
+    }
+    elements.push_back(static_cast<double>(numberV->getValue()));
+  }
+  return makeValue<ArrayValue>(std::move(elements));
+}
+
+sptr<Value> ExprInterpreter::evaluateIndex(const SMLoc loc,
+                                           const sptr<Value> &arrayVPtr,
+                                           const sptr<Value> &indexVPtr) {
+  if (!arrayVPtr || !indexVPtr)
+    return nullptr;
+
+  if (const auto *mapV = dyn_cast<MapValue>(arrayVPtr.get())) {
+    if (!checkKey(loc, *indexVPtr))
+      return nullptr;
+    if (const auto *entry = mapV->getTable().find(*indexVPtr))
+      return entry->Mapped;
+    return makeValue<NilValue>();
+  }
+  const auto *arrayV = dyn_cast<ArrayValue>(arrayVPtr.get());
+  if (!arrayV) {
+    report(Diag_operand_not_array, loc);
+    return nullptr;
+  }
+  const auto *indexV = dyn_cast<NumberValue>(indexVPtr.get());
+  if (!indexV) {
+    report(Diag_operand_not_number, loc);
+    return nullptr;
+  }
+  const auto index = toSize(indexV->getValue(), arrayV->size());
+  if (!index || *index == arrayV->size()) {
+    const auto size = formatSize(arrayV->size());
+    const auto got = formatNumber(indexV->getValue());
+    report(Diag_invalid_index, loc, {size, got});
+    return nullptr;
+  }
+  return makeValue<NumberValue>(arrayV->getElements()[*index]);
+}
+
+sptr<Value> ExprInterpreter::evaluateMap(const SMLoc loc,
+                                         const ArrayRef<sptr<Value>> operands) {
+  if (llvm::is_contained(operands, nullptr))
+    return nullptr;
+
+  MapTable table;
+  table.reserve(operands.size() / 2u);
+  for (std::size_t i = 0u; i < operands.size(); i += 2u) {
+    if (!checkKey(loc, *operands[i]))
+      return nullptr;
+    table.insert(operands[i], operands[i + 1u]);
+  }
+  return makeValue<MapValue>(std::move(table));
+}
+
+sptr<Value> ExprInterpreter::evaluateArrayArithmetic(const SMLoc loc,
+                                                     const TokenKind op,
+                                                     const Value &lhs,
+                                                     const Value &rhs) {
+  const auto *lhsArray = dyn_cast<ArrayValue>(&lhs);
+  const auto *rhsArray = dyn_cast<ArrayValue>(&rhs);
+  const auto *lhsNumber = dyn_cast<NumberValue>(&lhs);
+  const auto *rhsNumber = dyn_cast<NumberValue>(&rhs);
+  if ((!lhsArray && !lhsNumber) || (!rhsArray && !rhsNumber)) {
+    report(Diag_operands_not_numbers_or_arrays, loc);
+    return nullptr;
+  }
+
+  SmallVector<double, 0> elements;
+  if (lhsArray && rhsArray) {
+    if (lhsArray->size() != rhsArray->size()) {
+      const auto lhsSize = formatSize(lhsArray->size());
+      const auto rhsSize = formatSize(rhsArray->size());
+      report(Diag_length_mismatch, loc, {lhsSize, rhsSize});
+      return nullptr;
+    }
+    elements.resize(lhsArray->size());
+    kernels::map(op, lhsArray->getElements().data(),
+                 rhsArray->getElements().data(), elements.data(),
+                 elements.size());
+  } else if (lhsArray) {
+    // The number is broadcast, rounded to an element.
+    elements.resize(lhsArray->size());
+    kernels::map(op, lhsArray->getElements().data(),
+                 static_cast<double>(rhsNumber->getValue()), elements.data(),
+                 elements.size());
+  } else {
+    elements.resize(rhsArray->size());
+    kernels::map(op, static_cast<double>(lhsNumber->getValue()),
+                 rhsArray->getElements().data(), elements.data(),
+                 elements.size());
+  }
+  return makeValue<ArrayValue>(std::move(elements));
+}
+
+const NumberValue *ExprInterpreter::getNumberArg(
+    const SMLoc loc, const Builtin builtin, const ArrayRef<sptr<Value>> args,
+    const unsigned position) {
+  if (const auto *numberV = dyn_cast<NumberValue>(args[position - 1u].get()))
+    return numberV;
+  const auto arg = std::to_string(position);
+  report(Diag_argument_not_number, loc,
+         {StringRef(arg), getBuiltinName(builtin)});
+  return nullptr;
+}
+
+const ArrayValue *ExprInterpreter::getArrayArg(
+    const SMLoc loc, const Builtin builtin, const ArrayRef<sptr<Value>> args,
+    const unsigned position) {
+  if (const auto *arrayV = dyn_cast<ArrayValue>(args[position - 1u].get()))
+    return arrayV;
+  const auto arg = std::to_string(position);
+  report(Diag_argument_not_array, loc,
+         {StringRef(arg), getBuiltinName(builtin)});
+  return nullptr;
+}
+
+opt<std::size_t> ExprInterpreter::getLengthArg(
+    const SMLoc loc, const Builtin builtin, const ArrayRef<sptr<Value>> args,
+    const unsigned position) {
+  const auto *numberV = getNumberArg(loc, builtin, args, position);
+  if (!numberV)
+    return std::nullopt;
+  const auto length = toSize(numberV->getValue(), ArrayValue::MaxSize);
+  if (!length) {
+    const auto max = formatSize(ArrayValue::MaxSize);
+    const auto got = formatNumber(numberV->getValue());
+    report(Diag_invalid_length, loc, {max, got});
+  }
+  return length;
+}
+
+const MapValue *ExprInterpreter::getMapArg(const SMLoc loc,
+                                           const Builtin builtin,
+                                           const ArrayRef<sptr<Value>> args,
+                                           const unsigned position) {
+  if (const auto *mapV = dyn_cast<MapValue>(args[position - 1u].get()))
+    return mapV;
+  const auto arg = std::to_string(position);
+  report(Diag_argument_not_map, loc,
+         {StringRef(arg), getBuiltinName(builtin)});
+  return nullptr;
+}
+
+bool ExprInterpreter::checkKey(const SMLoc loc, const Value &key) {
+  if (MapTable::isKey(key))
+    return true;
+  report(Diag_invalid_key, loc);
+  return false;
+}
+
+sptr<Value> ExprInterpreter::evaluateCall(const SMLoc loc,
+                                          const Builtin builtin,
+                                          const ArrayRef<sptr<Value>> args,
+                                          const StringRef updated) {
+  assert(args.size() == getBuiltinArity(builtin) &&
+         "the parser checks the number of arguments");
+  if (llvm::is_contained(args, nullptr))
+    return nullptr;
+
+  switch (builtin) {
+  case Builtin_array: {
+    const auto length = getLengthArg(loc, builtin, args, 1u);
+    if (!length)
+      return nullptr;
+    const auto *fill = getNumberArg(loc, builtin, args, 2u);
+    if (!fill)
+      return nullptr;
+    return makeValue<ArrayValue>(SmallVector<double, 0>(
+        *length, static_cast<double>(fill->getValue())));
+  }
+  case Builtin_range: {
+    const auto length = getLengthArg(loc, builtin, args, 1u);
+    if (!length)
+      return nullptr;
+    SmallVector<double, 0> elements(*length);
+    std::iota(elements.begin(), elements.end(), 0.0);
+    return makeValue<ArrayValue>(std::move(elements));
+  }
+  case Builtin_len:
+    if (const auto *arrayV = dyn_cast<ArrayValue>(args[0].get()))
+      return makeValue<NumberValue>(arrayV->size());
+    if (const auto *mapV = dyn_cast<MapValue>(args[0].get()))
+      return makeValue<NumberValue>(mapV->size());
+    report(Diag_argument_not_array_or_map, loc,
+           {"1", getBuiltinName(builtin)});
+    return nullptr;
+  case Builtin_sum: {
+    const auto *arrayV = getArrayArg(loc, builtin, args, 1u);
+    if (!arrayV)
+      return nullptr;
+    return makeValue<NumberValue>(kernels::sum(arrayV->getElements()));
+  }
+  case Builtin_min:
+  case Builtin_max: {
+    const auto *arrayV = getArrayArg(loc, builtin, args, 1u);
+    if (!arrayV)
+      return nullptr;
+    if (!arrayV->size()) {
+      report(Diag_empty_array, loc, StringRef(getBuiltinName(builtin)));
+      return nullptr;
+    }
+    return makeValue<NumberValue>(builtin == Builtin_min
+                                      ? kernels::min(arrayV->getElements())
+                                      : kernels::max(arrayV->getElements()));
+  }
+  case Builtin_dot: {
+    const auto *lhs = getArrayArg(loc, builtin, args, 1u);
+    if (!lhs)
+      return nullptr;
+    const auto *rhs = getArrayArg(loc, builtin, args, 2u);
+    if (!rhs)
+      return nullptr;
+    if (lhs->size() != rhs->size()) {
+      const auto lhsSize = formatSize(lhs->size());
+      const auto rhsSize = formatSize(rhs->size());
+      report(Diag_length_mismatch, loc, {lhsSize, rhsSize});
+      return nullptr;
+    }
+    return makeValue<NumberValue>(
+        kernels::dot(lhs->getElements(), rhs->getElements()));
+  }
+  case Builtin_sort: {
+    const auto *arrayV = getArrayArg(loc, builtin, args, 1u);
+    if (!arrayV)
+      return nullptr;
+    SmallVector<double, 0> elements(arrayV->getElements().begin(),
+                                    arrayV->getElements().end());
+    kernels::sort(elements);
+    return makeValue<ArrayValue>(std::move(elements));
+  }
+  case Builtin_slice: {
+    const auto *arrayV = getArrayArg(loc, builtin, args, 1u);
+    if (!arrayV)
+      return nullptr;
+    const auto *beginV = getNumberArg(loc, builtin, args, 2u);
+    if (!beginV)
+      return nullptr;
+    const auto *endV = getNumberArg(loc, builtin, args, 3u);
+    if (!endV)
+      return nullptr;
+    const auto begin = toSize(beginV->getValue(), arrayV->size());
+    const auto end = toSize(endV->getValue(), arrayV->size());
+    if (!begin || !end || *begin > *end) {
+      const auto beginArg = formatNumber(beginV->getValue());
+      const auto endArg = formatNumber(endV->getValue());
+      const auto size = formatSize(arrayV->size());
+      report(Diag_invalid_slice, loc, {beginArg, endArg, size});
+      return nullptr;
+    }
+    const auto elements = arrayV->getElements().slice(*begin, *end - *begin);
+    return makeValue<ArrayValue>(
+        SmallVector<double, 0>(elements.begin(), elements.end()));
+  }
+  case Builtin_get:
+  case Builtin_has: {
+    const auto *mapV = getMapArg(loc, builtin, args, 1u);
+    if (!mapV || !checkKey(loc, *args[1]))
+      return nullptr;
+    const auto *entry = mapV->getTable().find(*args[1]);
+    if (builtin == Builtin_has)
+      return makeValue<BoolValue>(entry);
+    return entry ? entry->Mapped : makeValue<NilValue>();
+  }
+  case Builtin_set:
+  case Builtin_delete: {
+    const auto *mapV = getMapArg(loc, builtin, args, 1u);
+    if (!mapV || !checkKey(loc, *args[1]))
+      return nullptr;
+    // Nothing fails from here on. In `m = set(m, ...)` the old map is then
+    // only needed through `m` if something else holds it too; otherwise it
+    // is updated in place instead of copied.
+    if (!updated.empty())
+      releaseVar(updated);
+    if (args[0].use_count() == 1) {
+      auto &table = cast<MapValue>(*args[0]).getTable();
+      if (builtin == Builtin_set)
+        table.insert(args[1], args[2]);
+      else
+        table.erase(*args[1]);
+      return args[0];
+    }
+    auto table = mapV->getTable();
+    if (builtin == Builtin_set)
+      table.insert(args[1], args[2]);
+    else if (!table.erase(*args[1]))
+      return args[0];
+    return makeValue<MapValue>(std::move(table));
+  }
+  case BuiltinCount:
+    break;
+  }
+  llvm_unreachable("all builtins are handled");
+}
+
+} // namespace lox
@@ -0,0 +1,407 @@
+#include "lox/interpreter/Columnar.hpp"
+#include "llvm/Support/FormatVariadic.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace lox {
+
+void ColumnBatch::addNumbers(const StringRef name,
+                             const ArrayRef<double> values,
+                             const ArrayRef<bool> nils) {
+  assert(values.size() == rows && (nils.empty() || nils.size() == rows) &&
+         "a column has one value per row");
+  columns[name] = {ColumnType::Number, values.data(), nullptr,
+                   nils.empty() ? nullptr : nils.data()};
+}
+
+void ColumnBatch::addBools(const StringRef name, const ArrayRef<bool> values,
+                           const ArrayRef<bool> nils) {
+  assert(values.size() == rows && (nils.empty() || nils.size() == rows) &&
+         "a column has one value per row");
+  columns[name] = {ColumnType::Bool, nullptr, values.data(),
+                   nils.empty() ? nullptr : nils.data()};
+}
+
+/// Lowers an expression to instructions, typing every node.
+struct ColumnarExpr::Compiler {
+  const ColumnBatch &Layout;
+  SourceMgr &SrcMgr;
+  raw_ostream &DiagOS;
+  ColumnarExpr &Result;
+
+  /// The register holding the value of `expr`, or nothing after reporting.
+  opt<unsigned> compile(const Expr &expr) { return std::visit(*this, expr); }
+
+  opt<unsigned> operator()(const BinaryE &binaryE) {
+    const auto lhs = compile(*binaryE.getLhs());
+    const auto rhs = compile(*binaryE.getRhs());
+    if (!lhs || !rhs)
+      return std::nullopt;
+    const auto op = binaryE.getOpKind()->Kind;
+    const auto numbers = getType(*lhs) == ColumnType::Number &&
+                         getType(*rhs) == ColumnType::Number;
+
+    Opcode opcode;
+    auto type = ColumnType::Bool;
+    switch (op) {
+    case Tok_plus:
+      if (!numbers) {
+        // Strings aren't columns, so only numbers can be added here.
+        report(binaryE.getLoc(), "Operands must be a number or string");
+        return std::nullopt;
+      }
+      return emit(Op_add, ColumnType::Number, *lhs, *rhs);
+    case Tok_minus:
+      opcode = Op_sub;
+      type = ColumnType::Number;
+      break;
+    case Tok_star:
+      opcode = Op_mul;
+      type = ColumnType::Number;
+      break;
+    case Tok_slash:
+      opcode = Op_div;
+      type = ColumnType::Number;
+      break;
+    case Tok_lt:
+      opcode = Op_lt;
+      break;
+    case Tok_le:
+      opcode = Op_le;
+      break;
+    case Tok_gt:
+      opcode = Op_gt;
+      break;
+    case Tok_ge:
+      opcode = Op_ge;
+      break;
+    case Tok_equal_equal:
+      return emit(Op_eq, ColumnType::Bool, *lhs, *rhs);
+    case Tok_bang_equal:
+      return emit(Op_ne, ColumnType::Bool, *lhs, *rhs);
+    default:
+      llvm_unreachable("all binary operators are handled");
+    }
+    if (!numbers) {
+      report(binaryE.getLoc(), "Operands must be a number");
+      return std::nullopt;
+    }
+    return emit(opcode, type, *lhs, *rhs);
+  }
+
+  opt<unsigned> operator()(const UnaryE &unaryE) {
+    const auto operand = compile(*unaryE.getExpr());
+    if (!operand)
+      return std::nullopt;
+    if (unaryE.getOpKind()->Kind == Tok_bang)
+      return emit(Op_not, ColumnType::Bool, *operand);
+    if (getType(*operand) != ColumnType::Number) {
+      report(unaryE.getLoc(), "Operand must be a number");
+      return std::nullopt;
+    }
+    return emit(Op_neg, ColumnType::Number, *operand);
+  }
+
+  opt<unsigned> operator()(const GroupingE &groupingE) {
+    return compile(*groupingE.getExpr());
+  }
+
+  opt<unsigned> operator()(const LiteralE &literalE) {
+    const auto *token = literalE.getValue();
+    Instruction instruction{};
+    instruction.Op = Op_constant;
+    switch (token->Kind) {
+    case Tok_number:
+      instruction.Type = ColumnType::Number;
+      instruction.Number = std::stod(token->Symbol.str());
+      break;
+    case Tok_true:
+    case Tok_false:
+      instruction.Type = ColumnType::Bool;
+      instruction.Bool = token->Kind == Tok_true;
+      break;
+    case Tok_nil:
+      instruction.Type = ColumnType::Nil;
+      instruction.MayBeNil = true;
+      break;
+    default:
+      report(literalE.getLoc(),
+             "string values are not supported in batch expressions");
+      return std::nullopt;
+    }
+    return emit(instruction);
+  }
+
+  opt<unsigned> operator()(const VarE &varE) {
+    const auto name = varE.getSymbol()->Symbol;
+    const auto it = Layout.columns.find(name);
+    if (it == Layout.columns.end()) {
+      report(varE.getLoc(), formatv("Undefined variable : {0}", name).str());
+      return std::nullopt;
+    }
+    Instruction instruction{};
+    instruction.Op = Op_column;
+    instruction.Type = it->second.Type;
+    instruction.MayBeNil = it->second.Nils;
+    instruction.Column = Result.columnNames.insert(name).first->getKey();
+    return emit(instruction);
+  }
+
+  opt<unsigned> operator()(const AssignE &assignE) {
+    report(assignE.getLoc(),
+           "assignments are not supported in batch expressions");
+    return std::nullopt;
+  }
+
+  opt<unsigned> unsupportedCollection(const SMLoc loc) {
+    report(loc, "arrays and maps are not supported in batch expressions");
+    return std::nullopt;
+  }
+  opt<unsigned> operator()(const ArrayE &arrayE) {
+    return unsupportedCollection(arrayE.getLoc());
+  }
+  opt<unsigned> operator()(const IndexE &indexE) {
+    return unsupportedCollection(indexE.getLoc());
+  }
+  opt<unsigned> operator()(const CallE &callE) {
+    return unsupportedCollection(callE.getLoc());
+  }
+  opt<unsigned> operator()(const MapE &mapE) {
+    return unsupportedCollection(mapE.getLoc());
+  }
+
+  ColumnType getType(const unsigned reg) const {
+    return Result.code[reg].Type;
+  }
+
+  unsigned emit(const Instruction &instruction) {
+    Result.code.push_back(instruction);
+    return Result.code.size() - 1u;
+  }
+
+  unsigned emit(const Opcode op, const ColumnType type, const unsigned lhs,
+                const unsigned rhs = 0u) {
+    Instruction instruction{};
+    instruction.Op = op;
+    instruction.Type = type;
+    instruction.Lhs = lhs;
+    instruction.Rhs = rhs;
+    return emit(instruction);
+  }
+
+  void report(const SMLoc loc, const Twine &msg) {
+    SrcMgr.PrintMessage(DiagOS, loc, SourceMgr::DK_Error, msg);
+  }
+};
+
+uptr<ColumnarExpr> ColumnarExpr::compile(const Expr &expr,
+                                         const ColumnBatch &layout,
+                                         SourceMgr &srcMgr,
+                                         raw_ostream &diagOS) {
+  uptr<ColumnarExpr> result(new ColumnarExpr);
+  Compiler compiler{layout, srcMgr, diagOS, *result};
+  if (!compiler.compile(expr))
+    return nullptr;
+  return result;
+}
+
+ColumnType ColumnarExpr::getType() const { return code.back().Type; }
+
+namespace {
+
+/// The kernels: loops simple enough for the compiler to vectorize.
+
+template <typename T, typename R, typename Fn>
+void mapBinary(const T *lhs, const T *rhs, R *out, const std::size_t rows,
+               Fn fn) {
+  for (std::size_t i = 0u; i < rows; ++i)
+    out[i] = fn(lhs[i], rhs[i]);
+}
+
+/// Flag the rows that are nil in `nils`.
+void flagNils(const bool *nils, bool *errors, const std::size_t rows) {
+  for (std::size_t i = 0u; i < rows; ++i)
+    errors[i] |= nils[i];
+}
+
+/// Where a row is nil on either side, equality is whether both are.
+void fixNilEquality(const bool *lhsNils, const bool *rhsNils, bool *out,
+                    const std::size_t rows) {
+  for (std::size_t i = 0u; i < rows; ++i)
+    out[i] = (lhsNils[i] & rhsNils[i]) |
+             (!(lhsNils[i] | rhsNils[i]) & out[i]);
+}
+
+} // namespace
+
+ColumnOutput ColumnarExpr::evaluate(const ColumnBatch &batch) const {
+  const auto rows = batch.size();
+  const auto registers = code.size();
+
+  // Where each register is read from in the current block.
+  struct Register {
+    const double *Numbers = nullptr;
+    const bool *Bools = nullptr;
+    /// nullptr if no row is nil.
+    const bool *Nils = nullptr;
+  };
+  SmallVector<Register, 16> regs(registers);
+  SmallVector<const ColumnBatch::Column *, 8> columns(registers, nullptr);
+
+  // Scratch columns of one block for the registers computed, and the
+  // constant ones, which are filled once.
+  SmallVector<double, 0> numberScratch(registers * BlockSize);
+  SmallVector<bool, 0> boolScratch(registers * BlockSize);
+  SmallVector<bool, 0> noNils(BlockSize, false);
+  SmallVector<bool, 0> allNils(BlockSize, true);
+  for (std::size_t r = 0u; r < registers; ++r) {
+    const auto &instruction = code[r];
+    auto *numbers = numberScratch.data() + r * BlockSize;
+    auto *bools = boolScratch.data() + r * BlockSize;
+    if (instruction.Op == Op_column) {
+      const auto it = batch.columns.find(instruction.Column);
+      assert(it != batch.columns.end() &&
+             it->second.Type == instruction.Type &&
+             (instruction.MayBeNil || !it->second.Nils) &&
+             "the batch has the columns of the layout");
+      columns[r] = &it->second;
+    } else if (instruction.Op == Op_constant) {
+      std::fill_n(numbers, BlockSize, instruction.Number);
+      std::fill_n(bools, BlockSize, instruction.Bool);
+      if (instruction.Type == ColumnType::Nil)
+        regs[r].Nils = allNils.data();
+    }
+    regs[r].Numbers = numbers;
+    regs[r].Bools = bools;
+  }
+
+  ColumnOutput output;
+  output.Type = getType();
+  if (output.Type == ColumnType::Number)
+    output.Numbers.resize(rows);
+  else if (output.Type == ColumnType::Bool)
+    output.Bools.resize(rows);
+  output.Nils.resize(rows);
+  output.Errors.resize(rows);
+
+  for (std::size_t begin = 0u; begin < rows; begin += BlockSize) {
+    const auto n = std::min(BlockSize, rows - begin);
+    auto *errors = output.Errors.data() + begin;
+
+    for (std::size_t r = 0u; r < registers; ++r) {
+      const auto &instruction = code[r];
+      auto &reg = regs[r];
+      auto *numbers = numberScratch.data() + r * BlockSize;
+      auto *bools = boolScratch.data() + r * BlockSize;
+      const auto &lhs = regs[instruction.Lhs];
+      const auto &rhs = regs[instruction.Rhs];
+
+      // Arithmetic, comparisons and negation fail on nil.
+      switch (instruction.Op) {
+      case Op_add:
+      case Op_sub:
+      case Op_mul:
+      case Op_div:
+      case Op_lt:
+      case Op_le:
+      case Op_gt:
+      case Op_ge:
+        if (rhs.Nils)
+          flagNils(rhs.Nils, errors, n);
+        LLVM_FALLTHROUGH;
+      case Op_neg:
+        if (lhs.Nils)
+          flagNils(lhs.Nils, errors, n);
+        break;
+      default:
+        break;
+      }
+
+      switch (instruction.Op) {
+      case Op_column: {
+        const auto *column = columns[r];
+        reg.Numbers = column->Numbers ? column->Numbers + begin : nullptr;
+        reg.Bools = column->Bools ? column->Bools + begin : nullptr;
+        reg.Nils = column->Nils ? column->Nils + begin : nullptr;
+        break;
+      }
+      case Op_constant:
+        break;
+      case Op_add:
+        mapBinary(lhs.Numbers, rhs.Numbers, numbers, n, std::plus<>());
+        break;
+      case Op_sub:
+        mapBinary(lhs.Numbers, rhs.Numbers, numbers, n, std::minus<>());
+        break;
+      case Op_mul:
+        mapBinary(lhs.Numbers, rhs.Numbers, numbers, n, std::multiplies<>());
+        break;
+      case Op_div:
+        mapBinary(lhs.Numbers, rhs.Numbers, numbers, n, std::divides<>());
+        break;
+      case Op_lt:
+        mapBinary(lhs.Numbers, rhs.Numbers, bools, n, std::less<>());
+        break;
+      case Op_le:
+        mapBinary(lhs.Numbers, rhs.Numbers, bools, n, std::less_equal<>());
+        break;
+      case Op_gt:
+        mapBinary(lhs.Numbers, rhs.Numbers, bools, n, std::greater<>());
+        break;
+      case Op_ge:
+        mapBinary(lhs.Numbers, rhs.Numbers, bools, n, std::greater_equal<>());
+        break;
+      case Op_eq:
+      case Op_ne: {
+        const auto lhsType = code[instruction.Lhs].Type;
+        const auto rhsType = code[instruction.Rhs].Type;
+        if (lhsType != rhsType || lhsType == ColumnType::Nil)
+          std::fill_n(bools, n, false);
+        else if (lhsType == ColumnType::Number)
+          mapBinary(lhs.Numbers, rhs.Numbers, bools, n, std::equal_to<>());
+        else
+          mapBinary(lhs.Bools, rhs.Bools, bools, n, std::equal_to<>());
+        if (lhs.Nils || rhs.Nils)
+          fixNilEquality(lhs.Nils ? lhs.Nils : noNils.data(),
+                         rhs.Nils ? rhs.Nils : noNils.data(), bools, n);
+        if (instruction.Op == Op_ne)
+          for (std::size_t i = 0u; i < n; ++i)
+            bools[i] = !bools[i];
+        break;
+      }
+      case Op_neg:
+        for (std::size_t i = 0u; i < n; ++i)
+          numbers[i] = -lhs.Numbers[i];
+        break;
+      case Op_not:
+        // Only `true` is truthy; nil and numbers are not.
+        if (code[instruction.Lhs].Type != ColumnType::Bool) {
+          std::fill_n(bools, n, true);
+        } else if (lhs.Nils) {
+          for (std::size_t i = 0u; i < n; ++i)
+            bools[i] = lhs.Nils[i] | !lhs.Bools[i];
+        } else {
+          for (std::size_t i = 0u; i < n; ++i)
+            bools[i] = !lhs.Bools[i];
+        }
+        break;
+      }
+    }
+
+    const auto &result = regs.back();
+    if (output.Type == ColumnType::Number)
+      std::copy_n(result.Numbers, n, output.Numbers.data() + begin);
+    else if (output.Type == ColumnType::Bool)
+      std::copy_n(result.Bools, n, output.Bools.data() + begin);
+    if (result.Nils)
+      std::copy_n(result.Nils, n, output.Nils.data() + begin);
+  }
+
+  output.ErrorCount = std::count(output.Errors.begin(), output.Errors.end(),
+                                 true);
+  return output;
+}
+
+} // namespace lox
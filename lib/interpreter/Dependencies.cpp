@@ -0,0 +1,132 @@
+#include "lox/interpreter/Dependencies.hpp"
+#include "llvm/ADT/StringMap.h"
+#include <algorithm>
+
+namespace lox {
+
+namespace {
+
+struct AccessCollector {
+  StmtAccess &Access;
+
+  static void add(SmallVectorImpl<StringRef> &names, const StringRef name) {
+    if (!is_contained(names, name))
+      names.push_back(name);
+  }
+
+  void visit(const Expr *expr) {
+    if (expr)
+      std::visit(*this, *expr);
+  }
+
+  void operator()(const BinaryE &binaryE) {
+    visit(binaryE.getLhs());
+    visit(binaryE.getRhs());
+  }
+  void operator()(const UnaryE &unaryE) { visit(unaryE.getExpr()); }
+  void operator()(const GroupingE &groupingE) { visit(groupingE.getExpr()); }
+  void operator()(const LiteralE &) {}
+  void operator()(const VarE &varE) {
+    add(Access.Reads, varE.getSymbol()->Symbol);
+  }
+  void operator()(const AssignE &assignE) {
+    // The assignment looks the name up before it stores to it.
+    add(Access.Reads, assignE.getSymbol()->Symbol);
+    visit(assignE.getValue());
+    add(Access.Writes, assignE.getSymbol()->Symbol);
+  }
+  void operator()(const ArrayE &arrayE) {
+    for (const auto &element : arrayE.getElements())
+      visit(element.get());
+  }
+  void operator()(const IndexE &indexE) {
+    visit(indexE.getArray());
+    visit(indexE.getIndex());
+  }
+  void operator()(const CallE &callE) {
+    for (const auto &arg : callE.getArgs())
+      visit(arg.get());
+  }
+  void operator()(const MapE &mapE) {
+    for (const auto &operand : mapE.getOperands())
+      visit(operand.get());
+  }
+
+  void operator()(const ExprStmt &exprStmt) { visit(exprStmt.getExpr()); }
+  void operator()(const PrintStmt &printStmt) { visit(printStmt.getExpr()); }
+  void operator()(const VarStmt &varStmt) {
+    visit(varStmt.getInit());
+    add(Access.Writes, varStmt.getSymbol()->Symbol);
+  }
+};
+
+} // namespace
+
+StmtAccess collectAccess(const Stmt &stmt) {
+  StmtAccess access;
+  std::visit(AccessCollector{access}, stmt);
+  return access;
+}
+
+DependencyGraph::DependencyGraph(const Program &program) : edges(0u) {
+  struct NameState {
+    int LastWriter = -1;
+    /// Readers since the last write.
+    SmallVector<unsigned, 4> Readers;
+  };
+  StringMap<NameState> names;
+
+  accesses.reserve(program.size());
+  predecessors.resize(program.size());
+  successors.resize(program.size());
+
+  // Edges are added for one `to` at a time, in program order, so remembering
+  // the last successor of each statement is enough to skip duplicates.
+  SmallVector<unsigned, 0> lastSuccessor(program.size(), ~0u);
+  const auto addEdge = [&](const unsigned from, const unsigned to) {
+    if (from == to || lastSuccessor[from] == to)
+      return;
+    lastSuccessor[from] = to;
+    predecessors[to].push_back(from);
+    successors[from].push_back(to);
+    edges++;
+  };
+  for (unsigned i = 0u; i < program.size(); ++i) {
+    accesses.push_back(program[i] ? collectAccess(*program[i]) : StmtAccess{});
+    const auto &access = accesses.back();
+
+    for (const auto name : access.Reads) {
+      const auto &state = names[name];
+      if (state.LastWriter >= 0)
+        addEdge(state.LastWriter, i);
+    }
+    for (const auto name : access.Writes) {
+      auto &state = names[name];
+      if (state.LastWriter >= 0)
+        addEdge(state.LastWriter, i);
+      for (const auto reader : state.Readers)
+        addEdge(reader, i);
+      state.LastWriter = i;
+      state.Readers.clear();
+    }
+    for (const auto name : access.Reads) {
+      auto &state = names[name];
+      if (state.LastWriter != static_cast<int>(i))
+        state.Readers.push_back(i);
+    }
+  }
+}
+
+std::size_t DependencyGraph::getCriticalPath() const {
+  // Predecessors always come earlier in program order.
+  SmallVector<std::size_t, 0> depth(size(), 1u);
+  std::size_t longest = 0u;
+  for (std::size_t i = 0u; i < size(); ++i) {
+    for (const auto pred : predecessors[i])
+      depth[i] = std::max<std::size_t>(depth[i], depth[pred] + 1u);
+    longest = std::max(longest, depth[i]);
+  }
+  return longest;
+}
+
+} // namespace lox
@@ -0,0 +1,52 @@
+#include "lox/interpreter/ForkableGlobals.hpp"
+
+namespace lox {
+
+void ForkableGlobals::define(const StringRef name, sptr<Value> value) {
+  overlay[name] = std::move(value);
+}
+
+bool ForkableGlobals::assign(const StringRef name, sptr<Value> value) {
+  if (const auto it = overlay.find(name); it != overlay.end()) {
+    it->second = std::move(value);
+    return true;
+  }
+  if (!find(name))
+    return false;
+  // Copy on write: the frozen binding is shadowed, not changed.
+  overlay.try_emplace(name, std::move(value));
+  return true;
+}
+
+const sptr<Value> *ForkableGlobals::find(const StringRef name) const {
+  if (const auto it = overlay.find(name); it != overlay.end())
+    return &it->second;
+  for (const auto *layer = frozen.get(); layer; layer = layer->Parent.get())
+    if (const auto it = layer->Bindings.find(name);
+        it != layer->Bindings.end())
+      return &it->second;
+  return nullptr;
+}
+
+ForkableGlobals ForkableGlobals::fork() {
+  if (!overlay.empty()) {
+    auto layer = mksptr<Layer>();
+    layer->Bindings = std::move(overlay);
+    layer->Parent = std::move(frozen);
+    overlay = StringMap<sptr<Value>>();
+    frozen = std::move(layer);
+  }
+
+  ForkableGlobals child;
+  child.frozen = frozen;
+  return child;
+}
+
+std::size_t ForkableGlobals::getDepth() const {
+  std::size_t depth = 0u;
+  for (const auto *layer = frozen.get(); layer; layer = layer->Parent.get())
+    ++depth;
+  return depth;
+}
+
+} // namespace lox
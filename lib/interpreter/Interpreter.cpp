@@ -1,38 +1,83 @@
 #include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/ArrayKernels.hpp"
+#include "utils/Trace.hpp"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ErrorHandling.h"
 
-#include <llvm/Support/FormatVariadic.h>
 
 namespace lox {
 
+namespace {
+/// Fires the stmt__begin / stmt__end tracepoints around one statement. The
+/// location is the address of the statement in the source buffer.
+class StmtTraceScope {
+public:
+  StmtTraceScope(const SMLoc loc, const WorkCounters::StmtNode kind)
+      : loc(loc), kind(kind) {
+    LOX_TRACE2(stmt__begin, loc.getPointer(), kind);
+  }
+  ~StmtTraceScope() { LOX_TRACE2(stmt__end, loc.getPointer(), kind); }
+
+private:
+  SMLoc loc;
+  WorkCounters::StmtNode kind;
+};
+} // namespace
+
 sptr<Value> StmtInterpreter::Evaluate(const Expr &expr) const {
   return std::visit(ExprEvaluator, expr);
 }
 
 bool StmtInterpreter::operator()(const ExprStmt &exprStmt) {
+  ProfileFrame frame(profiler, exprStmt.getLoc());
+  count(WorkCounters::ExprS);
+  StmtTraceScope trace(exprStmt.getLoc(), WorkCounters::ExprS);
   if (Evaluate(*exprStmt.getExpr()))
     return false;
   return true;
 }
 
 bool StmtInterpreter::operator()(const PrintStmt &printStmt) {
-  const auto exprValuePtr = Evaluate(*printStmt.getExpr());
+  ProfileFrame frame(profiler, printStmt.getLoc());
+  count(WorkCounters::PrintS);
+  StmtTraceScope trace(printStmt.getLoc(), WorkCounters::PrintS);
+  return print(Evaluate(*printStmt.getExpr()));
+}
+
+bool StmtInterpreter::print(const sptr<Value> &exprValuePtr) {
   if (!exprValuePtr)
     return false;
-  os << exprValuePtr->str() << '\n';
+  // Straight into the stream, without a string in between.
+  const auto size = printValue(*os, *exprValuePtr, numberFormat);
+  if (counters)
+    counters->StringBytesCopied += size;
+  *os << '\n';
   return true;
 }
 
 bool StmtInterpreter::operator()(const VarStmt &varStmt) {
+  ProfileFrame frame(profiler, varStmt.getLoc());
+  count(WorkCounters::VarS);
+  StmtTraceScope trace(varStmt.getLoc(), WorkCounters::VarS);
   sptr<Value> init;
-  if (varStmt.getInit()) {
+  if (varStmt.getInit())
     init = std::visit(ExprEvaluator, *varStmt.getInit());
-    if (!init)
-      return false;
-  }
+  return define(varStmt.getSymbol()->Symbol, varStmt.getInit(),
+                std::move(init));
+}
+
+bool StmtInterpreter::define(const StringRef symbol, const bool hasInit,
+                             sptr<Value> init) {
+  if (hasInit && !init)
+    return false;
 
-  env.insert(varStmt.getSymbol()->Symbol, init);
+  if (counters)
+    counters->EnvInserts++;
+  if (auto *globals = ExprEvaluator.getForkableGlobals())
+    globals->define(symbol, std::move(init));
+  else
+    env.insert(symbol, init);
   return true;
 }
 
@@ -40,95 +85,112 @@ std::size_t StmtInterpreter::getError() const {
   return error + ExprEvaluator.getError();
 }
 
+void StmtInterpreter::setProfiler(Profiler *prof) {
+  profiler = prof;
+  ExprEvaluator.setProfiler(prof);
+}
+
+void StmtInterpreter::setWorkCounters(WorkCounters *workCounters) {
+  counters = workCounters;
+  ExprEvaluator.setWorkCounters(workCounters);
+}
+
 sptr<Value> ExprInterpreter::operator()(const BinaryE &binaryE) {
-  const auto lhsVPtr = std::visit(*this, *binaryE.getLhs());
-  const auto rhsVPtr = std::visit(*this, *binaryE.getRhs());
+  ProfileFrame frame(profiler, binaryE.getLoc());
+  count(WorkCounters::Binary);
+  const auto lhsVPtr = evaluate(*binaryE.getLhs());
+  const auto rhsVPtr = evaluate(*binaryE.getRhs());
+  return evaluateBinary(binaryE.getLoc(), binaryE.getOpKind()->Kind, lhsVPtr,
+                        rhsVPtr);
+}
+
+sptr<Value> ExprInterpreter::evaluateBinary(const SMLoc loc,
+                                            const TokenKind op,
+                                            const sptr<Value> &lhsVPtr,
+                                            const sptr<Value> &rhsVPtr) {
   if (!lhsVPtr || !rhsVPtr)
     return nullptr;
 
   const auto lhsV = lhsVPtr.get();
   const auto rhsV = rhsVPtr.get();
 
-  switch (const auto *opKind = binaryE.getOpKind(); opKind->Kind) {
+  // Arrays only take part in arithmetic; ordering them is an error below.
+  if ((isa<ArrayValue>(lhsV) || isa<ArrayValue>(rhsV)) &&
+      (op == Tok_plus || op == Tok_minus || op == Tok_star || op == Tok_slash))
+    return evaluateArrayArithmetic(loc, op, *lhsV, *rhsV);
+
+  switch (op) {
   case Tok_minus:
     if (NumberValue::classof(lhsV) && NumberValue::classof(rhsV)) {
-      return mkuptr<NumberValue>(llvm::cast<NumberValue>(lhsV)->getValue() -
-                                 llvm::cast<NumberValue>(rhsV)->getValue());
+      return makeValue<NumberValue>(llvm::cast<NumberValue>(lhsV)->getValue() -
+                                    llvm::cast<NumberValue>(rhsV)->getValue());
     } else {
-      report(binaryE.getLoc(), SourceMgr::DK_Error,
-             "Operands must be a number");
+      report(Diag_operands_not_numbers, loc);
       return {};
     }
   case Tok_plus:
     if (NumberValue::classof(lhsV) && NumberValue::classof(rhsV)) {
-      return mkuptr<NumberValue>(llvm::cast<NumberValue>(lhsV)->getValue() +
-                                 llvm::cast<NumberValue>(rhsV)->getValue());
+      return makeValue<NumberValue>(llvm::cast<NumberValue>(lhsV)->getValue() +
+                                    llvm::cast<NumberValue>(rhsV)->getValue());
     } else if (StringValue::classof(lhsV) && StringValue::classof(rhsV)) {
-      return mkuptr<StringValue>(llvm::cast<StringValue>(lhsV)->getValue() +
-                                 llvm::cast<StringValue>(rhsV)->getValue());
+      return makeValue<StringValue>(llvm::cast<StringValue>(lhsV)->getValue() +
+                                    llvm::cast<StringValue>(rhsV)->getValue());
     } else {
-      report(binaryE.getLoc(), SourceMgr::DK_Error,
-             "Operands must be a number or string");
+      report(Diag_operands_not_numbers_or_strings, loc);
       return {};
     }
   case Tok_slash:
     if (NumberValue::classof(lhsV) && NumberValue::classof(rhsV)) {
-      return mkuptr<NumberValue>(llvm::cast<NumberValue>(lhsV)->getValue() /
-                                 llvm::cast<NumberValue>(rhsV)->getValue());
+      return makeValue<NumberValue>(llvm::cast<NumberValue>(lhsV)->getValue() /
+                                    llvm::cast<NumberValue>(rhsV)->getValue());
     } else {
-      report(binaryE.getLoc(), SourceMgr::DK_Error,
-             "Operands must be a number");
+      report(Diag_operands_not_numbers, loc);
       return {};
     }
   case Tok_star:
     if (NumberValue::classof(lhsV) && NumberValue::classof(rhsV)) {
-      return mkuptr<NumberValue>(llvm::cast<NumberValue>(lhsV)->getValue() *
-                                 llvm::cast<NumberValue>(rhsV)->getValue());
+      return makeValue<NumberValue>(llvm::cast<NumberValue>(lhsV)->getValue() *
+                                    llvm::cast<NumberValue>(rhsV)->getValue());
     } else {
-      report(binaryE.getLoc(), SourceMgr::DK_Error,
-             "Operands must be a number");
+      report(Diag_operands_not_numbers, loc);
       return {};
     }
   case Tok_ge:
     if (NumberValue::classof(lhsV) && NumberValue::classof(rhsV)) {
-      return mkuptr<BoolValue>(llvm::cast<NumberValue>(lhsV)->getValue() >=
-                               llvm::cast<NumberValue>(rhsV)->getValue());
+      return makeValue<BoolValue>(llvm::cast<NumberValue>(lhsV)->getValue() >=
+                                  llvm::cast<NumberValue>(rhsV)->getValue());
     } else {
-      report(binaryE.getLoc(), SourceMgr::DK_Error,
-             "Operands must be a number");
+      report(Diag_operands_not_numbers, loc);
       return {};
     }
   case Tok_gt:
     if (NumberValue::classof(lhsV) && NumberValue::classof(rhsV)) {
-      return mkuptr<BoolValue>(llvm::cast<NumberValue>(lhsV)->getValue() >
-                               llvm::cast<NumberValue>(rhsV)->getValue());
+      return makeValue<BoolValue>(llvm::cast<NumberValue>(lhsV)->getValue() >
+                                  llvm::cast<NumberValue>(rhsV)->getValue());
     } else {
-      report(binaryE.getLoc(), SourceMgr::DK_Error,
-             "Operands must be a number");
+      report(Diag_operands_not_numbers, loc);
       return {};
     }
   case Tok_le:
     if (NumberValue::classof(lhsV) && NumberValue::classof(rhsV)) {
-      return mkuptr<BoolValue>(llvm::cast<NumberValue>(lhsV)->getValue() <=
-                               llvm::cast<NumberValue>(rhsV)->getValue());
+      return makeValue<BoolValue>(llvm::cast<NumberValue>(lhsV)->getValue() <=
+                                  llvm::cast<NumberValue>(rhsV)->getValue());
     } else {
-      report(binaryE.getLoc(), SourceMgr::DK_Error,
-             "Operands must be a number");
+      report(Diag_operands_not_numbers, loc);
       return {};
     }
   case Tok_lt:
     if (NumberValue::classof(lhsV) && NumberValue::classof(rhsV)) {
-      return mkuptr<BoolValue>(llvm::cast<NumberValue>(lhsV)->getValue() <
-                               llvm::cast<NumberValue>(rhsV)->getValue());
+      return makeValue<BoolValue>(llvm::cast<NumberValue>(lhsV)->getValue() <
+                                  llvm::cast<NumberValue>(rhsV)->getValue());
     } else {
-      report(binaryE.getLoc(), SourceMgr::DK_Error,
-             "Operands must be a number");
+      report(Diag_operands_not_numbers, loc);
       return {};
     }
   case Tok_equal_equal:
-    return mkuptr<BoolValue>(*lhsV == *rhsV);
+    return makeValue<BoolValue>(*lhsV == *rhsV);
   case Tok_bang_equal:
-    return mkuptr<BoolValue>(!(*lhsV == *rhsV));
+    return makeValue<BoolValue>(!(*lhsV == *rhsV));
 
   default:
     llvm_unreachable("runtime error");
@@ -136,23 +198,35 @@ sptr<Value> ExprInterpreter::operator()(const BinaryE &binaryE) {
 }
 
 sptr<Value> ExprInterpreter::operator()(const UnaryE &unaryE) {
-  const auto targetVPtr = std::visit(*this, *unaryE.getExpr());
+  ProfileFrame frame(profiler, unaryE.getLoc());
+  count(WorkCounters::Unary);
+  return evaluateUnary(unaryE.getLoc(), unaryE.getOpKind()->Kind,
+                       evaluate(*unaryE.getExpr()));
+}
+
+sptr<Value> ExprInterpreter::evaluateUnary(const SMLoc loc, const TokenKind op,
+                                           const sptr<Value> &targetVPtr) {
   if (!targetVPtr)
     return nullptr;
   const auto *targetV = targetVPtr.get();
 
-  switch (unaryE.getOpKind()->Kind) {
+  switch (op) {
   case Tok_minus: {
     if (const auto *numberV = llvm::dyn_cast<NumberValue>(targetV))
-      return mkuptr<NumberValue>(-numberV->getValue());
-    else {
-      report(unaryE.getLoc(), SourceMgr::DK_Error, "Operand must be a number");
+      return makeValue<NumberValue>(-numberV->getValue());
+    else if (const auto *arrayV = llvm::dyn_cast<ArrayValue>(targetV)) {
+      SmallVector<double, 0> elements(arrayV->size());
+      kernels::negate(arrayV->getElements().data(), elements.data(),
+                      elements.size());
+      return makeValue<ArrayValue>(std::move(elements));
+    } else {
+      report(Diag_operand_not_number, loc);
       return {};
     }
   }
   case Tok_bang: {
     const auto truthy = targetV->truthy();
-    return mkuptr<BoolValue>(!truthy);
+    return makeValue<BoolValue>(!truthy);
   }
   default:
     llvm_unreachable("all types of unary expression was handled");
@@ -160,56 +234,247 @@ sptr<Value> ExprInterpreter::operator()(const UnaryE &unaryE) {
 }
 
 sptr<Value> ExprInterpreter::operator()(const GroupingE &groupingE) {
-  return std::visit(*this, *groupingE.getExpr());
+  ProfileFrame frame(profiler, groupingE.getLoc());
+  count(WorkCounters::Grouping);
+  return evaluate(*groupingE.getExpr());
 }
 
 sptr<Value> ExprInterpreter::operator()(const LiteralE &literalE) {
-  switch (const auto *tok = literalE.getValue(); tok->Kind) {
+  ProfileFrame frame(profiler, literalE.getLoc());
+  count(WorkCounters::Literal);
+  const auto *tok = literalE.getValue();
+  return evaluateLiteral(tok->Kind, tok->Symbol);
+}
+
+sptr<Value> ExprInterpreter::evaluateLiteral(const TokenKind kind,
+                                             const StringRef symbol) {
+  switch (kind) {
   case Tok_number:
-    return mkuptr<NumberValue>(std::stold(tok->Symbol.str()));
+    return makeValue<NumberValue>(std::stold(symbol.str()));
   case Tok_string:
-    return mkuptr<StringValue>(tok->Symbol.str());
+    return makeValue<StringValue>(symbol.str());
   case Tok_true:
-    return mkuptr<BoolValue>(true);
+    return makeValue<BoolValue>(true);
   case Tok_false:
-    return mkuptr<BoolValue>(false);
+    return makeValue<BoolValue>(false);
   case Tok_nil:
-    return mkuptr<NilValue>();
+    return makeValue<NilValue>();
   default:
-    llvm::errs() << getTokenName(tok->Kind) << '\n';
+    llvm::errs() << getTokenName(kind) << '\n';
     llvm_unreachable("All of literal types are handled");
   }
 }
 
 sptr<Value> ExprInterpreter::operator()(const VarE &varE) {
-  auto symbol = varE.getSymbol()->Symbol;
-  if (!env.count(symbol)) {
-    report(varE.getLoc(), SourceMgr::DK_Error,
-           formatv("Undefined variable : {0}", symbol).str());
+  ProfileFrame frame(profiler, varE.getLoc());
+  count(WorkCounters::Var);
+  return evaluateVar(varE.getLoc(), varE.getSymbol()->Symbol);
+}
+
+sptr<Value> ExprInterpreter::evaluateVar(const SMLoc loc,
+                                         const StringRef symbol) {
+  if (!hasVar(symbol)) {
+    report(Diag_undefined_variable, loc, symbol);
     return nullptr;
   }
-  return env.lookup(symbol);
+  return lookupVar(symbol);
 }
 
 sptr<Value> ExprInterpreter::operator()(const AssignE &assignE) {
-  auto symbol = assignE.getSymbol();
-  if (!env.count(symbol->Symbol)) {
-    report(symbol->Loc, SourceMgr::DK_Error,
-           formatv("Undefined variable : {0}", symbol).str());
+  ProfileFrame frame(profiler, assignE.getLoc());
+  count(WorkCounters::Assign);
+  const auto *symbol = assignE.getSymbol();
+  if (!checkAssignTarget(symbol->Loc, symbol->Symbol))
     return nullptr;
+  return evaluateAssign(symbol->Symbol, evaluate(*assignE.getValue()));
+}
+
+bool ExprInterpreter::checkAssignTarget(const SMLoc symbolLoc,
+                                        const StringRef symbol) {
+  if (!hasVar(symbol)) {
+    report(Diag_undefined_variable, symbolLoc, symbol);
+    return false;
   }
-  const auto value = std::visit(*this, *assignE.getValue());
+  return true;
+}
+
+sptr<Value> ExprInterpreter::evaluateAssign(const StringRef symbol,
+                                            sptr<Value> value) {
   if (!value)
     return nullptr;
-  env.insert(symbol->Symbol, value);
+  assignVar(symbol, value);
   return value;
 }
 
-void ExprInterpreter::report(const SMLoc loc, const SourceMgr::DiagKind kind,
-                             const StringRef msg, raw_ostream &os) {
-  SrcMgr.PrintMessage(os, loc, kind, msg);
-  if (kind == SourceMgr::DK_Error)
-    error++;
+sptr<Value> ExprInterpreter::operator()(const ArrayE &arrayE) {
+  ProfileFrame frame(profiler, arrayE.getLoc());
+  count(WorkCounters::Array);
+  SmallVector<sptr<Value>, 4> elements;
+  for (const auto &element : arrayE.getElements())
+    elements.push_back(evaluate(*element));
+  return evaluateArray(arrayE.getLoc(), elements);
+}
+
+sptr<Value> ExprInterpreter::operator()(const IndexE &indexE) {
+  ProfileFrame frame(profiler, indexE.getLoc());
+  count(WorkCounters::Index);
+  const auto arrayVPtr = evaluate(*indexE.getArray());
+  const auto indexVPtr = evaluate(*indexE.getIndex());
+  return evaluateIndex(indexE.getLoc(), arrayVPtr, indexVPtr);
+}
+
+sptr<Value> ExprInterpreter::operator()(const CallE &callE) {
+  ProfileFrame frame(profiler, callE.getLoc());
+  count(WorkCounters::Call);
+  SmallVector<sptr<Value>, 4> args;
+  for (const auto &arg : callE.getArgs())
+    args.push_back(evaluate(*arg));
+  return evaluateCall(callE.getLoc(), callE.getBuiltin(), args,
+                      callE.getUpdated());
+}
+
+sptr<Value> ExprInterpreter::operator()(const MapE &mapE) {
+  ProfileFrame frame(profiler, mapE.getLoc());
+  count(WorkCounters::Map);
+  SmallVector<sptr<Value>, 4> operands;
+  for (const auto &operand : mapE.getOperands())
+    operands.push_back(evaluate(*operand));
+  return evaluateMap(mapE.getLoc(), operands);
+}
+
+sptr<Value> ExprInterpreter::evaluate(const Expr &expr) {
+  // Leaves need no stack.
+  if (std::holds_alternative<LiteralE>(expr) ||
+      std::holds_alternative<VarE>(expr))
+    return std::visit(*this, expr);
+
+  // Reentrant: another evaluation may be in progress below these bases.
+  const auto workBase = work.size();
+  work.push_back({&expr, false});
+  while (work.size() > workBase) {
+    const auto item = work.pop_back_val();
+    if (item.Expanded)
+      finish(*item.Node);
+    else
+      expand(*item.Node);
+  }
+  return operands.pop_back_val();
+}
+
+void ExprInterpreter::expand(const Expr &expr) {
+  if (const auto *binaryE = std::get_if<BinaryE>(&expr)) {
+    if (profiler)
+      profiler->push(binaryE->getLoc());
+    count(WorkCounters::Binary);
+    // The left operand is evaluated first.
+    work.push_back({&expr, true});
+    work.push_back({binaryE->getRhs(), false});
+    work.push_back({binaryE->getLhs(), false});
+  } else if (const auto *unaryE = std::get_if<UnaryE>(&expr)) {
+    if (profiler)
+      profiler->push(unaryE->getLoc());
+    count(WorkCounters::Unary);
+    work.push_back({&expr, true});
+    work.push_back({unaryE->getExpr(), false});
+  } else if (const auto *groupingE = std::get_if<GroupingE>(&expr)) {
+    if (profiler)
+      profiler->push(groupingE->getLoc());
+    count(WorkCounters::Grouping);
+    work.push_back({&expr, true});
+    work.push_back({groupingE->getExpr(), false});
+  } else if (const auto *assignE = std::get_if<AssignE>(&expr)) {
+    if (profiler)
+      profiler->push(assignE->getLoc());
+    count(WorkCounters::Assign);
+    const auto *symbol = assignE->getSymbol();
+    if (!checkAssignTarget(symbol->Loc, symbol->Symbol)) {
+      operands.push_back(nullptr);
+      if (profiler)
+        profiler->pop();
+      return;
+    }
+    work.push_back({&expr, true});
+    work.push_back({assignE->getValue(), false});
+  } else if (const auto *arrayE = std::get_if<ArrayE>(&expr)) {
+    if (profiler)
+      profiler->push(arrayE->getLoc());
+    count(WorkCounters::Array);
+    work.push_back({&expr, true});
+    for (const auto &element : llvm::reverse(arrayE->getElements()))
+      work.push_back({element.get(), false});
+  } else if (const auto *indexE = std::get_if<IndexE>(&expr)) {
+    if (profiler)
+      profiler->push(indexE->getLoc());
+    count(WorkCounters::Index);
+    work.push_back({&expr, true});
+    work.push_back({indexE->getIndex(), false});
+    work.push_back({indexE->getArray(), false});
+  } else if (const auto *callE = std::get_if<CallE>(&expr)) {
+    if (profiler)
+      profiler->push(callE->getLoc());
+    count(WorkCounters::Call);
+    work.push_back({&expr, true});
+    for (const auto &arg : llvm::reverse(callE->getArgs()))
+      work.push_back({arg.get(), false});
+  } else if (const auto *mapE = std::get_if<MapE>(&expr)) {
+    if (profiler)
+      profiler->push(mapE->getLoc());
+    count(WorkCounters::Map);
+    work.push_back({&expr, true});
+    for (const auto &operand : llvm::reverse(mapE->getOperands()))
+      work.push_back({operand.get(), false});
+  } else {
+    operands.push_back(std::visit(*this, expr));
+  }
+}
+
+void ExprInterpreter::finish(const Expr &expr) {
+  if (const auto *binaryE = std::get_if<BinaryE>(&expr)) {
+    const auto rhsVPtr = operands.pop_back_val();
+    const auto lhsVPtr = operands.pop_back_val();
+    operands.push_back(evaluateBinary(
+        binaryE->getLoc(), binaryE->getOpKind()->Kind, lhsVPtr, rhsVPtr));
+  } else if (const auto *unaryE = std::get_if<UnaryE>(&expr)) {
+    operands.back() = evaluateUnary(
+        unaryE->getLoc(), unaryE->getOpKind()->Kind, operands.back());
+  } else if (const auto *assignE = std::get_if<AssignE>(&expr)) {
+    operands.back() = evaluateAssign(assignE->getSymbol()->Symbol,
+                                     std::move(operands.back()));
+  } else if (const auto *arrayE = std::get_if<ArrayE>(&expr)) {
+    const auto size = arrayE->getElements().size();
+    auto arrayVPtr = evaluateArray(
+        arrayE->getLoc(), ArrayRef<sptr<Value>>(operands).take_back(size));
+    operands.truncate(operands.size() - size);
+    operands.push_back(std::move(arrayVPtr));
+  } else if (const auto *indexE = std::get_if<IndexE>(&expr)) {
+    const auto indexVPtr = operands.pop_back_val();
+    operands.back() =
+        evaluateIndex(indexE->getLoc(), operands.back(), indexVPtr);
+  } else if (const auto *callE = std::get_if<CallE>(&expr)) {
+    const auto size = callE->getArgs().size();
+    auto resultVPtr =
+        evaluateCall(callE->getLoc(), callE->getBuiltin(),
+                     ArrayRef<sptr<Value>>(operands).take_back(size),
+                     callE->getUpdated());
+    operands.truncate(operands.size() - size);
+    operands.push_back(std::move(resultVPtr));
+  } else if (const auto *mapE = std::get_if<MapE>(&expr)) {
+    const auto size = mapE->getOperands().size();
+    auto mapVPtr = evaluateMap(
+        mapE->getLoc(), ArrayRef<sptr<Value>>(operands).take_back(size));
+    operands.truncate(operands.size() - size);
+    operands.push_back(std::move(mapVPtr));
+  }
+  // A grouping is the value of its operand.
+  if (profiler)
+    profiler->pop();
+}
+
+void ExprInterpreter::report(const DiagCode code, const SMLoc loc,
+                             const ArrayRef<StringRef> args) {
+  const StringRef name = getDiagName(code);
+  LOX_TRACE3(runtime__error, loc.getPointer(), name.data(), name.size());
+  diags.report(code, loc, args);
 }
 
 } // namespace lox
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "lox/interpreter/Isolate.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+
+namespace lox {
+
+sptr<const CompiledScript> CompiledScript::compile(const StringRef name,
+                                                   const StringRef code,
+                                                   raw_ostream &diagOS) {
+  auto script = sptr<CompiledScript>(new CompiledScript);
+  script->buffer = MemoryBuffer::getMemBufferCopy(code, name);
+
+  // The SourceMgr is only needed for the diagnostics of the front end.
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(
+      MemoryBuffer::getMemBuffer(script->buffer->getMemBufferRef()), {});
+  const auto source = script->getSource();
+
+  Lexer lexer(srcMgr, source);
+  lexer.setDiagnosticStream(diagOS);
+  if (!lexer.Lex())
+    return nullptr;
+  script->tokens = lexer.takeTokens();
+
+  Parser parser(script->tokens, srcMgr);
+  parser.setDiagnosticStream(diagOS);
+  script->program = parser.Parse();
+  if (parser.getError())
+    return nullptr;
+  return script;
+}
+
+Isolate::Isolate()
+    : outputOS(output), diagOS(diagnostics), globals(nullptr),
+      exprInterpreter(srcMgr, env),
+      stmtInterpreter(srcMgr, exprInterpreter, env, outputOS),
+      resumable(stmtInterpreter) {
+  globals = mkuptr<LoxValueScope>(env);
+  exprInterpreter.setDiagnosticStream(diagOS);
+  exprInterpreter.setForkableGlobals(&variables);
+}
+
+uptr<Isolate> Isolate::fork() {
+  auto child = mkuptr<Isolate>();
+  child->variables = variables.fork();
+  child->setSharedGlobals(exprInterpreter.getSharedGlobals());
+  return child;
+}
+
+Isolate::~Isolate() = default;
+
+void Isolate::load(const sptr<const CompiledScript> &script) {
+  if (loaded.insert(script.get()).second) {
+    // A view of the shared buffer: the AST's locations resolve through this
+    // isolate's own SourceMgr.
+    srcMgr.AddNewSourceBuffer(
+        MemoryBuffer::getMemBuffer(script->getSource(), script->getName(),
+                                   false),
+        {});
+    scripts.push_back(script);
+  }
+}
+
+bool Isolate::run(const sptr<const CompiledScript> &script) {
+  load(script);
+  const auto errors = getError();
+  for (const auto &stmt : script->getProgram())
+    std::visit(stmtInterpreter, *stmt);
+  return getError() == errors;
+}
+
+void Isolate::start(const sptr<const CompiledScript> &script) {
+  load(script);
+  resumable.start(script->getProgram());
+}
+
+void Isolate::clearOutput() {
+  output.clear();
+  diagnostics.clear();
+}
+
+void Isolate::reset() {
+  resumable.stop();
+  variables = ForkableGlobals();
+  scripts.clear();
+  loaded.clear();
+  srcMgr = SourceMgr();
+  clearOutput();
+  stmtInterpreter.setOutputStream(outputOS);
+  exprInterpreter.setDiagnosticStream(diagOS);
+}
+
+void Isolate::setOutputStream(raw_ostream &os) {
+  stmtInterpreter.setOutputStream(os);
+}
+
+void Isolate::setDiagnosticStream(raw_ostream &os) {
+  exprInterpreter.setDiagnosticStream(os);
+}
+
+} // namespace lox
@@ -0,0 +1,245 @@
+#include "lox/interpreter/MapTable.hpp"
+#include "lox/interpreter/Value.hpp"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace lox {
+
+namespace {
+
+constexpr std::int8_t Empty = -128;
+constexpr std::int8_t Deleted = -2;
+constexpr std::size_t GroupWidth = 16u;
+constexpr std::size_t NotFound = ~std::size_t{0u};
+
+/// Bytes of a long double that carry its value; the x87 format is padded.
+constexpr std::size_t NumberBytes =
+    std::numeric_limits<long double>::digits == 64 ? 10u
+                                                   : sizeof(long double);
+
+/// The control bytes of one group of slots, as masks of 16 bits.
+class Group {
+public:
+#ifdef __SSE2__
+  explicit Group(const std::int8_t *ctrl)
+      : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl))) {}
+
+  [[nodiscard]] std::uint32_t match(const std::int8_t byte) const {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(byte), bytes));
+  }
+  /// Empty and deleted slots: the sign bits.
+  [[nodiscard]] std::uint32_t matchFree() const {
+    return _mm_movemask_epi8(bytes);
+  }
+
+private:
+  __m128i bytes;
+#else
+  explicit Group(const std::int8_t *ctrl) : ctrl(ctrl) {}
+
+  [[nodiscard]] std::uint32_t match(const std::int8_t byte) const {
+    std::uint32_t mask = 0u;
+    for (auto i = 0u; i < GroupWidth; ++i)
+      mask |= static_cast<std::uint32_t>(ctrl[i] == byte) << i;
+    return mask;
+  }
+  [[nodiscard]] std::uint32_t matchFree() const {
+    std::uint32_t mask = 0u;
+    for (auto i = 0u; i < GroupWidth; ++i)
+      mask |= static_cast<std::uint32_t>(ctrl[i] < 0) << i;
+    return mask;
+  }
+
+private:
+  const std::int8_t *ctrl;
+#endif
+};
+
+/// The 7 bits of a hash in the control byte of its slot.
+std::int8_t getTag(const std::uint64_t hash) {
+  return static_cast<std::int8_t>(hash & 0x7fu);
+}
+
+/// The groups a hash probes: its own, then in triangular steps, which visit
+/// every group of a power of two of them.
+class ProbeSequence {
+public:
+  ProbeSequence(const std::uint64_t hash, const std::size_t capacity)
+      : mask(capacity / GroupWidth - 1u), group((hash >> 7u) & mask) {}
+
+  [[nodiscard]] std::size_t getOffset() const { return group * GroupWidth; }
+  void next() { group = (group + ++step) & mask; }
+
+private:
+  std::size_t mask;
+  std::size_t group;
+  std::size_t step = 0u;
+};
+
+/// Most full slots in a table of `capacity`: 7/8 of them.
+std::size_t getMaxLoad(const std::size_t capacity) {
+  return capacity - capacity / 8u;
+}
+
+/// Final mix of MurmurHash3, so that close numbers spread over groups.
+std::uint64_t mix(std::uint64_t x) {
+  x ^= x >> 33u;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33u;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33u;
+  return x;
+}
+
+} // namespace
+
+bool MapTable::isKey(const Value &key) {
+  switch (key.getKind()) {
+  case Number:
+    return !std::isnan(cast<NumberValue>(key).getValue());
+  case String:
+  case Bool:
+  case Nil:
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::uint64_t MapTable::hash(const Value &key) {
+  switch (key.getKind()) {
+  case Number: {
+    // 0 and -0 are equal keys.
+    auto number = cast<NumberValue>(key).getValue();
+    if (number == 0.0L)
+      number = 0.0L;
+    std::uint64_t words[2] = {};
+    std::memcpy(words, &number, NumberBytes);
+    return mix(words[0] ^ mix(words[1] + Number));
+  }
+  case String:
+    return xxHash64(cast<StringValue>(key).getValue());
+  case Bool:
+    return mix(Bool << 1u | static_cast<unsigned>(key.truthy()));
+  default:
+    return mix(key.getKind());
+  }
+}
+
+std::size_t MapTable::findSlot(const Value &key,
+                               const std::uint64_t hash) const {
+  if (ctrl.empty())
+    return NotFound;
+  // At least an eighth of the slots are empty, so this ends.
+  for (ProbeSequence probe(hash, capacity());; probe.next()) {
+    const auto offset = probe.getOffset();
+    const Group group(&ctrl[offset]);
+    for (auto mask = group.match(getTag(hash)); mask; mask &= mask - 1u) {
+      const auto slot = offset + countTrailingZeros(mask);
+      if (slots[slot].Hash == hash && *slots[slot].Key == key)
+        return slot;
+    }
+    if (group.match(Empty))
+      return NotFound;
+  }
+}
+
+std::size_t MapTable::findFree(const std::uint64_t hash) const {
+  for (ProbeSequence probe(hash, capacity());; probe.next())
+    if (const auto mask = Group(&ctrl[probe.getOffset()]).matchFree())
+      return probe.getOffset() + countTrailingZeros(mask);
+}
+
+const MapTable::Entry *MapTable::find(const Value &key) const {
+  if (!isKey(key))
+    return nullptr;
+  const auto slot = findSlot(key, hash(key));
+  return slot == NotFound ? nullptr : &slots[slot];
+}
+
+bool MapTable::insert(sptr<Value> key, sptr<Value> mapped) {
+  assert(isKey(*key) && "maps only have numbers, strings, booleans and nil");
+  const auto keyHash = hash(*key);
+  if (const auto slot = findSlot(*key, keyHash); slot != NotFound) {
+    slots[slot].Mapped = std::move(mapped);
+    return false;
+  }
+
+  auto slot = ctrl.empty() ? NotFound : findFree(keyHash);
+  if (slot == NotFound || (ctrl[slot] == Empty && !growthLeft)) {
+    // Double if more than half the load is live, otherwise only drop the
+    // deleted slots.
+    const auto newCapacity = count + 1u > getMaxLoad(capacity()) / 2u
+                                 ? std::max(capacity() * 2u, GroupWidth)
+                                 : capacity();
+    rehash(newCapacity);
+    slot = findFree(keyHash);
+  }
+  // A deleted slot was still counted against the growth.
+  if (ctrl[slot] == Empty)
+    --growthLeft;
+  ctrl[slot] = getTag(keyHash);
+  slots[slot] = {keyHash, std::move(key), std::move(mapped)};
+  ++count;
+  return true;
+}
+
+bool MapTable::erase(const Value &key) {
+  if (!isKey(key))
+    return false;
+  const auto slot = findSlot(key, hash(key));
+  if (slot == NotFound)
+    return false;
+  // Probes stop at the first group with an empty slot. A group that has one
+  // had one ever since the last rehash, so no probe went past it, and the
+  // slot can be empty again instead of deleted.
+  const auto offset = slot & ~(GroupWidth - 1u);
+  if (Group(&ctrl[offset]).match(Empty)) {
+    ctrl[slot] = Empty;
+    ++growthLeft;
+  } else {
+    ctrl[slot] = Deleted;
+  }
+  slots[slot] = Entry();
+  --count;
+  return true;
+}
+
+void MapTable::reserve(const std::size_t size) {
+  if (size <= count + growthLeft)
+    return;
+  auto newCapacity = std::max(capacity(), GroupWidth);
+  while (getMaxLoad(newCapacity) < size)
+    newCapacity *= 2u;
+  rehash(newCapacity);
+}
+
+void MapTable::rehash(const std::size_t newCapacity) {
+  assert(newCapacity % GroupWidth == 0u && isPowerOf2_64(newCapacity) &&
+         "a power of two of groups");
+  std::vector<std::int8_t> oldCtrl(newCapacity, Empty);
+  std::vector<Entry> oldSlots(newCapacity);
+  oldCtrl.swap(ctrl);
+  oldSlots.swap(slots);
+  growthLeft = getMaxLoad(newCapacity) - count;
+  // The stored hashes place the entries; no key is hashed again.
+  for (std::size_t i = 0u; i < oldCtrl.size(); ++i) {
+    if (oldCtrl[i] < 0)
+      continue;
+    const auto slot = findFree(oldSlots[i].Hash);
+    ctrl[slot] = oldCtrl[i];
+    slots[slot] = std::move(oldSlots[i]);
+  }
+}
+
+} // namespace lox
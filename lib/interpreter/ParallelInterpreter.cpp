@@ -0,0 +1,148 @@
+#include "lox/interpreter/ParallelInterpreter.hpp"
+#include "lox/interpreter/Dependencies.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "utils/WorkStealingPool.hpp"
+#include "llvm/ADT/StringMap.h"
+#include <atomic>
+
+namespace lox {
+
+namespace {
+
+/// The value of one global between statements. Statements that touch the
+/// same name are ordered by the dependency graph, so no slot is ever
+/// written while another thread uses it.
+struct GlobalSlot {
+  sptr<Value> Current;
+  bool Defined = false;
+};
+
+struct StmtResult {
+  std::string Output;
+  std::string Diagnostics;
+  std::size_t Errors = 0u;
+};
+
+class ParallelRun {
+public:
+  ParallelRun(SourceMgr &srcMgr, const Program &program,
+              const DependencyGraph &graph,
+              const ParallelExecOptions &options)
+      : srcMgr(srcMgr), program(program), graph(graph),
+        numberFormat(options.Format), results(program.size()),
+        pending(program.size()), pool(options.Threads) {
+    for (std::size_t i = 0u; i < graph.size(); ++i) {
+      const auto &access = graph.getAccess(i);
+      for (const auto name : access.Reads)
+        slotIndex.try_emplace(name, slotIndex.size());
+      for (const auto name : access.Writes)
+        slotIndex.try_emplace(name, slotIndex.size());
+    }
+    slots.resize(slotIndex.size());
+  }
+
+  void run() {
+    for (std::size_t i = 0u; i < program.size(); ++i)
+      pending[i].store(graph.getPredecessors(i).size());
+    for (std::size_t i = 0u; i < program.size(); ++i)
+      if (graph.getPredecessors(i).empty())
+        pool.async([this, i] { runStmt(i); });
+    pool.wait();
+  }
+
+  [[nodiscard]] ArrayRef<StmtResult> getResults() const { return results; }
+
+private:
+  GlobalSlot &slot(const StringRef name) {
+    return slots[slotIndex.find(name)->second];
+  }
+
+  void runStmt(const std::size_t index) {
+    execute(index);
+    for (const auto succ : graph.getSuccessors(index))
+      if (pending[succ].fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+        pool.async([this, succ] { runStmt(succ); });
+  }
+
+  void execute(const std::size_t index) {
+    if (!program[index])
+      return;
+    auto &result = results[index];
+    raw_string_ostream os(result.Output);
+    raw_string_ostream diagOS(result.Diagnostics);
+    const auto &access = graph.getAccess(index);
+
+    LoxValueEnv env;
+    LoxValueScope scope(env);
+    // Writes of assignments are reads too, so this covers every name the
+    // statement can look up.
+    for (const auto name : access.Reads) {
+      const auto &global = slot(name);
+      if (global.Defined)
+        env.insert(name, global.Current);
+    }
+
+    ExprInterpreter exprInterpreter(srcMgr, env);
+    exprInterpreter.setDiagnosticStream(diagOS);
+    StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+    stmtInterpreter.setNumberFormat(numberFormat);
+    std::visit(stmtInterpreter, *program[index]);
+    result.Errors = stmtInterpreter.getError();
+
+    for (const auto name : access.Writes) {
+      if (!env.count(name))
+        continue;
+      auto &global = slot(name);
+      global.Current = env.lookup(name);
+      global.Defined = true;
+    }
+  }
+
+  SourceMgr &srcMgr;
+  const Program &program;
+  const DependencyGraph &graph;
+  NumberFormat numberFormat;
+  StringMap<unsigned> slotIndex;
+  std::vector<GlobalSlot> slots;
+  std::vector<StmtResult> results;
+  std::vector<std::atomic<unsigned>> pending;
+  WorkStealingPool pool;
+};
+
+} // namespace
+
+ParallelExecStats interpretParallel(SourceMgr &srcMgr, const Program &program,
+                                    raw_ostream &os, raw_ostream &diagOS,
+                                    const ParallelExecOptions &options) {
+  ParallelExecStats stats;
+  stats.Statements = program.size();
+  if (program.empty())
+    return stats;
+
+  // Diagnostics build the line table of the buffer; do it before the
+  // workers share the SourceMgr.
+  for (const auto &stmt : program)
+    if (stmt) {
+      srcMgr.FindLineNumber(getLoc(*stmt));
+      break;
+    }
+
+  const DependencyGraph graph(program);
+  stats.Edges = graph.getEdgeCount();
+  stats.CriticalPath = graph.getCriticalPath();
+
+  ParallelRun run(srcMgr, program, graph, options);
+  run.run();
+
+  for (const auto &result : run.getResults()) {
+    os << result.Output;
+    if (!result.Diagnostics.empty()) {
+      os.flush();
+      diagOS << result.Diagnostics;
+    }
+    stats.RuntimeErrors += result.Errors;
+  }
+  return stats;
+}
+
+} // namespace lox
@@ -0,0 +1,171 @@
+#include "lox/interpreter/Streaming.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "utils/SPSCQueue.hpp"
+#include <algorithm>
+#include <thread>
+
+namespace lox {
+
+namespace {
+
+struct TokenBatch {
+  SmallVector<uptr<Token>, 0> Tokens;
+  /// Lexer diagnostics, keyed by the position of the token they belong to
+  SmallVector<std::pair<std::size_t, std::string>, 0> Diagnostics;
+};
+
+struct ParsedDecl {
+  uptr<Stmt> Statement;
+  SmallVector<uptr<Token>> Tokens;
+  std::string Diagnostics;
+  bool SyntaxError = false;
+};
+
+using ParsedBatch = SmallVector<ParsedDecl, 0>;
+
+std::string takeString(std::string &str) {
+  auto result = std::move(str);
+  str.clear();
+  return result;
+}
+
+/// Hands out the tokens of the batches published by the lexer thread. The
+/// diagnostics of a token are forwarded to the parser's stream when the token
+/// is handed out, exactly when a Lexer used as the source would print them.
+class QueuedTokenSource : public TokenSource {
+public:
+  QueuedTokenSource(SPSCQueue<TokenBatch> &queue, raw_ostream &diagOS)
+      : queue(queue), diagOS(diagOS), cursor(0u), diagCursor(0u),
+        lexErrors(0u) {}
+
+  uptr<Token> next() override {
+    while (cursor == batch.Tokens.size()) {
+      auto nextBatch = queue.pop();
+      if (!nextBatch) {
+        assert(lastEof && "lexer stopped before eof");
+        return mkuptr<Token>(*lastEof);
+      }
+      batch = std::move(*nextBatch);
+      cursor = 0u;
+      diagCursor = 0u;
+    }
+
+    while (diagCursor < batch.Diagnostics.size() &&
+           batch.Diagnostics[diagCursor].first == cursor)
+      diagOS << batch.Diagnostics[diagCursor++].second;
+
+    auto tok = std::move(batch.Tokens[cursor++]);
+    // Every lexer error produces an error token.
+    if (tok->Kind == Tok_error)
+      lexErrors++;
+    if (tok->Kind == Tok_eof)
+      lastEof = mkuptr<Token>(*tok);
+    return tok;
+  }
+
+  [[nodiscard]] std::size_t getLexErrors() const { return lexErrors; }
+
+private:
+  SPSCQueue<TokenBatch> &queue;
+  raw_ostream &diagOS;
+  TokenBatch batch;
+  std::size_t cursor;
+  std::size_t diagCursor;
+  std::size_t lexErrors;
+  uptr<Token> lastEof;
+};
+
+} // namespace
+
+StreamingStats interpretPipelined(SourceMgr &srcMgr, const StringRef code,
+                                  StmtInterpreter &interpreter,
+                                  const PipelineOptions &options) {
+  // The line table of a buffer is built lazily on the first diagnostic and
+  // is not thread-safe; build it now so that all later lookups only read.
+  if (!code.empty())
+    srcMgr.FindLineNumber(SMLoc::getFromPointer(code.data()));
+
+  SPSCQueue<TokenBatch> tokenQueue(options.QueueDepth);
+  SPSCQueue<ParsedBatch> stmtQueue(options.QueueDepth);
+
+  std::thread lexThread([&] {
+    std::string diagnostics;
+    raw_string_ostream diagOS(diagnostics);
+    Lexer lexer(srcMgr, code);
+    lexer.setDiagnosticStream(diagOS);
+
+    TokenBatch batch;
+    for (auto atEnd = false; !atEnd;) {
+      auto tok = lexer.next();
+      atEnd = tok->Kind == Tok_eof;
+      if (!diagnostics.empty())
+        batch.Diagnostics.emplace_back(batch.Tokens.size(),
+                                       takeString(diagnostics));
+      batch.Tokens.emplace_back(std::move(tok));
+      if (atEnd || batch.Tokens.size() == options.TokenBatch) {
+        tokenQueue.push(std::move(batch));
+        batch = TokenBatch();
+      }
+    }
+    tokenQueue.close();
+  });
+
+  std::size_t syntaxErrors = 0u;
+  std::thread parseThread([&] {
+    std::string diagnostics;
+    raw_string_ostream diagOS(diagnostics);
+    QueuedTokenSource source(tokenQueue, diagOS);
+    Parser parser(source, srcMgr);
+    parser.setDiagnosticStream(diagOS);
+
+    ParsedBatch batch;
+    while (!parser.isAtEnd()) {
+      ParsedDecl decl;
+      decl.Statement = parser.Declaration();
+      decl.Tokens = parser.ReleaseTokens();
+      decl.Diagnostics = takeString(diagnostics);
+      decl.SyntaxError = source.getLexErrors() + parser.getError();
+      batch.emplace_back(std::move(decl));
+
+      if (batch.size() == options.StmtBatch) {
+        stmtQueue.push(std::move(batch));
+        batch = ParsedBatch();
+      }
+    }
+
+    // Diagnostics found while looking for the next declaration.
+    if (!diagnostics.empty()) {
+      ParsedDecl decl;
+      decl.Diagnostics = takeString(diagnostics);
+      batch.emplace_back(std::move(decl));
+    }
+    if (!batch.empty())
+      stmtQueue.push(std::move(batch));
+    stmtQueue.close();
+    syntaxErrors = source.getLexErrors() + parser.getError();
+  });
+
+  StreamingStats stats;
+  auto sawSyntaxError = false;
+  while (auto batch = stmtQueue.pop()) {
+    for (auto &decl : *batch) {
+      errs() << decl.Diagnostics;
+      stats.PeakTokens = std::max<std::size_t>(stats.PeakTokens,
+                                               decl.Tokens.size());
+      sawSyntaxError |= decl.SyntaxError;
+      if (!decl.Statement || sawSyntaxError)
+        continue;
+
+      std::visit(interpreter, *decl.Statement);
+      stats.Statements++;
+    }
+  }
+
+  lexThread.join();
+  parseThread.join();
+  stats.SyntaxErrors = syntaxErrors;
+  return stats;
+}
+
+} // namespace lox
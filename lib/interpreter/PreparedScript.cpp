@@ -0,0 +1,406 @@
+#include "lox/interpreter/PreparedScript.hpp"
+#include "lox/interpreter/Value.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <string>
+
+namespace lox {
+
+/// Resolves the variables of a program to slots and emits its code.
+struct PreparedScript::Lowering {
+  explicit Lowering(PreparedScript &result) : Result(result) {}
+
+  PreparedScript &Result;
+  StringMap<unsigned> Slots;
+  std::size_t Depth = 0u;
+  std::size_t MaxDepth = 0u;
+  /// The first array node, which the slots can't hold.
+  SMLoc Unsupported;
+
+  unsigned getSlot(const StringRef name) {
+    const auto [it, inserted] =
+        Slots.try_emplace(name, Result.globals.size());
+    if (inserted) {
+      Result.globals.emplace_back();
+      Result.defined.push_back(false);
+      Result.names.push_back(name.str());
+    }
+    return it->second;
+  }
+
+  void emit(const Opcode opcode, const unsigned operand = 0u,
+            const SMLoc loc = SMLoc(), const TokenKind op = Tok_error) {
+    Result.code.push_back({opcode, op, operand, 0u, loc});
+    switch (opcode) {
+    case Op_constant:
+    case Op_load:
+      MaxDepth = std::max(MaxDepth, ++Depth);
+      break;
+    case Op_binary:
+    case Op_print:
+    case Op_pop:
+    case Op_define:
+      --Depth;
+      break;
+    default:
+      break;
+    }
+  }
+
+  void lower(const Stmt &stmt) { std::visit(*this, stmt); }
+  void lower(const Expr &expr) { std::visit(*this, expr); }
+
+  void operator()(const ExprStmt &exprStmt) {
+    lower(*exprStmt.getExpr());
+    emit(Op_pop);
+  }
+
+  void operator()(const PrintStmt &printStmt) {
+    lower(*printStmt.getExpr());
+    emit(Op_print);
+  }
+
+  void operator()(const VarStmt &varStmt) {
+    const auto slot = getSlot(varStmt.getSymbol()->Symbol);
+    if (const auto *init = varStmt.getInit()) {
+      lower(*init);
+      emit(Op_define, slot);
+    } else {
+      emit(Op_define_empty, slot);
+    }
+  }
+
+  void operator()(const BinaryE &binaryE) {
+    lower(*binaryE.getLhs());
+    lower(*binaryE.getRhs());
+    emit(Op_binary, 0u, binaryE.getLoc(), binaryE.getOpKind()->Kind);
+  }
+
+  void operator()(const UnaryE &unaryE) {
+    lower(*unaryE.getExpr());
+    emit(Op_unary, 0u, unaryE.getLoc(), unaryE.getOpKind()->Kind);
+  }
+
+  void operator()(const GroupingE &groupingE) {
+    lower(*groupingE.getExpr());
+  }
+
+  void operator()(const LiteralE &literalE) {
+    const auto *token = literalE.getValue();
+    Slot constant;
+    switch (token->Kind) {
+    case Tok_number:
+      constant.Kind = Slot::Number;
+      constant.Num = std::stold(token->Symbol.str());
+      break;
+    case Tok_string:
+      // A view of the source, which outlives the script.
+      constant.Kind = Slot::String;
+      constant.Str = token->Symbol;
+      break;
+    case Tok_true:
+    case Tok_false:
+      constant.Kind = Slot::Bool;
+      constant.Boolean = token->Kind == Tok_true;
+      break;
+    default:
+      constant.Kind = Slot::Nil;
+      break;
+    }
+    Result.constants.push_back(std::move(constant));
+    emit(Op_constant, Result.constants.size() - 1u);
+  }
+
+  void operator()(const VarE &varE) {
+    emit(Op_load, getSlot(varE.getSymbol()->Symbol), varE.getLoc());
+  }
+
+  void operator()(const AssignE &assignE) {
+    // Like the interpreter, check the target before evaluating the value.
+    const auto *symbol = assignE.getSymbol();
+    const auto slot = getSlot(symbol->Symbol);
+    const auto check = Result.code.size();
+    emit(Op_check_assign, slot, symbol->Loc);
+    lower(*assignE.getValue());
+    emit(Op_store, slot);
+    Result.code[check].Target = Result.code.size();
+  }
+
+  void unsupported(const SMLoc loc) {
+    if (!Unsupported.isValid())
+      Unsupported = loc;
+  }
+  void operator()(const ArrayE &arrayE) { unsupported(arrayE.getLoc()); }
+  void operator()(const IndexE &indexE) { unsupported(indexE.getLoc()); }
+  void operator()(const CallE &callE) { unsupported(callE.getLoc()); }
+  void operator()(const MapE &mapE) { unsupported(mapE.getLoc()); }
+};
+
+uptr<PreparedScript> PreparedScript::prepare(const StringRef name,
+                                             const StringRef code,
+                                             const ArrayRef<StringRef> params,
+                                             raw_ostream &diagOS) {
+  uptr<PreparedScript> script(new PreparedScript);
+  const auto id = script->srcMgr.AddNewSourceBuffer(
+      MemoryBuffer::getMemBufferCopy(code, name), {});
+  const auto source = script->srcMgr.getMemoryBuffer(id)->getBuffer();
+
+  Lexer lexer(script->srcMgr, source);
+  lexer.setDiagnosticStream(diagOS);
+  if (!lexer.Lex())
+    return nullptr;
+  Parser parser(lexer.getTokens(), script->srcMgr);
+  parser.setDiagnosticStream(diagOS);
+  const auto program = parser.Parse();
+  if (parser.getError())
+    return nullptr;
+
+  Lowering lowering(*script);
+  for (const auto param : params)
+    lowering.getSlot(param);
+  assert(script->globals.size() == params.size() &&
+         "parameter names are unique");
+  script->params = params.size();
+  script->bound.resize(params.size());
+  for (const auto &stmt : program)
+    lowering.lower(*stmt);
+  if (lowering.Unsupported.isValid()) {
+    script->srcMgr.PrintMessage(
+        diagOS, lowering.Unsupported, SourceMgr::DK_Error,
+        "arrays and maps are not supported in prepared scripts");
+    return nullptr;
+  }
+  // Resized once: the slots hold views of their own buffers.
+  script->stack.resize(lowering.MaxDepth);
+  return script;
+}
+
+PreparedScript::~PreparedScript() = default;
+
+void PreparedScript::bindNumber(const unsigned index, const long double value) {
+  assert(index < params && "no such parameter");
+  bound[index].Kind = Slot::Number;
+  bound[index].Num = value;
+}
+
+void PreparedScript::bindBool(const unsigned index, const bool value) {
+  assert(index < params && "no such parameter");
+  bound[index].Kind = Slot::Bool;
+  bound[index].Boolean = value;
+}
+
+void PreparedScript::bindString(const unsigned index, const StringRef value) {
+  assert(index < params && "no such parameter");
+  auto &slot = bound[index];
+  slot.Kind = Slot::String;
+  slot.Storage.assign(value.data(), value.size());
+  slot.Str = slot.Storage;
+}
+
+void PreparedScript::bindNil(const unsigned index) {
+  assert(index < params && "no such parameter");
+  bound[index].Kind = Slot::Nil;
+}
+
+void PreparedScript::copy(Slot &to, const Slot &from) {
+  to.Kind = from.Kind;
+  to.Boolean = from.Boolean;
+  to.Num = from.Num;
+  if (from.Kind != Slot::String)
+    return;
+  if (from.Str.data() != from.Storage.data()) {
+    to.Str = from.Str;
+    return;
+  }
+  // Reuses the capacity of `to`.
+  to.Storage.assign(from.Str.data(), from.Str.size());
+  to.Str = to.Storage;
+}
+
+bool PreparedScript::invoke(raw_ostream &os) {
+  const auto errors = error;
+  for (std::size_t i = 0u; i < globals.size(); ++i) {
+    defined[i] = i < params;
+    if (i < params)
+      copy(globals[i], bound[i]);
+  }
+
+  std::size_t top = 0u;
+  for (std::size_t pc = 0u; pc < code.size(); ++pc) {
+    const auto &instruction = code[pc];
+    const auto slot = instruction.Operand;
+    switch (instruction.Op) {
+    case Op_constant:
+      copy(stack[top++], constants[slot]);
+      break;
+    case Op_load:
+      if (defined[slot]) {
+        copy(stack[top++], globals[slot]);
+        break;
+      }
+      report(instruction.Loc,
+             formatv("Undefined variable : {0}", names[slot]).str());
+      stack[top++].Kind = Slot::Absent;
+      break;
+    case Op_check_assign:
+      if (defined[slot])
+        break;
+      report(instruction.Loc,
+             formatv("Undefined variable : {0}", names[slot]).str());
+      stack[top++].Kind = Slot::Absent;
+      pc = instruction.Target - 1u;
+      break;
+    case Op_store:
+      if (stack[top - 1u].Kind != Slot::Absent)
+        copy(globals[slot], stack[top - 1u]);
+      break;
+    case Op_binary:
+      binary(instruction, stack[top - 2u], stack[top - 1u]);
+      --top;
+      break;
+    case Op_unary:
+      unary(instruction, stack[top - 1u]);
+      break;
+    case Op_print:
+      print(os, stack[--top]);
+      break;
+    case Op_pop:
+      --top;
+      break;
+    case Op_define:
+      // A failed initializer defines nothing.
+      if (stack[--top].Kind != Slot::Absent) {
+        copy(globals[slot], stack[top]);
+        defined[slot] = true;
+      }
+      break;
+    case Op_define_empty:
+      globals[slot].Kind = Slot::Absent;
+      defined[slot] = true;
+      break;
+    }
+  }
+  return error == errors;
+}
+
+void PreparedScript::binary(const Instruction &instruction, Slot &lhs,
+                            const Slot &rhs) {
+  if (lhs.Kind == Slot::Absent || rhs.Kind == Slot::Absent) {
+    lhs.Kind = Slot::Absent;
+    return;
+  }
+
+  const auto op = instruction.Operator;
+  if (op == Tok_equal_equal || op == Tok_bang_equal) {
+    auto equal = lhs.Kind == rhs.Kind;
+    if (equal && lhs.Kind == Slot::Number)
+      equal = lhs.Num == rhs.Num;
+    else if (equal && lhs.Kind == Slot::String)
+      equal = lhs.Str == rhs.Str;
+    else if (equal && lhs.Kind == Slot::Bool)
+      equal = lhs.Boolean == rhs.Boolean;
+    lhs.Kind = Slot::Bool;
+    lhs.Boolean = equal == (op == Tok_equal_equal);
+    return;
+  }
+
+  if (op == Tok_plus && lhs.Kind == Slot::String &&
+      rhs.Kind == Slot::String) {
+    if (lhs.Str.data() != lhs.Storage.data())
+      lhs.Storage.assign(lhs.Str.data(), lhs.Str.size());
+    lhs.Storage.append(rhs.Str.data(), rhs.Str.size());
+    lhs.Str = lhs.Storage;
+    return;
+  }
+  if (lhs.Kind != Slot::Number || rhs.Kind != Slot::Number) {
+    report(instruction.Loc, op == Tok_plus
+                                ? "Operands must be a number or string"
+                                : "Operands must be a number");
+    lhs.Kind = Slot::Absent;
+    return;
+  }
+
+  const auto l = lhs.Num, r = rhs.Num;
+  switch (op) {
+  case Tok_plus:
+    lhs.Num = l + r;
+    return;
+  case Tok_minus:
+    lhs.Num = l - r;
+    return;
+  case Tok_star:
+    lhs.Num = l * r;
+    return;
+  case Tok_slash:
+    lhs.Num = l / r;
+    return;
+  default:
+    break;
+  }
+  lhs.Kind = Slot::Bool;
+  switch (op) {
+  case Tok_gt:
+    lhs.Boolean = l > r;
+    return;
+  case Tok_ge:
+    lhs.Boolean = l >= r;
+    return;
+  case Tok_lt:
+    lhs.Boolean = l < r;
+    return;
+  case Tok_le:
+    lhs.Boolean = l <= r;
+    return;
+  default:
+    llvm_unreachable("all binary operators are handled");
+  }
+}
+
+void PreparedScript::unary(const Instruction &instruction, Slot &operand) {
+  if (operand.Kind == Slot::Absent)
+    return;
+  if (instruction.Operator == Tok_bang) {
+    // Only `true` is truthy.
+    const auto truthy = operand.Kind == Slot::Bool && operand.Boolean;
+    operand.Kind = Slot::Bool;
+    operand.Boolean = !truthy;
+    return;
+  }
+  if (operand.Kind != Slot::Number) {
+    report(instruction.Loc, "Operand must be a number");
+    operand.Kind = Slot::Absent;
+    return;
+  }
+  operand.Num = -operand.Num;
+}
+
+void PreparedScript::print(raw_ostream &os, const Slot &value) {
+  switch (value.Kind) {
+  case Slot::Absent:
+    return;
+  case Slot::Number:
+    // The format of NumberValue::str(), without a temporary string.
+    printNumber(os, value.Num);
+    break;
+  case Slot::String:
+    os << value.Str;
+    break;
+  case Slot::Bool:
+    os << (value.Boolean ? "true" : "false");
+    break;
+  case Slot::Nil:
+    os << "nil";
+    break;
+  }
+  os << '\n';
+}
+
+void PreparedScript::report(const SMLoc loc, const Twine &msg) {
+  srcMgr.PrintMessage(*diagOS, loc, SourceMgr::DK_Error, msg);
+  ++error;
+}
+
+} // namespace lox
@@ -0,0 +1,165 @@
+#include "lox/interpreter/Profiler.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FormatVariadic.h"
+#include <algorithm>
+#include <csignal>
+#include <sys/time.h>
+
+namespace lox {
+
+static std::atomic<Profiler *> ActiveProfiler{nullptr};
+
+static void handleProfileSignal(int) {
+  if (auto *profiler = ActiveProfiler.load(std::memory_order_relaxed))
+    profiler->sample();
+}
+
+Profiler::Profiler(SourceMgr &srcMgr, const std::size_t frameCapacity)
+    : SrcMgr(srcMgr), frames(), depth(0u), frameBuffer(frameCapacity),
+      frameCursor(0u), dropped(0u), saver(allocator) {
+  samples.reserve(frameCapacity / 4u);
+}
+
+Profiler::~Profiler() { stop(); }
+
+bool Profiler::start(const unsigned frequency) {
+  Profiler *expected = nullptr;
+  if (!ActiveProfiler.compare_exchange_strong(expected, this))
+    return false;
+
+  struct sigaction action {};
+  action.sa_handler = handleProfileSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, nullptr)) {
+    ActiveProfiler.store(nullptr);
+    return false;
+  }
+
+  const auto usec = 1000000u / std::max(frequency, 1u);
+  itimerval timer{};
+  timer.it_interval.tv_sec = usec / 1000000u;
+  timer.it_interval.tv_usec = usec % 1000000u;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr)) {
+    ActiveProfiler.store(nullptr);
+    return false;
+  }
+  return true;
+}
+
+void Profiler::stop() {
+  if (ActiveProfiler.load() != this)
+    return;
+  itimerval timer{};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+  signal(SIGPROF, SIG_IGN);
+  ActiveProfiler.store(nullptr);
+}
+
+void Profiler::sample() {
+  const auto d = depth.load(std::memory_order_relaxed);
+  std::atomic_signal_fence(std::memory_order_acquire);
+  if (!d)
+    return;
+
+  const auto stored = std::min(d, MaxDepth);
+  if (samples.size() == samples.capacity() ||
+      frameCursor + stored > frameBuffer.size()) {
+    dropped++;
+    return;
+  }
+
+  std::copy(frames, frames + stored, frameBuffer.begin() + frameCursor);
+  samples.push_back({frameCursor, stored});
+  frameCursor += stored;
+}
+
+StringRef Profiler::resolve(const char *ptr) {
+  auto &name = resolved[ptr];
+  if (!name.empty())
+    return name;
+
+  const auto loc = SMLoc::getFromPointer(ptr);
+  if (const auto id = SrcMgr.FindBufferContainingLoc(loc)) {
+    const auto line = SrcMgr.FindLineNumber(loc, id);
+    name = saver.save(
+        formatv("{0}:{1}", SrcMgr.getMemoryBuffer(id)->getBufferIdentifier(),
+                line)
+            .str());
+  } else {
+    name = "<unknown>";
+  }
+  return name;
+}
+
+void Profiler::printFoldedStacks(raw_ostream &os) {
+  StringMap<std::size_t> stacks;
+  std::vector<StringRef> order;
+  SmallString<256> key;
+
+  for (const auto &sample : samples) {
+    key.clear();
+    StringRef last;
+    for (auto i = 0u; i < sample.Depth; ++i) {
+      const auto frame = resolve(frameBuffer[sample.Begin + i]);
+      // Nested expressions on the same line are folded into one frame.
+      if (frame == last)
+        continue;
+      if (!key.empty())
+        key += ';';
+      key += frame;
+      last = frame;
+    }
+    auto [it, inserted] = stacks.try_emplace(key, 0u);
+    if (inserted)
+      order.push_back(it->getKey());
+    it->second++;
+  }
+
+  for (const auto stack : order)
+    os << stack << ' ' << stacks[stack] << '\n';
+}
+
+void Profiler::printHotLines(raw_ostream &os, const unsigned top) {
+  StringMap<std::pair<std::size_t, std::size_t>> lines;
+  for (const auto &sample : samples) {
+    const auto leaf = resolve(frameBuffer[sample.Begin + sample.Depth - 1u]);
+    lines[leaf].first++;
+
+    // Count every line once per sample for the inclusive column.
+    SmallVector<StringRef, 8> seen;
+    for (auto i = 0u; i < sample.Depth; ++i) {
+      const auto frame = resolve(frameBuffer[sample.Begin + i]);
+      if (llvm::is_contained(seen, frame))
+        continue;
+      seen.push_back(frame);
+      lines[frame].second++;
+    }
+  }
+
+  std::vector<std::pair<StringRef, std::pair<std::size_t, std::size_t>>>
+      sorted;
+  for (const auto &entry : lines)
+    sorted.emplace_back(entry.getKey(), entry.getValue());
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const auto &lhs, const auto &rhs) {
+                     if (lhs.second.first != rhs.second.first)
+                       return lhs.second.first > rhs.second.first;
+                     return lhs.first < rhs.first;
+                   });
+
+  const auto total = std::max<std::size_t>(samples.size(), 1u);
+  os << formatv("{0,8} {1,8}  {2}\n", "self%", "total%", "location");
+  for (auto i = 0u; i < sorted.size() && i < top; ++i) {
+    const auto &[line, counts] = sorted[i];
+    os << formatv("{0,7:f2}% {1,7:f2}%  {2}\n",
+                  100.0 * counts.first / total, 100.0 * counts.second / total,
+                  line);
+  }
+  if (dropped)
+    os << formatv("({0} samples dropped: buffer full)\n", dropped);
+}
+
+} // namespace lox
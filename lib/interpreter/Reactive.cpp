@@ -0,0 +1,143 @@
+#include "lox/interpreter/Reactive.hpp"
+#include "lox/interpreter/Dependencies.hpp"
+#include "llvm/ADT/STLExtras.h"
+
+namespace lox {
+
+bool ReactiveScript::Binding::operator==(const Binding &other) const {
+  if (Defined != other.Defined)
+    return false;
+  return Val == other.Val || (Val && other.Val && *Val == *other.Val);
+}
+
+ReactiveScript::ReactiveScript(sptr<const CompiledScript> compiled)
+    : script(std::move(compiled)), exprInterpreter(srcMgr, env),
+      stmtInterpreter(srcMgr, exprInterpreter, env) {
+  srcMgr.AddNewSourceBuffer(
+      MemoryBuffer::getMemBuffer(script->getSource(), script->getName(),
+                                 false),
+      {});
+
+  const auto &program = script->getProgram();
+  // Sized once: uses point to the results of the cells and to the inputs,
+  // whose StringMap entries don't move.
+  cells.resize(program.size());
+  queued.resize(program.size());
+  StringMap<unsigned> lastWriter;
+  for (unsigned i = 0u; i < program.size(); ++i) {
+    auto &cell = cells[i];
+    const auto access = collectAccess(*program[i]);
+    cell.Writes.assign(access.Writes.begin(), access.Writes.end());
+    cell.Results.resize(cell.Writes.size());
+
+    // Readers are added in program order, so the last one is the only
+    // possible duplicate.
+    const auto addReader = [i](SmallVectorImpl<unsigned> &readers) {
+      if (readers.empty() || readers.back() != i)
+        readers.push_back(i);
+    };
+    // A name the statement writes is used too: if it fails to, the name
+    // keeps the value it had before.
+    const auto use = [&](const StringRef name) {
+      if (any_of(cell.Uses, [&](const Use &use) { return use.Name == name; }))
+        return;
+      const auto writer = lastWriter.find(name);
+      if (writer == lastWriter.end()) {
+        auto &input = inputs[name];
+        addReader(input.Readers);
+        cell.Uses.push_back({name, &input.Bound});
+        return;
+      }
+      auto &from = cells[writer->second];
+      const auto result = find(from.Writes, name) - from.Writes.begin();
+      addReader(from.Readers);
+      cell.Uses.push_back({name, &from.Results[result]});
+    };
+    for (const auto name : access.Reads)
+      use(name);
+    for (const auto name : access.Writes)
+      use(name);
+
+    for (std::size_t k = 0u; k < cell.Writes.size(); ++k) {
+      lastWriter[cell.Writes[k]] = i;
+      finals[cell.Writes[k]] = &cell.Results[k];
+    }
+    enqueue(i);
+  }
+}
+
+ReactiveScript::~ReactiveScript() = default;
+
+void ReactiveScript::setInput(const StringRef name, sptr<Value> value) {
+  auto &input = inputs[name];
+  Binding bound{std::move(value), true};
+  if (input.Bound == bound)
+    return;
+  input.Bound = std::move(bound);
+  for (const auto reader : input.Readers)
+    enqueue(reader);
+}
+
+void ReactiveScript::enqueue(const unsigned stmt) {
+  if (queued.test(stmt))
+    return;
+  queued.set(stmt);
+  pending.push(stmt);
+}
+
+std::size_t ReactiveScript::run(raw_ostream &os) {
+  std::size_t executed = 0u;
+  // Statements only enqueue later ones, so this is program order.
+  while (!pending.empty()) {
+    const auto stmt = pending.top();
+    pending.pop();
+    queued.reset(stmt);
+    evaluate(stmt, os);
+    ++executed;
+  }
+  return executed;
+}
+
+void ReactiveScript::evaluate(const unsigned stmt, raw_ostream &os) {
+  auto &cell = cells[stmt];
+  // The statement sees each name as it is at its place in the script.
+  LoxValueScope scope(env);
+  for (const auto &use : cell.Uses)
+    if (use.Source->Defined)
+      env.insert(use.Name, use.Source->Val);
+
+  cell.Output.clear();
+  raw_string_ostream outputOS(cell.Output);
+  stmtInterpreter.setOutputStream(outputOS);
+  std::visit(stmtInterpreter, *script->getProgram()[stmt]);
+  os << outputOS.str();
+
+  auto changed = false;
+  for (std::size_t k = 0u; k < cell.Writes.size(); ++k) {
+    Binding result{env.lookup(cell.Writes[k]), env.count(cell.Writes[k]) != 0};
+    if (result == cell.Results[k])
+      continue;
+    cell.Results[k] = std::move(result);
+    changed = true;
+  }
+  if (changed)
+    for (const auto reader : cell.Readers)
+      enqueue(reader);
+}
+
+std::string ReactiveScript::getOutput() const {
+  std::string output;
+  for (const auto &cell : cells)
+    output += cell.Output;
+  return output;
+}
+
+sptr<Value> ReactiveScript::lookup(const StringRef name) const {
+  if (const auto writer = finals.find(name); writer != finals.end())
+    return writer->second->Val;
+  if (const auto input = inputs.find(name); input != inputs.end())
+    return input->second.Bound.Val;
+  return nullptr;
+}
+
+} // namespace lox
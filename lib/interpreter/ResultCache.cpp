@@ -0,0 +1,256 @@
+#include "lox/interpreter/ResultCache.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace lox {
+
+namespace {
+
+constexpr char Magic[8] = {'L', 'O', 'X', 'R', 'E', 'S', 'L', 'T'};
+/// Bump on any change of the layout, or of what scripts print.
+constexpr std::uint32_t Version = 3u;
+
+struct FileHeader {
+  char Magic[8];
+  std::uint32_t Version;
+  std::int32_t ExitCode;
+  std::uint64_t Key;
+  std::uint64_t Exact;
+  double Seconds;
+  std::uint64_t OutputSize;
+  std::uint64_t DiagnosticsSize;
+};
+
+std::size_t getSize(const CachedResult &result) {
+  return sizeof(FileHeader) + result.Output.size() + result.Diagnostics.size();
+}
+
+} // namespace
+
+void ResultCacheStats::print(raw_ostream &os) const {
+  os << formatv("result cache: {0} hits, {1} misses ({2:f1}% hit rate), "
+                "{3:f3} s saved, {4} entries, {5} bytes, {6} evicted\n",
+                Hits, Misses, getHitRate() * 100.0, SavedSeconds, Entries,
+                Bytes, Evictions);
+}
+
+ResultCache::ResultCache(ResultCacheOptions cacheOptions)
+    : options(std::move(cacheOptions)) {
+  if (options.Dir.empty())
+    return;
+
+  struct Found {
+    std::uint64_t Key;
+    std::size_t Size;
+    sys::TimePoint<> LastUse;
+  };
+  SmallVector<Found, 0> found;
+  std::error_code ec;
+  for (sys::fs::directory_iterator it(options.Dir, ec), end; it != end && !ec;
+       it.increment(ec)) {
+    const auto path = StringRef(it->path());
+    std::uint64_t key;
+    if (sys::path::extension(path) != ".result" ||
+        sys::path::stem(path).getAsInteger(16, key))
+      continue;
+    sys::fs::file_status status;
+    if (!sys::fs::status(path, status))
+      found.push_back(
+          {key, status.getSize(), status.getLastModificationTime()});
+  }
+  std::stable_sort(found.begin(), found.end(),
+                   [](const Found &lhs, const Found &rhs) {
+                     return lhs.LastUse > rhs.LastUse;
+                   });
+  for (const auto &file : found) {
+    entries.push_back({file.Key, 0u, file.Size, nullptr});
+    index.emplace(file.Key, std::prev(entries.end()));
+    bytes += file.Size;
+  }
+  evict();
+}
+
+ResultKey ResultCache::makeKey(const StringRef name, const StringRef source,
+                               const ArrayRef<uptr<Token>> tokens) {
+  // Each token as its kind, the size of its symbol and the symbol, so that
+  // different streams can't run together into the same bytes.
+  std::string stream;
+  stream.reserve(source.size() + tokens.size() * 5u);
+  for (const auto &token : tokens) {
+    char header[5];
+    header[0] = static_cast<char>(token->Kind);
+    support::endian::write32le(header + 1, token->Symbol.size());
+    stream.append(header, sizeof(header));
+    stream.append(token->Symbol.data(), token->Symbol.size());
+  }
+  ResultKey key;
+  key.Tokens = xxHash64(stream);
+  stream.assign(name.data(), name.size());
+  stream.push_back('\0');
+  stream.append(source.data(), source.size());
+  key.Exact = xxHash64(stream);
+  return key;
+}
+
+opt<CachedResult> ResultCache::lookup(const ResultKey &key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto it = index.find(key.Tokens);
+  if (it == index.end()) {
+    ++stats.Misses;
+    return std::nullopt;
+  }
+  auto &entry = *it->second;
+  if (!entry.Result) {
+    entry.Result = read(entry.Key, entry.Exact);
+    if (!entry.Result) {
+      erase(it->second);
+      ++stats.Misses;
+      return std::nullopt;
+    }
+  }
+  // Diagnostics quote the source as it was written.
+  if (!entry.Result->Diagnostics.empty() && entry.Exact != key.Exact) {
+    ++stats.Misses;
+    return std::nullopt;
+  }
+
+  entries.splice(entries.begin(), entries, it->second);
+  if (!options.Dir.empty())
+    touch(entry.Key);
+  ++stats.Hits;
+  stats.SavedSeconds += entry.Result->Seconds;
+  return *entry.Result;
+}
+
+bool ResultCache::store(const ResultKey &key, CachedResult result) {
+  const auto size = getSize(result);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (size > options.MaxBytes)
+    return true;
+  if (const auto it = index.find(key.Tokens); it != index.end())
+    erase(it->second);
+
+  entries.push_front(
+      {key.Tokens, key.Exact, size, mkuptr<CachedResult>(std::move(result))});
+  index.emplace(key.Tokens, entries.begin());
+  bytes += size;
+  ++stats.Stores;
+  const auto written = options.Dir.empty() || write(entries.front());
+  evict();
+  return written;
+}
+
+ResultCacheStats ResultCache::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto current = stats;
+  current.Entries = entries.size();
+  current.Bytes = bytes;
+  return current;
+}
+
+std::string ResultCache::getPath(const std::uint64_t key) const {
+  SmallString<128> path(options.Dir);
+  sys::path::append(path, formatv("{0:x-16}.result", key).str());
+  return path.str().str();
+}
+
+uptr<CachedResult> ResultCache::read(const std::uint64_t key,
+                                     std::uint64_t &exact) const {
+  auto bufferOrError = MemoryBuffer::getFile(getPath(key));
+  if (!bufferOrError)
+    return nullptr;
+  const auto contents = (*bufferOrError)->getBuffer();
+  FileHeader header;
+  if (contents.size() < sizeof(header))
+    return nullptr;
+  std::memcpy(&header, contents.data(), sizeof(header));
+  if (std::memcmp(header.Magic, Magic, sizeof(Magic)) ||
+      header.Version != Version || header.Key != key ||
+      header.OutputSize > contents.size() ||
+      header.DiagnosticsSize > contents.size() ||
+      sizeof(header) + header.OutputSize + header.DiagnosticsSize !=
+          contents.size())
+    return nullptr;
+
+  auto result = mkuptr<CachedResult>();
+  const auto payload = contents.drop_front(sizeof(header));
+  result->Output = payload.take_front(header.OutputSize).str();
+  result->Diagnostics = payload.drop_front(header.OutputSize).str();
+  result->ExitCode = header.ExitCode;
+  result->Seconds = header.Seconds;
+  exact = header.Exact;
+  return result;
+}
+
+bool ResultCache::write(const Entry &entry) const {
+  if (sys::fs::create_directories(options.Dir))
+    return false;
+
+  FileHeader header;
+  std::memcpy(header.Magic, Magic, sizeof(Magic));
+  header.Version = Version;
+  header.ExitCode = entry.Result->ExitCode;
+  header.Key = entry.Key;
+  header.Exact = entry.Exact;
+  header.Seconds = entry.Result->Seconds;
+  header.OutputSize = entry.Result->Output.size();
+  header.DiagnosticsSize = entry.Result->Diagnostics.size();
+
+  // Written under a temporary name and renamed, so that readers never see a
+  // partial file.
+  const auto path = getPath(entry.Key);
+  SmallString<128> temp;
+  int fd = -1;
+  if (sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, temp))
+    return false;
+  bool written;
+  {
+    raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os << entry.Result->Output << entry.Result->Diagnostics;
+    os.close();
+    written = !os.has_error();
+    os.clear_error();
+  }
+  if (!written || sys::fs::rename(temp, path)) {
+    sys::fs::remove(temp);
+    return false;
+  }
+  return true;
+}
+
+void ResultCache::touch(const std::uint64_t key) const {
+  int fd = -1;
+  if (sys::fs::openFileForWrite(getPath(key), fd, sys::fs::CD_OpenExisting,
+                                sys::fs::OF_Append))
+    return;
+  sys::fs::setLastAccessAndModificationTime(
+      fd, sys::TimePoint<>(std::chrono::system_clock::now()));
+  sys::Process::SafelyCloseFileDescriptor(fd);
+}
+
+void ResultCache::erase(const std::list<Entry>::iterator entry) {
+  if (!options.Dir.empty())
+    sys::fs::remove(getPath(entry->Key));
+  bytes -= entry->Size;
+  index.erase(entry->Key);
+  entries.erase(entry);
+}
+
+void ResultCache::evict() {
+  while (bytes > options.MaxBytes && !entries.empty()) {
+    erase(std::prev(entries.end()));
+    ++stats.Evictions;
+  }
+}
+
+} // namespace lox
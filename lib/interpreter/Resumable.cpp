@@ -0,0 +1,226 @@
+#include "lox/interpreter/Resumable.hpp"
+#include <cstdint>
+
+namespace lox {
+
+namespace {
+
+const Expr *getStmtExpr(const Stmt &stmt) {
+  if (const auto *exprStmt = std::get_if<ExprStmt>(&stmt))
+    return exprStmt->getExpr();
+  if (const auto *printStmt = std::get_if<PrintStmt>(&stmt))
+    return printStmt->getExpr();
+  return std::get<VarStmt>(stmt).getInit();
+}
+
+} // namespace
+
+void ResumableInterpreter::start(const Program &prog) {
+  program = &prog;
+  stmtIndex = 0u;
+  inStmt = false;
+  frames.clear();
+  operands.clear();
+  fuelUsed = 0u;
+}
+
+void ResumableInterpreter::stop() {
+  program = nullptr;
+  stmtIndex = 0u;
+  inStmt = false;
+  frames.clear();
+  operands.clear();
+}
+
+bool ResumableInterpreter::resume(const std::uint64_t fuel) {
+  const auto budget =
+      fuel > UINT64_MAX - fuelUsed ? UINT64_MAX : fuelUsed + fuel;
+  for (;;) {
+    // Completing a statement whose expression is done is free, so a slice
+    // never ends with a result that wasn't printed or stored yet.
+    if (inStmt && frames.empty()) {
+      finishStmt();
+      continue;
+    }
+    if (isFinished())
+      return true;
+    if (fuelUsed >= budget)
+      return false;
+    if (!inStmt) {
+      fuelUsed++;
+      enterStmt();
+      continue;
+    }
+    step();
+  }
+}
+
+void ResumableInterpreter::enterStmt() {
+  const auto &stmt = *(*program)[stmtIndex];
+  inStmt = true;
+  if (std::holds_alternative<ExprStmt>(stmt))
+    interpreter.count(WorkCounters::ExprS);
+  else if (std::holds_alternative<PrintStmt>(stmt))
+    interpreter.count(WorkCounters::PrintS);
+  else
+    interpreter.count(WorkCounters::VarS);
+
+  if (const auto *expr = getStmtExpr(stmt))
+    frames.push_back({expr, 0u});
+}
+
+void ResumableInterpreter::finishStmt() {
+  const auto &stmt = *(*program)[stmtIndex];
+  sptr<Value> value;
+  if (!operands.empty()) {
+    value = std::move(operands.back());
+    operands.pop_back();
+  }
+  if (std::holds_alternative<PrintStmt>(stmt))
+    interpreter.print(value);
+  else if (const auto *varStmt = std::get_if<VarStmt>(&stmt))
+    interpreter.define(varStmt->getSymbol()->Symbol, varStmt->getInit(),
+                       std::move(value));
+
+  inStmt = false;
+  stmtIndex++;
+}
+
+void ResumableInterpreter::step() {
+  auto &evaluator = interpreter.ExprEvaluator;
+  const auto frame = frames.back();
+  const auto pop = [&] {
+    auto value = std::move(operands.back());
+    operands.pop_back();
+    return value;
+  };
+  // The last `count` operands, which are popped after use.
+  const auto top = [&](const std::size_t count) {
+    return ArrayRef<sptr<Value>>(operands).take_back(count);
+  };
+  const auto charge = [&] {
+    if (!frame.Stage)
+      fuelUsed++;
+  };
+
+  if (const auto *binaryE = std::get_if<BinaryE>(frame.Node)) {
+    charge();
+    if (frame.Stage < 2u) {
+      frames.back().Stage++;
+      frames.push_back({frame.Stage ? binaryE->getRhs() : binaryE->getLhs(),
+                        0u});
+      return;
+    }
+    frames.pop_back();
+    evaluator.count(WorkCounters::Binary);
+    const auto rhs = pop();
+    const auto lhs = pop();
+    operands.push_back(evaluator.evaluateBinary(
+        binaryE->getLoc(), binaryE->getOpKind()->Kind, lhs, rhs));
+  } else if (const auto *unaryE = std::get_if<UnaryE>(frame.Node)) {
+    charge();
+    if (!frame.Stage) {
+      frames.back().Stage++;
+      frames.push_back({unaryE->getExpr(), 0u});
+      return;
+    }
+    frames.pop_back();
+    evaluator.count(WorkCounters::Unary);
+    operands.push_back(evaluator.evaluateUnary(
+        unaryE->getLoc(), unaryE->getOpKind()->Kind, pop()));
+  } else if (const auto *groupingE = std::get_if<GroupingE>(frame.Node)) {
+    charge();
+    if (!frame.Stage) {
+      evaluator.count(WorkCounters::Grouping);
+      frames.back().Stage++;
+      frames.push_back({groupingE->getExpr(), 0u});
+      return;
+    }
+    frames.pop_back();
+  } else if (const auto *assignE = std::get_if<AssignE>(frame.Node)) {
+    charge();
+    if (!frame.Stage) {
+      evaluator.count(WorkCounters::Assign);
+      const auto *symbol = assignE->getSymbol();
+      if (!evaluator.checkAssignTarget(symbol->Loc, symbol->Symbol)) {
+        frames.pop_back();
+        operands.push_back(nullptr);
+        return;
+      }
+      frames.back().Stage++;
+      frames.push_back({assignE->getValue(), 0u});
+      return;
+    }
+    frames.pop_back();
+    operands.push_back(
+        evaluator.evaluateAssign(assignE->getSymbol()->Symbol, pop()));
+  } else if (const auto *arrayE = std::get_if<ArrayE>(frame.Node)) {
+    charge();
+    const auto elements = arrayE->getElements();
+    if (!frame.Stage)
+      evaluator.count(WorkCounters::Array);
+    if (frame.Stage < elements.size()) {
+      frames.back().Stage++;
+      frames.push_back({elements[frame.Stage].get(), 0u});
+      return;
+    }
+    frames.pop_back();
+    auto value =
+        evaluator.evaluateArray(arrayE->getLoc(), top(elements.size()));
+    operands.truncate(operands.size() - elements.size());
+    operands.push_back(std::move(value));
+  } else if (const auto *indexE = std::get_if<IndexE>(frame.Node)) {
+    charge();
+    if (frame.Stage < 2u) {
+      frames.back().Stage++;
+      frames.push_back(
+          {frame.Stage ? indexE->getIndex() : indexE->getArray(), 0u});
+      return;
+    }
+    frames.pop_back();
+    evaluator.count(WorkCounters::Index);
+    const auto index = pop();
+    const auto array = pop();
+    operands.push_back(evaluator.evaluateIndex(indexE->getLoc(), array, index));
+  } else if (const auto *callE = std::get_if<CallE>(frame.Node)) {
+    charge();
+    const auto args = callE->getArgs();
+    if (!frame.Stage)
+      evaluator.count(WorkCounters::Call);
+    if (frame.Stage < args.size()) {
+      frames.back().Stage++;
+      frames.push_back({args[frame.Stage].get(), 0u});
+      return;
+    }
+    frames.pop_back();
+    auto value = evaluator.evaluateCall(callE->getLoc(), callE->getBuiltin(),
+                                        top(args.size()), callE->getUpdated());
+    operands.truncate(operands.size() - args.size());
+    operands.push_back(std::move(value));
+    // The updated variable may be unbound until it is assigned the result,
+    // so that happens before a slice can end.
+    if (!callE->getUpdated().empty())
+      step();
+  } else if (const auto *mapE = std::get_if<MapE>(frame.Node)) {
+    charge();
+    const auto entries = mapE->getOperands();
+    if (!frame.Stage)
+      evaluator.count(WorkCounters::Map);
+    if (frame.Stage < entries.size()) {
+      frames.back().Stage++;
+      frames.push_back({entries[frame.Stage].get(), 0u});
+      return;
+    }
+    frames.pop_back();
+    auto value = evaluator.evaluateMap(mapE->getLoc(), top(entries.size()));
+    operands.truncate(operands.size() - entries.size());
+    operands.push_back(std::move(value));
+  } else {
+    // Literals and variables are leaves.
+    fuelUsed++;
+    frames.pop_back();
+    operands.push_back(std::visit(evaluator, *frame.Node));
+  }
+}
+
+} // namespace lox
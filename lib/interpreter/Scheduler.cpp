@@ -0,0 +1,180 @@
+#include "lox/interpreter/Scheduler.hpp"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FormatVariadic.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <deque>
+#include <thread>
+
+namespace lox {
+
+namespace {
+
+double threadCpuSeconds() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct ActiveJob {
+  std::size_t Id;
+  unsigned Priority;
+  /// Order of the last enqueue; breaks priority ties round-robin.
+  std::uint64_t Sequence;
+  uptr<Isolate> Runner;
+};
+
+/// FIFO under the fair policy, highest priority first otherwise.
+class RunQueue {
+public:
+  explicit RunQueue(const SlicePolicy policy) : policy(policy), sequence(0u) {}
+
+  void push(ActiveJob job) {
+    job.Sequence = sequence++;
+    jobs.push_back(std::move(job));
+    if (policy == SlicePolicy::Priority)
+      std::push_heap(jobs.begin(), jobs.end(), later);
+  }
+
+  ActiveJob pop() {
+    if (policy == SlicePolicy::Fair) {
+      auto job = std::move(jobs.front());
+      jobs.pop_front();
+      return job;
+    }
+    std::pop_heap(jobs.begin(), jobs.end(), later);
+    auto job = std::move(jobs.back());
+    jobs.pop_back();
+    return job;
+  }
+
+  [[nodiscard]] bool empty() const { return jobs.empty(); }
+
+private:
+  /// Heap order: true if `lhs` runs after `rhs`.
+  static bool later(const ActiveJob &lhs, const ActiveJob &rhs) {
+    if (lhs.Priority != rhs.Priority)
+      return lhs.Priority < rhs.Priority;
+    return lhs.Sequence > rhs.Sequence;
+  }
+
+  SlicePolicy policy;
+  std::uint64_t sequence;
+  std::deque<ActiveJob> jobs;
+};
+
+/// Nearest-rank percentile of sorted `values`.
+double percentile(ArrayRef<double> values, const double p) {
+  if (values.empty())
+    return 0.0;
+  const auto rank = static_cast<std::size_t>(p * values.size() + 0.999999);
+  return values[std::min(values.size(), std::max<std::size_t>(rank, 1u)) - 1u];
+}
+
+} // namespace
+
+std::size_t ScriptScheduler::submit(ScriptJob job) {
+  jobs.push_back(std::move(job));
+  results.emplace_back();
+  return jobs.size() - 1u;
+}
+
+void ScriptScheduler::run() {
+  const auto threads = std::max(1u, options.Threads);
+  if (threads == 1u) {
+    runShard(0u);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for (auto shard = 0u; shard < threads; ++shard)
+    workers.emplace_back([this, shard] { runShard(shard); });
+  for (auto &worker : workers)
+    worker.join();
+}
+
+void ScriptScheduler::runShard(const unsigned shard) {
+  const auto threads = std::max(1u, options.Threads);
+  const auto start = std::chrono::steady_clock::now();
+  RunQueue queue(options.Policy);
+  for (auto id = shard; id < jobs.size(); id += threads)
+    if (results[id].Status == JobStatus::Pending)
+      queue.push({id, jobs[id].Priority, 0u, nullptr});
+
+  while (!queue.empty()) {
+    auto active = queue.pop();
+    const auto &job = jobs[active.Id];
+    auto &result = results[active.Id];
+    if (!active.Runner) {
+      active.Runner = mkuptr<Isolate>();
+      active.Runner->start(job.Script);
+    }
+    auto &isolate = *active.Runner;
+
+    auto fuel = options.Slice;
+    if (job.FuelLimit)
+      fuel = std::min(fuel, job.FuelLimit - isolate.getFuelUsed());
+    const auto cpuStart = threadCpuSeconds();
+    const auto finished = isolate.resume(fuel);
+    result.CpuSeconds += threadCpuSeconds() - cpuStart;
+    result.FuelUsed = isolate.getFuelUsed();
+    result.Slices++;
+
+    if (finished)
+      result.Status =
+          isolate.getError() ? JobStatus::Failed : JobStatus::Finished;
+    else if (job.FuelLimit && result.FuelUsed >= job.FuelLimit)
+      result.Status = JobStatus::FuelLimitExceeded;
+    else if (job.CpuLimit > 0.0 && result.CpuSeconds >= job.CpuLimit)
+      result.Status = JobStatus::CpuLimitExceeded;
+
+    if (result.Status == JobStatus::Pending) {
+      queue.push(std::move(active));
+      continue;
+    }
+    result.Output = isolate.getOutput().str();
+    result.Diagnostics = isolate.getDiagnostics().str();
+    const std::chrono::duration<double> latency =
+        std::chrono::steady_clock::now() - start;
+    result.Latency = latency.count();
+  }
+}
+
+SmallVector<ClassLatency> ScriptScheduler::getLatencies() const {
+  StringMap<std::size_t> classIndex;
+  SmallVector<ClassLatency> classes;
+  SmallVector<std::vector<double>> latencies;
+  for (std::size_t id = 0u; id < jobs.size(); ++id) {
+    if (results[id].Status == JobStatus::Pending)
+      continue;
+    const auto [it, inserted] =
+        classIndex.try_emplace(jobs[id].Class, classes.size());
+    if (inserted) {
+      classes.emplace_back();
+      classes.back().Class = jobs[id].Class;
+      latencies.emplace_back();
+    }
+    latencies[it->second].push_back(results[id].Latency);
+  }
+
+  for (std::size_t i = 0u; i < classes.size(); ++i) {
+    auto &values = latencies[i];
+    std::sort(values.begin(), values.end());
+    classes[i].Jobs = values.size();
+    classes[i].P50 = percentile(values, 0.50);
+    classes[i].P99 = percentile(values, 0.99);
+    classes[i].Max = values.back();
+  }
+  return classes;
+}
+
+void ScriptScheduler::printLatencyReport(raw_ostream &os) const {
+  os << formatv("{0,-16} {1,8} {2,12} {3,12} {4,12}\n", "class", "jobs",
+                "p50 ms", "p99 ms", "max ms");
+  for (const auto &latency : getLatencies())
+    os << formatv("{0,-16} {1,8} {2,12:f3} {3,12:f3} {4,12:f3}\n",
+                  latency.Class, latency.Jobs, latency.P50 * 1e3,
+                  latency.P99 * 1e3, latency.Max * 1e3);
+}
+
+} // namespace lox
@@ -0,0 +1,604 @@
+#include "lox/interpreter/ScriptCache.hpp"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/xxhash.h"
+#include <cstring>
+
+namespace lox {
+
+namespace {
+
+constexpr char Magic[8] = {'L', 'O', 'X', 'I', 'M', 'A', 'G', 'E'};
+constexpr std::uint32_t NoNode = ~0u;
+
+enum FlatStmtKind : std::uint8_t { Flat_expr, Flat_print, Flat_var };
+
+enum FlatNodeKind : std::uint8_t {
+  Flat_binary,
+  Flat_unary,
+  Flat_grouping,
+  Flat_literal,
+  Flat_variable,
+  Flat_assign,
+  Flat_array,
+  Flat_index,
+  Flat_call,
+  /// One link of the elements of an array or map or the arguments of a call.
+  Flat_arg,
+  Flat_map,
+};
+
+/// Identifies what the image layout depends on besides Version.
+std::uint32_t getHostTag() {
+  const std::uint32_t one = 1u;
+  std::uint8_t little = 0u;
+  std::memcpy(&little, &one, 1u);
+  return (little ? 0x100u : 0u) | sizeof(void *);
+}
+
+std::size_t alignTo8(const std::size_t offset) { return (offset + 7u) & ~7u; }
+
+/// The operators ExprInterpreter::evaluateBinary handles.
+bool isBinaryOp(const unsigned op) {
+  switch (op) {
+  case Tok_minus:
+  case Tok_plus:
+  case Tok_slash:
+  case Tok_star:
+  case Tok_ge:
+  case Tok_gt:
+  case Tok_le:
+  case Tok_lt:
+  case Tok_equal_equal:
+  case Tok_bang_equal:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool isUnaryOp(const unsigned op) { return op == Tok_minus || op == Tok_bang; }
+
+bool isLiteral(const unsigned op) {
+  return op == Tok_number || op == Tok_string || op == Tok_true ||
+         op == Tok_false || op == Tok_nil;
+}
+
+/// Whether `symbol` is a number as the lexer reads one: digits, optionally
+/// followed by a dot and more digits.
+bool isNumberLiteral(const StringRef symbol) {
+  const auto [whole, fraction] = symbol.split('.');
+  const auto isDigits = [](const StringRef digits) {
+    return llvm::all_of(digits, [](const char ch) { return isDigit(ch); });
+  };
+  return !whole.empty() && isDigits(whole) && isDigits(fraction);
+}
+
+} // namespace
+
+namespace image {
+
+struct Header {
+  char Magic[8];
+  std::uint32_t Version;
+  std::uint32_t HostTag;
+  std::uint64_t SourceHash;
+  std::uint64_t SourceSize;
+  std::uint32_t StmtCount;
+  std::uint32_t NodeCount;
+  std::uint32_t StringCount;
+  std::uint32_t StringBytes;
+  std::uint64_t StmtOffset;
+  std::uint64_t NodeOffset;
+  std::uint64_t StringOffset;
+  std::uint64_t StringDataOffset;
+};
+
+struct Stmt {
+  std::uint8_t Kind;
+  std::uint8_t HasExpr;
+  std::uint16_t Reserved;
+  /// Expression node, or NoNode.
+  std::uint32_t Expr;
+  /// VarStmt only.
+  std::uint32_t Symbol;
+};
+
+struct Node {
+  std::uint8_t Kind;
+  /// TokenKind of the operator or literal.
+  std::uint8_t Op;
+  std::uint16_t Reserved;
+  /// Source offset of the node.
+  std::uint32_t Loc;
+  /// Operand nodes; the symbol string for literals, variables and
+  /// assignments, whose B is the value node. Arrays, maps and calls have
+  /// their first Flat_arg, or NoNode, and their number of operands; a
+  /// Flat_arg has its value and the next Flat_arg, or NoNode.
+  std::uint32_t A;
+  std::uint32_t B;
+  /// Source offset of an assignment's target; the string of a call's
+  /// CallE::getUpdated(), or NoNode; the number of links from a Flat_arg to
+  /// the end of its list.
+  std::uint32_t SymbolLoc;
+};
+
+struct StringEntry {
+  std::uint32_t Offset;
+  std::uint32_t Size;
+};
+
+} // namespace image
+
+namespace {
+
+/// Lays a Program out as an image.
+class ImageBuilder {
+public:
+  explicit ImageBuilder(const StringRef code) : code(code) {}
+
+  void addStmt(const lox::Stmt &stmt) {
+    if (const auto *exprStmt = std::get_if<ExprStmt>(&stmt)) {
+      stmts.push_back({Flat_expr, 1u, 0u, addExpr(*exprStmt->getExpr()), 0u});
+    } else if (const auto *printStmt = std::get_if<PrintStmt>(&stmt)) {
+      stmts.push_back(
+          {Flat_print, 1u, 0u, addExpr(*printStmt->getExpr()), 0u});
+    } else {
+      const auto &varStmt = std::get<VarStmt>(stmt);
+      const auto init =
+          varStmt.getInit() ? addExpr(*varStmt.getInit()) : NoNode;
+      stmts.push_back({Flat_var, init != NoNode, 0u, init,
+                       addString(varStmt.getSymbol()->Symbol)});
+    }
+  }
+
+  void write(raw_ostream &os) const {
+    image::Header header{};
+    std::memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = ScriptImage::Version;
+    header.HostTag = getHostTag();
+    header.SourceHash = ScriptImage::hashSource(code);
+    header.SourceSize = code.size();
+    header.StmtCount = stmts.size();
+    header.NodeCount = nodes.size();
+    header.StringCount = strings.size();
+    header.StringBytes = stringData.size();
+    header.StmtOffset = alignTo8(sizeof(header));
+    header.NodeOffset =
+        alignTo8(header.StmtOffset + stmts.size() * sizeof(image::Stmt));
+    header.StringOffset =
+        alignTo8(header.NodeOffset + nodes.size() * sizeof(image::Node));
+    header.StringDataOffset = alignTo8(
+        header.StringOffset + strings.size() * sizeof(image::StringEntry));
+
+    std::uint64_t offset = 0u;
+    const auto emit = [&](const void *data, const std::size_t size,
+                          const std::uint64_t at) {
+      os.write_zeros(at - offset);
+      os.write(static_cast<const char *>(data), size);
+      offset = at + size;
+    };
+    emit(&header, sizeof(header), 0u);
+    emit(stmts.data(), stmts.size() * sizeof(image::Stmt), header.StmtOffset);
+    emit(nodes.data(), nodes.size() * sizeof(image::Node), header.NodeOffset);
+    emit(strings.data(), strings.size() * sizeof(image::StringEntry),
+         header.StringOffset);
+    emit(stringData.data(), stringData.size(), header.StringDataOffset);
+  }
+
+  std::uint32_t operator()(const BinaryE &binaryE) {
+    const auto lhs = addExpr(*binaryE.getLhs());
+    const auto rhs = addExpr(*binaryE.getRhs());
+    return addNode(Flat_binary, binaryE.getOpKind()->Kind, binaryE.getLoc(),
+                   lhs, rhs);
+  }
+  std::uint32_t operator()(const UnaryE &unaryE) {
+    const auto target = addExpr(*unaryE.getExpr());
+    return addNode(Flat_unary, unaryE.getOpKind()->Kind, unaryE.getLoc(),
+                   target, 0u);
+  }
+  std::uint32_t operator()(const GroupingE &groupingE) {
+    const auto inner = addExpr(*groupingE.getExpr());
+    return addNode(Flat_grouping, 0u, groupingE.getLoc(), inner, 0u);
+  }
+  std::uint32_t operator()(const LiteralE &literalE) {
+    const auto *tok = literalE.getValue();
+    return addNode(Flat_literal, tok->Kind, literalE.getLoc(),
+                   addString(tok->Symbol), 0u);
+  }
+  std::uint32_t operator()(const VarE &varE) {
+    return addNode(Flat_variable, 0u, varE.getLoc(),
+                   addString(varE.getSymbol()->Symbol), 0u);
+  }
+  std::uint32_t operator()(const AssignE &assignE) {
+    const auto *symbol = assignE.getSymbol();
+    const auto value = addExpr(*assignE.getValue());
+    const auto index = addNode(Flat_assign, 0u, assignE.getLoc(),
+                               addString(symbol->Symbol), value);
+    nodes[index].SymbolLoc = offsetOf(symbol->Loc);
+    return index;
+  }
+  std::uint32_t operator()(const ArrayE &arrayE) {
+    const auto elements = addList(arrayE.getElements());
+    return addNode(Flat_array, 0u, arrayE.getLoc(), elements,
+                   arrayE.getElements().size());
+  }
+  std::uint32_t operator()(const IndexE &indexE) {
+    const auto array = addExpr(*indexE.getArray());
+    const auto index = addExpr(*indexE.getIndex());
+    return addNode(Flat_index, 0u, indexE.getLoc(), array, index);
+  }
+  std::uint32_t operator()(const CallE &callE) {
+    const auto args = addList(callE.getArgs());
+    const auto index =
+        addNode(Flat_call, static_cast<unsigned>(callE.getBuiltin()),
+                callE.getLoc(), args, callE.getArgs().size());
+    nodes[index].SymbolLoc = callE.getUpdated().empty()
+                                 ? NoNode
+                                 : addString(callE.getUpdated());
+    return index;
+  }
+  std::uint32_t operator()(const MapE &mapE) {
+    const auto operands = addList(mapE.getOperands());
+    return addNode(Flat_map, 0u, mapE.getLoc(), operands,
+                   mapE.getOperands().size());
+  }
+
+private:
+  std::uint32_t addExpr(const Expr &expr) { return std::visit(*this, expr); }
+
+  std::uint32_t addNode(const FlatNodeKind kind, const unsigned op,
+                        const SMLoc loc, const std::uint32_t a,
+                        const std::uint32_t b) {
+    nodes.push_back({kind, static_cast<std::uint8_t>(op), 0u, offsetOf(loc),
+                     a, b, 0u});
+    return nodes.size() - 1u;
+  }
+
+  /// The operands, then their Flat_args from the last, so that every link
+  /// comes after the next one. Returns the first link, or NoNode.
+  std::uint32_t addList(const ArrayRef<uptr<Expr>> exprs) {
+    SmallVector<std::uint32_t, 4> values;
+    for (const auto &expr : exprs)
+      values.push_back(addExpr(*expr));
+    auto next = NoNode;
+    for (auto i = values.size(); i--;) {
+      next = addNode(Flat_arg, 0u, SMLoc::getFromPointer(code.data()),
+                     values[i], next);
+      nodes[next].SymbolLoc = values.size() - i;
+    }
+    return next;
+  }
+
+  std::uint32_t addString(const StringRef str) {
+    const auto [it, inserted] = stringIndex.try_emplace(str, strings.size());
+    if (inserted) {
+      strings.push_back({static_cast<std::uint32_t>(stringData.size()),
+                         static_cast<std::uint32_t>(str.size())});
+      stringData.append(str.begin(), str.end());
+    }
+    return it->second;
+  }
+
+  std::uint32_t offsetOf(const SMLoc loc) const {
+    return loc.getPointer() - code.data();
+  }
+
+  StringRef code;
+  std::vector<image::Stmt> stmts;
+  std::vector<image::Node> nodes;
+  std::vector<image::StringEntry> strings;
+  std::string stringData;
+  StringMap<std::uint32_t> stringIndex;
+};
+
+} // namespace
+
+std::uint64_t ScriptImage::hashSource(const StringRef code) {
+  return xxHash64(code);
+}
+
+bool ScriptImage::write(raw_ostream &os, const StringRef code,
+                        const Program &program) {
+  if (code.size() >= NoNode)
+    return false;
+  ImageBuilder builder(code);
+  for (const auto &stmt : program) {
+    if (!stmt)
+      return false;
+    builder.addStmt(*stmt);
+  }
+  builder.write(os);
+  return true;
+}
+
+ScriptImage::ScriptImage(uptr<MemoryBuffer> file, const StringRef code)
+    : file(std::move(file)), code(code), header(nullptr) {}
+
+ScriptImage::~ScriptImage() = default;
+
+uptr<ScriptImage> ScriptImage::load(const StringRef path,
+                                    const StringRef code) {
+  // Large files are mapped, not read.
+  auto fileOrError = MemoryBuffer::getFile(path, /*IsText=*/false,
+                                           /*RequiresNullTerminator=*/false);
+  if (!fileOrError)
+    return nullptr;
+  uptr<ScriptImage> result(new ScriptImage(std::move(*fileOrError), code));
+  if (!result->verify())
+    return nullptr;
+  return result;
+}
+
+bool ScriptImage::verify() {
+  const auto data = file->getBuffer();
+  if (data.size() < sizeof(image::Header) ||
+      reinterpret_cast<std::uintptr_t>(data.data()) % alignof(image::Header))
+    return false;
+
+  const auto *h = reinterpret_cast<const image::Header *>(data.data());
+  if (std::memcmp(h->Magic, Magic, sizeof(Magic)) || h->Version != Version ||
+      h->HostTag != getHostTag() || h->SourceSize != code.size() ||
+      h->SourceHash != hashSource(code))
+    return false;
+
+  const auto fits = [&](const std::uint64_t offset, const std::uint64_t count,
+                        const std::uint64_t size) {
+    return offset % 8u == 0u && offset <= data.size() &&
+           count <= (data.size() - offset) / size;
+  };
+  if (!fits(h->StmtOffset, h->StmtCount, sizeof(image::Stmt)) ||
+      !fits(h->NodeOffset, h->NodeCount, sizeof(image::Node)) ||
+      !fits(h->StringOffset, h->StringCount, sizeof(image::StringEntry)) ||
+      !fits(h->StringDataOffset, h->StringBytes, 1u))
+    return false;
+
+  header = h;
+  stmts = {reinterpret_cast<const image::Stmt *>(data.data() +
+                                                      h->StmtOffset),
+                h->StmtCount};
+  nodes = {reinterpret_cast<const image::Node *>(data.data() +
+                                                      h->NodeOffset),
+                h->NodeCount};
+  strings = {reinterpret_cast<const image::StringEntry *>(
+                      data.data() + h->StringOffset),
+                  h->StringCount};
+  stringData = data.substr(h->StringDataOffset, h->StringBytes);
+
+  // One pass over the nodes, so that executing needs no checks: operands
+  // come before their node and aren't list links, strings and locations are
+  // in range, and operators and literals are ones the interpreter handles.
+  for (const auto &entry : strings)
+    if (entry.Offset > stringData.size() ||
+        entry.Size > stringData.size() - entry.Offset)
+      return false;
+  const auto isString = [&](const std::uint32_t index) {
+    return index < strings.size();
+  };
+  // A list of `size` links starting at `first`; the links were checked.
+  const auto isList = [&](const std::uint32_t first, const std::uint32_t size,
+                          const std::uint32_t i) {
+    if (first == NoNode)
+      return size == 0u;
+    return first < i && nodes[first].Kind == Flat_arg &&
+           nodes[first].SymbolLoc == size;
+  };
+  // An expression before node `i`; list links are only reached through
+  // their list.
+  const auto isExpr = [&](const std::uint32_t index, const std::uint32_t i) {
+    return index < i && nodes[index].Kind != Flat_arg;
+  };
+  for (std::uint32_t i = 0u; i < nodes.size(); ++i) {
+    const auto &node = nodes[i];
+    if (node.Loc >= code.size() + 1u)
+      return false;
+    switch (node.Kind) {
+    case Flat_binary:
+      if (!isBinaryOp(node.Op) || !isExpr(node.A, i) || !isExpr(node.B, i))
+        return false;
+      break;
+    case Flat_unary:
+      if (!isUnaryOp(node.Op) || !isExpr(node.A, i))
+        return false;
+      break;
+    case Flat_grouping:
+      if (!isExpr(node.A, i))
+        return false;
+      break;
+    case Flat_literal:
+      if (!isLiteral(node.Op) || !isString(node.A) ||
+          (node.Op == Tok_number && !isNumberLiteral(getString(node.A))))
+        return false;
+      break;
+    case Flat_variable:
+      if (!isString(node.A))
+        return false;
+      break;
+    case Flat_assign:
+      if (!isString(node.A) || !isExpr(node.B, i) ||
+          node.SymbolLoc > code.size())
+        return false;
+      break;
+    case Flat_array:
+      if (!isList(node.A, node.B, i))
+        return false;
+      break;
+    case Flat_index:
+      if (!isExpr(node.A, i) || !isExpr(node.B, i))
+        return false;
+      break;
+    case Flat_call:
+      if (node.Op >= BuiltinCount ||
+          node.B != getBuiltinArity(static_cast<Builtin>(node.Op)) ||
+          !isList(node.A, node.B, i) ||
+          (node.SymbolLoc != NoNode && !isString(node.SymbolLoc)))
+        return false;
+      break;
+    case Flat_map:
+      if (node.B % 2u || !isList(node.A, node.B, i))
+        return false;
+      break;
+    case Flat_arg:
+      if (!isExpr(node.A, i) ||
+          (node.B == NoNode ? node.SymbolLoc != 1u
+                            : !isList(node.B, node.SymbolLoc - 1u, i)))
+        return false;
+      break;
+    default:
+      return false;
+    }
+  }
+  for (const auto &stmt : stmts) {
+    if (stmt.Kind > Flat_var ||
+        (stmt.HasExpr && !isExpr(stmt.Expr, nodes.size())) ||
+        (stmt.Kind != Flat_var && !stmt.HasExpr) ||
+        (stmt.Kind == Flat_var && !isString(stmt.Symbol)))
+      return false;
+  }
+  return true;
+}
+
+std::size_t ScriptImage::getStmtCount() const { return stmts.size(); }
+
+StringRef ScriptImage::getString(const std::uint32_t index) const {
+  const auto &entry = strings[index];
+  return stringData.substr(entry.Offset, entry.Size);
+}
+
+SMLoc ScriptImage::getLoc(const std::uint32_t offset) const {
+  return SMLoc::getFromPointer(code.data() + offset);
+}
+
+sptr<Value> ScriptImage::evaluate(ExprInterpreter &evaluator,
+                                  const std::uint32_t index) const {
+  const auto &node = nodes[index];
+  const auto op = static_cast<TokenKind>(node.Op);
+  switch (node.Kind) {
+  case Flat_binary: {
+    evaluator.count(WorkCounters::Binary);
+    const auto lhs = evaluate(evaluator, node.A);
+    const auto rhs = evaluate(evaluator, node.B);
+    return evaluator.evaluateBinary(getLoc(node.Loc), op, lhs, rhs);
+  }
+  case Flat_unary:
+    evaluator.count(WorkCounters::Unary);
+    return evaluator.evaluateUnary(getLoc(node.Loc), op,
+                                   evaluate(evaluator, node.A));
+  case Flat_grouping:
+    evaluator.count(WorkCounters::Grouping);
+    return evaluate(evaluator, node.A);
+  case Flat_literal:
+    evaluator.count(WorkCounters::Literal);
+    return evaluator.evaluateLiteral(op, getString(node.A));
+  case Flat_variable:
+    evaluator.count(WorkCounters::Var);
+    return evaluator.evaluateVar(getLoc(node.Loc), getString(node.A));
+  case Flat_array:
+    evaluator.count(WorkCounters::Array);
+    return evaluator.evaluateArray(getLoc(node.Loc),
+                                   evaluateList(evaluator, node.A));
+  case Flat_index: {
+    evaluator.count(WorkCounters::Index);
+    const auto array = evaluate(evaluator, node.A);
+    const auto index = evaluate(evaluator, node.B);
+    return evaluator.evaluateIndex(getLoc(node.Loc), array, index);
+  }
+  case Flat_call:
+    evaluator.count(WorkCounters::Call);
+    return evaluator.evaluateCall(
+        getLoc(node.Loc), static_cast<Builtin>(node.Op),
+        evaluateList(evaluator, node.A),
+        node.SymbolLoc == NoNode ? StringRef() : getString(node.SymbolLoc));
+  case Flat_map:
+    evaluator.count(WorkCounters::Map);
+    return evaluator.evaluateMap(getLoc(node.Loc),
+                                 evaluateList(evaluator, node.A));
+  case Flat_assign: {
+    evaluator.count(WorkCounters::Assign);
+    const auto symbol = getString(node.A);
+    if (!evaluator.checkAssignTarget(getLoc(node.SymbolLoc), symbol))
+      return nullptr;
+    return evaluator.evaluateAssign(symbol, evaluate(evaluator, node.B));
+  }
+  default:
+    llvm_unreachable("lists are evaluated by their array, map or call");
+  }
+}
+
+SmallVector<sptr<Value>, 4>
+ScriptImage::evaluateList(ExprInterpreter &evaluator,
+                          std::uint32_t index) const {
+  SmallVector<sptr<Value>, 4> values;
+  for (; index != NoNode; index = nodes[index].B)
+    values.push_back(evaluate(evaluator, nodes[index].A));
+  return values;
+}
+
+void ScriptImage::execute(StmtInterpreter &interpreter) const {
+  auto &evaluator = interpreter.ExprEvaluator;
+  for (const auto &stmt : stmts) {
+    sptr<Value> value;
+    if (stmt.HasExpr)
+      value = evaluate(evaluator, stmt.Expr);
+    switch (stmt.Kind) {
+    case Flat_expr:
+      interpreter.count(WorkCounters::ExprS);
+      break;
+    case Flat_print:
+      interpreter.count(WorkCounters::PrintS);
+      interpreter.print(value);
+      break;
+    default:
+      interpreter.count(WorkCounters::VarS);
+      interpreter.define(getString(stmt.Symbol), stmt.HasExpr,
+                         std::move(value));
+      break;
+    }
+  }
+}
+
+std::string ScriptCache::getPath(const StringRef code) const {
+  SmallString<128> path(dir);
+  sys::path::append(path, formatv("{0:x-16}.loxi",
+                                  ScriptImage::hashSource(code)).str());
+  return path.str().str();
+}
+
+uptr<ScriptImage> ScriptCache::lookup(const StringRef code) const {
+  return ScriptImage::load(getPath(code), code);
+}
+
+bool ScriptCache::store(const StringRef code, const Program &program) const {
+  if (sys::fs::create_directories(dir))
+    return false;
+
+  const auto path = getPath(code);
+  SmallString<128> temp;
+  int fd = -1;
+  if (sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, temp))
+    return false;
+  bool written;
+  {
+    raw_fd_ostream os(fd, /*shouldClose=*/true);
+    written = ScriptImage::write(os, code, program);
+    os.close();
+    written = written && !os.has_error();
+    os.clear_error();
+  }
+  if (!written) {
+    sys::fs::remove(temp);
+    return false;
+  }
+  if (sys::fs::rename(temp, path)) {
+    sys::fs::remove(temp);
+    return false;
+  }
+  return true;
+}
+
+} // namespace lox
@@ -0,0 +1,197 @@
+#include "lox/interpreter/SharedGlobals.hpp"
+#include <cassert>
+#include <functional>
+#include <vector>
+
+namespace lox {
+
+namespace {
+
+/// Per-thread announcement of the epoch the thread is reading in; 0 when it
+/// isn't reading. Records are recycled when their thread exits.
+struct alignas(64) EpochRecord {
+  std::atomic<std::uint64_t> Epoch{0u};
+  std::atomic<bool> InUse{false};
+  EpochRecord *Next = nullptr;
+};
+
+/// Process-wide epoch-based reclamation.
+///
+/// Something unlinked while the global epoch is E can still be reached by
+/// readers that entered in E or earlier. The epoch only advances past E once
+/// no thread is reading in an older one, so it is safe to free at E + 2.
+class EpochDomain {
+public:
+  static EpochDomain &get() {
+    static EpochDomain domain;
+    return domain;
+  }
+
+  ~EpochDomain() {
+    for (auto &retired : retiredList)
+      retired.Free();
+  }
+
+  EpochRecord &record() {
+    thread_local RecordHolder holder(*this);
+    return *holder.Record;
+  }
+
+  void enter(EpochRecord &record) {
+    // A full barrier: the announcement is visible before any shared pointer
+    // is loaded.
+    record.Epoch.exchange(epoch.load(std::memory_order_relaxed));
+  }
+
+  static void exit(EpochRecord &record) {
+    record.Epoch.store(0u, std::memory_order_release);
+  }
+
+  void retire(std::function<void()> free) {
+    std::lock_guard<std::mutex> lock(retireMutex);
+    retiredList.push_back({epoch.load(), std::move(free)});
+    if (retiredList.size() % 64u == 0u)
+      reclaim();
+  }
+
+private:
+  struct Retired {
+    std::uint64_t Epoch;
+    std::function<void()> Free;
+  };
+
+  struct RecordHolder {
+    explicit RecordHolder(EpochDomain &domain) : Record(domain.acquire()) {}
+    ~RecordHolder() {
+      Record->Epoch.store(0u);
+      Record->InUse.store(false, std::memory_order_release);
+    }
+    EpochRecord *Record;
+  };
+
+  EpochRecord *acquire() {
+    for (auto *record = records.load(); record; record = record->Next) {
+      auto inUse = false;
+      if (record->InUse.compare_exchange_strong(inUse, true))
+        return record;
+    }
+    auto *record = new EpochRecord;
+    record->InUse.store(true);
+    record->Next = records.load();
+    while (!records.compare_exchange_weak(record->Next, record))
+      ;
+    return record;
+  }
+
+  /// Advance the epoch if every reader is in the current one.
+  bool tryAdvance() {
+    auto current = epoch.load();
+    for (auto *record = records.load(); record; record = record->Next) {
+      const auto seen = record->Epoch.load();
+      if (seen && seen != current)
+        return false;
+    }
+    return epoch.compare_exchange_strong(current, current + 1u);
+  }
+
+  /// Called with retireMutex held.
+  void reclaim() {
+    tryAdvance();
+    const auto safe = epoch.load();
+    std::size_t kept = 0u;
+    for (auto &retired : retiredList) {
+      if (retired.Epoch + 2u <= safe)
+        retired.Free();
+      else
+        retiredList[kept++] = std::move(retired);
+    }
+    retiredList.resize(kept);
+  }
+
+  std::atomic<std::uint64_t> epoch{1u};
+  /// Records are pushed and never unlinked.
+  std::atomic<EpochRecord *> records{nullptr};
+  std::mutex retireMutex;
+  std::vector<Retired> retiredList;
+};
+
+/// Keeps the calling thread inside an epoch for its lifetime.
+class ReadGuard {
+public:
+  ReadGuard() : record(getRecord()) { EpochDomain::get().enter(record); }
+  ~ReadGuard() { EpochDomain::exit(record); }
+
+private:
+  static EpochRecord &getRecord() {
+    thread_local auto *cached = &EpochDomain::get().record();
+    return *cached;
+  }
+
+  EpochRecord &record;
+};
+
+} // namespace
+
+SharedGlobals::SharedGlobals() : table(new Table) {}
+
+SharedGlobals::~SharedGlobals() {
+  delete table.load();
+  for (auto &slot : slots)
+    delete slot.Box.load();
+}
+
+void SharedGlobals::store(Slot &slot, sptr<Value> value) {
+  assert(value && "shared globals can't be unbound");
+  const auto *old = slot.Box.exchange(new sptr<Value>(std::move(value)),
+                                      std::memory_order_acq_rel);
+  if (old)
+    EpochDomain::get().retire([old] { delete old; });
+}
+
+void SharedGlobals::define(const StringRef name, sptr<Value> value) {
+  std::lock_guard<std::mutex> lock(defineMutex);
+  const auto *current = table.load(std::memory_order_acquire);
+  const auto it = current->find(name);
+  if (it != current->end()) {
+    store(*it->second, std::move(value));
+    return;
+  }
+
+  auto &slot = slots.emplace_back();
+  store(slot, std::move(value));
+  auto *next = new Table(*current);
+  next->try_emplace(name, &slot);
+  table.store(next, std::memory_order_release);
+  EpochDomain::get().retire([current] { delete current; });
+}
+
+bool SharedGlobals::assign(const StringRef name, sptr<Value> value) {
+  ReadGuard guard;
+  const auto *current = table.load(std::memory_order_acquire);
+  const auto it = current->find(name);
+  if (it == current->end())
+    return false;
+  store(*it->second, std::move(value));
+  return true;
+}
+
+sptr<Value> SharedGlobals::lookup(const StringRef name) const {
+  ReadGuard guard;
+  const auto *current = table.load(std::memory_order_acquire);
+  const auto it = current->find(name);
+  if (it == current->end())
+    return nullptr;
+  return *it->second->Box.load(std::memory_order_acquire);
+}
+
+bool SharedGlobals::count(const StringRef name) const {
+  ReadGuard guard;
+  return table.load(std::memory_order_acquire)->count(name);
+}
+
+std::size_t SharedGlobals::size() const {
+  ReadGuard guard;
+  return table.load(std::memory_order_acquire)->size();
+}
+
+} // namespace lox
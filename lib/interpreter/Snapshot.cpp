@@ -0,0 +1,391 @@
+#include "lox/interpreter/Snapshot.hpp"
+#include "lox/interpreter/ScriptCache.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Support/FileSystem.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace lox {
+
+namespace {
+
+constexpr char Magic[8] = {'L', 'O', 'X', 'S', 'N', 'A', 'P', '\0'};
+constexpr std::uint32_t NoValue = ~0u;
+
+/// Bytes of a long double that carry its value; the x87 format is padded.
+constexpr std::size_t NumberBytes =
+    std::numeric_limits<long double>::digits == 64 ? 10u
+                                                   : sizeof(long double);
+
+enum SnapshotValueKind : std::uint8_t {
+  Snap_number,
+  Snap_string,
+  Snap_bool,
+  Snap_nil,
+  /// The elements are a string of their bytes.
+  Snap_array,
+  /// The entries are a string of pairs of uint32 indices of a key and its
+  /// value, which come before the map.
+  Snap_map,
+};
+
+/// Identifies what the layout depends on besides Version.
+std::uint32_t getHostTag() {
+  const std::uint32_t one = 1u;
+  std::uint8_t little = 0u;
+  std::memcpy(&little, &one, 1u);
+  return (little ? 0x100u : 0u) | sizeof(void *) |
+         static_cast<std::uint32_t>(NumberBytes << 16u);
+}
+
+std::size_t alignTo8(const std::size_t offset) { return (offset + 7u) & ~7u; }
+
+} // namespace
+
+namespace snapshot {
+
+struct Header {
+  char Magic[8];
+  std::uint32_t Version;
+  std::uint32_t HostTag;
+  std::uint64_t SourceHash;
+  std::uint64_t SourceSize;
+  std::uint32_t BindingCount;
+  std::uint32_t ValueCount;
+  std::uint32_t StringCount;
+  std::uint32_t StringBytes;
+  std::uint64_t BindingOffset;
+  std::uint64_t ValueOffset;
+  std::uint64_t StringOffset;
+  std::uint64_t StringDataOffset;
+};
+
+struct Binding {
+  /// Name in the string table.
+  std::uint32_t Name;
+  /// Index of the value, or NoValue for `var a;`.
+  std::uint32_t Value;
+};
+
+struct ValueEntry {
+  std::uint8_t Kind;
+  std::uint8_t Bool;
+  std::uint16_t Reserved;
+  /// String, array and map values only.
+  std::uint32_t String;
+  unsigned char Number[16];
+};
+
+struct StringEntry {
+  std::uint32_t Offset;
+  std::uint32_t Size;
+};
+
+} // namespace snapshot
+
+namespace {
+
+/// Whether `entry` can be a key of a map, like MapTable::isKey.
+bool isKey(const snapshot::ValueEntry &entry) {
+  if (entry.Kind != Snap_number)
+    return entry.Kind <= Snap_nil;
+  long double number = 0.0L;
+  std::memcpy(&number, entry.Number, NumberBytes);
+  return !std::isnan(number);
+}
+
+/// Lays the bindings out as a snapshot, sharing equal values and strings.
+class SnapshotBuilder {
+public:
+  void addBinding(const StringRef name, const sptr<Value> &value) {
+    bindings.push_back({addString(name), value ? addValue(*value) : NoValue});
+  }
+
+  void write(raw_ostream &os, const StringRef prelude) const {
+    snapshot::Header header{};
+    std::memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = EnvSnapshot::Version;
+    header.HostTag = getHostTag();
+    header.SourceHash = ScriptImage::hashSource(prelude);
+    header.SourceSize = prelude.size();
+    header.BindingCount = bindings.size();
+    header.ValueCount = values.size();
+    header.StringCount = strings.size();
+    header.StringBytes = stringData.size();
+    header.BindingOffset = alignTo8(sizeof(header));
+    header.ValueOffset = alignTo8(header.BindingOffset +
+                                  bindings.size() * sizeof(snapshot::Binding));
+    header.StringOffset = alignTo8(
+        header.ValueOffset + values.size() * sizeof(snapshot::ValueEntry));
+    header.StringDataOffset = alignTo8(
+        header.StringOffset + strings.size() * sizeof(snapshot::StringEntry));
+
+    std::uint64_t offset = 0u;
+    const auto emit = [&](const void *data, const std::size_t size,
+                          const std::uint64_t at) {
+      os.write_zeros(at - offset);
+      os.write(static_cast<const char *>(data), size);
+      offset = at + size;
+    };
+    emit(&header, sizeof(header), 0u);
+    emit(bindings.data(), bindings.size() * sizeof(snapshot::Binding),
+         header.BindingOffset);
+    emit(values.data(), values.size() * sizeof(snapshot::ValueEntry),
+         header.ValueOffset);
+    emit(strings.data(), strings.size() * sizeof(snapshot::StringEntry),
+         header.StringOffset);
+    emit(stringData.data(), stringData.size(), header.StringDataOffset);
+  }
+
+  /// Whether string offsets, which arrays make large, fit the layout.
+  [[nodiscard]] bool fits() const {
+    return stringData.size() <= std::numeric_limits<std::uint32_t>::max();
+  }
+
+private:
+  std::uint32_t addValue(const Value &value) {
+    snapshot::ValueEntry entry{};
+    if (const auto *number = dyn_cast<NumberValue>(&value)) {
+      const auto v = number->getValue();
+      entry.Kind = Snap_number;
+      std::memcpy(entry.Number, &v, NumberBytes);
+    } else if (const auto *string = dyn_cast<StringValue>(&value)) {
+      entry.Kind = Snap_string;
+      entry.String = addString(string->getValue());
+    } else if (const auto *array = dyn_cast<ArrayValue>(&value)) {
+      const auto elements = array->getElements();
+      entry.Kind = Snap_array;
+      entry.String = addString(
+          StringRef(reinterpret_cast<const char *>(elements.data()),
+                    elements.size() * sizeof(double)));
+    } else if (const auto *map = dyn_cast<MapValue>(&value)) {
+      std::vector<std::uint32_t> indices;
+      indices.reserve(map->size() * 2u);
+      for (const auto &mapEntry : map->getTable()) {
+        indices.push_back(addValue(*mapEntry.Key));
+        indices.push_back(addValue(*mapEntry.Mapped));
+      }
+      entry.Kind = Snap_map;
+      entry.String = addString(
+          StringRef(reinterpret_cast<const char *>(indices.data()),
+                    indices.size() * sizeof(std::uint32_t)));
+    } else if (isa<BoolValue>(&value)) {
+      entry.Kind = Snap_bool;
+      entry.Bool = value.truthy();
+    } else {
+      entry.Kind = Snap_nil;
+    }
+
+    const StringRef key(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    const auto [it, inserted] = valueIndex.try_emplace(key, values.size());
+    if (inserted)
+      values.push_back(entry);
+    return it->second;
+  }
+
+  std::uint32_t addString(const StringRef str) {
+    const auto [it, inserted] = stringIndex.try_emplace(str, strings.size());
+    if (inserted) {
+      strings.push_back({static_cast<std::uint32_t>(stringData.size()),
+                         static_cast<std::uint32_t>(str.size())});
+      stringData.append(str.begin(), str.end());
+    }
+    return it->second;
+  }
+
+  std::vector<snapshot::Binding> bindings;
+  std::vector<snapshot::ValueEntry> values;
+  std::vector<snapshot::StringEntry> strings;
+  std::string stringData;
+  StringMap<std::uint32_t> valueIndex;
+  StringMap<std::uint32_t> stringIndex;
+};
+
+} // namespace
+
+bool EnvSnapshot::write(raw_ostream &os, const StringRef prelude,
+                        const Program &program, const LoxValueEnv &env) {
+  // Globals only come from `var`, so the prelude names all of them.
+  StringSet<> seen;
+  SnapshotBuilder builder;
+  for (const auto &stmt : program) {
+    const auto *varStmt = stmt ? std::get_if<VarStmt>(stmt.get()) : nullptr;
+    if (!varStmt)
+      continue;
+    const auto name = varStmt->getSymbol()->Symbol;
+    if (!env.count(name) || !seen.insert(name).second)
+      continue;
+    builder.addBinding(name, env.lookup(name));
+  }
+  if (!builder.fits())
+    return false;
+  builder.write(os, prelude);
+  return true;
+}
+
+bool EnvSnapshot::save(const StringRef path, const StringRef prelude,
+                       const Program &program, const LoxValueEnv &env) {
+  SmallString<128> temp;
+  int fd = -1;
+  if (sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, temp))
+    return false;
+  bool written;
+  {
+    raw_fd_ostream os(fd, /*shouldClose=*/true);
+    written = write(os, prelude, program, env);
+    os.close();
+    written = written && !os.has_error();
+    os.clear_error();
+  }
+  if (!written || sys::fs::rename(temp, path)) {
+    sys::fs::remove(temp);
+    return false;
+  }
+  return true;
+}
+
+EnvSnapshot::EnvSnapshot(uptr<MemoryBuffer> file) : file(std::move(file)) {}
+
+EnvSnapshot::~EnvSnapshot() = default;
+
+uptr<EnvSnapshot> EnvSnapshot::load(const StringRef path,
+                                    const StringRef prelude) {
+  auto fileOrError = MemoryBuffer::getFile(path, /*IsText=*/false,
+                                           /*RequiresNullTerminator=*/false);
+  if (!fileOrError)
+    return nullptr;
+  uptr<EnvSnapshot> result(new EnvSnapshot(std::move(*fileOrError)));
+  if (!result->verify(prelude))
+    return nullptr;
+  return result;
+}
+
+bool EnvSnapshot::verify(const StringRef prelude) {
+  const auto data = file->getBuffer();
+  if (data.size() < sizeof(snapshot::Header) ||
+      reinterpret_cast<std::uintptr_t>(data.data()) %
+          alignof(snapshot::Header))
+    return false;
+
+  const auto *h = reinterpret_cast<const snapshot::Header *>(data.data());
+  if (std::memcmp(h->Magic, Magic, sizeof(Magic)) || h->Version != Version ||
+      h->HostTag != getHostTag() || h->SourceSize != prelude.size() ||
+      h->SourceHash != ScriptImage::hashSource(prelude))
+    return false;
+
+  const auto fits = [&](const std::uint64_t offset, const std::uint64_t count,
+                        const std::uint64_t size) {
+    return offset % 8u == 0u && offset <= data.size() &&
+           count <= (data.size() - offset) / size;
+  };
+  if (!fits(h->BindingOffset, h->BindingCount, sizeof(snapshot::Binding)) ||
+      !fits(h->ValueOffset, h->ValueCount, sizeof(snapshot::ValueEntry)) ||
+      !fits(h->StringOffset, h->StringCount, sizeof(snapshot::StringEntry)) ||
+      !fits(h->StringDataOffset, h->StringBytes, 1u))
+    return false;
+
+  bindings = {reinterpret_cast<const snapshot::Binding *>(data.data() +
+                                                          h->BindingOffset),
+              h->BindingCount};
+  values = {reinterpret_cast<const snapshot::ValueEntry *>(data.data() +
+                                                           h->ValueOffset),
+            h->ValueCount};
+  strings = {reinterpret_cast<const snapshot::StringEntry *>(
+                 data.data() + h->StringOffset),
+             h->StringCount};
+  stringData = data.substr(h->StringDataOffset, h->StringBytes);
+
+  for (const auto &entry : strings)
+    if (entry.Offset > stringData.size() ||
+        entry.Size > stringData.size() - entry.Offset)
+      return false;
+  for (std::uint32_t i = 0u; i < values.size(); ++i) {
+    const auto &entry = values[i];
+    if (entry.Kind > Snap_map ||
+        ((entry.Kind == Snap_string || entry.Kind == Snap_array ||
+          entry.Kind == Snap_map) &&
+         entry.String >= strings.size()) ||
+        (entry.Kind == Snap_array &&
+         strings[entry.String].Size % sizeof(double)))
+      return false;
+    if (entry.Kind != Snap_map)
+      continue;
+    // Keys and values come first, so restoring never looks ahead.
+    const auto bytes = getString(entry.String);
+    if (bytes.size() % (2u * sizeof(std::uint32_t)))
+      return false;
+    for (std::size_t offset = 0u; offset < bytes.size();
+         offset += 2u * sizeof(std::uint32_t)) {
+      std::uint32_t pair[2];
+      std::memcpy(pair, bytes.data() + offset, sizeof(pair));
+      if (pair[0] >= i || pair[1] >= i || !isKey(values[pair[0]]))
+        return false;
+    }
+  }
+  for (const auto &binding : bindings)
+    if (binding.Name >= strings.size() ||
+        (binding.Value != NoValue && binding.Value >= values.size()))
+      return false;
+  return true;
+}
+
+std::size_t EnvSnapshot::getBindingCount() const { return bindings.size(); }
+
+StringRef EnvSnapshot::getString(const std::uint32_t index) const {
+  const auto &entry = strings[index];
+  return stringData.substr(entry.Offset, entry.Size);
+}
+
+sptr<Value>
+EnvSnapshot::materialize(const snapshot::ValueEntry &entry,
+                         const ArrayRef<sptr<Value>> restored) const {
+  switch (entry.Kind) {
+  case Snap_number: {
+    long double number = 0.0L;
+    std::memcpy(&number, entry.Number, NumberBytes);
+    return mksptr<NumberValue>(number);
+  }
+  case Snap_string:
+    return mksptr<StringValue>(getString(entry.String).str());
+  case Snap_bool:
+    return mksptr<BoolValue>(entry.Bool != 0u);
+  case Snap_array: {
+    // The string table is not aligned for doubles.
+    const auto bytes = getString(entry.String);
+    SmallVector<double, 0> elements(bytes.size() / sizeof(double));
+    std::memcpy(elements.data(), bytes.data(), bytes.size());
+    return mksptr<ArrayValue>(std::move(elements));
+  }
+  case Snap_map: {
+    const auto bytes = getString(entry.String);
+    MapTable table;
+    table.reserve(bytes.size() / (2u * sizeof(std::uint32_t)));
+    for (std::size_t offset = 0u; offset < bytes.size();
+         offset += 2u * sizeof(std::uint32_t)) {
+      std::uint32_t pair[2];
+      std::memcpy(pair, bytes.data() + offset, sizeof(pair));
+      table.insert(restored[pair[0]], restored[pair[1]]);
+    }
+    return mksptr<MapValue>(std::move(table));
+  }
+  default:
+    return mksptr<NilValue>();
+  }
+}
+
+void EnvSnapshot::restore(LoxValueEnv &env) const {
+  // Values are immutable, so bindings of equal values share one object.
+  std::vector<sptr<Value>> restored;
+  restored.reserve(values.size());
+  for (const auto &entry : values)
+    restored.push_back(materialize(entry, restored));
+
+  for (const auto &binding : bindings)
+    env.insert(getString(binding.Name),
+               binding.Value == NoValue ? nullptr : restored[binding.Value]);
+}
+
+} // namespace lox
@@ -0,0 +1,30 @@
+#include "lox/interpreter/Streaming.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include <algorithm>
+
+namespace lox {
+
+StreamingStats interpretStreaming(SourceMgr &srcMgr, const StringRef code,
+                                  StmtInterpreter &interpreter) {
+  StreamingStats stats;
+  Lexer lexer(srcMgr, code);
+  Parser parser(lexer, srcMgr);
+
+  while (!parser.isAtEnd()) {
+    const auto stmt = parser.Declaration();
+    const auto tokens = parser.ReleaseTokens();
+    stats.PeakTokens = std::max<std::size_t>(stats.PeakTokens, tokens.size());
+
+    stats.SyntaxErrors = lexer.getError() + parser.getError();
+    if (!stmt || stats.SyntaxErrors)
+      continue;
+
+    std::visit(interpreter, *stmt);
+    stats.Statements++;
+  }
+  stats.SyntaxErrors = lexer.getError() + parser.getError();
+  return stats;
+}
+
+} // namespace lox
@@ -1,5 +1,10 @@
 #include "lox/interpreter/Value.hpp"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/ErrorHandling.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
 
 namespace lox {
 
@@ -42,4 +47,234 @@ bool NilValue::operator==(const Value &other) const {
     return true;
   return false;
 }
+
+std::string ArrayValue::str() const {
+  std::string text;
+  raw_string_ostream os(text);
+  printValue(os, *this);
+  return os.str();
+}
+bool ArrayValue::truthy() const { return false; }
+bool ArrayValue::classof(const Value *value) {
+  return value->getKind() == Array;
+}
+bool ArrayValue::operator==(const Value &other) const {
+  if (const auto *array = dyn_cast<ArrayValue>(&other))
+    return getElements() == array->getElements();
+  return false;
+}
+
+std::string MapValue::str() const {
+  std::string text;
+  raw_string_ostream os(text);
+  printValue(os, *this);
+  return os.str();
+}
+bool MapValue::truthy() const { return false; }
+bool MapValue::classof(const Value *value) { return value->getKind() == Map; }
+bool MapValue::operator==(const Value &other) const {
+  const auto *map = dyn_cast<MapValue>(&other);
+  if (!map || size() != map->size())
+    return false;
+  return std::all_of(table.begin(), table.end(),
+                     [&](const MapTable::Entry &entry) {
+                       const auto *found = map->table.find(*entry.Key);
+                       return found && *found->Mapped == *entry.Mapped;
+                     });
+}
+
+namespace {
+
+/// "%Lf" of a finite `value` below 2^63 in magnitude: rounded to six
+/// decimals, to nearest with ties to even on the exact binary value, like
+/// glibc. Returns the end of the text.
+char *formatFixed(char *out, long double value) {
+  if (std::signbit(value)) {
+    *out++ = '-';
+    value = -value;
+  }
+  const auto integer = std::trunc(value);
+  auto whole = static_cast<std::uint64_t>(integer);
+  // Exact: the fraction has no more significant bits than `value`.
+  const auto fraction = value - integer;
+  std::uint64_t micros = 0u;
+  if (fraction != 0.0L) {
+    // fraction = bits * 2^-shift exactly, with 64 significant bits.
+    int exponent;
+    const auto bits =
+        static_cast<std::uint64_t>(std::ldexp(std::frexp(fraction, &exponent),
+                                              64));
+    const auto shift = static_cast<unsigned>(64 - exponent);
+    // Below 2^-64, the fraction rounds to zero.
+    if (shift < 128u) {
+      const auto scaled = static_cast<unsigned __int128>(bits) * 1000000u;
+      micros = static_cast<std::uint64_t>(scaled >> shift);
+      const auto rest =
+          scaled - (static_cast<unsigned __int128>(micros) << shift);
+      const auto half = static_cast<unsigned __int128>(1u) << (shift - 1u);
+      if (rest > half || (rest == half && micros % 2u))
+        ++micros;
+    }
+    if (micros == 1000000u) {
+      micros = 0u;
+      ++whole;
+    }
+  }
+
+  char digits[20];
+  auto count = 0u;
+  do {
+    digits[count++] = static_cast<char>('0' + whole % 10u);
+    whole /= 10u;
+  } while (whole);
+  while (count)
+    *out++ = digits[--count];
+  *out++ = '.';
+  for (auto i = 6u; i-- > 0u;) {
+    out[i] = static_cast<char>('0' + micros % 10u);
+    micros /= 10u;
+  }
+  return out + 6;
+}
+
+/// The shortest text of `value`, in the notation std::to_chars picks, when
+/// it is a decimal of at most nine fraction digits below 2^53; null
+/// otherwise. Most numbers scripts print are, and std::to_chars takes
+/// several times longer on a long double.
+char *formatShortDecimal(char *out, const long double value) {
+  const auto magnitude = std::fabs(value);
+  if (!(magnitude > 0.0L && magnitude < 0x1p53L))
+    return nullptr;
+  auto scale = 1.0L;
+  for (auto fractionDigits = 0u; fractionDigits <= 9u;
+       ++fractionDigits, scale *= 10.0L) {
+    const auto scaled = magnitude * scale;
+    if (scaled >= 0x1p53L)
+      return nullptr;
+    // Below 2^53 the rounding of `scaled` can't pick the wrong neighbour of
+    // a decimal that reads back as `value`, so the first one found is the
+    // shortest.
+    const auto digits = std::rint(scaled);
+    if (digits / scale != magnitude)
+      continue;
+
+    char reversed[20];
+    auto length = 0u;
+    for (auto rest = static_cast<std::uint64_t>(digits); rest; rest /= 10u)
+      reversed[length++] = static_cast<char>('0' + rest % 10u);
+    auto trailingZeros = 0u;
+    while (reversed[trailingZeros] == '0')
+      ++trailingZeros;
+    // The exponent has two digits in this range.
+    const auto significant = length - trailingZeros;
+    const auto scientific = significant + (significant > 1u) + 4u;
+    const auto plain =
+        !fractionDigits ? length
+                        : std::max(length, fractionDigits + 1u) + 1u;
+    if (scientific < plain)
+      return nullptr;
+
+    if (value < 0.0L)
+      *out++ = '-';
+    // The point goes between the digits, or before them after "0.".
+    auto pointAt = fractionDigits;
+    if (length <= fractionDigits) {
+      *out++ = '0';
+      *out++ = '.';
+      for (auto i = length; i < fractionDigits; ++i)
+        *out++ = '0';
+      pointAt = 0u;
+    }
+    for (; length; --length) {
+      if (length == pointAt)
+        *out++ = '.';
+      *out++ = reversed[length - 1u];
+    }
+    return out;
+  }
+  return nullptr;
+}
+
+} // namespace
+
+std::size_t printNumber(raw_ostream &os, const long double value,
+                        const NumberFormat format) {
+  char buffer[64];
+  switch (format) {
+  case NumberFormat::Fixed: {
+    if (!std::isfinite(value) || std::fabs(value) >= 0x1p63L) {
+      const auto text = std::to_string(value);
+      os << text;
+      return text.size();
+    }
+    const auto *end = formatFixed(buffer, value);
+    os.write(buffer, end - buffer);
+    return end - buffer;
+  }
+  case NumberFormat::Shortest: {
+    auto *end = formatShortDecimal(buffer, value);
+    if (!end) {
+      const auto [last, ec] =
+          std::to_chars(buffer, buffer + sizeof(buffer), value);
+      if (ec != std::errc())
+        return printNumber(os, value, NumberFormat::Fixed);
+      end = last;
+    }
+    os.write(buffer, end - buffer);
+    return end - buffer;
+  }
+  }
+  llvm_unreachable("all number formats are handled");
+}
+
+std::size_t printValue(raw_ostream &os, const Value &value,
+                       const NumberFormat format) {
+  switch (value.getKind()) {
+  case Number:
+    return printNumber(os, cast<NumberValue>(value).getValue(), format);
+  case String: {
+    const auto &text = cast<StringValue>(value).getValue();
+    os << text;
+    return text.size();
+  }
+  case Bool: {
+    const StringRef text = value.truthy() ? "true" : "false";
+    os << text;
+    return text.size();
+  }
+  case Nil:
+    os << "nil";
+    return 3u;
+  case Array: {
+    std::size_t size = 2u;
+    os << '[';
+    for (const auto element : cast<ArrayValue>(value).getElements()) {
+      if (size > 2u) {
+        os << ", ";
+        size += 2u;
+      }
+      size += printNumber(os, element, format);
+    }
+    os << ']';
+    return size;
+  }
+  case Map: {
+    std::size_t size = 2u;
+    os << '{';
+    for (const auto &entry : cast<MapValue>(value).getTable()) {
+      if (size > 2u) {
+        os << ", ";
+        size += 2u;
+      }
+      size += printValue(os, *entry.Key, format);
+      os << ": ";
+      size += 2u + printValue(os, *entry.Mapped, format);
+    }
+    os << '}';
+    return size;
+  }
+  }
+  llvm_unreachable("all value kinds are handled");
+}
+
 } // namespace lox
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "lox/interpreter/WorkCounter.hpp"
+#include "llvm/Support/FormatVariadic.h"
+#include <numeric>
+
+namespace lox {
+
+const char *WorkCounters::getExprNodeName(const ExprNode node) {
+  static const char *names[] = {"BinaryE",  "UnaryE", "GroupingE",
+                                "LiteralE", "VarE",   "AssignE",
+                                "ArrayE",   "IndexE", "CallE",
+                                "MapE"};
+  return names[node];
+}
+
+const char *WorkCounters::getStmtNodeName(const StmtNode node) {
+  static const char *names[] = {"ExprStmt", "PrintStmt", "VarStmt"};
+  return names[node];
+}
+
+std::uint64_t WorkCounters::getExprVisits() const {
+  return std::accumulate(ExprVisits.begin(), ExprVisits.end(),
+                         std::uint64_t{0u});
+}
+
+std::uint64_t WorkCounters::getStmtVisits() const {
+  return std::accumulate(StmtVisits.begin(), StmtVisits.end(),
+                         std::uint64_t{0u});
+}
+
+std::uint64_t WorkCounters::getTotal() const {
+  return getExprVisits() + getStmtVisits() + ValueAllocations + EnvLookups +
+         EnvInserts + StringBytesCopied;
+}
+
+void WorkCounters::print(raw_ostream &os) const {
+  for (auto i = 0u; i < StmtNodeCount; ++i)
+    os << formatv("{0,-20} {1,12}\n",
+                  getStmtNodeName(static_cast<StmtNode>(i)), StmtVisits[i]);
+  for (auto i = 0u; i < ExprNodeCount; ++i)
+    os << formatv("{0,-20} {1,12}\n",
+                  getExprNodeName(static_cast<ExprNode>(i)), ExprVisits[i]);
+  os << formatv("{0,-20} {1,12}\n", "value allocations", ValueAllocations);
+  os << formatv("{0,-20} {1,12}\n", "env lookups", EnvLookups);
+  os << formatv("{0,-20} {1,12}\n", "env inserts", EnvInserts);
+  os << formatv("{0,-20} {1,12}\n", "string bytes copied", StringBytesCopied);
+  os << formatv("{0,-20} {1,12}\n", "total", getTotal());
+}
+
+} // namespace lox
@@ -0,0 +1,175 @@
+#include "lox/parser/Diagnostics.hpp"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
+#include <numeric>
+
+namespace lox {
+
+namespace {
+
+struct DiagInfo {
+  const char *Name;
+  DiagCategory Category;
+  const char *Format;
+};
+
+constexpr DiagInfo Infos[] = {
+#define DIAG(ID, CATEGORY, FORMAT) {#ID, DiagCategory::CATEGORY, FORMAT},
+#include "lox/parser/Diagnostic.def"
+};
+
+/// `format` with each {N} replaced by `args[N]`.
+void formatMessage(raw_ostream &os, const StringRef format,
+                   const ArrayRef<StringRef> args) {
+  for (std::size_t i = 0u; i < format.size(); ++i) {
+    if (format[i] == '{' && i + 2u < format.size() && format[i + 2u] == '}' &&
+        static_cast<unsigned>(format[i + 1u] - '0') < args.size()) {
+      os << args[format[i + 1u] - '0'];
+      i += 2u;
+      continue;
+    }
+    os << format[i];
+  }
+}
+
+} // namespace
+
+const char *getDiagName(const DiagCode code) { return Infos[code].Name; }
+
+DiagCategory getDiagCategory(const DiagCode code) {
+  return Infos[code].Category;
+}
+
+const char *getDiagCategoryName(const DiagCategory category) {
+  switch (category) {
+  case DiagCategory::Lexer:
+    return "lexer";
+  case DiagCategory::Parser:
+    return "parser";
+  case DiagCategory::Runtime:
+    return "runtime";
+  }
+  llvm_unreachable("all diagnostic categories are handled");
+}
+
+DiagnosticEngine::DiagnosticEngine(SourceMgr &srcMgr, raw_ostream &os,
+                                   DiagnosticOptions options)
+    : SrcMgr(srcMgr), os(&os), options(options) {}
+
+void DiagnosticEngine::report(const DiagCode code, const SMLoc loc,
+                              const ArrayRef<StringRef> messageArgs) {
+  const auto category = static_cast<unsigned>(getDiagCategory(code));
+  ++errors[category];
+  // Beyond the limit, counting is all there is to do.
+  if (options.MaxPerCategory && kept[category] >= options.MaxPerCategory)
+    return;
+  ++kept[category];
+
+  Diagnostic diag{code, loc, static_cast<unsigned>(args.size()),
+                  static_cast<unsigned>(messageArgs.size())};
+  if (!options.Deferred) {
+    // Printed right away, so the arguments needn't outlive this call.
+    const auto first = args.size();
+    args.append(messageArgs.begin(), messageArgs.end());
+    print(diag);
+    args.truncate(first);
+    return;
+  }
+  for (const auto arg : messageArgs)
+    args.push_back(saver.save(arg));
+  diagnostics.push_back(diag);
+}
+
+void DiagnosticEngine::flush() {
+  for (; flushed < diagnostics.size(); ++flushed)
+    print(diagnostics[flushed]);
+
+  for (unsigned i = 0u; i < DiagCategoryCount; ++i) {
+    const auto category = static_cast<DiagCategory>(i);
+    const auto suppressed = getSuppressedCount(category);
+    if (suppressed == summarized[i])
+      continue;
+    *os << formatv("note: {0} more {1} errors suppressed (limit : {2})\n",
+                   suppressed - summarized[i], getDiagCategoryName(category),
+                   options.MaxPerCategory);
+    summarized[i] = suppressed;
+  }
+}
+
+void DiagnosticEngine::print(const Diagnostic &diag) {
+  SrcMgr.PrintMessage(*os, diag.Loc, SourceMgr::DK_Error, getMessage(diag));
+}
+
+std::string DiagnosticEngine::getMessage(const Diagnostic &diag) const {
+  std::string message;
+  raw_string_ostream messageOS(message);
+  formatMessage(messageOS, Infos[diag.Code].Format, getArgs(diag));
+  return message;
+}
+
+void DiagnosticEngine::printJSON(raw_ostream &stream) const {
+  json::OStream json(stream);
+  json.object([&] {
+    json.attributeArray("diagnostics", [&] {
+      for (const auto &diag : diagnostics) {
+        json.object([&] {
+          json.attribute("severity", "error");
+          json.attribute("category",
+                         getDiagCategoryName(getDiagCategory(diag.Code)));
+          json.attribute("code", getDiagName(diag.Code));
+          if (const auto id = SrcMgr.FindBufferContainingLoc(diag.Loc)) {
+            const auto *buffer = SrcMgr.getMemoryBuffer(id);
+            const auto [line, column] = SrcMgr.getLineAndColumn(diag.Loc, id);
+            json.attribute("file", buffer->getBufferIdentifier());
+            json.attribute("line", static_cast<std::int64_t>(line));
+            json.attribute("column", static_cast<std::int64_t>(column));
+            json.attribute("offset", static_cast<std::int64_t>(
+                                         diag.Loc.getPointer() -
+                                         buffer->getBufferStart()));
+          }
+          json.attribute("message", getMessage(diag));
+          json.attributeArray("args", [&] {
+            for (const auto arg : getArgs(diag))
+              json.value(arg);
+          });
+        });
+      }
+    });
+    json.attribute("errors", static_cast<std::int64_t>(getErrorCount()));
+    json.attributeObject("suppressed", [&] {
+      for (unsigned i = 0u; i < DiagCategoryCount; ++i) {
+        const auto category = static_cast<DiagCategory>(i);
+        json.attribute(getDiagCategoryName(category),
+                       static_cast<std::int64_t>(getSuppressedCount(category)));
+      }
+    });
+  });
+  stream << '\n';
+}
+
+std::size_t DiagnosticEngine::getErrorCount() const {
+  return std::accumulate(errors.begin(), errors.end(), std::size_t(0u));
+}
+
+std::size_t
+DiagnosticEngine::getSuppressedCount(const DiagCategory category) const {
+  const auto i = static_cast<unsigned>(category);
+  return errors[i] - kept[i];
+}
+
+void DiagnosticSink::setStream(raw_ostream &os) {
+  carried = getErrorCount();
+  stream = &os;
+  if (own)
+    own->setStream(os);
+  engine = own.get();
+  base = own ? own->getErrorCount(category) : 0u;
+}
+
+void DiagnosticSink::setEngine(DiagnosticEngine &shared) {
+  carried = getErrorCount();
+  engine = &shared;
+  base = shared.getErrorCount(category);
+}
+
+} // namespace lox
@@ -0,0 +1,281 @@
+#include "lox/parser/IncrementalParser.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include <algorithm>
+
+namespace lox {
+
+struct IncrementalDocument::Segment {
+  /// The region this segment was lexed in, shared with its neighbours from
+  /// the same edit.
+  sptr<const MemoryBuffer> Buffer;
+  StringRef Text;
+  /// Ends with eof.
+  SmallVector<uptr<Token>> Tokens;
+  Program Statements;
+  /// Offsets are relative to the segment.
+  std::vector<IncrementalDiagnostic> Diagnostics;
+  std::size_t Errors = 0u;
+};
+
+namespace {
+
+/// Collects the diagnostics of one region with the pointer they are at.
+struct RegionDiagnostics {
+  std::vector<std::pair<const char *, std::string>> Entries;
+
+  static void handle(const SMDiagnostic &diag, void *context) {
+    static_cast<RegionDiagnostics *>(context)->Entries.emplace_back(
+        diag.getLoc().getPointer(), diag.getMessage().str());
+  }
+};
+
+/// True if `trivia` ends inside a line comment, which would swallow what
+/// follows it.
+bool endsInComment(const StringRef trivia) {
+  const auto comment = trivia.rfind("//");
+  if (comment == StringRef::npos)
+    return false;
+  const auto newline = trivia.rfind('\n');
+  return newline == StringRef::npos || newline < comment;
+}
+
+} // namespace
+
+IncrementalDocument::IncrementalDocument(const StringRef text,
+                                         const StringRef name)
+    : name(name.str()), shiftFrom(0u), shift(0u), errors(0u) {
+  parseRegion(text, true, segments);
+  if (segments.empty())
+    segments.push_back(mkuptr<Segment>());
+  starts.push_back(0u);
+  for (const auto &segment : segments) {
+    errors += segment->Errors;
+    starts.push_back(starts.back() + segment->Text.size());
+  }
+}
+
+IncrementalDocument::~IncrementalDocument() = default;
+
+bool IncrementalDocument::parseRegion(
+    const StringRef text, const bool atEnd,
+    std::vector<uptr<Segment>> &result) const {
+  sptr<const MemoryBuffer> buffer =
+      MemoryBuffer::getMemBufferCopy(text, name);
+  const auto code = buffer->getBuffer();
+
+  RegionDiagnostics diagnostics;
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(
+      MemoryBuffer::getMemBuffer(code, buffer->getBufferIdentifier(), false),
+      {});
+  srcMgr.setDiagHandler(RegionDiagnostics::handle, &diagnostics);
+
+  Lexer lexer(srcMgr, code);
+  lexer.Lex();
+  auto tokens = lexer.takeTokens();
+
+  // Cut after every `;`; the eof token is last.
+  SmallVector<std::size_t> cuts;
+  for (std::size_t i = 0u; i + 1u < tokens.size(); ++i)
+    if (tokens[i]->Kind == Tok_semicolon)
+      cuts.push_back(i + 1u);
+
+  const auto endOf = [&](const std::size_t cut) {
+    const auto *last = tokens[cut - 1u].get();
+    return static_cast<std::size_t>(last->Loc.getPointer() - code.data()) +
+           last->Symbol.size();
+  };
+  const auto tailBegin = cuts.empty() ? 0u : endOf(cuts.back());
+  const auto tailTokens = cuts.empty() ? 0u : cuts.back();
+  const auto tailIsTrivia = tailTokens + 1u == tokens.size();
+  if (!atEnd &&
+      (!tailIsTrivia || endsInComment(code.drop_front(tailBegin))))
+    return false;
+
+  // A trailing run of whitespace and comments stays with the last
+  // declaration; at the end of the document anything left is the tail.
+  if (!tailIsTrivia || (cuts.empty() && !code.empty()))
+    cuts.push_back(tokens.size() - 1u);
+
+  std::size_t textBegin = 0u, tokenBegin = 0u;
+  for (std::size_t c = 0u; c < cuts.size(); ++c) {
+    const auto isLast = c + 1u == cuts.size();
+    const auto tokenEnd = isLast ? tokens.size() : cuts[c];
+    const auto textEnd = isLast ? code.size() : endOf(cuts[c]);
+
+    auto segment = mkuptr<Segment>();
+    segment->Buffer = buffer;
+    segment->Text = code.slice(textBegin, textEnd);
+    for (auto i = tokenBegin; i < tokenEnd; ++i)
+      segment->Tokens.push_back(std::move(tokens[i]));
+    if (!isLast)
+      segment->Tokens.push_back(mkuptr<Token>(
+          SMLoc::getFromPointer(code.data() + textEnd),
+          segment->Tokens.size(), Tok_eof, ""));
+    result.push_back(std::move(segment));
+    textBegin = textEnd;
+    tokenBegin = tokenEnd;
+  }
+
+  // Lexer diagnostics go to the segment they point into.
+  for (auto &[pointer, message] : diagnostics.Entries) {
+    const auto offset = static_cast<std::size_t>(pointer - code.data());
+    auto it = std::upper_bound(
+        result.begin(), result.end(), offset,
+        [&](const std::size_t value, const uptr<Segment> &segment) {
+          return value < static_cast<std::size_t>(segment->Text.end() -
+                                                  code.data());
+        });
+    if (it == result.end())
+      --it;
+    const auto begin = (*it)->Text.data() - code.data();
+    (*it)->Diagnostics.push_back({offset - begin, std::move(message)});
+    (*it)->Errors++;
+  }
+
+  for (auto &segment : result) {
+    if (segment->Errors || segment->Tokens.size() < 2u)
+      continue;
+    diagnostics.Entries.clear();
+    Parser parser(segment->Tokens, srcMgr);
+    segment->Statements = parser.Parse();
+    segment->Errors = parser.getError();
+    const auto begin = segment->Text.data();
+    for (auto &[pointer, message] : diagnostics.Entries)
+      segment->Diagnostics.push_back(
+          {static_cast<std::size_t>(pointer - begin), std::move(message)});
+  }
+  return true;
+}
+
+EditStats IncrementalDocument::edit(const TextEdit &edit) {
+  const auto offset = std::min(edit.Offset, size());
+  const auto removed = std::min(edit.Removed, size() - offset);
+
+  const auto first = findSegment(offset);
+  auto last = findSegment(removed ? offset + removed - 1u : offset);
+  const auto regionBegin = getStart(first);
+
+  EditStats stats;
+  std::vector<uptr<Segment>> parsed;
+  std::size_t oldSize = 0u, newSize = 0u;
+  for (std::size_t extra = 1u;; extra *= 2u) {
+    oldSize = getStart(last + 1u) - regionBegin;
+    std::string text;
+    text.reserve(oldSize + edit.Inserted.size());
+    for (auto i = first; i <= last; ++i)
+      text += segments[i]->Text;
+    text.replace(offset - regionBegin, removed, edit.Inserted.str());
+
+    stats.RelexedBytes += text.size();
+    newSize = text.size();
+    const auto atEnd = last + 1u == segments.size();
+    if (parseRegion(text, atEnd, parsed))
+      break;
+    // Not at a boundary: take in more of what follows, doubling each time.
+    last = std::min(last + extra, segments.size() - 1u);
+  }
+
+  for (auto i = first; i <= last; ++i)
+    errors -= segments[i]->Errors;
+  for (const auto &segment : parsed)
+    errors += segment->Errors;
+  stats.ReparsedSegments = parsed.size();
+
+  // Offsets up to the region are exact from here on; the ones after it
+  // move with the pending shift.
+  moveShift(last + 1u);
+  const auto replaced = last + 1u - first;
+  if (parsed.size() == replaced) {
+    // The common case: no declaration was added or removed.
+    for (std::size_t i = 0u; i < replaced; ++i)
+      segments[first + i] = std::move(parsed[i]);
+  } else {
+    segments.erase(segments.begin() + first, segments.begin() + last + 1u);
+    segments.insert(segments.begin() + first,
+                    std::make_move_iterator(parsed.begin()),
+                    std::make_move_iterator(parsed.end()));
+    if (parsed.empty())
+      starts.erase(starts.begin() + first, starts.begin() + last + 1u);
+    else
+      starts.erase(starts.begin() + first + 1u, starts.begin() + last + 1u);
+    if (!parsed.empty())
+      starts.insert(starts.begin() + first + 1u, parsed.size() - 1u, 0u);
+  }
+  for (std::size_t i = 1u; i < parsed.size(); ++i)
+    starts[first + i] =
+        starts[first + i - 1u] + segments[first + i - 1u]->Text.size();
+  shiftFrom = first + parsed.size();
+  shift += newSize - oldSize;
+
+  if (segments.empty()) {
+    segments.push_back(mkuptr<Segment>());
+    starts.assign(2u, 0u);
+    shiftFrom = shift = 0u;
+  }
+  stats.ReusedSegments = segments.size() - parsed.size();
+  return stats;
+}
+
+void IncrementalDocument::moveShift(const std::size_t index) {
+  for (auto i = shiftFrom; i < index; ++i)
+    starts[i] += shift;
+  for (auto i = index; i < shiftFrom; ++i)
+    starts[i] -= shift;
+  shiftFrom = index;
+}
+
+std::size_t IncrementalDocument::size() const {
+  return getStart(segments.size());
+}
+
+std::string IncrementalDocument::getText() const {
+  std::string text;
+  text.reserve(size());
+  for (const auto &segment : segments)
+    text += segment->Text;
+  return text;
+}
+
+void IncrementalDocument::getStatements(
+    SmallVectorImpl<const Stmt *> &statements) const {
+  for (const auto &segment : segments)
+    for (const auto &stmt : segment->Statements)
+      if (stmt)
+        statements.push_back(stmt.get());
+}
+
+std::vector<IncrementalDiagnostic>
+IncrementalDocument::getDiagnostics() const {
+  std::vector<IncrementalDiagnostic> result;
+  for (std::size_t i = 0u; i < segments.size(); ++i)
+    for (const auto &diag : segments[i]->Diagnostics)
+      result.push_back({getStart(i) + diag.Offset, diag.Message});
+  return result;
+}
+
+std::size_t IncrementalDocument::getOffset(const SMLoc loc) const {
+  const auto *pointer = loc.getPointer();
+  for (std::size_t i = 0u; i < segments.size(); ++i) {
+    const auto text = segments[i]->Text;
+    if (pointer >= text.begin() && pointer <= text.end())
+      return getStart(i) + (pointer - text.begin());
+  }
+  return StringRef::npos;
+}
+
+std::size_t IncrementalDocument::findSegment(const std::size_t offset) const {
+  // The last segment starting at or before `offset`.
+  std::size_t low = 0u, high = segments.size();
+  while (high - low > 1u) {
+    const auto middle = low + (high - low) / 2u;
+    if (getStart(middle) <= offset)
+      low = middle;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+} // namespace lox
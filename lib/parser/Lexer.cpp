@@ -1,29 +1,35 @@
 #include "lox/parser/Lexer.hpp"
+#include "utils/Trace.hpp"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSwitch.h"
-#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
 
 namespace lox {
 
 bool Lexer::Lex() {
+  LOX_TRACE1(lex__begin, buffer.size());
   auto tok = addNextToken();
   while (tok.Kind != Tok_eof) {
     tok = addNextToken();
   }
-  if (errorNum)
+  LOX_TRACE3(lex__end, buffer.size(), tokens.size(), getError());
+  if (getError())
     return false;
   return true;
 }
 
-#define RETURN_TOKEN(kind)                                                     \
-  {                                                                            \
-    Token tok{loc, tokens.size(), kind, buffer.slice(curr, cursor)};           \
-    tokens.emplace_back(mkuptr<Token>(tok));                                   \
-    return tok;                                                                \
-  }
+uptr<Token> Lexer::next() { return mkuptr<Token>(lexToken()); }
+
 Token Lexer::addNextToken() {
+  auto tok = lexToken();
+  tokens.emplace_back(mkuptr<Token>(tok));
+  return tok;
+}
+
+#define RETURN_TOKEN(kind)                                                     \
+  return Token{loc, tokenIndex++, kind, buffer.slice(curr, cursor)}
+Token Lexer::lexToken() {
 lex:
   eatWhitespace();
   auto ch = peekChar();
@@ -42,6 +48,15 @@ lex:
   case '}':
     skip();
     RETURN_TOKEN(Tok_rbrace);
+  case '[':
+    skip();
+    RETURN_TOKEN(Tok_lbracket);
+  case ']':
+    skip();
+    RETURN_TOKEN(Tok_rbracket);
+  case ':':
+    skip();
+    RETURN_TOKEN(Tok_colon);
   case ',':
     skip();
     RETURN_TOKEN(Tok_comma);
@@ -101,9 +116,7 @@ lex:
     } else
       RETURN_TOKEN(Tok_lt);
   case CharEof: {
-    Token tok{loc, tokens.size(), Tok_eof, ""};
-    tokens.emplace_back(mkuptr<Token>(tok));
-    return tok;
+    return Token{loc, tokenIndex++, Tok_eof, ""};
   }
   case '"': {
     skip();
@@ -114,14 +127,12 @@ lex:
       ch = peekChar();
     }
     if (ch == CharEof) {
-      report(loc, SourceMgr::DiagKind::DK_Error, "Unclosed string literal");
+      diags.report(Diag_unclosed_string, loc);
       RETURN_TOKEN(Tok_error);
     }
     auto end = cursor;
     skip();
-    Token tok{loc, tokens.size(), Tok_string, buffer.slice(start, end)};
-    tokens.emplace_back(mkuptr<Token>(tok));
-    return tok;
+    return Token{loc, tokenIndex++, Tok_string, buffer.slice(start, end)};
   }
   default:
     if (isNumber(ch)) {
@@ -147,10 +158,7 @@ lex:
           skip();
           ch = peekChar();
         }
-        report(
-            loc, SourceMgr::DK_Error,
-            llvm::formatv("Unhandled Token : {0}", buffer.slice(curr, cursor))
-                .str());
+        diags.report(Diag_unhandled_token, loc, buffer.slice(curr, cursor));
         RETURN_TOKEN(Tok_error);
       }
 
@@ -169,9 +177,7 @@ lex:
 #include "lox/parser/Token.def"
 
                       .Default(Tok_identifier);
-      Token tok{loc, tokens.size(), kind, symbol};
-      tokens.emplace_back(mkuptr<Token>(tok));
-      return tok;
+      return Token{loc, tokenIndex++, kind, symbol};
     }
     skip();
     ch = peekChar();
@@ -179,9 +185,7 @@ lex:
       skip();
       ch = peekChar();
     }
-    report(loc, SourceMgr::DK_Error,
-           llvm::formatv("Unhandled Token : {0}", buffer.slice(curr, cursor))
-               .str());
+    diags.report(Diag_unhandled_token, loc, buffer.slice(curr, cursor));
     RETURN_TOKEN(Tok_error);
   }
 }
@@ -228,11 +232,4 @@ bool Lexer::isWhitespace(const char ch) {
   return (ch == '\n' || ch == ' ' || ch == '\r' || ch == '\t' || ch == '\f');
 }
 
-void Lexer::report(const SMLoc loc, const SourceMgr::DiagKind kind,
-                   const StringRef msg, raw_ostream &os) {
-  SrcMgr.PrintMessage(os, loc, kind, msg);
-  if (kind == SourceMgr::DiagKind::DK_Error)
-    errorNum++;
-}
-
 } // namespace lox
\ No newline at end of file
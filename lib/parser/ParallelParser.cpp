@@ -0,0 +1,165 @@
+#include "lox/parser/ParallelParser.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/ThreadPool.h"
+
+namespace lox {
+
+namespace {
+
+struct ParsedChunk {
+  StringRef Text;
+  SmallVector<uptr<Token>> Tokens;
+  Program Statements;
+  std::string LexDiagnostics;
+  std::string ParseDiagnostics;
+  std::size_t LexErrors = 0u;
+  std::size_t ParseErrors = 0u;
+
+  /// The chunk ended in the state a statement boundary would leave the
+  /// sequential lexer and parser in.
+  [[nodiscard]] bool endsAtBoundary() const {
+    // The last token is always eof.
+    if (Tokens.size() < 2u)
+      return Tokens.size() == 1u;
+    return Tokens[Tokens.size() - 2u]->Kind == Tok_semicolon;
+  }
+};
+
+ParsedChunk parseChunk(SourceMgr &srcMgr, const StringRef text) {
+  ParsedChunk chunk;
+  chunk.Text = text;
+
+  raw_string_ostream lexOS(chunk.LexDiagnostics);
+  Lexer lexer(srcMgr, text);
+  lexer.setDiagnosticStream(lexOS);
+  lexer.Lex();
+  chunk.LexErrors = lexer.getError();
+
+  chunk.Tokens = lexer.takeTokens();
+
+  raw_string_ostream parseOS(chunk.ParseDiagnostics);
+  Parser parser(chunk.Tokens, srcMgr);
+  parser.setDiagnosticStream(parseOS);
+  chunk.Statements = parser.Parse();
+  chunk.ParseErrors = parser.getError();
+  return chunk;
+}
+
+/// Speculatively find a line break at or after `from` whose line ends in a
+/// `;`. The scan doesn't know whether it is inside a string or a comment;
+/// that is checked after lexing.
+std::size_t findBoundary(const StringRef code, std::size_t from) {
+  while (from < code.size()) {
+    const auto newline = code.find('\n', from);
+    if (newline == StringRef::npos)
+      return code.size();
+
+    auto last = newline;
+    while (last > 0u && (code[last - 1u] == ' ' || code[last - 1u] == '\t' ||
+                         code[last - 1u] == '\r'))
+      --last;
+    if (last > 0u && code[last - 1u] == ';')
+      return newline + 1u;
+    from = newline + 1u;
+  }
+  return code.size();
+}
+
+SmallVector<StringRef> splitChunks(const StringRef code,
+                                   const std::size_t chunks) {
+  SmallVector<StringRef> result;
+  std::size_t begin = 0u;
+  for (std::size_t i = 1u; i < chunks && begin < code.size(); ++i) {
+    const auto target = std::max(begin, code.size() * i / chunks);
+    const auto end = findBoundary(code, target);
+    if (end >= code.size())
+      break;
+    result.push_back(code.slice(begin, end));
+    begin = end;
+  }
+  result.push_back(code.drop_front(begin));
+  return result;
+}
+
+} // namespace
+
+ParsedSource parseParallel(SourceMgr &srcMgr, const StringRef code,
+                           const ParallelParseOptions &options,
+                           raw_ostream &diagOS) {
+  // SourceMgr builds the line table of a buffer on the first diagnostic, and
+  // not thread-safely; build it now so that the workers only read it.
+  if (!code.empty())
+    srcMgr.FindLineNumber(SMLoc::getFromPointer(code.data()));
+
+  const auto strategy = hardware_concurrency(options.Threads);
+  const auto threads = strategy.compute_thread_count();
+  const auto chunkCount = std::max<std::size_t>(
+      1u, std::min<std::size_t>(threads * 4u,
+                                code.size() / std::max<std::size_t>(
+                                                  options.MinChunkSize, 1u)));
+  const auto texts = splitChunks(code, chunkCount);
+
+  SmallVector<ParsedChunk, 0> chunks;
+  chunks.resize(texts.size());
+  {
+    ThreadPool pool(strategy);
+    for (std::size_t i = 0u; i < texts.size(); ++i)
+      pool.async([&, i] { chunks[i] = parseChunk(srcMgr, texts[i]); });
+    pool.wait();
+  }
+
+  ParsedSource result;
+  result.Chunks = chunks.size();
+
+  // Merge every chunk that didn't end at a statement boundary with its
+  // successor, serially, until it does.
+  SmallVector<ParsedChunk, 0> valid;
+  for (std::size_t i = 0u; i < chunks.size(); ++i) {
+    auto chunk = std::move(chunks[i]);
+    while (i + 1u < chunks.size() && !chunk.endsAtBoundary()) {
+      ++i;
+      result.Misspeculations++;
+      const auto begin = chunk.Text.data();
+      const auto end = chunks[i].Text.end();
+      chunk = parseChunk(srcMgr, StringRef(begin, end - begin));
+    }
+    valid.emplace_back(std::move(chunk));
+  }
+
+  std::size_t tokenCount = 0u, statementCount = 0u;
+  for (const auto &chunk : valid) {
+    tokenCount += chunk.Tokens.size();
+    statementCount += chunk.Statements.size();
+  }
+  result.Tokens.reserve(tokenCount);
+  result.Statements.reserve(statementCount);
+
+  // Stitch: drop the eof of every chunk but the last and renumber.
+  for (std::size_t i = 0u; i < valid.size(); ++i) {
+    auto &chunk = valid[i];
+    const auto isLast = i + 1u == valid.size();
+    for (auto &tok : chunk.Tokens) {
+      if (!isLast && tok->Kind == Tok_eof)
+        continue;
+      tok->Index = result.Tokens.size();
+      result.Tokens.emplace_back(std::move(tok));
+    }
+    diagOS << chunk.LexDiagnostics;
+    result.LexErrors += chunk.LexErrors;
+  }
+
+  // The batch pipeline doesn't parse a script that failed to lex.
+  if (result.LexErrors)
+    return result;
+
+  for (auto &chunk : valid) {
+    diagOS << chunk.ParseDiagnostics;
+    result.ParseErrors += chunk.ParseErrors;
+    for (auto &stmt : chunk.Statements)
+      result.Statements.emplace_back(std::move(stmt));
+  }
+  return result;
+}
+
+} // namespace lox
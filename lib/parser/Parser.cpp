@@ -1,14 +1,52 @@
 #include "lox/parser/Parser.hpp"
-#include "llvm/Support/FormatVariadic.h"
+#include "utils/Trace.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
 
 namespace lox {
 
+namespace {
+
+/// Mark `m = set(m, ...)` and `m = delete(m, ...)`: the old map isn't read
+/// through `m` after the call.
+void markUpdate(CallE &callE, Token *symbol) {
+  if (callE.getBuiltin() != Builtin_set &&
+      callE.getBuiltin() != Builtin_delete)
+    return;
+  const auto *varE = std::get_if<VarE>(callE.getArgs().front().get());
+  if (varE && varE->getSymbol()->Symbol == symbol->Symbol)
+    callE.setUpdated(symbol);
+}
+
+} // namespace
+
 Program Parser::Parse() {
+  LOX_TRACE1(parse__begin, tokens.size());
   Program program;
   while (!isAtEnd())
     program.emplace_back(Declaration());
+  LOX_TRACE2(parse__end, program.size(), getError());
   return program;
 }
+SmallVector<uptr<Token>> Parser::ReleaseTokens() {
+  assert(source && "only a streaming parser owns its tokens");
+  const auto consumed = std::min(cursor - windowBase, window.size());
+  SmallVector<uptr<Token>> released(
+      std::make_move_iterator(window.begin()),
+      std::make_move_iterator(window.begin() + consumed));
+  window.erase(window.begin(), window.begin() + consumed);
+  windowBase += consumed;
+  return released;
+}
+
+Token *Parser::fetch(const std::size_t index) const {
+  assert(index >= windowBase && "token was already released");
+  while (windowBase + window.size() <= index)
+    window.emplace_back(source->next());
+  return window[index - windowBase].get();
+}
+
 uptr<Stmt> Parser::Declaration() {
   uptr<Stmt> stmt;
   if (match(Tok_var))
@@ -24,10 +62,8 @@ uptr<Stmt> Parser::Declaration() {
 uptr<Stmt> Parser::varDeclaration() {
   const auto loc = previous()->Loc;
   if (peek()->Kind != (Tok_identifier)) {
-    report(peek()->Loc, SourceMgr::DK_Error,
-           formatv("Unexpected token. expected {0}, got {1}",
-                   getTokenName(Tok_identifier), getTokenName(peek()->Kind))
-               .str());
+    diags.report(Diag_unexpected_token, peek()->Loc,
+                 {getTokenName(Tok_identifier), getTokenName(peek()->Kind)});
     return nullptr;
   }
   auto *tok = advance();
@@ -37,10 +73,8 @@ uptr<Stmt> Parser::varDeclaration() {
     expr = Expression();
 
   if (!match(Tok_semicolon)) {
-    report(peek()->Loc, SourceMgr::DK_Error,
-           formatv("Unexpected token. expected {0}, got {1}",
-                   getTokenName(Tok_semicolon), getTokenName(peek()->Kind))
-               .str());
+    diags.report(Diag_unexpected_token, peek()->Loc,
+                 {getTokenName(Tok_semicolon), getTokenName(peek()->Kind)});
     return nullptr;
   }
   return mkuptr<Stmt>(VarStmt(loc, tok, std::move(expr)));
@@ -52,15 +86,13 @@ uptr<Stmt> Parser::statement() {
   return exprStmt();
 }
 
-uptr<Expr> Parser::Expression() { return assignment(); }
-
 uptr<Stmt> Parser::exprStmt() {
   auto expr = Expression();
   if (!expr)
     return nullptr;
   const auto loc = getLoc(*expr);
   if (!match(Tok_semicolon))
-    report(loc, SourceMgr::DK_Error, "Expect `;` after value.");
+    diags.report(Diag_expect_semicolon, loc);
   return mkuptr<Stmt>(ExprStmt(loc, std::move(expr)));
 }
 
@@ -70,130 +102,236 @@ uptr<Stmt> Parser::printStmt() {
     return nullptr;
   const auto loc = getLoc(*expr);
   if (!match(Tok_semicolon))
-    report(loc, SourceMgr::DK_Error, "Expect `;` after value.");
+    diags.report(Diag_expect_semicolon, loc);
   return mkuptr<Stmt>(PrintStmt(loc, std::move(expr)));
 }
 
-uptr<Expr> Parser::assignment() {
-  auto expr = equality();
-  if (!expr)
-    return nullptr;
+uptr<Expr> Parser::Expression() {
+  unsigned height;
+  return expression(Precedence::Assignment, height);
+}
 
-  if (match(Tok_equal)) {
-    const auto *equal = previous();
-    auto valueE = assignment();
-    if (!valueE)
-      return nullptr;
+Parser::Precedence Parser::getPrecedence(const TokenKind kind) {
+  static constexpr auto Table = [] {
+    std::array<Precedence, TokenCount> table{};
+    table[Tok_equal] = Precedence::Assignment;
+    table[Tok_bang_equal] = table[Tok_equal_equal] = Precedence::Equality;
+    table[Tok_gt] = table[Tok_ge] = table[Tok_lt] = table[Tok_le] =
+        Precedence::Comparison;
+    table[Tok_minus] = table[Tok_plus] = Precedence::Term;
+    table[Tok_star] = table[Tok_slash] = Precedence::Factor;
+    return table;
+  }();
+  return Table[kind];
+}
 
-    if (auto *varE = std::get_if<VarE>(expr.get())) {
-      const auto symbol = varE->getSymbol();
-      return mkuptr<Expr>(AssignE(equal->Loc, symbol, std::move(valueE)));
-    }
+bool Parser::enter() {
+  if (depth >= maxDepth) {
+    reportTooDeep(peek()->Loc);
+    return false;
   }
-  return expr;
+  ++depth;
+  return true;
 }
 
-uptr<Expr> Parser::equality() {
-  auto expr = comparison();
-  if (!expr)
+void Parser::reportTooDeep(const SMLoc loc) {
+  const auto limit = std::to_string(maxDepth);
+  diags.report(Diag_nested_too_deeply, loc, StringRef(limit));
+}
+
+uptr<Expr> Parser::expression(const Precedence min, unsigned &height) {
+  if (!enter())
     return nullptr;
+  auto expr = unary(height);
+  while (expr) {
+    const auto precedence = getPrecedence(peek()->Kind);
+    if (precedence == Precedence::None || precedence < min)
+      break;
+    auto *opKind = advance();
+    unsigned rhsHeight;
+
+    if (precedence == Precedence::Assignment) {
+      // Right-associative: the value takes every following operator.
+      auto valueE = expression(Precedence::Assignment, rhsHeight);
+      if (!valueE)
+        expr = nullptr;
+      else if (auto *varE = std::get_if<VarE>(expr.get())) {
+        const auto symbol = varE->getSymbol();
+        if (auto *callE = std::get_if<CallE>(valueE.get()))
+          markUpdate(*callE, symbol);
+        expr = mkuptr<Expr>(AssignE(opKind->Loc, symbol, std::move(valueE)));
+        height = rhsHeight + 1u;
+      } else if (std::holds_alternative<IndexE>(*expr)) {
+        diags.report(Diag_assign_to_element, opKind->Loc);
+        expr = nullptr;
+      }
+      break;
+    }
 
-  while (match(Tok_bang_equal, Tok_equal_equal)) {
-    const auto opKind = previous();
-    auto right = comparison();
-    if (!right)
-      return nullptr;
+    // Left-associative: the right operand stops at an operator of the same
+    // precedence, which then takes the whole expression as its left operand.
+    auto right = expression(static_cast<Precedence>(
+                                static_cast<unsigned>(precedence) + 1u),
+                            rhsHeight);
+    if (!right) {
+      expr = nullptr;
+      break;
+    }
+    // A long chain is built without nesting the parser, but every later
+    // pass over the tree recurses through it.
+    height = std::max(height, rhsHeight) + 1u;
+    if (height > maxDepth) {
+      reportTooDeep(opKind->Loc);
+      expr = nullptr;
+      break;
+    }
     expr = mkuptr<Expr>(
         BinaryE(opKind->Loc, std::move(expr), std::move(right), opKind));
   }
-
+  leave();
   return expr;
 }
 
-uptr<Expr> Parser::comparison() {
-  auto expr = term();
+uptr<Expr> Parser::unary(unsigned &height) {
+  if (!match(Tok_bang, Tok_minus))
+    return postfix(height);
+  const auto opKind = previous();
+  auto expr = expression(Precedence::Unary, height);
   if (!expr)
     return nullptr;
+  ++height;
+  return mkuptr<Expr>(UnaryE(opKind->Loc, std::move(expr), opKind));
+}
 
-  while (match(Tok_gt, Tok_ge, Tok_lt, Tok_le)) {
-    const auto opKind = previous();
-    auto right = term();
-    if (!right)
+uptr<Expr> Parser::postfix(unsigned &height) {
+  auto expr = primary(height);
+  while (expr && match(Tok_lbracket)) {
+    const auto loc = previous()->Loc;
+    unsigned indexHeight;
+    auto index = expression(Precedence::Assignment, indexHeight);
+    if (!index || !expect(Tok_rbracket))
       return nullptr;
-    expr = mkuptr<Expr>(
-        BinaryE(opKind->Loc, std::move(expr), std::move(right), opKind));
+    // Like a chain of binary operators, a chain of subscripts doesn't nest
+    // the parser.
+    height = std::max(height, indexHeight) + 1u;
+    if (height > maxDepth) {
+      reportTooDeep(loc);
+      return nullptr;
+    }
+    expr = mkuptr<Expr>(IndexE(loc, std::move(expr), std::move(index)));
   }
-
   return expr;
 }
 
-uptr<Expr> Parser::term() {
-  auto expr = factor();
-  if (!expr)
-    return nullptr;
+bool Parser::arguments(const TokenKind close,
+                       SmallVectorImpl<uptr<Expr>> &args, unsigned &height) {
+  height = 1u;
+  if (match(close))
+    return true;
+  do {
+    unsigned argHeight;
+    auto arg = expression(Precedence::Assignment, argHeight);
+    if (!arg)
+      return false;
+    height = std::max(height, argHeight + 1u);
+    args.push_back(std::move(arg));
+  } while (match(Tok_comma));
+  return expect(close);
+}
 
-  while (match(Tok_minus, Tok_plus)) {
-    const auto opKind = previous();
-    auto right = factor();
-    if (!right)
-      return nullptr;
-    expr = mkuptr<Expr>(
-        BinaryE(opKind->Loc, std::move(expr), std::move(right), opKind));
-  }
+bool Parser::entries(SmallVectorImpl<uptr<Expr>> &operands,
+                     unsigned &height) {
+  height = 1u;
+  if (match(Tok_rbrace))
+    return true;
+  do {
+    unsigned keyHeight, valueHeight;
+    auto key = expression(Precedence::Assignment, keyHeight);
+    if (!key || !expect(Tok_colon))
+      return false;
+    auto value = expression(Precedence::Assignment, valueHeight);
+    if (!value)
+      return false;
+    height = std::max({height, keyHeight + 1u, valueHeight + 1u});
+    operands.push_back(std::move(key));
+    operands.push_back(std::move(value));
+  } while (match(Tok_comma));
+  return expect(Tok_rbrace);
+}
 
-  return expr;
+bool Parser::expect(const TokenKind kind) {
+  if (match(kind))
+    return true;
+  diags.report(Diag_unexpected_token, peek()->Loc,
+               {getTokenName(kind), getTokenName(peek()->Kind)});
+  return false;
 }
 
-uptr<Expr> Parser::factor() {
-  auto expr = unary();
-  if (!expr)
-    return nullptr;
+uptr<Expr> Parser::primary(unsigned &height) {
+  height = 1u;
+  if (match(Tok_true, Tok_false, Tok_nil, Tok_number, Tok_string))
+    return mkuptr<Expr>(LiteralE(previous()->Loc, previous()));
+  if (match(Tok_identifier)) {
+    auto *symbol = previous();
+    if (!match(Tok_lparen))
+      return mkuptr<Expr>(VarE(symbol->Loc, symbol));
+    return call(symbol, height);
+  }
 
-  while (match(Tok_star, Tok_slash)) {
-    auto opKind = previous();
-    auto right = unary();
-    if (!right)
+  if (match(Tok_lbracket)) {
+    const auto loc = previous()->Loc;
+    SmallVector<uptr<Expr>, 4> elements;
+    if (!arguments(Tok_rbracket, elements, height))
       return nullptr;
-    expr = mkuptr<Expr>(
-        BinaryE(opKind->Loc, std::move(expr), std::move(right), opKind));
+    return mkuptr<Expr>(ArrayE(loc, std::move(elements)));
   }
 
-  return expr;
-}
-
-uptr<Expr> Parser::unary() {
-  if (match(Tok_bang, Tok_minus)) {
-    const auto opKind = previous();
-    auto expr = unary();
-    if (!expr)
+  if (match(Tok_lbrace)) {
+    const auto loc = previous()->Loc;
+    SmallVector<uptr<Expr>, 4> operands;
+    if (!entries(operands, height))
       return nullptr;
-    return mkuptr<Expr>(UnaryE(opKind->Loc, std::move(expr), opKind));
+    return mkuptr<Expr>(MapE(loc, std::move(operands)));
   }
 
-  return primary();
-}
-
-uptr<Expr> Parser::primary() {
-  if (match(Tok_true, Tok_false, Tok_nil, Tok_number, Tok_string))
-    return mkuptr<Expr>(LiteralE(previous()->Loc, previous()));
-  if (match(Tok_identifier))
-    return mkuptr<Expr>(VarE(previous()->Loc, previous()));
-
   if (match(Tok_lparen)) {
     auto loc = previous()->Loc;
-    auto expr = Expression();
+    auto expr = expression(Precedence::Assignment, height);
+    if (!expr)
+      return nullptr;
     if (!match(Tok_rparen)) {
-      report(peek()->Loc, SourceMgr::DK_Error,
-             llvm::formatv("unexpected token. expected : {0} got : {1}",
-                           getTokenName(Tok_rparen), getTokenName(peek()->Kind))
-                 .str());
+      diags.report(Diag_expect_rparen, peek()->Loc,
+                   {getTokenName(Tok_rparen), getTokenName(peek()->Kind)});
       return nullptr;
     }
+    ++height;
     return mkuptr<Expr>(GroupingE(loc, std::move(expr)));
   }
+  diags.report(Diag_expect_expression, peek()->Loc,
+               StringRef(getTokenName(peek()->Kind)));
   return nullptr;
 }
 
+uptr<Expr> Parser::call(Token *callee, unsigned &height) {
+  SmallVector<uptr<Expr>, 4> args;
+  if (!arguments(Tok_rparen, args, height))
+    return nullptr;
+  const auto builtin = lookupBuiltin(callee->Symbol);
+  if (!builtin) {
+    diags.report(Diag_undefined_function, callee->Loc, callee->Symbol);
+    return nullptr;
+  }
+  if (const auto arity = getBuiltinArity(*builtin); args.size() != arity) {
+    const auto expected = std::to_string(arity);
+    const auto got = std::to_string(args.size());
+    diags.report(Diag_wrong_argument_count, callee->Loc,
+                 {callee->Symbol, expected, got});
+    return nullptr;
+  }
+  return mkuptr<Expr>(
+      CallE(callee->Loc, callee, *builtin, std::move(args)));
+}
+
 void Parser::synchronize() {
   advance();
 
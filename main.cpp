@@ -1,7 +1,202 @@
-#include <iostream>
+#include "lox/driver/Driver.hpp"
+#include "llvm/Support/CommandLine.h"
 
-int main()
-{
-    std::cout << "Hello, World!" << std::endl;
-    return 0;
+using namespace llvm;
+
+static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<script>"),
+                                      cl::init("-"));
+
+static cl::OptionCategory ProfileCategory("Profiling options");
+
+static cl::opt<bool> Profile("profile",
+                             cl::desc("Sample the script and report hot lines"),
+                             cl::cat(ProfileCategory));
+
+static cl::opt<std::string>
+    ProfileOutput("profile-output",
+                  cl::desc("Folded stack output file ('-' for stdout)"),
+                  cl::value_desc("file"), cl::init("lox.folded"),
+                  cl::cat(ProfileCategory));
+
+static cl::opt<unsigned>
+    ProfileFrequency("profile-frequency",
+                     cl::desc("Samples per second of CPU time"),
+                     cl::init(997u), cl::cat(ProfileCategory));
+
+static cl::opt<unsigned>
+    ProfileTop("profile-top", cl::desc("Number of lines in the hot list"),
+               cl::init(20u), cl::cat(ProfileCategory));
+
+static cl::opt<bool>
+    CountWork("count-work",
+              cl::desc("Print the abstract work counters after the run"));
+
+static cl::opt<bool>
+    Stream("stream", cl::desc("Execute each statement as soon as it is parsed, "
+                              "keeping memory constant in script length"));
+
+static cl::opt<bool>
+    Pipeline("pipeline",
+             cl::desc("Like --stream, with the lexer and the parser running "
+                      "on their own threads"));
+
+static cl::opt<bool>
+    ParallelParse("parallel-parse",
+                  cl::desc("Lex and parse the script in chunks on a thread "
+                           "pool"));
+
+static cl::opt<unsigned>
+    Threads("jobs", cl::desc("Worker threads (0: one per hardware thread)"),
+            cl::init(0u));
+
+static cl::opt<bool>
+    Batch("batch", cl::desc("The input is a manifest listing scripts, one per "
+                            "line, or a directory of *.lox scripts; process "
+                            "them on a worker pool"));
+
+static cl::opt<bool> SyntaxOnly("syntax-only",
+                                cl::desc("Stop after parsing"));
+
+static cl::opt<bool>
+    AutoParallel("auto-parallel",
+                 cl::desc("Run independent top-level statements in parallel, "
+                          "printing in program order"));
+
+static cl::opt<std::string>
+    CacheDir("cache-dir",
+             cl::desc("Keep compiled images of scripts in this directory and "
+                      "run an unchanged script from its image"),
+             cl::value_desc("dir"));
+
+static cl::opt<bool>
+    CacheResults("cache-results",
+                 cl::desc("Answer a script run before, modulo whitespace and "
+                          "comments, with its recorded output (with --serve, "
+                          "or across runs with --result-cache-dir)"));
+
+static cl::opt<std::string>
+    ResultCacheDir("result-cache-dir",
+                   cl::desc("Keep the results of --cache-results in this "
+                            "directory"),
+                   cl::value_desc("dir"));
+
+static cl::opt<unsigned>
+    ResultCacheSize("result-cache-size",
+                    cl::desc("Megabytes of results kept by --cache-results"),
+                    cl::init(64u));
+
+static cl::opt<lox::NumberFormat> Format(
+    "number-format", cl::desc("How print formats numbers"),
+    cl::values(clEnumValN(lox::NumberFormat::Fixed, "fixed",
+                          "Six decimals, like printf(\"%Lf\")"),
+               clEnumValN(lox::NumberFormat::Shortest, "shortest",
+                          "The shortest text that reads back the same")),
+    cl::init(lox::NumberFormat::Fixed));
+
+static cl::opt<unsigned>
+    OutputBuffer("output-buffer",
+                 cl::desc("Kilobytes of stdout buffered when it isn't a "
+                          "terminal (0: the default)"),
+                 cl::init(64u));
+
+static cl::opt<lox::DiagnosticFormat> DiagFormat(
+    "diagnostics-format", cl::desc("How errors are printed"),
+    cl::values(clEnumValN(lox::DiagnosticFormat::Text, "text",
+                          "As they are reported, with the source line"),
+               clEnumValN(lox::DiagnosticFormat::JSON, "json",
+                          "One JSON object on stderr after the run")),
+    cl::init(lox::DiagnosticFormat::Text));
+
+static cl::opt<unsigned>
+    DiagnosticLimit("diagnostic-limit",
+                    cl::desc("Errors printed per category: lexer, parser "
+                             "and runtime (0: no limit)"),
+                    cl::init(100u));
+
+static cl::opt<std::string>
+    Prelude("prelude", cl::desc("Run this script first, in the same globals"),
+            cl::value_desc("script"));
+
+static cl::opt<std::string>
+    Snapshot("snapshot",
+             cl::desc("Restore the globals of --prelude from this file, or "
+                      "save them to it when it is missing or out of date"),
+             cl::value_desc("file"));
+
+static cl::OptionCategory ServerCategory("Server options");
+
+static cl::opt<std::string>
+    Serve("serve",
+          cl::desc("Run scripts submitted on this Unix domain socket until "
+                   "interrupted"),
+          cl::value_desc("socket"), cl::cat(ServerCategory));
+
+static cl::opt<std::string>
+    Connect("connect",
+            cl::desc("Run the script on the server listening on this socket"),
+            cl::value_desc("socket"), cl::cat(ServerCategory));
+
+static cl::opt<bool>
+    LoadTest("load-test",
+             cl::desc("With --connect, submit the script --requests times "
+                      "and report requests/sec and latency percentiles"),
+             cl::cat(ServerCategory));
+
+static cl::opt<unsigned> Requests("requests",
+                                  cl::desc("Requests sent by --load-test"),
+                                  cl::init(1000u), cl::cat(ServerCategory));
+
+static cl::opt<unsigned>
+    Concurrency("concurrency",
+                cl::desc("Clients of --load-test submitting at once"),
+                cl::init(8u), cl::cat(ServerCategory));
+
+static cl::opt<unsigned>
+    Timeout("timeout",
+            cl::desc("Per-request timeout in milliseconds (0: none)"),
+            cl::init(0u), cl::cat(ServerCategory));
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "lox interpreter\n");
+
+  lox::DriverOptions options;
+  options.Profile = Profile;
+  options.ProfileOutput = ProfileOutput;
+  options.ProfileFrequency = ProfileFrequency;
+  options.ProfileTop = ProfileTop;
+  options.CountWork = CountWork;
+  options.Stream = Stream;
+  options.Pipeline = Pipeline;
+  options.ParallelParse = ParallelParse;
+  options.Threads = Threads;
+  options.SyntaxOnly = SyntaxOnly;
+  options.AutoParallel = AutoParallel;
+  options.CacheDir = CacheDir;
+  options.CacheResults = CacheResults;
+  options.ResultCacheDir = ResultCacheDir;
+  options.ResultCacheBytes = static_cast<std::size_t>(ResultCacheSize) << 20u;
+  options.Format = Format;
+  options.OutputBuffer = static_cast<std::size_t>(OutputBuffer) << 10u;
+  options.DiagFormat = DiagFormat;
+  options.DiagnosticLimit = DiagnosticLimit;
+  options.Prelude = Prelude;
+  options.Snapshot = Snapshot;
+  options.Timeout = Timeout;
+
+  if (!Serve.empty())
+    return lox::runServer(Serve, options);
+  if (LoadTest) {
+    if (Connect.empty()) {
+      errs() << "--load-test needs --connect\n";
+      return lox::Exit_usage;
+    }
+    return lox::runLoadTest(InputFile, Connect, Requests, Concurrency,
+                            options);
+  }
+  if (!Connect.empty())
+    return lox::runClient(InputFile, Connect, options);
+
+  if (Batch)
+    return lox::runFiles(InputFile, options);
+  return lox::runFile(InputFile, options);
 }
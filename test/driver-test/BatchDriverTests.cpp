@@ -0,0 +1,84 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "doctest/doctest.h"
+#include "lox/driver/BatchDriver.hpp"
+#include "lox/driver/Driver.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Path.h"
+
+namespace lox {
+
+static std::string writeScript(const StringRef dir, const StringRef name,
+                               const StringRef code) {
+  SmallString<128> path(dir);
+  sys::path::append(path, name);
+  std::error_code ec;
+  raw_fd_ostream os(path, ec);
+  REQUIRE_FALSE(ec);
+  os << code;
+  return path.str().str();
+}
+
+TEST_CASE("Batch driver test" * doctest::test_suite("Driver tests")) {
+  SmallString<128> dir;
+  REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-batch", dir));
+
+  std::string expected;
+  for (auto i = 0u; i < 40u; ++i) {
+    writeScript(dir, formatv("s{0:2}.lox", i).str(),
+                formatv("var a = {0};\nprint a * 2;\n", i).str());
+    expected += formatv("{0:f6}\n", i * 2.0).str();
+  }
+  const auto syntaxError = writeScript(dir, "x1.lox", "print 1 +;\n");
+  const auto runtimeError = writeScript(dir, "x2.lox", "print -\"a\";\n");
+
+  SUBCASE("directory, ordered output") {
+    SmallVector<std::string> files;
+    REQUIRE(collectBatchInputs(dir, files));
+    REQUIRE_EQ(files.size(), 42u);
+
+    BatchOptions options;
+    options.Threads = 4u;
+    std::string output, diag;
+    raw_string_ostream os(output), diagOS(diag);
+    const auto summary = runBatch(files, options, os, diagOS);
+    CHECK_EQ(output, expected);
+    CHECK_EQ(summary.Files, 42u);
+    CHECK_EQ(summary.Failed, 2u);
+    CHECK_EQ(summary.ExitCode, Exit_data);
+    CHECK_LT(diag.find("x1.lox"), diag.find("x2.lox"));
+  }
+
+  SUBCASE("manifest, syntax only") {
+    const auto manifest = writeScript(
+        dir, "manifest.txt", "# checked on deploy\ns00.lox\n\nx2.lox\n");
+    SmallVector<std::string> files;
+    REQUIRE(collectBatchInputs(manifest, files));
+    REQUIRE_EQ(files.size(), 2u);
+    CHECK_EQ(files[1], runtimeError);
+
+    BatchOptions options;
+    options.SyntaxOnly = true;
+    std::string output, diag;
+    raw_string_ostream os(output), diagOS(diag);
+    const auto summary = runBatch(files, options, os, diagOS);
+    CHECK_EQ(output, "");
+    CHECK_EQ(diag, "");
+    CHECK_EQ(summary.Failed, 0u);
+    CHECK_EQ(summary.ExitCode, Exit_success);
+  }
+
+  SUBCASE("missing file") {
+    BatchOptions options;
+    std::string output, diag;
+    raw_string_ostream os(output), diagOS(diag);
+    const std::string files[] = {syntaxError, dir.str().str() + "/none.lox"};
+    const auto summary = runBatch(files, options, os, diagOS);
+    CHECK_EQ(summary.Failed, 2u);
+    CHECK_EQ(summary.ExitCode, Exit_noinput);
+  }
+
+  sys::fs::remove_directories(dir);
+}
+
+} // namespace lox
@@ -0,0 +1,98 @@
+#include "doctest/doctest.h"
+#include "lox/driver/Driver.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include <unistd.h>
+
+namespace lox {
+
+namespace {
+
+struct DriverRun {
+  int ExitCode;
+  std::string Diagnostics;
+};
+
+/// runFile() with stderr written to a file and read back.
+DriverRun runCapturingStderr(const StringRef path, const StringRef dir,
+                             const DriverOptions &options) {
+  SmallString<128> errPath(dir);
+  sys::path::append(errPath, "stderr.txt");
+  int errFD;
+  REQUIRE_FALSE(sys::fs::openFileForWrite(errPath, errFD));
+  errs().flush();
+  const auto saved = ::dup(STDERR_FILENO);
+  ::dup2(errFD, STDERR_FILENO);
+  DriverRun run;
+  run.ExitCode = runFile(path, options);
+  outs().flush();
+  errs().flush();
+  ::dup2(saved, STDERR_FILENO);
+  ::close(saved);
+  ::close(errFD);
+
+  auto bufferOrError = MemoryBuffer::getFile(errPath);
+  REQUIRE(bufferOrError);
+  run.Diagnostics = (*bufferOrError)->getBuffer().str();
+  return run;
+}
+
+std::string writeFile(const StringRef dir, const StringRef name,
+                      const StringRef code) {
+  SmallString<128> path(dir);
+  sys::path::append(path, name);
+  std::error_code ec;
+  raw_fd_ostream os(path, ec);
+  REQUIRE_FALSE(ec);
+  os << code;
+  return path.str().str();
+}
+
+} // namespace
+
+TEST_CASE("Driver prelude diagnostics test" *
+          doctest::test_suite("Driver tests")) {
+  SmallString<128> dir;
+  REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-driver", dir));
+  const auto script = writeFile(dir, "main.lox", "var b = 1;\n");
+
+  DriverOptions options;
+  options.Prelude = writeFile(dir, "pre.lox", "var a = 1 +;\n");
+
+  SUBCASE("json") {
+    options.DiagFormat = DiagnosticFormat::JSON;
+    const auto run = runCapturingStderr(script, dir, options);
+    CHECK_EQ(run.ExitCode, Exit_data);
+    // One document and nothing else, counting the prelude's errors.
+    auto document = json::parse(run.Diagnostics);
+    REQUIRE(static_cast<bool>(document));
+    const auto *object = document->getAsObject();
+    REQUIRE(object);
+    CHECK_EQ(object->getInteger("errors").getValueOr(-1), 1);
+    const auto *diagnostics = object->getArray("diagnostics");
+    REQUIRE(diagnostics);
+    REQUIRE_EQ(diagnostics->size(), 1u);
+    const auto *diag = (*diagnostics)[0].getAsObject();
+    REQUIRE(diag);
+    CHECK(diag->getString("file").getValueOr("").endswith("pre.lox"));
+    CHECK_EQ(diag->getInteger("line").getValueOr(-1), 1);
+  }
+
+  SUBCASE("text is limited like the script's") {
+    options.DiagnosticLimit = 1u;
+    writeFile(dir, "pre.lox", "var a = 1 +;\nvar b = 2 +;\nvar c = 3 +;\n");
+    const auto run = runCapturingStderr(script, dir, options);
+    CHECK_EQ(run.ExitCode, Exit_data);
+    CHECK_NE(run.Diagnostics.find("pre.lox:1:"), std::string::npos);
+    CHECK_EQ(run.Diagnostics.find("pre.lox:2:"), std::string::npos);
+    CHECK_NE(run.Diagnostics.find("2 more parser errors suppressed"),
+             std::string::npos);
+  }
+
+  sys::fs::remove_directories(dir);
+}
+
+} // namespace lox
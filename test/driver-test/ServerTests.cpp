@@ -0,0 +1,265 @@
+#include "doctest/doctest.h"
+#include "lox/driver/Driver.hpp"
+#include "lox/driver/Server.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Path.h"
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace lox {
+
+namespace {
+
+/// A connection to the server at `socket` that sends `bytes` and nothing
+/// else, and reads nothing.
+int connectRaw(const StringRef socket, const StringRef bytes) {
+  const auto fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  REQUIRE(fd >= 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, socket.data(), socket.size());
+  REQUIRE_EQ(
+      ::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)),
+      0);
+  REQUIRE_EQ(::send(fd, bytes.data(), bytes.size(), 0),
+             static_cast<ssize_t>(bytes.size()));
+  return fd;
+}
+
+} // namespace
+
+TEST_CASE("Script server test" * doctest::test_suite("Driver tests")) {
+  SmallString<128> dir;
+  REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-server", dir));
+  SmallString<128> socket(dir);
+  sys::path::append(socket, "lox.sock");
+
+  ServerOptions options;
+  options.Threads = 2u;
+  options.Slice = 1000u;
+  ScriptServer server(options);
+  REQUIRE(server.listen(socket));
+  std::thread serving([&] { server.run(); });
+
+  SUBCASE("output, diagnostics and exit codes") {
+    const auto client = ServerClient::connect(socket);
+    REQUIRE(client);
+
+    std::string output, diag;
+    raw_string_ostream os(output), diagOS(diag);
+    CHECK_EQ(client->submit("a.lox", "var a = 1;\nprint a + 1;\n", 0u, os,
+                            diagOS),
+             Exit_success);
+    CHECK_EQ(output, "2.000000\n");
+    CHECK(diag.empty());
+
+    // Every request starts from fresh globals.
+    output.clear();
+    CHECK_EQ(client->submit("b.lox", "print a;\n", 0u, os, diagOS),
+             Exit_software);
+    CHECK(output.empty());
+    CHECK_NE(diag.find("b.lox:1:7"), std::string::npos);
+
+    diag.clear();
+    CHECK_EQ(client->submit("c.lox", "print 1 +;\n", 0u, os, diagOS),
+             Exit_data);
+    CHECK_NE(diag.find("c.lox"), std::string::npos);
+
+    // The same script again comes from the cache.
+    output.clear();
+    CHECK_EQ(client->submit("a.lox", "var a = 1;\nprint a + 1;\n", 0u, os,
+                            diagOS),
+             Exit_success);
+    CHECK_EQ(output, "2.000000\n");
+    CHECK_EQ(server.getCacheHitCount(), 1u);
+    CHECK_EQ(server.getRequestCount(), 4u);
+  }
+
+  SUBCASE("timeout") {
+    std::string code, expected;
+    for (auto i = 0u; i < 200000u; ++i)
+      code += formatv("print {0};\n", i).str();
+    const auto client = ServerClient::connect(socket);
+    REQUIRE(client);
+
+    std::string output, diag;
+    raw_string_ostream os(output), diagOS(diag);
+    CHECK_EQ(client->submit("slow.lox", code, 1u, os, diagOS), Exit_tempfail);
+    CHECK_NE(diag.find("slow.lox: timed out after 1 ms"), std::string::npos);
+    CHECK_EQ(server.getTimeoutCount(), 1u);
+
+    // The connection and the isolate are usable afterwards.
+    output.clear();
+    CHECK_EQ(client->submit("a.lox", "print 3;\n", 0u, os, diagOS),
+             Exit_success);
+    CHECK_EQ(output, "3.000000\n");
+  }
+
+  SUBCASE("load test") {
+    LoadTestOptions loadOptions;
+    loadOptions.Requests = 50u;
+    loadOptions.Concurrency = 4u;
+    const auto report =
+        runLoadTest(socket, "load.lox", "var x = 2;\nprint x * x;\n",
+                    loadOptions);
+    CHECK_EQ(report.Requests, 50u);
+    CHECK_EQ(report.Failed, 0u);
+    CHECK_LE(report.P50, report.P90);
+    CHECK_LE(report.P99, report.Max);
+    CHECK_EQ(server.getCacheHitCount(), 49u);
+  }
+
+  server.requestStop();
+  serving.join();
+  CHECK_FALSE(sys::fs::exists(socket));
+  CHECK_FALSE(ServerClient::connect(socket, nulls()));
+  sys::fs::remove_directories(dir);
+}
+
+TEST_CASE("Script server result cache test" *
+          doctest::test_suite("Driver tests")) {
+  SmallString<128> dir;
+  REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-server", dir));
+  SmallString<128> socket(dir);
+  sys::path::append(socket, "lox.sock");
+
+  ServerOptions options;
+  options.Threads = 1u;
+  options.CacheResults = true;
+  ScriptServer server(options);
+  REQUIRE(server.listen(socket));
+  std::thread serving([&] { server.run(); });
+
+  const auto client = ServerClient::connect(socket);
+  REQUIRE(client);
+  std::string output, diag;
+  raw_string_ostream os(output), diagOS(diag);
+  const auto submit = [&](const StringRef name, const StringRef code) {
+    output.clear();
+    diag.clear();
+    return client->submit(name, code, 0u, os, diagOS);
+  };
+
+  CHECK_EQ(submit("a.lox", "var a = 1;\nprint a + 1;\n"), Exit_success);
+  CHECK_EQ(submit("b.lox", "// again\nvar a=1; print a+1;"), Exit_success);
+  CHECK_EQ(output, "2.000000\n");
+  // Answered without compiling the script.
+  CHECK_EQ(server.getCacheHitCount(), 0u);
+
+  CHECK_EQ(submit("c.lox", "print 1;\nprint c;\n"), Exit_software);
+  CHECK_EQ(submit("c.lox", "print 1;\nprint c;\n"), Exit_software);
+  CHECK_EQ(output, "1.000000\n");
+  CHECK_NE(diag.find("c.lox:2:7"), std::string::npos);
+  // Diagnostics would quote another location.
+  CHECK_EQ(submit("c.lox", "print 1; print c;\n"), Exit_software);
+  CHECK_NE(diag.find("c.lox:1:16"), std::string::npos);
+
+  CHECK_EQ(submit("d.lox", "print 1 +;\n"), Exit_data);
+  CHECK_EQ(submit("d.lox", "print 1 +;\n"), Exit_data);
+  CHECK_NE(diag.find("d.lox"), std::string::npos);
+
+  const auto stats = server.getResultCacheStats();
+  CHECK_EQ(stats.Hits, 3u);
+  CHECK_EQ(stats.Misses, 4u);
+  CHECK_EQ(server.getRequestCount(), 7u);
+
+  server.requestStop();
+  serving.join();
+  sys::fs::remove_directories(dir);
+}
+
+TEST_CASE("Script server stalled client test" *
+          doctest::test_suite("Driver tests")) {
+  SmallString<128> dir;
+  REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-server", dir));
+  SmallString<128> socket(dir);
+  sys::path::append(socket, "lox.sock");
+
+  ServerOptions options;
+  options.Threads = 1u;
+  options.ReadTimeout = 100u;
+  ScriptServer server(options);
+  REQUIRE(server.listen(socket));
+  std::thread serving([&] { server.run(); });
+
+  // Clients that send the header of a request and half of its payload,
+  // then nothing.
+  const char partial[] = {'R', 100, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0};
+  const StringRef bytes(partial, sizeof(partial));
+  const int stalled[] = {connectRaw(socket, bytes),
+                         connectRaw(socket, bytes)};
+
+  // The only worker is free again once the stalled reads expire.
+  const auto client = ServerClient::connect(socket);
+  REQUIRE(client);
+  std::string output, diag;
+  raw_string_ostream os(output), diagOS(diag);
+  CHECK_EQ(client->submit("a.lox", "print 1;\n", 0u, os, diagOS),
+           Exit_success);
+  CHECK_EQ(output, "1.000000\n");
+
+  // The server closed the stalled connections without an answer.
+  for (const auto fd : stalled) {
+    char byte;
+    CHECK_EQ(::recv(fd, &byte, 1u, 0), 0);
+    ::close(fd);
+  }
+  CHECK_EQ(server.getRequestCount(), 1u);
+
+  server.requestStop();
+  serving.join();
+  sys::fs::remove_directories(dir);
+}
+
+TEST_CASE("Script server slow reader test" *
+          doctest::test_suite("Driver tests")) {
+  SmallString<128> dir;
+  REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-server", dir));
+  SmallString<128> socket(dir);
+  sys::path::append(socket, "lox.sock");
+
+  ServerOptions options;
+  options.Threads = 1u;
+  options.Timeout = 200u;
+  ScriptServer server(options);
+  REQUIRE(server.listen(socket));
+  std::thread serving([&] { server.run(); });
+
+  // A client that submits a script printing megabytes, then reads nothing.
+  const StringRef name = "big.lox", source = "print range(1000000);\n";
+  std::string request(13u, '\0');
+  request[0] = 'R';
+  support::endian::write32le(request.data() + 1u, 8u + name.size() +
+                                                      source.size());
+  support::endian::write32le(request.data() + 9u, name.size());
+  request += name;
+  request += source;
+  const auto reader = connectRaw(socket, request);
+  while (!server.getRequestCount())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  // The only worker gives up on it at the deadline.
+  const auto client = ServerClient::connect(socket);
+  REQUIRE(client);
+  std::string output, diag;
+  raw_string_ostream os(output), diagOS(diag);
+  CHECK_EQ(client->submit("a.lox", "print 1;\n", 0u, os, diagOS),
+           Exit_success);
+  CHECK_EQ(output, "1.000000\n");
+  CHECK_EQ(server.getTimeoutCount(), 1u);
+  CHECK_EQ(server.getRequestCount(), 2u);
+  ::close(reader);
+
+  server.requestStop();
+  serving.join();
+  sys::fs::remove_directories(dir);
+}
+
+} // namespace lox
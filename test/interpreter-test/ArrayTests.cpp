@@ -0,0 +1,234 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/ArrayKernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace lox {
+
+TEST_CASE("Array test" * doctest::test_suite("Interpreter tests")) {
+  SUBCASE("literals, indexing and builtins") {
+    const auto run = runScript(R"(
+var a = [1, 2.5, -3];
+print a;
+print [];
+print a[1];
+print len(a) + len([]);
+print range(4);
+print array(3, 0.5);
+print sum(a);
+print sum([]);
+print min(a);
+print max(a);
+print dot(a, [2, 2, 2]);
+print sort([3, -1, 2, -1]);
+print slice(range(6), 2, 5);
+print slice(a, 3, 3);
+print a == [1, 2.5, -3];
+print a == [1, 2.5];
+print a == 1;
+print !a;
+)");
+    CHECK_EQ(run.Errors, 0u);
+    CHECK_EQ(run.Output, R"([1, 2.5, -3]
+[]
+2.5
+3
+[0, 1, 2, 3]
+[0.5, 0.5, 0.5]
+0.5
+0
+-3
+2.5
+1
+[-1, -1, 2, 3]
+[2, 3, 4]
+[]
+true
+false
+false
+true
+)");
+  }
+
+  SUBCASE("arithmetic is elementwise and broadcasts numbers") {
+    const auto run = runScript(R"(
+var a = [1, 2, 3];
+print a + [10, 20, 30];
+print a - 1;
+print 12 / a;
+print -a * a;
+print (a + a)[2];
+)");
+    CHECK_EQ(run.Errors, 0u);
+    CHECK_EQ(run.Output, R"([11, 22, 33]
+[0, 1, 2]
+[12, 6, 4]
+[-1, -4, -9]
+6
+)");
+  }
+
+  SUBCASE("NaNs") {
+    const auto run = runScript(R"(
+var nan = 0 / 0;
+print sort([nan, 2, nan, 1]);
+print min([nan, 2, 1]);
+print max([nan, nan]);
+print [nan] == [nan];
+)");
+    CHECK_EQ(run.Errors, 0u);
+    const StringRef output = run.Output;
+    CHECK(output.startswith("[1, 2, "));
+    CHECK_NE(output.find("\n1\n"), StringRef::npos);
+    CHECK(output.endswith("\nfalse\n"));
+  }
+
+  SUBCASE("errors") {
+    const std::pair<StringRef, StringRef> cases[] = {
+        {"print [1, \"a\"];", "Array elements must be numbers"},
+        {"print 1[0];", "Operand must be an array"},
+        {"print [1][true];", "Operand must be a number"},
+        {"print [1][1];", "Index must be an integer below the length 1. got 1"},
+        {"print [1][-1];",
+         "Index must be an integer below the length 1. got -1"},
+        {"print [1, 2][0.5];",
+         "Index must be an integer below the length 2. got 0.5"},
+        {"print [1] + [1, 2];",
+         "Arrays must have the same length. got 1 and 2"},
+        {"print [1] + \"a\";", "Operands must be a number or array"},
+        {"print [1] < [2];", "Operands must be a number"},
+        {"print -\"a\";", "Operand must be a number"},
+        {"print len(1);", "Argument 1 of len must be an array"},
+        {"print array(1, nil);", "Argument 2 of array must be a number"},
+        {"print range(-1);",
+         "Length must be an integer from 0 to 134217728. got -1"},
+        {"print range(10000000000);",
+         "Length must be an integer from 0 to 134217728. got 1e+10"},
+        {"print min([]);", "min of an empty array"},
+        {"print max([]);", "max of an empty array"},
+        {"print dot([1], [1, 2]);",
+         "Arrays must have the same length. got 1 and 2"},
+        {"print slice([1, 2], 1, 3);",
+         "Slice [1, 3) is out of an array of length 2"},
+        {"print slice([1, 2], 2, 1);",
+         "Slice [2, 1) is out of an array of length 2"},
+    };
+    for (const auto &[code, message] : cases) {
+      const auto run = runScript(code);
+      CHECK_EQ(run.Errors, 1u);
+      CHECK(run.Output.empty());
+      if (run.Diagnostics.find(message.str()) == std::string::npos)
+        FAIL(run.Diagnostics);
+    }
+    // A failed operand fails the whole expression, and nothing else.
+    const auto run = runScript("print len([1, x]);\nprint len([1]);\n");
+    CHECK_EQ(run.Errors, 1u);
+    CHECK_EQ(run.Output, "1\n");
+  }
+
+  SUBCASE("resuming evaluates like the tree") {
+    const StringRef code = R"(
+var a = range(5) * 2;
+print a[len(a) - 1] + sum([a[0], a[1]]);
+print slice(sort(-a), 1, 3);
+print [1, [2][0], 3][1];
+print a[9];
+print dot(a, a);
+)";
+    const auto expected = runScript(code);
+    CHECK_EQ(expected.Errors, 1u);
+    for (const auto fuel : {1u, 3u, 100u}) {
+      const auto resumed = runScript(code, fuel);
+      CHECK_EQ(resumed.Output, expected.Output);
+      CHECK_EQ(resumed.Diagnostics, expected.Diagnostics);
+    }
+  }
+}
+
+TEST_CASE("Array kernel test" * doctest::test_suite("Interpreter tests")) {
+  std::mt19937 random(3u);
+  std::uniform_real_distribution<double> uniform(-100.0, 100.0);
+  const auto makeArray = [&](const std::size_t size) {
+    std::vector<double> values(size);
+    for (auto &value : values)
+      value = uniform(random);
+    return values;
+  };
+
+  // Sizes around the eight lanes, for every tail.
+  const auto maxSize = 40u;
+
+  SUBCASE("elementwise matches one element at a time") {
+    for (std::size_t size = 0u; size < maxSize; ++size) {
+      const auto lhs = makeArray(size);
+      const auto rhs = makeArray(size);
+      std::vector<double> out(size);
+      kernels::map(Tok_minus, lhs.data(), rhs.data(), out.data(), size);
+      for (std::size_t i = 0u; i < size; ++i)
+        CHECK_EQ(out[i], lhs[i] - rhs[i]);
+      kernels::map(Tok_slash, lhs.data(), 3.0, out.data(), size);
+      for (std::size_t i = 0u; i < size; ++i)
+        CHECK_EQ(out[i], lhs[i] / 3.0);
+      kernels::map(Tok_star, 0.5, rhs.data(), out.data(), size);
+      for (std::size_t i = 0u; i < size; ++i)
+        CHECK_EQ(out[i], 0.5 * rhs[i]);
+      kernels::negate(lhs.data(), out.data(), size);
+      for (std::size_t i = 0u; i < size; ++i)
+        CHECK_EQ(out[i], -lhs[i]);
+    }
+  }
+
+  SUBCASE("reductions match a sequential loop") {
+    for (std::size_t size = 0u; size < maxSize; ++size) {
+      const auto lhs = makeArray(size);
+      const auto rhs = makeArray(size);
+      double sum = 0.0;
+      double dot = 0.0;
+      for (std::size_t i = 0u; i < size; ++i) {
+        sum += lhs[i];
+        dot += lhs[i] * rhs[i];
+      }
+      // Only the order of the additions differs.
+      CHECK_LE(std::abs(kernels::sum(lhs) - sum), 1e-9);
+      CHECK_LE(std::abs(kernels::dot(lhs, rhs) - dot), 1e-7);
+      if (size) {
+        CHECK_EQ(kernels::min(lhs), *std::min_element(lhs.begin(), lhs.end()));
+        CHECK_EQ(kernels::max(lhs), *std::max_element(lhs.begin(), lhs.end()));
+      }
+    }
+  }
+
+  SUBCASE("NaNs are skipped and sorted last") {
+    const auto nan = std::numeric_limits<double>::quiet_NaN();
+    const auto isNaN = [](const double value) { return std::isnan(value); };
+    for (std::size_t size = 1u; size < maxSize; ++size) {
+      auto values = makeArray(size);
+      for (std::size_t i = 0u; i < size; i += 3u)
+        values[i] = nan;
+      std::vector<double> numbers;
+      std::remove_copy_if(values.begin(), values.end(),
+                          std::back_inserter(numbers), isNaN);
+      if (numbers.empty()) {
+        CHECK(std::isnan(kernels::min(values)));
+        CHECK(std::isnan(kernels::max(values)));
+      } else {
+        CHECK_EQ(kernels::min(values),
+                 *std::min_element(numbers.begin(), numbers.end()));
+        CHECK_EQ(kernels::max(values),
+                 *std::max_element(numbers.begin(), numbers.end()));
+      }
+
+      kernels::sort(values);
+      const auto firstNaN = std::find_if(values.begin(), values.end(), isNaN);
+      CHECK(std::is_sorted(values.begin(), firstNaN));
+      CHECK(std::all_of(firstNaN, values.end(), isNaN));
+      CHECK_EQ(static_cast<std::size_t>(firstNaN - values.begin()),
+               numbers.size());
+    }
+  }
+}
+
+} // namespace lox
@@ -0,0 +1,140 @@
+#include "doctest/doctest.h"
+#include "lox/interpreter/Columnar.hpp"
+#include "lox/interpreter/ForkableGlobals.hpp"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cmath>
+#include <random>
+
+namespace lox {
+
+namespace {
+
+/// An expression parsed from source, with what it points into.
+struct ParsedExpr {
+  SourceMgr SrcMgr;
+  uptr<Lexer> Tokens;
+  uptr<Expr> Root;
+};
+
+uptr<ParsedExpr> parseExpr(const StringRef code) {
+  auto parsed = mkuptr<ParsedExpr>();
+  const auto id = parsed->SrcMgr.AddNewSourceBuffer(
+      MemoryBuffer::getMemBufferCopy(code, "formula"), {});
+  parsed->Tokens = mkuptr<Lexer>(
+      parsed->SrcMgr, parsed->SrcMgr.getMemoryBuffer(id)->getBuffer());
+  REQUIRE(parsed->Tokens->Lex());
+  Parser parser(parsed->Tokens->getTokens(), parsed->SrcMgr);
+  parsed->Root = parser.Expression();
+  REQUIRE(parsed->Root);
+  return parsed;
+}
+
+} // namespace
+
+TEST_CASE("Columnar evaluation test" *
+          doctest::test_suite("Interpreter tests")) {
+  // Crosses several blocks and ends with a partial one.
+  const std::size_t rows = 3u * ColumnarExpr::BlockSize + 123u;
+  std::mt19937 random(7u);
+  SmallVector<double, 0> x(rows), y(rows);
+  SmallVector<bool, 0> xNils(rows), flag(rows), flagNils(rows);
+  for (std::size_t i = 0u; i < rows; ++i) {
+    x[i] = static_cast<int>(random() % 101u) - 50;
+    y[i] = static_cast<int>(random() % 101u) - 50;
+    xNils[i] = random() % 10u == 0u;
+    flag[i] = random() % 2u;
+    flagNils[i] = random() % 20u == 0u;
+  }
+  ColumnBatch batch(rows);
+  batch.addNumbers("x", x, xNils);
+  batch.addNumbers("y", y);
+  batch.addBools("flag", flag, flagNils);
+
+  SUBCASE("same results as the interpreter") {
+    for (const auto *code :
+         {"x + y * 2", "(x - y) / (y + 1) >= 0.5", "-x < y == !flag",
+          "x == nil", "flag != (y > 3)", "!x", "!flag", "!nil == true",
+          "x != y", "nil == flag", "x", "flag", "nil", "y / 0 > 1"}) {
+      auto parsed = parseExpr(code);
+      const auto compiled =
+          ColumnarExpr::compile(*parsed->Root, batch, parsed->SrcMgr);
+      REQUIRE(compiled);
+      const auto output = compiled->evaluate(batch);
+
+      LoxValueEnv env;
+      ForkableGlobals globals;
+      ExprInterpreter interpreter(parsed->SrcMgr, env);
+      interpreter.setForkableGlobals(&globals);
+      interpreter.setDiagnosticStream(nulls());
+      std::size_t errors = 0u;
+      for (std::size_t i = 0u; i < rows; ++i) {
+        globals.define("x", xNils[i] ? sptr<Value>(mksptr<NilValue>())
+                                     : mksptr<NumberValue>(x[i]));
+        globals.define("y", mksptr<NumberValue>(y[i]));
+        globals.define("flag", flagNils[i]
+                                   ? sptr<Value>(mksptr<NilValue>())
+                                   : mksptr<BoolValue>(flag[i]));
+        const auto before = interpreter.getError();
+        const auto value = std::visit(interpreter, *parsed->Root);
+        const auto failed = interpreter.getError() != before;
+        REQUIRE_EQ(output.Errors[i], failed);
+        if (failed) {
+          ++errors;
+          continue;
+        }
+        REQUIRE_EQ(output.Nils[i], isa<NilValue>(value.get()));
+        if (const auto *number = dyn_cast<NumberValue>(value.get())) {
+          REQUIRE_EQ(output.Type, ColumnType::Number);
+          const auto expected = static_cast<double>(number->getValue());
+          if (std::isfinite(expected))
+            CHECK_LE(std::abs(output.Numbers[i] - expected),
+                     1e-12 * std::max(1.0, std::abs(expected)));
+          else
+            CHECK_EQ(output.Numbers[i], expected);
+        } else if (isa<BoolValue>(value.get())) {
+          REQUIRE_EQ(output.Type, ColumnType::Bool);
+          CHECK_EQ(output.Bools[i], value->truthy());
+        }
+      }
+      CHECK_EQ(output.ErrorCount, errors);
+    }
+  }
+
+  SUBCASE("errors only on nil operands") {
+    auto parsed = parseExpr("x * y - 1");
+    const auto compiled =
+        ColumnarExpr::compile(*parsed->Root, batch, parsed->SrcMgr);
+    REQUIRE(compiled);
+    const auto output = compiled->evaluate(batch);
+    CHECK_EQ(output.ErrorCount,
+             static_cast<std::size_t>(
+                 std::count(xNils.begin(), xNils.end(), true)));
+    for (std::size_t i = 0u; i < rows; ++i)
+      if (!xNils[i])
+        REQUIRE_EQ(output.Numbers[i], x[i] * y[i] - 1);
+  }
+
+  SUBCASE("unsupported expressions") {
+    for (const auto &[code, message] :
+         {std::pair{"x + true", "formula:1:3: error: Operands must be a "
+                                "number or string"},
+          std::pair{"-flag", "formula:1:1: error: Operand must be a number"},
+          std::pair{"y < nil", "formula:1:3: error: Operands must be a "
+                               "number"},
+          std::pair{"z * 2", "formula:1:1: error: Undefined variable : z"},
+          std::pair{"x == \"a\"", "string values are not supported"},
+          std::pair{"x = 1", "assignments are not supported"}}) {
+      auto parsed = parseExpr(code);
+      std::string diag;
+      raw_string_ostream diagOS(diag);
+      CHECK_FALSE(ColumnarExpr::compile(*parsed->Root, batch, parsed->SrcMgr,
+                                        diagOS));
+      CHECK_NE(diag.find(message), std::string::npos);
+    }
+  }
+}
+
+} // namespace lox
@@ -1,5 +1,8 @@
 #include "InterpreterTestUtils.hpp"
 #include "doctest/doctest.h"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/thread.h"
 
 namespace lox {
 
@@ -39,4 +42,61 @@ TEST_CASE("Expression Interpreter Test" *
   INTERPRETER_TEST("truthy test - 2", R"(!(10 + 30))", BoolValue(true));
 }
 
+TEST_CASE("Explicit stack evaluation test" *
+          doctest::test_suite("Interpreter tests")) {
+  // Trees as deep as the parser allows, evaluated on a thread whose stack
+  // holds a few dozen frames of a recursive walk.
+  const auto depth = Parser::DefaultMaxDepth - 1u;
+  std::string chain = "a = 0";
+  for (auto i = 0u; i < depth - 2u; ++i)
+    chain += i % 2u ? " + 1" : " - -1";
+  std::string nested = "b = ";
+  for (auto i = 0u; i < depth / 2u; ++i)
+    nested += "-(";
+  nested += "c";
+  nested.append(depth / 2u, ')');
+
+  SourceMgr srcMgr;
+  for (const auto isChain : {true, false}) {
+    const auto &code = isChain ? chain : nested;
+    const auto id = srcMgr.AddNewSourceBuffer(
+        MemoryBuffer::getMemBufferCopy(code, "source"), {});
+    Lexer lexer(srcMgr, srcMgr.getMemoryBuffer(id)->getBuffer());
+    REQUIRE(lexer.Lex());
+    Parser parser(lexer.getTokens(), srcMgr);
+    const auto expr = parser.Expression();
+    REQUIRE(expr);
+
+    LoxValueEnv env;
+    LoxValueScope scope(env);
+    env.insert("a", nullptr);
+    env.insert("b", nullptr);
+    std::string diagnostics;
+    raw_string_ostream diagOS(diagnostics);
+    ExprInterpreter interpreter(srcMgr, env);
+    interpreter.setDiagnosticStream(diagOS);
+    sptr<Value> visited, evaluated;
+    llvm::thread worker(Optional<unsigned>(128u << 10u), [&] {
+      visited = std::visit(interpreter, *expr);
+      evaluated = interpreter.evaluate(*expr);
+    });
+    worker.join();
+
+    if (isChain) {
+      REQUIRE(visited);
+      REQUIRE(evaluated);
+      CHECK_EQ(*visited, NumberValue(depth - 2u));
+      CHECK_EQ(*evaluated, NumberValue(depth - 2u));
+      CHECK_EQ(*env.lookup("a"), NumberValue(depth - 2u));
+    } else {
+      // `c` is undefined: reported once per evaluation, and nothing is
+      // assigned.
+      CHECK_FALSE(visited);
+      CHECK_FALSE(evaluated);
+      CHECK_FALSE(env.lookup("b"));
+    }
+    CHECK_EQ(interpreter.getError(), isChain ? 0u : 2u);
+  }
+}
+
 } // namespace lox
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/ForkableGlobals.hpp"
+#include "lox/interpreter/Isolate.hpp"
+#include "utils/WorkStealingPool.hpp"
+
+namespace lox {
+
+static sptr<Value> number(const long double value) {
+  return mksptr<NumberValue>(value);
+}
+
+static long double numberOf(const sptr<Value> *value) {
+  REQUIRE(value);
+  REQUIRE(*value);
+  return cast<NumberValue>(value->get())->getValue();
+}
+
+TEST_CASE("Forkable globals test" * doctest::test_suite("Interpreter tests")) {
+  SUBCASE("forks see the parent and change on their own") {
+    ForkableGlobals parent;
+    parent.define("a", number(1));
+    parent.define("b", number(2));
+
+    auto child = parent.fork();
+    CHECK_EQ(child.getOverlaySize(), 0u);
+    CHECK_EQ(numberOf(child.find("a")), 1);
+
+    CHECK(child.assign("a", number(10)));
+    child.define("c", number(3));
+    CHECK(parent.assign("b", number(20)));
+    CHECK_FALSE(child.assign("missing", number(0)));
+
+    CHECK_EQ(numberOf(child.find("a")), 10);
+    CHECK_EQ(numberOf(child.find("b")), 2);
+    CHECK_EQ(numberOf(parent.find("a")), 1);
+    CHECK_EQ(numberOf(parent.find("b")), 20);
+    CHECK_FALSE(parent.count("c"));
+    CHECK_EQ(child.getOverlaySize(), 2u);
+    CHECK_EQ(parent.getOverlaySize(), 1u);
+  }
+
+  SUBCASE("unchanged state adds no layer") {
+    ForkableGlobals parent;
+    parent.define("a", number(1));
+    std::vector<ForkableGlobals> forks;
+    for (auto i = 0u; i < 1000u; ++i)
+      forks.push_back(parent.fork());
+    CHECK_EQ(parent.getDepth(), 1u);
+    for (const auto &fork : forks) {
+      CHECK_EQ(fork.getDepth(), 1u);
+      CHECK_EQ(fork.getOverlaySize(), 0u);
+    }
+
+    parent.define("b", number(2));
+    auto grandChild = parent.fork().fork();
+    CHECK_EQ(grandChild.getDepth(), 2u);
+    CHECK_EQ(numberOf(grandChild.find("a")), 1);
+    CHECK_EQ(numberOf(grandChild.find("b")), 2);
+  }
+
+  SUBCASE("isolate scenarios") {
+    const auto base = CompiledScript::compile("base", R"(
+var rate = 0.5;
+var total = 100;
+var label = "base";
+)");
+    const auto scenario = CompiledScript::compile("scenario", R"(
+rate = rate + 0.25;
+total = total * rate;
+print label + " " + "scenario";
+print total;
+)");
+    REQUIRE(base);
+    REQUIRE(scenario);
+
+    Isolate parent;
+    REQUIRE(parent.run(base));
+
+    std::vector<uptr<Isolate>> forks;
+    for (auto i = 0u; i < 200u; ++i)
+      forks.push_back(parent.fork());
+    {
+      WorkStealingPool pool(4u);
+      for (auto &fork : forks)
+        pool.async([&] { fork->run(scenario); });
+      pool.wait();
+    }
+    for (const auto &fork : forks)
+      CHECK_EQ(fork->getOutput(), "base scenario\n75.000000\n");
+
+    // Each fork ran the scenario once on the untouched base.
+    const auto check = CompiledScript::compile("check", "print total;\n");
+    REQUIRE(check);
+    CHECK(parent.run(check));
+    CHECK_EQ(parent.getOutput(), "100.000000\n");
+    CHECK(forks.front()->run(scenario));
+    CHECK_EQ(forks.front()->getOutput(),
+             "base scenario\n75.000000\nbase scenario\n75.000000\n");
+  }
+}
+
+} // namespace lox
@@ -3,6 +3,7 @@
 
 #include "doctest/doctest.h"
 #include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/Resumable.hpp"
 #include "lox/parser/Lexer.hpp"
 #include "lox/parser/Parser.hpp"
 #include "llvm/ADT/StringRef.h"
@@ -84,6 +85,85 @@ inline bool runPrintInterpretTest(const StringRef code,
 #define PRINT_OUTPUT_TEST(test, code, expect)                                  \
   SUBCASE(test) CHECK(::lox::runPrintInterpretTest(code, expect))
 
+inline bool runWorkCountTest(const StringRef code, WorkCounters &counters) {
+  auto bufferPtr = MemoryBuffer::getMemBuffer(code, "source");
+  const auto &buffer = *bufferPtr;
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(std::move(bufferPtr), {});
+  Lexer lexer(srcMgr, buffer.getBuffer());
+  if (const auto success = lexer.Lex(); !success)
+    return false;
+
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+  if (parser.getError())
+    return false;
+
+  std::string result;
+  raw_string_ostream ss(result);
+  LoxValueEnv Env;
+  ExprInterpreter exprInterpreter(srcMgr, Env);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, Env, ss);
+  stmtInterpreter.setWorkCounters(&counters);
+  {
+    LoxValueScope globalScope(Env);
+    for (const auto &stmt : program)
+      std::visit(stmtInterpreter, *stmt);
+  }
+
+  return !stmtInterpreter.getError();
+}
+
+/// Fails when evaluating `code` takes more than `bound` abstract work units.
+#define WORK_BOUND_TEST(test, code, bound)                                     \
+  SUBCASE(test) {                                                              \
+    ::lox::WorkCounters counters;                                              \
+    CHECK(::lox::runWorkCountTest(code, counters));                            \
+    CHECK_LE(counters.getTotal(), bound);                                      \
+  }
+
+struct ScriptRun {
+  std::string Output;
+  std::string Diagnostics;
+  std::size_t Errors = 0u;
+};
+
+/// Run `code` with numbers printed shortest, all at once or in slices of
+/// `fuel` steps.
+inline ScriptRun runScript(const StringRef code,
+                           const std::uint64_t fuel = 0u) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "test"), {});
+  Lexer lexer(srcMgr, code);
+  REQUIRE(lexer.Lex());
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+  REQUIRE_FALSE(parser.getError());
+
+  ScriptRun run;
+  raw_string_ostream os(run.Output);
+  raw_string_ostream diagOS(run.Diagnostics);
+  LoxValueEnv env;
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  exprInterpreter.setDiagnosticStream(diagOS);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+  stmtInterpreter.setNumberFormat(NumberFormat::Shortest);
+  {
+    LoxValueScope globalScope(env);
+    if (fuel) {
+      ResumableInterpreter resumable(stmtInterpreter);
+      resumable.start(program);
+      while (!resumable.resume(fuel))
+        ;
+    } else {
+      for (const auto &stmt : program)
+        std::visit(stmtInterpreter, *stmt);
+    }
+  }
+  run.Errors = stmtInterpreter.getError();
+  return run;
+}
+
 } // namespace lox
 
 #endif /// __INTERPRETER_TEST_UTILS_HPP__
\ No newline at end of file
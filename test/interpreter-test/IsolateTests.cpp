@@ -0,0 +1,93 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/Isolate.hpp"
+#include "utils/WorkStealingPool.hpp"
+
+namespace lox {
+
+TEST_CASE("Isolate test" * doctest::test_suite("Interpreter tests")) {
+  SUBCASE("globals persist across runs") {
+    const auto define = CompiledScript::compile("define", "var a = 1;\n");
+    const auto bump = CompiledScript::compile("bump", "a = a + 1;\nprint a;\n");
+    REQUIRE(define);
+    REQUIRE(bump);
+
+    Isolate isolate;
+    CHECK(isolate.run(define));
+    CHECK(isolate.run(bump));
+    CHECK(isolate.run(bump));
+    CHECK_EQ(isolate.getOutput(), "2.000000\n3.000000\n");
+
+    Isolate other;
+    CHECK_FALSE(other.run(bump));
+    CHECK_EQ(other.getOutput(), "");
+    CHECK_NE(other.getDiagnostics().find("bump:1:1"), StringRef::npos);
+    CHECK_EQ(isolate.getDiagnostics(), "");
+  }
+
+  SUBCASE("syntax errors") {
+    std::string diag;
+    raw_string_ostream diagOS(diag);
+    CHECK_FALSE(CompiledScript::compile("bad", "print 1 +;", diagOS));
+    CHECK_NE(diag.find("bad:1:10"), std::string::npos);
+  }
+
+  SUBCASE("one script, many isolates") {
+    const auto script = CompiledScript::compile("shared", R"(
+var a = 0;
+a = a + 1;
+print "count " + "done";
+print a * 10;
+)");
+    REQUIRE(script);
+
+    std::vector<uptr<Isolate>> isolates;
+    for (auto i = 0u; i < 1000u; ++i)
+      isolates.emplace_back(mkuptr<Isolate>());
+    {
+      WorkStealingPool pool(4u);
+      for (auto &isolate : isolates)
+        pool.async([&] { isolate->run(script); });
+      pool.wait();
+    }
+    for (const auto &isolate : isolates)
+      CHECK_EQ(isolate->getOutput(), "count done\n10.000000\n");
+  }
+
+  SUBCASE("reset") {
+    const auto script = CompiledScript::compile("a", "var a = 1;\nprint a;");
+    const auto slow = CompiledScript::compile("b", "var b = 1 + 2 + 3;");
+    REQUIRE(script);
+    REQUIRE(slow);
+
+    Isolate isolate;
+    REQUIRE(isolate.run(script));
+    std::string redirected;
+    raw_string_ostream os(redirected);
+    isolate.setOutputStream(os);
+    isolate.start(slow);
+    CHECK_FALSE(isolate.resume(2u));
+
+    isolate.reset();
+    CHECK(isolate.getOutput().empty());
+    CHECK_FALSE(isolate.run(CompiledScript::compile("c", "print a;")));
+    CHECK_NE(isolate.getDiagnostics().find("c:1:7"), std::string::npos);
+    CHECK(isolate.run(script));
+    CHECK_EQ(isolate.getOutput(), "1.000000\n");
+    CHECK(redirected.empty());
+  }
+
+  SUBCASE("tasks spawning tasks") {
+    std::atomic<unsigned> sum(0u);
+    WorkStealingPool pool(3u);
+    for (auto i = 0u; i < 100u; ++i)
+      pool.async([&] {
+        for (auto j = 0u; j < 10u; ++j)
+          pool.async([&] { sum++; });
+      });
+    pool.wait();
+    CHECK_EQ(sum.load(), 1000u);
+  }
+}
+
+} // namespace lox
@@ -0,0 +1,251 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/MapTable.hpp"
+#include <limits>
+#include <random>
+#include <unordered_map>
+
+namespace lox {
+
+TEST_CASE("Map test" * doctest::test_suite("Interpreter tests")) {
+  SUBCASE("literals, indexing and builtins") {
+    const auto run = runScript(R"(
+var m = {"a": 1, 2: [3], true: nil};
+print m["a"];
+print m[2][0];
+print m["b"];
+print get(m, true);
+print has(m, true);
+print has(m, "b");
+print len(m) + len({});
+print {"only": "one"};
+print {};
+print {1: "x", 1: "y"}[1];
+print {-0: "zero"}[0];
+print m == {true: nil, 2: [3], "a": 1};
+print m == {"a": 1};
+print {} == [];
+print !m;
+)");
+    CHECK_EQ(run.Errors, 0u);
+    CHECK_EQ(run.Output, R"(1
+3
+nil
+nil
+true
+false
+3
+{only: one}
+{}
+y
+zero
+true
+false
+false
+true
+)");
+  }
+
+  SUBCASE("set and delete return new maps") {
+    const auto run = runScript(R"(
+var m = {"a": 1};
+var n = set(m, "b", 2);
+var o = delete(n, "a");
+print len(m);
+print len(n);
+print o;
+print m;
+print set(m, "a", 3)["a"];
+print delete(m, "missing") == m;
+print len(delete(delete(n, "a"), "b"));
+)");
+    CHECK_EQ(run.Errors, 0u);
+    CHECK_EQ(run.Output, R"(1
+2
+{b: 2}
+{a: 1}
+3
+true
+0
+)");
+  }
+
+  SUBCASE("set and delete of the variable they assign") {
+    const auto run = runScript(R"(
+var m = {};
+m = set(m, 1, "x");
+m = set(m, 2, "y");
+m = delete(m, 1);
+m = delete(m, 3);
+print m;
+var n = m;
+m = set(m, 3, "z");
+print len(n);
+m = set(m, 4, m);
+print len(m[4]);
+print len(m);
+print len(m);
+m = set(m, [1], 1);
+print len(m);
+m = delete(m, 2) == m;
+print m;
+)");
+    CHECK_EQ(run.Errors, 1u);
+    CHECK_EQ(run.Output, R"({2: y}
+1
+2
+3
+3
+3
+false
+)");
+  }
+
+  SUBCASE("an unshared map is updated instead of copied") {
+    WorkCounters counters;
+    CHECK(runWorkCountTest(R"(
+var m = {};
+m = set(m, 1, 2);
+m = set(m, 2, 3);
+m = delete(m, 1);
+print len(m);
+)",
+                           counters));
+    // {}, the five number literals and len's result
+    CHECK_EQ(counters.ValueAllocations, 7u);
+  }
+
+  SUBCASE("errors") {
+    const std::pair<StringRef, StringRef> cases[] = {
+        {"print {0 / 0: 1};", "Map keys must be numbers other than NaN"},
+        {"print {[1]: 1};", "Map keys must be numbers other than NaN"},
+        {"print {{}: 1};", "Map keys must be numbers other than NaN"},
+        {"print {}[[1]];", "Map keys must be numbers other than NaN"},
+        {"print has({}, 0 / 0);", "Map keys must be numbers other than NaN"},
+        {"print set({}, {}, 1);", "Map keys must be numbers other than NaN"},
+        {"print get(1, 2);", "Argument 1 of get must be a map"},
+        {"print delete([1], 0);", "Argument 1 of delete must be a map"},
+        {"print len(nil);", "Argument 1 of len must be an array or map"},
+        {"print {} + {};", "Operands must be"},
+        {"print -{};", "Operand must be a number"},
+    };
+    for (const auto &[code, message] : cases) {
+      const auto run = runScript(code);
+      CHECK_EQ(run.Errors, 1u);
+      CHECK(run.Output.empty());
+      if (run.Diagnostics.find(message.str()) == std::string::npos)
+        FAIL(run.Diagnostics);
+    }
+  }
+
+  SUBCASE("resuming evaluates like the tree") {
+    const StringRef code = R"(
+var m = {"a": range(3), "b": {1: 2}};
+print m["a"][2] + get(m["b"], 1);
+print len(set(m, "c", [m["b"][1]]));
+print has(delete(m, "a"), "a");
+print {1: 0 / 0 == 1, 2: x};
+print m["b"][1];
+m = set(m, "c", m);
+var n = m;
+m = delete(m, "a");
+print len(m) + len(n);
+m = delete(m, "c");
+print len(m) + len(n);
+)";
+    const auto expected = runScript(code);
+    CHECK_EQ(expected.Errors, 1u);
+    for (const auto fuel : {1u, 3u, 100u}) {
+      const auto resumed = runScript(code, fuel);
+      CHECK_EQ(resumed.Output, expected.Output);
+      CHECK_EQ(resumed.Diagnostics, expected.Diagnostics);
+    }
+  }
+}
+
+TEST_CASE("Map table test" * doctest::test_suite("Interpreter tests")) {
+  const auto key = [](const long number) {
+    return mksptr<NumberValue>(number);
+  };
+
+  SUBCASE("matches std::unordered_map") {
+    std::mt19937 random(7u);
+    std::uniform_int_distribution<long> keys(0, 2000);
+    std::uniform_int_distribution<int> ops(0, 2);
+    MapTable table;
+    std::unordered_map<long, long> expected;
+    for (long i = 0; i < 20000; ++i) {
+      const auto k = keys(random);
+      if (ops(random)) {
+        CHECK_EQ(table.insert(key(k), key(i)), expected.count(k) == 0u);
+        expected[k] = i;
+      } else {
+        CHECK_EQ(table.erase(NumberValue(k)), expected.erase(k) == 1u);
+      }
+      const auto probe = keys(random);
+      const auto *entry = table.find(NumberValue(probe));
+      const auto it = expected.find(probe);
+      REQUIRE_EQ(entry != nullptr, it != expected.end());
+      if (entry)
+        CHECK(*entry->Mapped == NumberValue(it->second));
+    }
+    CHECK_EQ(table.size(), expected.size());
+    std::size_t iterated = 0u;
+    for (const auto &entry : table) {
+      const auto number = cast<NumberValue>(*entry.Key).getValue();
+      const auto it = expected.find(static_cast<long>(number));
+      REQUIRE(it != expected.end());
+      CHECK(*entry.Mapped == NumberValue(it->second));
+      ++iterated;
+    }
+    CHECK_EQ(iterated, expected.size());
+  }
+
+  SUBCASE("keys of every kind") {
+    MapTable table;
+    table.insert(key(0), key(1));
+    table.insert(mksptr<StringValue>("0"), key(2));
+    table.insert(mksptr<BoolValue>(false), key(3));
+    table.insert(mksptr<NilValue>(), key(4));
+    CHECK_EQ(table.size(), 4u);
+    CHECK(*table.find(NumberValue(-0.0L))->Mapped == NumberValue(1));
+    CHECK(*table.find(StringValue("0"))->Mapped == NumberValue(2));
+    CHECK(*table.find(BoolValue(false))->Mapped == NumberValue(3));
+    CHECK(*table.find(NilValue())->Mapped == NumberValue(4));
+    CHECK_FALSE(table.find(BoolValue(true)));
+    CHECK_FALSE(MapTable::isKey(
+        NumberValue(std::numeric_limits<long double>::quiet_NaN())));
+    CHECK_FALSE(MapTable::isKey(ArrayValue(SmallVector<double, 0>())));
+    CHECK_EQ(MapTable::hash(NumberValue(0.0L)),
+             MapTable::hash(NumberValue(-0.0L)));
+  }
+
+  SUBCASE("deleted slots are reused instead of growing") {
+    MapTable table;
+    table.reserve(100u);
+    const auto capacity = table.capacity();
+    for (long i = 0; i < 100000; ++i) {
+      table.insert(key(i), key(i));
+      if (i >= 50)
+        CHECK(table.erase(NumberValue(i - 50)));
+    }
+    CHECK_EQ(table.size(), 50u);
+    CHECK_EQ(table.capacity(), capacity);
+    for (long i = 100000 - 50; i < 100000; ++i)
+      CHECK(table.find(NumberValue(i)));
+  }
+
+  SUBCASE("reserve makes room without growing") {
+    MapTable table;
+    table.reserve(1000u);
+    const auto capacity = table.capacity();
+    CHECK_GE(capacity * 7u / 8u, 1000u);
+    for (long i = 0; i < 1000; ++i)
+      table.insert(key(i), key(i));
+    CHECK_EQ(table.capacity(), capacity);
+    table.insert(key(1000), key(1000));
+    CHECK_EQ(table.size(), 1001u);
+  }
+}
+
+} // namespace lox
@@ -0,0 +1,128 @@
+#include "doctest/doctest.h"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/Support/MemoryBuffer.h"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+
+namespace lox {
+
+static std::string format(const long double value,
+                          const NumberFormat numberFormat) {
+  std::string text;
+  raw_string_ostream os(text);
+  const auto size = printNumber(os, value, numberFormat);
+  os.flush();
+  CHECK_EQ(size, text.size());
+  return text;
+}
+
+static std::string run(const StringRef code, const NumberFormat numberFormat) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "test"), {});
+  Lexer lexer(srcMgr, code);
+  REQUIRE(lexer.Lex());
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+  REQUIRE_FALSE(parser.getError());
+
+  std::string output;
+  raw_string_ostream os(output);
+  LoxValueEnv env;
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+  stmtInterpreter.setNumberFormat(numberFormat);
+  LoxValueScope globalScope(env);
+  for (const auto &stmt : program)
+    std::visit(stmtInterpreter, *stmt);
+  return os.str();
+}
+
+TEST_CASE("Number format test" * doctest::test_suite("Interpreter tests")) {
+  SUBCASE("fixed is the format of std::to_string") {
+    std::vector<long double> values = {
+        0.0L,        -0.0L,         1.0L,        -1.0L,      0.5L,
+        0.1L,        1.0L / 3.0L,   2.0L / 3.0L, 123.456L,   0.0000005L,
+        0.0000015L,  0.0000025L,    -0.0000005L, 0.9999995L, 9.9999999L,
+        1e-9L,       -1e-9L,        1e-30L,      1e18L,      0x1p63L - 1.0L,
+        0x1p63L,     -0x1p63L,      1e19L,       1e300L,     -1e4000L,
+        std::numeric_limits<long double>::denorm_min(),
+        std::numeric_limits<long double>::max(),
+        std::numeric_limits<long double>::infinity(),
+        -std::numeric_limits<long double>::infinity(),
+        std::numeric_limits<long double>::quiet_NaN()};
+    // Ties at the sixth decimal, which round to even on the exact value.
+    for (auto i = 0; i < 512; ++i)
+      values.push_back(std::ldexp(static_cast<long double>(i), -7) +
+                       std::ldexp(1.0L, -27));
+    for (auto i = 0; i < 512; ++i)
+      values.push_back(std::ldexp(static_cast<long double>(i), -7));
+    std::mt19937_64 random(7u);
+    for (auto i = 0; i < 2000; ++i) {
+      const auto scale =
+          std::ldexp(1.0L, static_cast<int>(random() % 80u) - 20);
+      const auto value = static_cast<long double>(random()) /
+                         static_cast<long double>(random.max()) * scale;
+      values.push_back(i % 2 ? -value : value);
+    }
+    for (const auto value : values)
+      CHECK_EQ(format(value, NumberFormat::Fixed), std::to_string(value));
+  }
+
+  SUBCASE("shortest reads back the same number") {
+    CHECK_EQ(format(0.1L, NumberFormat::Shortest), "0.1");
+    CHECK_EQ(format(3.0L, NumberFormat::Shortest), "3");
+    CHECK_EQ(format(-2.5L, NumberFormat::Shortest), "-2.5");
+    CHECK_EQ(format(1e30L, NumberFormat::Shortest), "1e+30");
+
+    std::mt19937_64 random(11u);
+    for (auto i = 0; i < 2000; ++i) {
+      const auto scale =
+          std::ldexp(1.0L, static_cast<int>(random() % 400u) - 200);
+      const auto value = static_cast<long double>(random()) /
+                         static_cast<long double>(random.max()) * scale;
+      const auto text = format(value, NumberFormat::Shortest);
+      CHECK_EQ(std::strtold(text.c_str(), nullptr), value);
+      CHECK_LE(text.size(), 32u);
+    }
+
+    // Short decimals are formatted without std::to_chars, in the same way.
+    std::vector<long double> decimals = {
+        1.0L,    -7.0L,  10000.0L, 100000.0L, 123000.0L, 0.5L,
+        0.001L,  0.0001L, 0.25L,   -0.075L,   1e15L,     9007199254740991.0L,
+        1.5e-9L, 12.5e-9L};
+    for (auto i = 0u; i < 5000u; ++i) {
+      decimals.push_back(i * 0.37L);
+      decimals.push_back(static_cast<long double>(random() % 100000000u) /
+                         std::pow(10.0L, static_cast<int>(random() % 12u)));
+    }
+    for (const auto value : decimals) {
+      char expected[64];
+      const auto result =
+          std::to_chars(expected, expected + sizeof(expected), value);
+      CHECK_EQ(format(value, NumberFormat::Shortest),
+               std::string(expected, result.ptr));
+    }
+  }
+
+  SUBCASE("print writes every kind of value") {
+    const auto code = R"(
+var a;
+print 1 / 3;
+print 0.1 + 0.2;
+print "text";
+print 1 < 2;
+print nil;
+)";
+    CHECK_EQ(run(code, NumberFormat::Fixed),
+             "0.333333\n0.300000\ntext\ntrue\nnil\n");
+    CHECK_EQ(run(code, NumberFormat::Shortest),
+             "0.33333333333333333334\n0.3\ntext\ntrue\nnil\n");
+  }
+}
+
+} // namespace lox
@@ -0,0 +1,120 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/Dependencies.hpp"
+#include "lox/interpreter/ParallelInterpreter.hpp"
+
+namespace lox {
+
+/// Run `code` sequentially and in parallel and compare output and
+/// diagnostics.
+inline bool runParallelTest(const StringRef code,
+                            ParallelExecStats *statsOut = nullptr) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  Lexer lexer(srcMgr, code);
+  if (!lexer.Lex())
+    return false;
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+  if (parser.getError())
+    return false;
+
+  std::string expected, expectedDiag;
+  raw_string_ostream expectedOS(expected), expectedDiagOS(expectedDiag);
+  {
+    LoxValueEnv env;
+    ExprInterpreter exprInterpreter(srcMgr, env);
+    exprInterpreter.setDiagnosticStream(expectedDiagOS);
+    StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, expectedOS);
+    LoxValueScope globalScope(env);
+    for (const auto &stmt : program)
+      std::visit(stmtInterpreter, *stmt);
+  }
+
+  std::string output, diag;
+  raw_string_ostream os(output), diagOS(diag);
+  ParallelExecOptions options;
+  options.Threads = 4u;
+  const auto stats = interpretParallel(srcMgr, program, os, diagOS, options);
+  if (statsOut)
+    *statsOut = stats;
+
+  CHECK_EQ(output, expected);
+  CHECK_EQ(diag, expectedDiag);
+  return output == expected && diag == expectedDiag;
+}
+
+TEST_CASE("Dependency graph test" * doctest::test_suite("Interpreter tests")) {
+  const StringRef code = R"(var a = 1;
+var b = 2;
+print a + b;
+a = b * 2;
+var c = a;
+)";
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  Lexer lexer(srcMgr, code);
+  REQUIRE(lexer.Lex());
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+  REQUIRE_FALSE(parser.getError());
+
+  const DependencyGraph graph(program);
+  const auto preds = [&](const std::size_t stmt) {
+    const auto list = graph.getPredecessors(stmt);
+    return std::vector<unsigned>(list.begin(), list.end());
+  };
+  CHECK(preds(0).empty());
+  CHECK(preds(1).empty());
+  CHECK_EQ(preds(2), (std::vector<unsigned>{0u, 1u}));
+  // Look up a and read b after 0 and 1, write a after the read in 2.
+  CHECK_EQ(preds(3), (std::vector<unsigned>{0u, 1u, 2u}));
+  CHECK_EQ(preds(4), (std::vector<unsigned>{3u}));
+  CHECK_EQ(graph.getEdgeCount(), 6u);
+  CHECK_EQ(graph.getCriticalPath(), 4u);
+}
+
+TEST_CASE("Parallel interpreter test" *
+          doctest::test_suite("Interpreter tests")) {
+  SUBCASE("independent statements") {
+    std::string code;
+    for (auto i = 0u; i < 300u; ++i)
+      code += formatv("var v{0} = {0} * 3;\nprint v{0} - 1;\n", i).str();
+    ParallelExecStats stats;
+    CHECK(runParallelTest(code, &stats));
+    CHECK_EQ(stats.CriticalPath, 2u);
+  }
+
+  SUBCASE("chains, shadowing and reassignment") {
+    CHECK(runParallelTest(R"(
+var a = 1;
+var b = a + 1;
+print a;
+a = b * 10;
+print a;
+var a = "shadow";
+print a + "!";
+var c;
+print c;
+c = (b = 3) + 1;
+print b + c;
+)"));
+  }
+
+  SUBCASE("runtime errors are reported in order") {
+    ParallelExecStats stats;
+    CHECK(runParallelTest(R"(
+print x;
+var x = 1;
+print -"s";
+print x;
+y = 2;
+print (x = 5) + nil;
+print x;
+)",
+                          &stats));
+    CHECK_EQ(stats.RuntimeErrors, 4u);
+  }
+}
+
+} // namespace lox
@@ -0,0 +1,158 @@
+#include "doctest/doctest.h"
+#include "lox/interpreter/Interpreter.hpp"
+#include "lox/interpreter/PreparedScript.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "lox/parser/Parser.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+/// Allocations made by any thread, to check the steady state of
+/// PreparedScript::invoke().
+std::atomic<std::size_t> Allocations(0u);
+
+} // namespace
+
+void *operator new(const std::size_t size) {
+  ++Allocations;
+  if (auto *pointer = std::malloc(size ? size : 1u))
+    return pointer;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace lox {
+
+namespace {
+
+struct RunResult {
+  std::string Output;
+  std::string Diagnostics;
+  bool Success;
+};
+
+/// Run `code` with a fresh interpreter, `a`, `b` and `s` defined.
+RunResult interpret(const StringRef code, const long double a,
+                    const long double b, const StringRef s) {
+  RunResult result;
+  raw_string_ostream os(result.Output), diagOS(result.Diagnostics);
+  SourceMgr srcMgr;
+  const auto id = srcMgr.AddNewSourceBuffer(
+      MemoryBuffer::getMemBufferCopy(code, "prepared"), {});
+  Lexer lexer(srcMgr, srcMgr.getMemoryBuffer(id)->getBuffer());
+  REQUIRE(lexer.Lex());
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+  REQUIRE_FALSE(parser.getError());
+
+  LoxValueEnv env;
+  LoxValueScope scope(env);
+  env.insert("a", mksptr<NumberValue>(a));
+  env.insert("b", mksptr<NumberValue>(b));
+  env.insert("s", mksptr<StringValue>(s.str()));
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  exprInterpreter.setDiagnosticStream(diagOS);
+  StmtInterpreter interpreter(srcMgr, exprInterpreter, env, os);
+  for (const auto &stmt : program)
+    std::visit(interpreter, *stmt);
+  result.Success = !interpreter.getError();
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("Prepared script test" * doctest::test_suite("Interpreter tests")) {
+  const StringRef params[] = {"a", "b", "s"};
+
+  SUBCASE("same output and diagnostics as the interpreter") {
+    for (const auto *code : {
+             "print a + b * 2;",
+             "var t = a / b; print t > 1; print -t; print !(t <= 2);",
+             "print s + \"-\" + s; var u = s + s; u = u + \"!\"; print u;",
+             "print a == b; print s != \"x\"; print nil == nil; print !nil;",
+             "print c; c = 1; print a + s; print -s;",
+             "var v; print v; v = a; print v; var w = v + x; print w;",
+             "a = a * 2; print a; var a = \"shadow\"; print a;",
+             "print (a = 3) + (b = 4); print a * b;",
+             "print \"a\" + 1; print true < 1; print s;",
+         }) {
+      const auto prepared = PreparedScript::prepare("prepared", code, params);
+      REQUIRE(prepared);
+      for (const auto &[a, b, s] : {std::tuple{1.5L, 2.0L, "x"},
+                                    std::tuple{7.0L, -3.25L, "long string"},
+                                    std::tuple{0.0L, 0.0L, ""}}) {
+        const auto expected = interpret(code, a, b, s);
+        RunResult actual;
+        raw_string_ostream os(actual.Output), diagOS(actual.Diagnostics);
+        prepared->setDiagnosticStream(diagOS);
+        prepared->bindNumber(0u, a);
+        prepared->bindNumber(1u, b);
+        prepared->bindString(2u, s);
+        actual.Success = prepared->invoke(os);
+        CHECK_EQ(actual.Output, expected.Output);
+        CHECK_EQ(actual.Diagnostics, expected.Diagnostics);
+        CHECK_EQ(actual.Success, expected.Success);
+      }
+    }
+  }
+
+  SUBCASE("parameters start from their bound values") {
+    const auto prepared = PreparedScript::prepare(
+        "prepared", "a = a + 1; print a; print b;", params);
+    REQUIRE(prepared);
+    CHECK_EQ(prepared->getParamCount(), 3u);
+    std::string output;
+    raw_string_ostream os(output);
+    prepared->bindNumber(0u, 1.0L);
+    CHECK(prepared->invoke(os));
+    CHECK(prepared->invoke(os));
+    prepared->bindBool(1u, true);
+    prepared->bindNil(0u);
+    prepared->setDiagnosticStream(nulls());
+    CHECK_FALSE(prepared->invoke(os));
+    CHECK_EQ(output, "2.000000\nnil\n2.000000\nnil\nnil\ntrue\n");
+    CHECK_EQ(prepared->getError(), 1u);
+  }
+
+  SUBCASE("syntax errors") {
+    std::string diag;
+    raw_string_ostream diagOS(diag);
+    CHECK_FALSE(PreparedScript::prepare("bad", "print a +;", params, diagOS));
+    CHECK_NE(diag.find("bad:1:10"), std::string::npos);
+  }
+
+  SUBCASE("no allocation on the steady state") {
+    const auto prepared = PreparedScript::prepare(
+        "prepared",
+        "var total = a * b; var label = s + \": \"; print label;"
+        "print total * 1.08; print total > 100 == (s == \"big\");",
+        params);
+    REQUIRE(prepared);
+    SmallString<256> output;
+    raw_svector_ostream os(output);
+    const auto run = [&](const long double a, const StringRef s) {
+      output.clear();
+      prepared->bindNumber(0u, a);
+      prepared->bindNumber(1u, 3.0L);
+      prepared->bindString(2u, s);
+      return prepared->invoke(os);
+    };
+    REQUIRE(run(50.0L, "a label long enough to be on the heap"));
+
+    const auto before = Allocations.load();
+    for (auto i = 0u; i < 1000u; ++i)
+      run(i, i % 2u ? "big" : "small");
+    CHECK_EQ(Allocations.load(), before);
+    CHECK_EQ(output, "big: \n3236.760000\ntrue\n");
+  }
+}
+
+} // namespace lox
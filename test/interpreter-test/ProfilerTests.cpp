@@ -0,0 +1,59 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/Profiler.hpp"
+
+namespace lox {
+
+TEST_CASE("Profiler test" * doctest::test_suite("Interpreter tests")) {
+  const StringRef code = "var a = 1;\nprint a + 2;\n";
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  const auto line1 = SMLoc::getFromPointer(code.data());
+  const auto line2 = SMLoc::getFromPointer(code.data() + code.find("print"));
+  const auto plus = SMLoc::getFromPointer(code.data() + code.find('+'));
+
+  Profiler profiler(srcMgr);
+
+  SUBCASE("folded stacks") {
+    profiler.push(line1);
+    profiler.sample();
+    profiler.pop();
+
+    profiler.push(line2);
+    profiler.push(plus);
+    profiler.sample();
+    profiler.sample();
+    profiler.pop();
+    profiler.pop();
+
+    // Nothing is running.
+    profiler.sample();
+
+    CHECK_EQ(profiler.getSampleCount(), 3u);
+
+    std::string folded;
+    raw_string_ostream ss(folded);
+    profiler.printFoldedStacks(ss);
+    CHECK_EQ(ss.str(), "source:1 1\nsource:2 2\n");
+  }
+
+  SUBCASE("hot lines") {
+    profiler.push(line1);
+    profiler.sample();
+    profiler.push(line2);
+    profiler.sample();
+    profiler.sample();
+    profiler.pop();
+    profiler.pop();
+
+    std::string hot;
+    raw_string_ostream ss(hot);
+    profiler.printHotLines(ss);
+    CHECK_EQ(ss.str(), R"(   self%   total%  location
+  66.67%   66.67%  source:2
+  33.33%  100.00%  source:1
+)");
+  }
+}
+
+} // namespace lox
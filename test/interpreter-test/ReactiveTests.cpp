@@ -0,0 +1,145 @@
+#include "doctest/doctest.h"
+#include "lox/interpreter/Reactive.hpp"
+#include <map>
+
+namespace lox {
+
+namespace {
+
+using Inputs = std::map<std::string, long double>;
+
+/// The output of a full run of `script` with `inputs` defined.
+std::string runFull(const sptr<const CompiledScript> &script,
+                    const Inputs &inputs) {
+  std::string output;
+  raw_string_ostream os(output);
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(
+      MemoryBuffer::getMemBuffer(script->getSource(), script->getName(),
+                                 false),
+      {});
+  LoxValueEnv env;
+  LoxValueScope scope(env);
+  for (const auto &[name, value] : inputs)
+    env.insert(name, mksptr<NumberValue>(value));
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  exprInterpreter.setDiagnosticStream(nulls());
+  StmtInterpreter interpreter(srcMgr, exprInterpreter, env, os);
+  for (const auto &stmt : script->getProgram())
+    std::visit(interpreter, *stmt);
+  return output;
+}
+
+} // namespace
+
+TEST_CASE("Reactive script test" * doctest::test_suite("Interpreter tests")) {
+  SUBCASE("only dependent statements are executed") {
+    const auto script = CompiledScript::compile("sheet", R"(
+var price = base * 2;
+var tax = price * rate;
+var label = "total";
+print label;
+print price + tax;
+print rate;
+)");
+    REQUIRE(script);
+    ReactiveScript reactive(script);
+    reactive.setInput("base", mksptr<NumberValue>(10.0L));
+    reactive.setInput("rate", mksptr<NumberValue>(0.5L));
+
+    std::string output;
+    raw_string_ostream os(output);
+    CHECK_EQ(reactive.run(os), 6u);
+    CHECK_EQ(output, "total\n30.000000\n0.500000\n");
+
+    output.clear();
+    reactive.setInput("base", mksptr<NumberValue>(20.0L));
+    CHECK_EQ(reactive.run(os), 3u);
+    CHECK_EQ(output, "60.000000\n");
+    CHECK_EQ(reactive.getOutput(), "total\n60.000000\n0.500000\n");
+
+    output.clear();
+    reactive.setInput("rate", mksptr<NumberValue>(0.25L));
+    CHECK_EQ(reactive.run(os), 3u);
+    CHECK_EQ(output, "50.000000\n0.250000\n");
+
+    // Nothing changed: nothing runs.
+    output.clear();
+    reactive.setInput("rate", mksptr<NumberValue>(0.25L));
+    CHECK_EQ(reactive.run(os), 0u);
+    CHECK_EQ(output, "");
+    CHECK_EQ(reactive.lookup("tax")->str(), "10.000000");
+  }
+
+  SUBCASE("unchanged results stop the propagation") {
+    const auto script = CompiledScript::compile("cutoff", R"(
+var positive = x > 0;
+var a = positive == true;
+print a;
+)");
+    REQUIRE(script);
+    ReactiveScript reactive(script);
+    reactive.setInput("x", mksptr<NumberValue>(1.0L));
+    CHECK_EQ(reactive.run(nulls()), 3u);
+    reactive.setInput("x", mksptr<NumberValue>(2.0L));
+    CHECK_EQ(reactive.run(nulls()), 1u);
+    reactive.setInput("x", mksptr<NumberValue>(-1.0L));
+    CHECK_EQ(reactive.run(nulls()), 3u);
+    CHECK_EQ(reactive.getOutput(), "false\n");
+  }
+
+  SUBCASE("runtime errors are reported when executed") {
+    const auto script = CompiledScript::compile("errors", R"(
+var y = x + 1;
+print y;
+print z;
+)");
+    REQUIRE(script);
+    std::string diag;
+    raw_string_ostream diagOS(diag);
+    ReactiveScript reactive(script);
+    reactive.setDiagnosticStream(diagOS);
+    reactive.run(nulls());
+    CHECK_EQ(reactive.getError(), 3u);
+    CHECK_NE(diag.find("errors:2:9"), std::string::npos);
+    CHECK_NE(diag.find("errors:3:7"), std::string::npos);
+    CHECK_NE(diag.find("errors:4:7"), std::string::npos);
+
+    reactive.setInput("x", mksptr<NumberValue>(1.0L));
+    CHECK_EQ(reactive.run(nulls()), 2u);
+    CHECK_EQ(reactive.getError(), 3u);
+    CHECK_EQ(reactive.getOutput(), "2.000000\n");
+  }
+
+  SUBCASE("same output as a full run") {
+    for (const auto *code : {
+             "var a = x; print a; a = 5; print a; var a = a + y; print a;",
+             "x = x * 2; print x; var b = x + y; x = b; print x + b;",
+             "var c = x > y; print c == true; var d; print d; d = c; print d;",
+             "var e = w; print e; var w = x; print w; e = w + e; print e;",
+             "var s = \"s\"; s = s + s; print s; print x / y; var s = y;",
+             "var f = x + y; f = f * f; f = f - x; print f; print f > 100;",
+         }) {
+      const auto script = CompiledScript::compile("sheet", code, nulls());
+      REQUIRE(script);
+      ReactiveScript reactive(script);
+      reactive.setDiagnosticStream(nulls());
+      Inputs inputs{{"x", 1.0L}, {"y", 2.0L}};
+      for (const auto &[name, value] : inputs)
+        reactive.setInput(name, mksptr<NumberValue>(value));
+      reactive.run(nulls());
+      CHECK_EQ(reactive.getOutput(), runFull(script, inputs));
+
+      for (const auto &[name, value] :
+           {std::pair{"x", 3.0L}, std::pair{"y", -4.5L}, std::pair{"x", 3.0L},
+            std::pair{"y", 20.0L}, std::pair{"x", 0.0L}}) {
+        inputs[name] = value;
+        reactive.setInput(name, mksptr<NumberValue>(value));
+        reactive.run(nulls());
+        CHECK_EQ(reactive.getOutput(), runFull(script, inputs));
+      }
+    }
+  }
+}
+
+} // namespace lox
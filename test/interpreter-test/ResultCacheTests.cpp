@@ -0,0 +1,137 @@
+#include "doctest/doctest.h"
+#include "lox/interpreter/ResultCache.hpp"
+#include "lox/parser/Lexer.hpp"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+
+namespace lox {
+
+static ResultKey getKey(const StringRef name, const StringRef code) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, name), {});
+  Lexer lexer(srcMgr, code);
+  REQUIRE(lexer.Lex());
+  return ResultCache::makeKey(name, code, lexer.getTokens());
+}
+
+static CachedResult makeResult(const StringRef output,
+                               const StringRef diagnostics = "",
+                               const double seconds = 0.5) {
+  CachedResult result;
+  result.Output = output.str();
+  result.Diagnostics = diagnostics.str();
+  result.ExitCode = diagnostics.empty() ? 0 : 70;
+  result.Seconds = seconds;
+  return result;
+}
+
+TEST_CASE("Result cache test" * doctest::test_suite("Interpreter tests")) {
+  SUBCASE("keys ignore whitespace and comments") {
+    const auto key = getKey("a.lox", "var a = 1;\nprint a + 2;\n");
+    const auto spaced =
+        getKey("a.lox", "// sum\nvar a=1;  print a+2; // done\n");
+    const auto renamed = getKey("b.lox", "var a = 1;\nprint a + 2;\n");
+    CHECK_EQ(spaced.Tokens, key.Tokens);
+    CHECK_NE(spaced.Exact, key.Exact);
+    CHECK_EQ(renamed.Tokens, key.Tokens);
+    CHECK_NE(renamed.Exact, key.Exact);
+
+    for (const auto *other : {"var a = 1;\nprint a + 3;\n",
+                              "var b = 1;\nprint b + 2;\n",
+                              "var a = \"1\";\nprint a + 2;\n"})
+      CHECK_NE(getKey("a.lox", other).Tokens, key.Tokens);
+  }
+
+  SUBCASE("hits, misses and saved time") {
+    ResultCache cache;
+    const auto key = getKey("a.lox", "print 1;");
+    CHECK_FALSE(cache.lookup(key));
+    CHECK(cache.store(key, makeResult("1.000000\n")));
+
+    const auto hit = cache.lookup(getKey("a.lox", "print   1 ;"));
+    REQUIRE(hit);
+    CHECK_EQ(hit->Output, "1.000000\n");
+    CHECK_EQ(hit->ExitCode, 0);
+    CHECK(cache.lookup(key));
+
+    const auto stats = cache.getStats();
+    CHECK_EQ(stats.Hits, 2u);
+    CHECK_EQ(stats.Misses, 1u);
+    CHECK_EQ(stats.Stores, 1u);
+    CHECK_EQ(stats.Entries, 1u);
+    CHECK_EQ(stats.SavedSeconds, 1.0);
+    CHECK_EQ(stats.getHitRate(), 2.0 / 3.0);
+  }
+
+  SUBCASE("diagnostics are only replayed for the same source") {
+    ResultCache cache;
+    const auto key = getKey("a.lox", "print b;");
+    CHECK(cache.store(key, makeResult("", "a.lox:1:7: error")));
+    CHECK(cache.lookup(key));
+    CHECK_FALSE(cache.lookup(getKey("a.lox", "print  b;")));
+    CHECK_FALSE(cache.lookup(getKey("c.lox", "print b;")));
+  }
+
+  SUBCASE("least recently used results are evicted") {
+    ResultCacheOptions options;
+    // Room for two results of this size.
+    const auto size = makeResult("x").Output.size();
+    options.MaxBytes = 2u * (size + 64u) + 10u;
+    ResultCache cache(options);
+    const auto a = getKey("a", "print 1;"), b = getKey("b", "print 2;"),
+               c = getKey("c", "print 3;");
+    cache.store(a, makeResult("x"));
+    cache.store(b, makeResult("x"));
+    CHECK(cache.lookup(a));
+    cache.store(c, makeResult("x"));
+    CHECK(cache.lookup(a));
+    CHECK_FALSE(cache.lookup(b));
+    CHECK(cache.lookup(c));
+    CHECK_EQ(cache.getStats().Evictions, 1u);
+
+    // Larger than the whole cache: not kept.
+    cache.store(b, makeResult(std::string(options.MaxBytes, 'x')));
+    CHECK_FALSE(cache.lookup(b));
+    CHECK_EQ(cache.getStats().Entries, 2u);
+  }
+
+  SUBCASE("results persist in a directory") {
+    SmallString<128> dir;
+    REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-results", dir));
+    ResultCacheOptions options;
+    options.Dir = dir.str().str();
+    const auto a = getKey("a", "print 1;"), b = getKey("b", "print b;");
+    {
+      ResultCache cache(options);
+      CHECK(cache.store(a, makeResult("1.000000\n")));
+      CHECK(cache.store(b, makeResult("", "b:1:7: error", 2.0)));
+    }
+    {
+      ResultCache cache(options);
+      CHECK_EQ(cache.getStats().Entries, 2u);
+      const auto hit = cache.lookup(b);
+      REQUIRE(hit);
+      CHECK_EQ(hit->Diagnostics, "b:1:7: error");
+      CHECK_EQ(hit->ExitCode, 70);
+      CHECK_EQ(hit->Seconds, 2.0);
+      CHECK_FALSE(cache.lookup(getKey("b", "print  b;")));
+      CHECK(cache.lookup(a));
+    }
+
+    // A smaller cache keeps the most recently used file only.
+    options.MaxBytes = 80u;
+    {
+      ResultCache cache(options);
+      CHECK_EQ(cache.getStats().Entries, 1u);
+      CHECK_EQ(cache.getStats().Evictions, 1u);
+      CHECK(cache.lookup(a));
+    }
+    ResultCache cache(options);
+    CHECK_FALSE(cache.lookup(b));
+    sys::fs::remove_directories(dir);
+  }
+}
+
+} // namespace lox
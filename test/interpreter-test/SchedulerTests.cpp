@@ -0,0 +1,151 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/Resumable.hpp"
+#include "lox/interpreter/Scheduler.hpp"
+
+namespace lox {
+
+/// Run `code` in slices of `fuel` and compare with running it in one go.
+inline bool runResumableTest(const StringRef code, const std::uint64_t fuel) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  Lexer lexer(srcMgr, code);
+  if (!lexer.Lex())
+    return false;
+  Parser parser(lexer.getTokens(), srcMgr);
+  const auto program = parser.Parse();
+  if (parser.getError())
+    return false;
+
+  std::string expected, expectedDiag, output, diag;
+  raw_string_ostream expectedOS(expected), expectedDiagOS(expectedDiag);
+  raw_string_ostream os(output), diagOS(diag);
+  {
+    LoxValueEnv env;
+    ExprInterpreter exprInterpreter(srcMgr, env);
+    exprInterpreter.setDiagnosticStream(expectedDiagOS);
+    StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, expectedOS);
+    LoxValueScope globalScope(env);
+    for (const auto &stmt : program)
+      std::visit(stmtInterpreter, *stmt);
+  }
+
+  LoxValueEnv env;
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  exprInterpreter.setDiagnosticStream(diagOS);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+  LoxValueScope globalScope(env);
+  ResumableInterpreter resumable(stmtInterpreter);
+  resumable.start(program);
+  auto slices = 0u;
+  while (!resumable.resume(fuel))
+    slices++;
+
+  CHECK_EQ(output, expected);
+  CHECK_EQ(diag, expectedDiag);
+  CHECK_GE(slices + 1u, resumable.getFuelUsed() / fuel);
+  return output == expected && diag == expectedDiag;
+}
+
+TEST_CASE("Resumable interpreter test" *
+          doctest::test_suite("Interpreter tests")) {
+  const StringRef code = R"(
+var a = 1;
+var b = (a + 2) * -(3 - a) / 4;
+print a + b;
+print "s" + "t" + "r";
+var c;
+print c;
+a = b = !true == false;
+print a;
+print y;
+print (z = 1) + 1;
+print -"x";
+print 1 + nil;
+print 1 < 2 != 2 >= 3;
+)";
+  for (const auto fuel : {1u, 2u, 3u, 7u, 1000u})
+    CHECK(runResumableTest(code, fuel));
+}
+
+TEST_CASE("Scheduler test" * doctest::test_suite("Interpreter tests")) {
+  const auto shortScript = CompiledScript::compile("short", "print 1 + 1;");
+  std::string longCode;
+  for (auto i = 0u; i < 200u; ++i)
+    longCode += "print " + std::to_string(i) + " * 2;\n";
+  const auto longScript = CompiledScript::compile("long", longCode);
+  const auto badScript = CompiledScript::compile("bad", "print -nil;");
+  REQUIRE(shortScript);
+  REQUIRE(longScript);
+  REQUIRE(badScript);
+
+  SUBCASE("fair slicing lets short scripts through") {
+    SchedulerOptions options;
+    options.Slice = 50u;
+    ScriptScheduler scheduler(options);
+    ScriptJob heavy{longScript, "heavy"};
+    const auto heavyId = scheduler.submit(heavy);
+    std::vector<std::size_t> light;
+    for (auto i = 0u; i < 20u; ++i)
+      light.push_back(scheduler.submit({shortScript, "light"}));
+    const auto badId = scheduler.submit({badScript, "light"});
+    scheduler.run();
+
+    const auto &heavyResult = scheduler.getResult(heavyId);
+    CHECK_EQ(heavyResult.Status, JobStatus::Finished);
+    CHECK_GT(heavyResult.Slices, 1u);
+    CHECK_EQ(heavyResult.Output.substr(0u, 18u), "0.000000\n2.000000\n");
+    for (const auto id : light) {
+      CHECK_EQ(scheduler.getResult(id).Status, JobStatus::Finished);
+      CHECK_EQ(scheduler.getResult(id).Output, "2.000000\n");
+      CHECK_LE(scheduler.getResult(id).Latency, heavyResult.Latency);
+    }
+    CHECK_EQ(scheduler.getResult(badId).Status, JobStatus::Failed);
+    CHECK_NE(scheduler.getResult(badId).Diagnostics.find("bad:1:7"),
+             std::string::npos);
+
+    const auto latencies = scheduler.getLatencies();
+    REQUIRE_EQ(latencies.size(), 2u);
+    CHECK_EQ(latencies[0].Class, "heavy");
+    CHECK_EQ(latencies[1].Class, "light");
+    CHECK_EQ(latencies[1].Jobs, 21u);
+    CHECK_LE(latencies[1].P50, latencies[1].P99);
+  }
+
+  SUBCASE("priority and limits") {
+    SchedulerOptions options;
+    options.Slice = 10u;
+    options.Policy = SlicePolicy::Priority;
+    ScriptScheduler scheduler(options);
+    ScriptJob limited{longScript, "limited"};
+    limited.FuelLimit = 25u;
+    const auto limitedId = scheduler.submit(limited);
+    const auto lowId = scheduler.submit({shortScript, "low", 0u});
+    const auto highId = scheduler.submit({longScript, "high", 5u});
+    scheduler.run();
+
+    const auto &limitedResult = scheduler.getResult(limitedId);
+    CHECK_EQ(limitedResult.Status, JobStatus::FuelLimitExceeded);
+    CHECK_EQ(limitedResult.FuelUsed, 25u);
+    // Four units per statement: the statement, `*` and its two operands.
+    CHECK_EQ(StringRef(limitedResult.Output).count('\n'), 6u);
+    CHECK_EQ(scheduler.getResult(highId).Status, JobStatus::Finished);
+    // The high-priority job runs to the end before the others get a slice.
+    CHECK_LT(scheduler.getResult(highId).Latency,
+             scheduler.getResult(lowId).Latency);
+  }
+
+  SUBCASE("threads") {
+    SchedulerOptions options;
+    options.Threads = 3u;
+    options.Slice = 7u;
+    ScriptScheduler scheduler(options);
+    for (auto i = 0u; i < 300u; ++i)
+      scheduler.submit({i % 10u ? shortScript : longScript});
+    scheduler.run();
+    for (auto i = 0u; i < 300u; ++i)
+      CHECK_EQ(scheduler.getResult(i).Status, JobStatus::Finished);
+  }
+}
+
+} // namespace lox
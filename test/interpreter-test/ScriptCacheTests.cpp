@@ -0,0 +1,280 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/ScriptCache.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+namespace lox {
+
+struct CacheRun {
+  std::string Output;
+  std::string Diagnostics;
+  bool Error = false;
+};
+
+/// Run `code` from the tree, or from `image` when given.
+static CacheRun runCached(const StringRef code, const ScriptImage *image) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  CacheRun run;
+  raw_string_ostream os(run.Output);
+  raw_string_ostream diagOS(run.Diagnostics);
+  srcMgr.setDiagHandler(
+      [](const SMDiagnostic &diag, void *context) {
+        diag.print(nullptr, *static_cast<raw_ostream *>(context), false);
+      },
+      &diagOS);
+
+  Lexer lexer(srcMgr, code);
+  Program program;
+  if (!image) {
+    REQUIRE(lexer.Lex());
+    Parser parser(lexer.getTokens(), srcMgr);
+    program = parser.Parse();
+    REQUIRE_FALSE(parser.getError());
+  }
+
+  LoxValueEnv env;
+  ExprInterpreter exprInterpreter(srcMgr, env);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, env, os);
+  {
+    LoxValueScope globalScope(env);
+    if (image) {
+      image->execute(stmtInterpreter);
+    } else {
+      for (const auto &stmt : program)
+        std::visit(stmtInterpreter, *stmt);
+    }
+  }
+  run.Error = stmtInterpreter.getError();
+  return run;
+}
+
+static Program parseProgram(const StringRef code, SourceMgr &srcMgr,
+                            Lexer &lexer) {
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  REQUIRE(lexer.Lex());
+  Parser parser(lexer.getTokens(), srcMgr);
+  auto program = parser.Parse();
+  REQUIRE_FALSE(parser.getError());
+  return program;
+}
+
+TEST_CASE("Script cache test" * doctest::test_suite("Interpreter tests")) {
+  SmallString<128> dir;
+  REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-cache-test", dir));
+  const ScriptCache cache(dir.str().str());
+
+  SUBCASE("image runs like the tree") {
+    const StringRef code = R"(
+var a = 1;
+var b;
+a = a + 2 * (3 - -1);
+print a;
+print !(a == 9) == true;
+print "con" + "cat";
+print b;
+b = a = 4;
+print a + b;
+print nil == false;
+print 1 + "x";
+print c;
+)";
+    {
+      SourceMgr srcMgr;
+      Lexer lexer(srcMgr, code);
+      const auto program = parseProgram(code, srcMgr, lexer);
+      CHECK(cache.store(code, program));
+    }
+    const auto image = cache.lookup(code);
+    REQUIRE(image);
+    CHECK_EQ(image->getStmtCount(), 12u);
+
+    const auto expected = runCached(code, nullptr);
+    const auto cached = runCached(code, image.get());
+    CHECK(expected.Error);
+    CHECK_EQ(cached.Error, expected.Error);
+    CHECK_EQ(cached.Output, expected.Output);
+    CHECK_EQ(cached.Diagnostics, expected.Diagnostics);
+    CHECK_NE(cached.Diagnostics.find("Undefined variable : c"),
+             std::string::npos);
+  }
+
+  SUBCASE("arrays run like the tree") {
+    const StringRef code = R"(
+var a = [1, 2, 3];
+print a * 2 - [1, 1, 1];
+print a[1] + len([]) + dot(a, a);
+print sort(slice([3, 2, 1, 0], 1, 4));
+print max(range(5)) + min(array(2, -1));
+print a[3];
+print len(1);
+)";
+    {
+      SourceMgr srcMgr;
+      Lexer lexer(srcMgr, code);
+      const auto program = parseProgram(code, srcMgr, lexer);
+      CHECK(cache.store(code, program));
+    }
+    const auto image = cache.lookup(code);
+    REQUIRE(image);
+
+    const auto expected = runCached(code, nullptr);
+    const auto cached = runCached(code, image.get());
+    CHECK(expected.Error);
+    CHECK_EQ(cached.Output, expected.Output);
+    CHECK_EQ(cached.Diagnostics, expected.Diagnostics);
+    CHECK_EQ(cached.Output, "[1.000000, 3.000000, 5.000000]\n16.000000\n"
+                            "[0.000000, 1.000000, 2.000000]\n3.000000\n");
+  }
+
+  SUBCASE("maps run like the tree") {
+    const StringRef code = R"(
+var m = {"a": 1, 2: [3], nil: {}};
+print m["a"] + get(m, 2)[0];
+print len(set(m, "b", true)) + len(delete(m, nil));
+print has(m, 2);
+m = set(m, "c", m);
+var n = m;
+m = delete(m, "a");
+print len(m) + len(n);
+m = delete(m, "c");
+print len(m) + len(n);
+print {0 / 0: 1};
+)";
+    {
+      SourceMgr srcMgr;
+      Lexer lexer(srcMgr, code);
+      const auto program = parseProgram(code, srcMgr, lexer);
+      CHECK(cache.store(code, program));
+    }
+    const auto image = cache.lookup(code);
+    REQUIRE(image);
+
+    const auto expected = runCached(code, nullptr);
+    const auto cached = runCached(code, image.get());
+    CHECK(expected.Error);
+    CHECK_EQ(cached.Output, expected.Output);
+    CHECK_EQ(cached.Diagnostics, expected.Diagnostics);
+    CHECK_EQ(cached.Output,
+             "4.000000\n6.000000\ntrue\n7.000000\n6.000000\n");
+  }
+
+  SUBCASE("a changed source misses") {
+    const StringRef code = "print 1;\n";
+    SourceMgr srcMgr;
+    Lexer lexer(srcMgr, code);
+    CHECK(cache.store(code, parseProgram(code, srcMgr, lexer)));
+    CHECK(cache.lookup(code));
+    CHECK_FALSE(cache.lookup("print 2;\n"));
+    CHECK_FALSE(ScriptImage::load(cache.getPath(code), "print 2;\n"));
+  }
+
+  SUBCASE("damaged images are refused") {
+    const StringRef code = "var a = 1;\nprint a + a;\n";
+    const auto path = cache.getPath(code);
+    std::string bytes;
+    {
+      SourceMgr srcMgr;
+      Lexer lexer(srcMgr, code);
+      raw_string_ostream os(bytes);
+      CHECK(ScriptImage::write(os, code, parseProgram(code, srcMgr, lexer)));
+    }
+
+    const auto writeFile = [&](const StringRef contents) {
+      std::error_code ec;
+      raw_fd_ostream os(path, ec);
+      REQUIRE_FALSE(ec);
+      os << contents;
+    };
+
+    writeFile(bytes);
+    CHECK(ScriptImage::load(path, code));
+
+    writeFile(StringRef(bytes).take_front(bytes.size() / 2u));
+    CHECK_FALSE(ScriptImage::load(path, code));
+
+    auto badVersion = bytes;
+    badVersion[8] ^= 0x7f;
+    writeFile(badVersion);
+    CHECK_FALSE(ScriptImage::load(path, code));
+
+    // A node referring to itself.
+    auto badNode = bytes;
+    std::uint64_t nodeOffset;
+    std::memcpy(&nodeOffset, badNode.data() + 56, sizeof(nodeOffset));
+    const std::uint32_t self = 0u;
+    std::memcpy(badNode.data() + nodeOffset + 8, &self, sizeof(self));
+    badNode[nodeOffset] = 0; // binary
+    writeFile(badNode);
+    CHECK_FALSE(ScriptImage::load(path, code));
+
+    // `a + a` is the last node; an operator the interpreter has no case for.
+    std::uint32_t nodeCount;
+    std::memcpy(&nodeCount, bytes.data() + 36, sizeof(nodeCount));
+    const auto lastNode = nodeOffset + (nodeCount - 1u) * 20u;
+    REQUIRE_EQ(bytes[lastNode], 0); // binary
+    REQUIRE_EQ(bytes[lastNode + 1], static_cast<char>(Tok_plus));
+    for (const auto op : {Tok_bang, Tok_number, Tok_eof}) {
+      auto badOp = bytes;
+      badOp[lastNode + 1] = static_cast<char>(op);
+      writeFile(badOp);
+      CHECK_FALSE(ScriptImage::load(path, code));
+    }
+
+    // The literal `1` as a string that does not parse as a number.
+    std::uint64_t stringDataOffset;
+    std::memcpy(&stringDataOffset, bytes.data() + 72,
+                sizeof(stringDataOffset));
+    const auto one = bytes.find('1', stringDataOffset);
+    REQUIRE(one != std::string::npos);
+    auto badNumber = bytes;
+    badNumber[one] = 'x';
+    writeFile(badNumber);
+    CHECK_FALSE(ScriptImage::load(path, code));
+  }
+
+  SUBCASE("operands that are list links are refused") {
+    // Nodes: 1, the Flat_arg of [1], [1], 1, 2 and 1 + 2.
+    const StringRef code = "print [1];\nprint 1 + 2;\n";
+    const auto path = cache.getPath(code);
+    std::string bytes;
+    {
+      SourceMgr srcMgr;
+      Lexer lexer(srcMgr, code);
+      raw_string_ostream os(bytes);
+      CHECK(ScriptImage::write(os, code, parseProgram(code, srcMgr, lexer)));
+    }
+    const auto writeFile = [&](const StringRef contents) {
+      std::error_code ec;
+      raw_fd_ostream os(path, ec);
+      REQUIRE_FALSE(ec);
+      os << contents;
+    };
+    writeFile(bytes);
+    CHECK(ScriptImage::load(path, code));
+
+    std::uint64_t stmtOffset, nodeOffset;
+    std::memcpy(&stmtOffset, bytes.data() + 48, sizeof(stmtOffset));
+    std::memcpy(&nodeOffset, bytes.data() + 56, sizeof(nodeOffset));
+    const std::uint32_t link = 1u;
+    REQUIRE_EQ(bytes[nodeOffset + link * 20u], 9); // arg
+    const auto binary = nodeOffset + 5u * 20u;
+    REQUIRE_EQ(bytes[binary], 0); // binary
+
+    auto badOperand = bytes;
+    std::memcpy(badOperand.data() + binary + 8, &link, sizeof(link));
+    writeFile(badOperand);
+    CHECK_FALSE(ScriptImage::load(path, code));
+
+    // The second statement's expression.
+    auto badStmt = bytes;
+    std::memcpy(badStmt.data() + stmtOffset + 12u + 4u, &link, sizeof(link));
+    writeFile(badStmt);
+    CHECK_FALSE(ScriptImage::load(path, code));
+  }
+
+  sys::fs::remove_directories(dir);
+}
+
+} // namespace lox
@@ -0,0 +1,83 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/Isolate.hpp"
+#include "lox/interpreter/SharedGlobals.hpp"
+#include "llvm/Support/Casting.h"
+#include <thread>
+
+namespace lox {
+
+TEST_CASE("Shared globals test" * doctest::test_suite("Interpreter tests")) {
+  SharedGlobals globals;
+  globals.define("limit", mksptr<NumberValue>(10));
+  globals.define("name", mksptr<StringValue>("prod"));
+
+  SUBCASE("define, assign, lookup") {
+    CHECK_EQ(globals.size(), 2u);
+    CHECK(globals.count("limit"));
+    CHECK_FALSE(globals.count("other"));
+    CHECK_EQ(globals.lookup("other"), nullptr);
+    CHECK(globals.assign("limit", mksptr<NumberValue>(20)));
+    CHECK_FALSE(globals.assign("other", mksptr<NumberValue>(20)));
+    CHECK_EQ(globals.lookup("limit")->str(), "20.000000");
+    globals.define("limit", mksptr<NumberValue>(30));
+    CHECK_EQ(globals.lookup("limit")->str(), "30.000000");
+    CHECK_EQ(globals.size(), 2u);
+  }
+
+  SUBCASE("isolates read, write and shadow") {
+    const auto read = CompiledScript::compile("read", R"(
+print name + "-" + "x";
+print limit * 2;
+)");
+    const auto write = CompiledScript::compile("write", "limit = limit + 1;");
+    const auto shadow =
+        CompiledScript::compile("shadow", "var limit = 0;\nlimit = 5;\n");
+    REQUIRE(read);
+    REQUIRE(write);
+    REQUIRE(shadow);
+
+    Isolate reader, writer, shadower;
+    reader.setSharedGlobals(&globals);
+    writer.setSharedGlobals(&globals);
+    shadower.setSharedGlobals(&globals);
+
+    CHECK(reader.run(read));
+    CHECK(writer.run(write));
+    CHECK(shadower.run(shadow));
+    CHECK(reader.run(read));
+    CHECK_EQ(reader.getOutput(),
+             "prod-x\n20.000000\nprod-x\n22.000000\n");
+    CHECK_EQ(globals.lookup("limit")->str(), "11.000000");
+  }
+
+  SUBCASE("concurrent readers and writers") {
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned> torn(0u);
+    std::vector<std::thread> readers;
+    for (auto i = 0u; i < 4u; ++i)
+      readers.emplace_back([&] {
+        while (!stop.load()) {
+          const auto value = globals.lookup("limit");
+          const auto *number = dyn_cast<NumberValue>(value.get());
+          if (!number || number->getValue() < 10)
+            torn++;
+        }
+      });
+
+    for (auto i = 0u; i < 2000u; ++i) {
+      globals.assign("limit", mksptr<NumberValue>(10 + i));
+      if (i % 100u == 0u)
+        globals.define("v" + std::to_string(i), mksptr<NilValue>());
+    }
+    stop.store(true);
+    for (auto &reader : readers)
+      reader.join();
+
+    CHECK_EQ(torn.load(), 0u);
+    CHECK_EQ(globals.size(), 22u);
+    CHECK_EQ(globals.lookup("limit")->str(), "2009.000000");
+  }
+}
+
+} // namespace lox
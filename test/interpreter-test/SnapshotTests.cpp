@@ -0,0 +1,197 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/Snapshot.hpp"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+namespace lox {
+
+/// Runs a prelude, then a main script, in one global scope.
+struct SnapshotRun {
+  explicit SnapshotRun(const StringRef prelude) : prelude(prelude) {
+    srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(prelude, "prelude"),
+                              {});
+  }
+
+  void runPrelude() {
+    lexers.push_back(mkuptr<Lexer>(srcMgr, prelude));
+    REQUIRE(lexers.back()->Lex());
+    Parser parser(lexers.back()->getTokens(), srcMgr);
+    program = parser.Parse();
+    REQUIRE_FALSE(parser.getError());
+    for (const auto &stmt : program)
+      std::visit(interpreter, *stmt);
+  }
+
+  void runMain(const StringRef code) {
+    const auto id = srcMgr.AddNewSourceBuffer(
+        MemoryBuffer::getMemBuffer(code, "main"), {});
+    lexers.push_back(
+        mkuptr<Lexer>(srcMgr, srcMgr.getMemoryBuffer(id)->getBuffer()));
+    REQUIRE(lexers.back()->Lex());
+    Parser parser(lexers.back()->getTokens(), srcMgr);
+    for (const auto &stmt : parser.Parse())
+      std::visit(interpreter, *stmt);
+  }
+
+  StringRef prelude;
+  SourceMgr srcMgr;
+  std::vector<uptr<Lexer>> lexers;
+  Program program;
+  std::string output;
+  raw_string_ostream os{output};
+  LoxValueEnv env;
+  ExprInterpreter evaluator{srcMgr, env};
+  StmtInterpreter interpreter{srcMgr, evaluator, env, os};
+  LoxValueScope globalScope{env};
+};
+
+TEST_CASE("Environment snapshot test" *
+          doctest::test_suite("Interpreter tests")) {
+  SmallString<128> dir;
+  REQUIRE_FALSE(sys::fs::createUniqueDirectory("lox-snapshot-test", dir));
+  SmallString<128> path(dir);
+  sys::path::append(path, "prelude.snap");
+
+  const StringRef prelude = R"(
+var pi = 3.14159265358979;
+var tau = pi * 2;
+var greeting = "hello";
+var again = "hel" + "lo";
+var yes = true;
+var nothing = nil;
+var unset;
+var pi = 3;
+tau = tau + 1;
+)";
+  const StringRef main = R"(
+print pi;
+print tau;
+print greeting + " " + again;
+print yes;
+print nothing;
+unset = 1;
+print unset;
+)";
+
+  SUBCASE("restoring matches running the prelude") {
+    SnapshotRun replayed(prelude);
+    replayed.runPrelude();
+    CHECK(EnvSnapshot::save(path, prelude, replayed.program, replayed.env));
+    replayed.runMain(main);
+    CHECK_FALSE(replayed.interpreter.getError());
+
+    const auto snapshot = EnvSnapshot::load(path, prelude);
+    REQUIRE(snapshot);
+    CHECK_EQ(snapshot->getBindingCount(), 7u);
+
+    SnapshotRun restored(prelude);
+    snapshot->restore(restored.env);
+    restored.runMain(main);
+    CHECK_FALSE(restored.interpreter.getError());
+    CHECK_EQ(restored.output, replayed.output);
+    CHECK_EQ(restored.output, "3.000000\n7.283185\nhello hello\ntrue\nnil\n"
+                              "1.000000\n");
+  }
+
+  SUBCASE("arrays are restored") {
+    const StringRef arrays = R"(
+var empty = [];
+var values = slice(range(9), 1, 9) / 4;
+var copy = values * 1;
+)";
+    SnapshotRun run(arrays);
+    run.runPrelude();
+    CHECK(EnvSnapshot::save(path, arrays, run.program, run.env));
+    const auto snapshot = EnvSnapshot::load(path, arrays);
+    REQUIRE(snapshot);
+
+    SnapshotRun restored(arrays);
+    snapshot->restore(restored.env);
+    restored.runMain("print empty;\nprint values;\nprint sum(copy);\n");
+    CHECK_FALSE(restored.interpreter.getError());
+    CHECK_EQ(restored.output, "[]\n[0.250000, 0.500000, 0.750000, 1.000000, "
+                              "1.250000, 1.500000, 1.750000, 2.000000]\n"
+                              "9.000000\n");
+    // Equal arrays share one value too.
+    CHECK_EQ(restored.env.lookup("values"), restored.env.lookup("copy"));
+  }
+
+  SUBCASE("maps are restored") {
+    const StringRef maps = R"(
+var empty = {};
+var inner = {1: "one", -0: [2]};
+var outer = {"inner": inner, true: nil, "one": "one"};
+var same = set(outer, "inner", inner);
+)";
+    SnapshotRun run(maps);
+    run.runPrelude();
+    CHECK(EnvSnapshot::save(path, maps, run.program, run.env));
+    const auto snapshot = EnvSnapshot::load(path, maps);
+    REQUIRE(snapshot);
+
+    SnapshotRun restored(maps);
+    snapshot->restore(restored.env);
+    restored.runMain("print empty;\nprint outer[\"inner\"][0][0];\n"
+                     "print get(outer, true);\nprint outer == same;\n"
+                     "print len(inner) + len(outer);\n");
+    CHECK_FALSE(restored.interpreter.getError());
+    CHECK_EQ(restored.output, "{}\n2.000000\nnil\ntrue\n5.000000\n");
+    // Keys, values and the nested map are shared like any value.
+    CHECK_EQ(restored.env.lookup("outer"), restored.env.lookup("same"));
+    const auto *outer = dyn_cast<MapValue>(restored.env.lookup("outer").get());
+    REQUIRE(outer);
+    CHECK_EQ(outer->getTable().find(StringValue("inner"))->Mapped,
+             restored.env.lookup("inner"));
+  }
+
+  SUBCASE("equal values are stored once") {
+    const StringRef shared = "var a = \"x\";\nvar b = \"x\";\nvar c = 1;\n"
+                             "var d = 2 - 1;\n";
+    SnapshotRun run(shared);
+    run.runPrelude();
+    CHECK(EnvSnapshot::save(path, shared, run.program, run.env));
+    const auto snapshot = EnvSnapshot::load(path, shared);
+    REQUIRE(snapshot);
+
+    SnapshotRun restored(shared);
+    snapshot->restore(restored.env);
+    CHECK_EQ(restored.env.lookup("a"), restored.env.lookup("b"));
+    CHECK_EQ(restored.env.lookup("c"), restored.env.lookup("d"));
+    CHECK_NE(restored.env.lookup("a"), restored.env.lookup("c"));
+  }
+
+  SUBCASE("stale and damaged snapshots are refused") {
+    SnapshotRun run(prelude);
+    run.runPrelude();
+    CHECK(EnvSnapshot::save(path, prelude, run.program, run.env));
+    CHECK(EnvSnapshot::load(path, prelude));
+    CHECK_FALSE(EnvSnapshot::load(path, "var pi = 3;\n"));
+
+    auto bytes = MemoryBuffer::getFile(path);
+    REQUIRE(bytes);
+    const auto contents = (*bytes)->getBuffer().str();
+    const auto writeFile = [&](const StringRef data) {
+      std::error_code ec;
+      raw_fd_ostream os(path, ec);
+      REQUIRE_FALSE(ec);
+      os << data;
+    };
+
+    writeFile(StringRef(contents).drop_back(8u));
+    CHECK_FALSE(EnvSnapshot::load(path, prelude));
+
+    // The first binding naming a string past the table.
+    auto badName = contents;
+    std::uint64_t bindingOffset;
+    std::memcpy(&bindingOffset, badName.data() + 48, sizeof(bindingOffset));
+    const std::uint32_t name = 1000u;
+    std::memcpy(badName.data() + bindingOffset, &name, sizeof(name));
+    writeFile(badName);
+    CHECK_FALSE(EnvSnapshot::load(path, prelude));
+  }
+
+  sys::fs::remove_directories(dir);
+}
+
+} // namespace lox
@@ -0,0 +1,101 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/interpreter/Streaming.hpp"
+
+namespace lox {
+
+inline bool runStreamingTest(const StringRef code, const StringRef output,
+                             StreamingStats *statsOut = nullptr,
+                             const PipelineOptions *pipeline = nullptr) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+
+  std::string result;
+  raw_string_ostream ss(result);
+  LoxValueEnv Env;
+  ExprInterpreter exprInterpreter(srcMgr, Env);
+  StmtInterpreter stmtInterpreter(srcMgr, exprInterpreter, Env, ss);
+  StreamingStats stats;
+  {
+    LoxValueScope globalScope(Env);
+    stats = pipeline
+                ? interpretPipelined(srcMgr, code, stmtInterpreter, *pipeline)
+                : interpretStreaming(srcMgr, code, stmtInterpreter);
+  }
+  if (statsOut)
+    *statsOut = stats;
+
+  if (stats.SyntaxErrors || stmtInterpreter.getError())
+    return false;
+
+  if (result != output) {
+    FAIL(result);
+    return false;
+  }
+  return true;
+}
+
+TEST_CASE("Streaming interpreter test" *
+          doctest::test_suite("Interpreter tests")) {
+  SUBCASE("same output as batch") {
+    const auto code = R"(
+var a = 10;
+a = a + 10;
+print a;
+print "hello" + " " + "world";
+)";
+    CHECK(runPrintInterpretTest(code, "20.000000\nhello world\n"));
+    CHECK(runStreamingTest(code, "20.000000\nhello world\n"));
+  }
+
+  SUBCASE("tokens are bounded by statement size") {
+    std::string code = "var a = 0;\n";
+    for (auto i = 0u; i < 1000u; ++i)
+      code += "a = a + 1;\n";
+    code += "print a;\n";
+
+    StreamingStats stats;
+    CHECK(runStreamingTest(code, "1000.000000\n", &stats));
+    CHECK_EQ(stats.Statements, 1002u);
+    CHECK_LE(stats.PeakTokens, 8u);
+  }
+
+  SUBCASE("statements before a syntax error run") {
+    StreamingStats stats;
+    CHECK_FALSE(runStreamingTest("print 1;\nprint ;\nprint 2;\n", "", &stats));
+    CHECK_EQ(stats.Statements, 1u);
+    CHECK_EQ(stats.SyntaxErrors, 1u);
+  }
+}
+
+TEST_CASE("Pipelined interpreter test" *
+          doctest::test_suite("Interpreter tests")) {
+  PipelineOptions options;
+  // Tiny batches and queues exercise the backpressure paths.
+  options.TokenBatch = 3u;
+  options.StmtBatch = 2u;
+  options.QueueDepth = 1u;
+
+  SUBCASE("same output as streaming") {
+    std::string code = "var a = 0;\n";
+    std::string expected;
+    for (auto i = 1u; i <= 200u; ++i) {
+      code += "a = a + 1;\nprint a;\n";
+      expected += std::to_string(static_cast<long double>(i)) + "\n";
+    }
+
+    StreamingStats stats;
+    CHECK(runStreamingTest(code, expected, &stats, &options));
+    CHECK_EQ(stats.Statements, 401u);
+  }
+
+  SUBCASE("statements before a syntax error run") {
+    StreamingStats stats;
+    CHECK_FALSE(runStreamingTest("print 1;\nprint 2;\nprint ;\nprint 3;\n",
+                                 "", &stats, &options));
+    CHECK_EQ(stats.Statements, 2u);
+    CHECK_EQ(stats.SyntaxErrors, 1u);
+  }
+}
+
+} // namespace lox
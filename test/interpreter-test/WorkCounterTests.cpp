@@ -0,0 +1,44 @@
+#include "InterpreterTestUtils.hpp"
+#include "doctest/doctest.h"
+
+namespace lox {
+
+TEST_CASE("Work counter test" * doctest::test_suite("Interpreter tests")) {
+  SUBCASE("counts per kind") {
+    WorkCounters counters;
+    CHECK(runWorkCountTest(R"(
+var a = 1 + 2;
+print a;
+print "ab" + "c";
+)",
+                           counters));
+
+    CHECK_EQ(counters.StmtVisits[WorkCounters::VarS], 1u);
+    CHECK_EQ(counters.StmtVisits[WorkCounters::PrintS], 2u);
+    CHECK_EQ(counters.ExprVisits[WorkCounters::Binary], 2u);
+    CHECK_EQ(counters.ExprVisits[WorkCounters::Literal], 4u);
+    CHECK_EQ(counters.ExprVisits[WorkCounters::Var], 1u);
+    // 4 literals and 2 binary results
+    CHECK_EQ(counters.ValueAllocations, 6u);
+    CHECK_EQ(counters.EnvLookups, 2u);
+    CHECK_EQ(counters.EnvInserts, 1u);
+    // "ab", "c", "abc" and the printed "3.000000" and "abc"
+    CHECK_EQ(counters.StringBytesCopied, 2u + 1u + 3u + 8u + 3u);
+  }
+
+  WORK_BOUND_TEST("arithmetic", R"(
+var a = 1;
+a = a + 2 * 3 - 4 / 5;
+print a;
+)",
+                  60u);
+
+  WORK_BOUND_TEST("string concat", R"(
+var s = "hello";
+s = s + " " + "world";
+print s;
+)",
+                  90u);
+}
+
+} // namespace lox
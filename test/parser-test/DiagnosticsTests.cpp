@@ -0,0 +1,160 @@
+#include "ParserTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/parser/Diagnostics.hpp"
+#include "llvm/Support/JSON.h"
+
+namespace lox {
+
+TEST_CASE("Diagnostics test" * doctest::test_suite("Parser tests")) {
+  const StringRef code = "var a = 1 $ 2;\nprint @;\nprint (1;\n";
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  const auto at = [&](const std::size_t offset) {
+    return SMLoc::getFromPointer(code.data() + offset);
+  };
+
+  SUBCASE("printed like SourceMgr::PrintMessage") {
+    std::string expected, diag;
+    raw_string_ostream expectedOS(expected), diagOS(diag);
+    srcMgr.PrintMessage(expectedOS, at(10), SourceMgr::DK_Error,
+                        "Unhandled Token : $");
+    srcMgr.PrintMessage(expectedOS, at(21), SourceMgr::DK_Error,
+                        "Unexpected token. expected identifier, got at");
+
+    DiagnosticEngine engine(srcMgr, diagOS);
+    engine.report(Diag_unhandled_token, at(10), StringRef("$"));
+    engine.report(Diag_unexpected_token, at(21), {"identifier", "at"});
+    CHECK_EQ(diagOS.str(), expectedOS.str());
+    CHECK_EQ(engine.getErrorCount(), 2u);
+    CHECK_EQ(engine.getErrorCount(DiagCategory::Lexer), 1u);
+    CHECK_EQ(engine.getErrorCount(DiagCategory::Parser), 1u);
+  }
+
+  SUBCASE("limits are per category") {
+    std::string diag;
+    raw_string_ostream diagOS(diag);
+    DiagnosticOptions options;
+    options.MaxPerCategory = 2u;
+    DiagnosticEngine engine(srcMgr, diagOS, options);
+    for (auto i = 0u; i < 5u; ++i)
+      engine.report(Diag_unhandled_token, at(10), StringRef("$"));
+    engine.report(Diag_expect_semicolon, at(24));
+    CHECK_EQ(engine.getErrorCount(), 6u);
+    CHECK_EQ(engine.getSuppressedCount(DiagCategory::Lexer), 3u);
+    CHECK_EQ(engine.getSuppressedCount(DiagCategory::Parser), 0u);
+    CHECK_EQ(engine.getDiagnostics().size(), 0u);
+
+    const auto printed = diagOS.str().size();
+    engine.flush();
+    CHECK(StringRef(diagOS.str())
+              .endswith("note: 3 more lexer errors suppressed (limit : 2)\n"));
+    // Summarized once.
+    const auto flushed = diagOS.str().size();
+    CHECK_GT(flushed, printed);
+    engine.flush();
+    CHECK_EQ(diagOS.str().size(), flushed);
+  }
+
+  SUBCASE("deferred until flushed") {
+    std::string diag;
+    raw_string_ostream diagOS(diag);
+    DiagnosticOptions options;
+    options.Deferred = true;
+    DiagnosticEngine engine(srcMgr, diagOS, options);
+    {
+      // The arguments are copied.
+      std::string arg = "$";
+      engine.report(Diag_unhandled_token, at(10), StringRef(arg));
+      arg = "#";
+    }
+    engine.report(Diag_expect_semicolon, at(24));
+    CHECK(diagOS.str().empty());
+    REQUIRE_EQ(engine.getDiagnostics().size(), 2u);
+    CHECK_EQ(engine.getMessage(engine.getDiagnostics()[0]),
+             "Unhandled Token : $");
+
+    engine.flush();
+    const StringRef printed = diagOS.str();
+    CHECK_LT(printed.find("Unhandled Token : $"),
+             printed.find("Expect `;` after value."));
+  }
+
+  SUBCASE("JSON") {
+    std::string json;
+    raw_string_ostream jsonOS(json);
+    DiagnosticOptions options;
+    options.MaxPerCategory = 1u;
+    options.Deferred = true;
+    DiagnosticEngine engine(srcMgr, nulls(), options);
+    engine.report(Diag_unhandled_token, at(10), StringRef("$"));
+    engine.report(Diag_unhandled_token, at(21), StringRef("@"));
+    engine.report(Diag_expect_rparen, at(32), {"rparen", "semicolon"});
+    engine.printJSON(jsonOS);
+
+    auto parsed = json::parse(jsonOS.str());
+    REQUIRE(static_cast<bool>(parsed));
+    const auto *root = parsed->getAsObject();
+    REQUIRE(root);
+    CHECK_EQ(root->getInteger("errors").getValueOr(-1), 3);
+    const auto *suppressed = root->getObject("suppressed");
+    REQUIRE(suppressed);
+    CHECK_EQ(suppressed->getInteger("lexer").getValueOr(-1), 1);
+    CHECK_EQ(suppressed->getInteger("parser").getValueOr(-1), 0);
+
+    const auto *diagnostics = root->getArray("diagnostics");
+    REQUIRE(diagnostics);
+    REQUIRE_EQ(diagnostics->size(), 2u);
+    const auto *lexerDiag = (*diagnostics)[0].getAsObject();
+    REQUIRE(lexerDiag);
+    CHECK_EQ(lexerDiag->getString("category"), StringRef("lexer"));
+    CHECK_EQ(lexerDiag->getString("code"), StringRef("unhandled_token"));
+    CHECK_EQ(lexerDiag->getString("file"), StringRef("source"));
+    CHECK_EQ(lexerDiag->getInteger("line").getValueOr(-1), 1);
+    CHECK_EQ(lexerDiag->getInteger("column").getValueOr(-1), 11);
+    CHECK_EQ(lexerDiag->getInteger("offset").getValueOr(-1), 10);
+    CHECK_EQ(lexerDiag->getString("message"),
+             StringRef("Unhandled Token : $"));
+
+    const auto *parserDiag = (*diagnostics)[1].getAsObject();
+    REQUIRE(parserDiag);
+    CHECK_EQ(parserDiag->getInteger("line").getValueOr(-1), 3);
+    CHECK_EQ(parserDiag->getInteger("column").getValueOr(-1), 9);
+    const auto *args = parserDiag->getArray("args");
+    REQUIRE(args);
+    REQUIRE_EQ(args->size(), 2u);
+    CHECK_EQ((*args)[1].getAsString(), StringRef("semicolon"));
+  }
+
+  SUBCASE("lexer and parser share an engine") {
+    std::string expected, diag;
+    raw_string_ostream expectedOS(expected), diagOS(diag);
+    Lexer expectedLexer(srcMgr, code);
+    expectedLexer.setDiagnosticStream(expectedOS);
+    expectedLexer.Lex();
+    Parser expectedParser(expectedLexer.getTokens(), srcMgr);
+    expectedParser.setDiagnosticStream(expectedOS);
+    (void)expectedParser.Parse();
+
+    DiagnosticEngine engine(srcMgr, diagOS);
+    Lexer lexer(srcMgr, code);
+    lexer.setDiagnosticEngine(engine);
+    CHECK_FALSE(lexer.Lex());
+    Parser parser(lexer.getTokens(), srcMgr);
+    parser.setDiagnosticEngine(engine);
+    (void)parser.Parse();
+
+    CHECK_EQ(diagOS.str(), expectedOS.str());
+    CHECK_EQ(lexer.getError(), expectedLexer.getError());
+    CHECK_EQ(parser.getError(), expectedParser.getError());
+    CHECK_EQ(engine.getErrorCount(DiagCategory::Lexer), lexer.getError());
+    CHECK_EQ(engine.getErrorCount(),
+             lexer.getError() + parser.getError());
+
+    // Counts carry over when a component switches streams or engines.
+    const auto errors = parser.getError();
+    parser.setDiagnosticStream(nulls());
+    CHECK_EQ(parser.getError(), errors);
+  }
+}
+
+} // namespace lox
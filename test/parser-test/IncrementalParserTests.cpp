@@ -0,0 +1,158 @@
+#include "ParserTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/parser/IncrementalParser.hpp"
+#include "llvm/Support/FormatVariadic.h"
+#include <random>
+
+namespace lox {
+
+static std::string printStatements(ArrayRef<const Stmt *> statements) {
+  std::string result;
+  StmtPrinter printer(result);
+  for (const auto *stmt : statements) {
+    std::visit(printer, *stmt);
+    result += '\n';
+  }
+  return result;
+}
+
+static std::string printDocument(const IncrementalDocument &document) {
+  SmallVector<const Stmt *> statements;
+  document.getStatements(statements);
+  return printStatements(statements);
+}
+
+/// The statements and error count the batch front end gets for `code`.
+static std::pair<std::string, std::size_t> parseBatch(const StringRef code) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  std::string diag;
+  raw_string_ostream diagOS(diag);
+  Lexer lexer(srcMgr, code);
+  lexer.setDiagnosticStream(diagOS);
+  if (!lexer.Lex())
+    return {"", lexer.getError()};
+  Parser parser(lexer.getTokens(), srcMgr);
+  parser.setDiagnosticStream(diagOS);
+  const auto program = parser.Parse();
+  SmallVector<const Stmt *> statements;
+  for (const auto &stmt : program)
+    if (stmt)
+      statements.push_back(stmt.get());
+  return {printStatements(statements), parser.getError()};
+}
+
+/// Checks `document` against parsing its text from scratch.
+static void checkAgainstFullParse(const IncrementalDocument &document) {
+  const auto text = document.getText();
+  CHECK_EQ(document.size(), text.size());
+
+  const IncrementalDocument fresh(text);
+  CHECK_EQ(printDocument(document), printDocument(fresh));
+  CHECK_EQ(document.getErrorCount(), fresh.getErrorCount());
+  const auto diags = document.getDiagnostics();
+  const auto freshDiags = fresh.getDiagnostics();
+  REQUIRE_EQ(diags.size(), freshDiags.size());
+  for (std::size_t i = 0u; i < diags.size(); ++i) {
+    CHECK_EQ(diags[i].Offset, freshDiags[i].Offset);
+    CHECK_EQ(diags[i].Message, freshDiags[i].Message);
+  }
+
+  if (!document.getErrorCount()) {
+    const auto [statements, errors] = parseBatch(text);
+    CHECK_EQ(errors, 0u);
+    CHECK_EQ(printDocument(document), statements);
+  }
+}
+
+TEST_CASE("Incremental parser test" * doctest::test_suite("Parser tests")) {
+  SUBCASE("same tree as the batch parser") {
+    const StringRef code = R"(var a = 1;
+// comment; with a semicolon
+var s = "a;b";
+print a + 2 * (3 - -a);
+a = s;
+)";
+    const IncrementalDocument document(code);
+    CHECK_EQ(document.getErrorCount(), 0u);
+    CHECK_EQ(document.getSegmentCount(), 4u);
+    CHECK_EQ(printDocument(document), parseBatch(code).first);
+  }
+
+  SUBCASE("untouched statements are reused") {
+    std::string code;
+    for (auto i = 0u; i < 1000u; ++i)
+      code += formatv("var v{0} = {0} + 1;\n", i).str();
+    IncrementalDocument document(code);
+
+    SmallVector<const Stmt *> before, after;
+    document.getStatements(before);
+    REQUIRE_EQ(before.size(), 1000u);
+
+    const auto offset = code.find("v500 = 500") + 7u;
+    const auto stats = document.edit({offset, 3u, "42 * 2"});
+    CHECK_EQ(stats.ReparsedSegments, 1u);
+    CHECK_EQ(stats.ReusedSegments, 999u);
+    CHECK_LT(stats.RelexedBytes, 32u);
+
+    document.getStatements(after);
+    REQUIRE_EQ(after.size(), 1000u);
+    for (std::size_t i = 0u; i < after.size(); ++i)
+      if (i != 500u)
+        CHECK_EQ(after[i], before[i]);
+    CHECK_NE(after[500], before[500]);
+    CHECK_EQ(document.getOffset(std::get<VarStmt>(*after[500]).getLoc()),
+             code.find("var v500"));
+    checkAgainstFullParse(document);
+  }
+
+  SUBCASE("edits across declaration boundaries") {
+    IncrementalDocument document("var a = 1;\nvar b = 2;\nprint a;\n");
+
+    // Removing a `;` merges two declarations.
+    document.edit({9u, 1u, ""});
+    CHECK_EQ(document.getErrorCount(), 1u);
+    checkAgainstFullParse(document);
+    document.edit({9u, 0u, ";"});
+    CHECK_EQ(document.getErrorCount(), 0u);
+    checkAgainstFullParse(document);
+
+    // An open string runs to the end.
+    document.edit({8u, 0u, "\""});
+    CHECK_EQ(document.getErrorCount(), 1u);
+    checkAgainstFullParse(document);
+    document.edit({8u, 1u, ""});
+    CHECK_EQ(document.getErrorCount(), 0u);
+
+    // A comment without its line break swallows the next declaration.
+    document.edit({10u, 1u, " //"});
+    checkAgainstFullParse(document);
+    CHECK_EQ(document.getText(), "var a = 1; //var b = 2;\nprint a;\n");
+
+    document.edit({0u, document.size(), ""});
+    CHECK_EQ(document.size(), 0u);
+    CHECK_EQ(document.getErrorCount(), 0u);
+    document.edit({0u, 0u, "print 1;"});
+    CHECK_EQ(printDocument(document), parseBatch("print 1;").first);
+  }
+
+  SUBCASE("random edits match a full parse") {
+    const StringRef pieces[] = {";",   "\"",  "//",  "\n", " ",  "var ",
+                                "x",   "= ",  "1",   "+",  "(",  ")",
+                                "print ", "y;", "@", "a = b;\n"};
+    std::mt19937 random(7u);
+    IncrementalDocument document(
+        "var x = 1;\nvar y = x + 2;\nprint x * y;\nx = y;\n// end\n");
+    for (auto i = 0u; i < 500u; ++i) {
+      const auto offset = random() % (document.size() + 1u);
+      const auto removed = random() % 4u;
+      std::string inserted;
+      for (auto n = random() % 3u; n; --n)
+        inserted += pieces[random() % std::size(pieces)];
+      document.edit({offset, removed, inserted});
+      checkAgainstFullParse(document);
+    }
+  }
+}
+
+} // namespace lox
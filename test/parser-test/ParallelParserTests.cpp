@@ -0,0 +1,91 @@
+#include "ParserTestUtils.hpp"
+#include "doctest/doctest.h"
+#include "lox/parser/ParallelParser.hpp"
+
+namespace lox {
+
+inline bool runParallelParseTest(const StringRef code,
+                                 std::size_t *misspeculations = nullptr) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+
+  std::string expectedDiag;
+  raw_string_ostream expectedDiagOS(expectedDiag);
+  Lexer lexer(srcMgr, code);
+  lexer.setDiagnosticStream(expectedDiagOS);
+  lexer.Lex();
+  Parser parser(lexer.getTokens(), srcMgr);
+  parser.setDiagnosticStream(expectedDiagOS);
+  const auto program = parser.Parse();
+
+  ParallelParseOptions options;
+  options.Threads = 4u;
+  options.MinChunkSize = 16u;
+  std::string diag;
+  raw_string_ostream diagOS(diag);
+  const auto parsed = parseParallel(srcMgr, code, options, diagOS);
+  if (misspeculations)
+    *misspeculations = parsed.Misspeculations;
+
+  CHECK_GT(parsed.Chunks, 1u);
+  CHECK_EQ(diag, expectedDiag);
+  CHECK_EQ(parsed.ParseErrors, parser.getError());
+
+  const auto tokens = lexer.getTokens();
+  REQUIRE_EQ(parsed.Tokens.size(), tokens.size());
+  for (std::size_t i = 0u; i < tokens.size(); ++i) {
+    CHECK_EQ(parsed.Tokens[i]->Index, tokens[i]->Index);
+    CHECK_EQ(parsed.Tokens[i]->Kind, tokens[i]->Kind);
+    CHECK_EQ(parsed.Tokens[i]->Loc.getPointer(), tokens[i]->Loc.getPointer());
+  }
+
+  std::string expected, result;
+  StmtPrinter expectedPrinter(expected), printer(result);
+  REQUIRE_EQ(parsed.Statements.size(), program.size());
+  for (std::size_t i = 0u; i < program.size(); ++i) {
+    REQUIRE_EQ(!parsed.Statements[i], !program[i]);
+    if (!program[i])
+      continue;
+    std::visit(expectedPrinter, *program[i]);
+    std::visit(printer, *parsed.Statements[i]);
+  }
+  CHECK_EQ(result, expected);
+  return result == expected && diag == expectedDiag;
+}
+
+TEST_CASE("Parallel parse test" * doctest::test_suite("Parser tests")) {
+  SUBCASE("independent statements") {
+    std::string code;
+    for (auto i = 0u; i < 200u; ++i)
+      code += "var a" + std::to_string(i) + " = " + std::to_string(i) +
+              " * 2;\nprint a" + std::to_string(i) + " + 1;\n";
+    std::size_t misspeculations = 0u;
+    CHECK(runParallelParseTest(code, &misspeculations));
+    CHECK_EQ(misspeculations, 0u);
+  }
+
+  SUBCASE("boundaries inside strings, comments and statements") {
+    std::string code;
+    for (auto i = 0u; i < 50u; ++i)
+      code += R"(print "multi;
+line;
+string";
+// comment;
+var x = 1 +
+  2;
+print x; // trailing;
+)";
+    std::size_t misspeculations = 0u;
+    CHECK(runParallelParseTest(code, &misspeculations));
+    CHECK_GT(misspeculations, 0u);
+  }
+
+  SUBCASE("syntax errors") {
+    std::string code;
+    for (auto i = 0u; i < 50u; ++i)
+      code += "print (1;\n2);\nvar = 3;\nprint 4;\n";
+    CHECK(runParallelParseTest(code));
+  }
+}
+
+} // namespace lox
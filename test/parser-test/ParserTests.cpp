@@ -50,11 +50,41 @@ TEST_CASE("Parse expr test") {
 )",
       R"(((((1 + (2 * 3)) + ((4 / 5) / ((6 - 8)))) - (-9)) + !10))");
 
+  EXPR_PARSE_TEST("every precedence level", R"(
+a = b = 1 < 2 == -3 * 4 + 5 >= 6 != !7
+)",
+                  R"((a = (b = (((1 < 2) == (((-3 * 4) + 5) >= 6)) != !7))))");
+
+  EXPR_PARSE_TEST("only a variable is assigned", R"(
+a + b = c
+)",
+                  R"((a + b))");
+
   EXPR_PARSE_TEST("string add", R"(
 "abcde" + "fgh"
 )",
                   R"(("abcde" + "fgh"))");
 
+  EXPR_PARSE_TEST("array literal", R"(
+[1, -2, [3]]
+)",
+                  R"([1, -2, [3]])");
+
+  EXPR_PARSE_TEST("index binds tighter than unary", R"(
+-a[1][i + 1] * [][0]
+)",
+                  R"((-a[1][(i + 1)] * [][0]))");
+
+  EXPR_PARSE_TEST("builtin call", R"(
+sum(a * 2) + slice(range(10), 1, len([]))[0]
+)",
+                  R"((sum((a * 2)) + slice(range(10), 1, len([]))[0]))");
+
+  EXPR_PARSE_TEST("map literal", R"(
+{a: 1, "b": [2], 3: {}}["b"]
+)",
+                  R"({a: 1, "b": [2], 3: {}}["b"])");
+
   PROGRAM_PARSE_TEST("print", R"(
 print "ABCDE";
 )",
@@ -81,4 +111,109 @@ print a;
 )");
 }
 
-} // namespace lox
\ No newline at end of file
+static std::size_t parseErrors(const std::string &code,
+                               const unsigned maxDepth) {
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  Lexer lexer(srcMgr, code);
+  REQUIRE(lexer.Lex());
+  Parser parser(lexer.getTokens(), srcMgr);
+  parser.setDiagnosticStream(nulls());
+  parser.setMaxDepth(maxDepth);
+  const auto program = parser.Parse();
+  return parser.getError();
+}
+
+TEST_CASE("Nesting depth test") {
+  const auto repeat = [](const StringRef text, const unsigned count) {
+    std::string result;
+    for (auto i = 0u; i < count; ++i)
+      result += text;
+    return result;
+  };
+
+  SUBCASE("nested expressions up to the limit") {
+    // 10 levels each.
+    const auto groups = "print " + repeat("(", 9u) + "1" + repeat(")", 9u) +
+                        ";";
+    const auto negations = "print " + repeat("-", 9u) + "1;";
+    const auto assignments = "var a;\n" + repeat("a = ", 9u) + "1;";
+    const auto chain = "print 1" + repeat(" + 1", 9u) + ";";
+    for (const auto &code : {groups, negations, assignments, chain}) {
+      CHECK_EQ(parseErrors(code, 10u), 0u);
+      CHECK_EQ(parseErrors(code, 9u), 1u);
+    }
+    // Precedence levels don't count, only the tree.
+    CHECK_EQ(parseErrors("print 1 * 2 + 3 < 4 == true;", 5u), 0u);
+  }
+
+  SUBCASE("adversarial nesting is an error, not a crash") {
+    const auto depth = 100000u;
+    CHECK_EQ(parseErrors("print " + repeat("(", depth) + "1" +
+                             repeat(")", depth) + ";\nprint 2;",
+                         Parser::DefaultMaxDepth),
+             1u);
+    CHECK_EQ(parseErrors("print " + repeat("!", depth) + "true;",
+                         Parser::DefaultMaxDepth),
+             1u);
+    CHECK_EQ(parseErrors("print 1" + repeat(" + 1", depth) + ";",
+                         Parser::DefaultMaxDepth),
+             1u);
+  }
+}
+
+TEST_CASE("Array syntax test") {
+  const auto depth = Parser::DefaultMaxDepth;
+  CHECK_EQ(parseErrors("print [1, 2][0] + len(range(3));", depth), 0u);
+  CHECK_EQ(parseErrors("print [];\nprint sort([]);", depth), 0u);
+  // Unknown functions and wrong arities are found before running.
+  CHECK_EQ(parseErrors("print foo(1);", depth), 1u);
+  CHECK_EQ(parseErrors("print len(1, 2);\nprint sum();", depth), 2u);
+  // Arrays are immutable.
+  CHECK_EQ(parseErrors("var a = [1];\na[0] = 2;", depth), 1u);
+  CHECK_EQ(parseErrors("print [1, 2;", depth), 1u);
+  CHECK_EQ(parseErrors("print a[1;", depth), 1u);
+  // Indexing nests like any operator.
+  CHECK_EQ(parseErrors("print a[0][0][0];", 4u), 0u);
+  CHECK_EQ(parseErrors("print a[0][0][0];", 3u), 1u);
+}
+
+TEST_CASE("Map syntax test") {
+  const auto depth = Parser::DefaultMaxDepth;
+  CHECK_EQ(parseErrors("print {};\nprint {1: {2: 3}}[1];", depth), 0u);
+  CHECK_EQ(parseErrors("print get(set({}, 1, 2), 1);", depth), 0u);
+  CHECK_EQ(parseErrors("print {1};", depth), 1u);
+  CHECK_EQ(parseErrors("print {1: 2,};", depth), 1u);
+  CHECK_EQ(parseErrors("print {1: 2;", depth), 1u);
+  // Maps are immutable like arrays.
+  CHECK_EQ(parseErrors("var m = {};\nm[1] = 2;", depth), 1u);
+  CHECK_EQ(parseErrors("print has({});", depth), 1u);
+}
+
+TEST_CASE("Streaming parse test") {
+  const StringRef code = R"(
+var a = 10;
+print a + 1;
+a = a * 2;
+)";
+  SourceMgr srcMgr;
+  srcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(code, "source"), {});
+  Lexer lexer(srcMgr, code);
+  Parser parser(lexer, srcMgr);
+
+  std::string result;
+  StmtPrinter stmtPrinter(result);
+  std::size_t maxTokens = 0u;
+  while (!parser.isAtEnd()) {
+    auto stmt = parser.Declaration();
+    REQUIRE(stmt);
+    std::visit(stmtPrinter, *stmt);
+    maxTokens = std::max(maxTokens, parser.ReleaseTokens().size());
+  }
+
+  CHECK_EQ(parser.getError(), 0u);
+  CHECK_EQ(result, "var a = 10;\nprint (a + 1);\n(a = (a * 2));\n");
+  CHECK_EQ(maxTokens, 6u);
+}
+
+} // namespace lox